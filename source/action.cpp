@@ -250,6 +250,8 @@ void Action::commit(DirtyList* dirty_list) {
 				if (whathouse) {
 					Position oldpos = whathouse->getExit();
 					whathouse->setExit(p->second);
+					editor.map.touchTile(oldpos);
+					editor.map.touchTile(p->second);
 					p->second = oldpos;
 				}
 				break;
@@ -277,6 +279,8 @@ void Action::commit(DirtyList* dirty_list) {
 					// Update shit
 					Position oldpos = wp->pos;
 					wp->pos = p->second;
+					editor.map.touchTile(oldpos);
+					editor.map.touchTile(wp->pos);
 					p->second = oldpos;
 				}
 				break;
@@ -377,6 +381,8 @@ void Action::undo(DirtyList* dirty_list) {
 				if (whathouse) {
 					Position oldpos = whathouse->getExit();
 					whathouse->setExit(p->second);
+					editor.map.touchTile(oldpos);
+					editor.map.touchTile(p->second);
 					p->second = oldpos;
 				}
 				break;
@@ -406,6 +412,8 @@ void Action::undo(DirtyList* dirty_list) {
 					// Update shit
 					Position oldpos = wp->pos;
 					wp->pos = p->second;
+					editor.map.touchTile(oldpos);
+					editor.map.touchTile(wp->pos);
 					p->second = oldpos;
 				}
 				break;
@@ -599,7 +607,7 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay) {
 		batch->commit();
 
 		// Update title
-		if (editor.map.doChange()) {
+		if (editor.map.doTrackedChange()) {
 			// Use a safer version that doesn't trigger UI updates
 			// during the first drawing operation
 			static bool isFirstOperation = true;
@@ -715,6 +723,7 @@ void ActionQueue::clear() {
 		it = actions.erase(it);
 	}
 	current = 0;
+	memory_size = 0;
 }
 
 DirtyList::DirtyList() :
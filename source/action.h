@@ -224,6 +224,14 @@ public:
 		return current < actions.size();
 	}
 
+	// Bytes held by the undo history, as counted against the undo memory limit
+	size_t memsize() const {
+		return memory_size;
+	}
+	size_t size() const {
+		return actions.size();
+	}
+
 protected:
 	size_t current;
 	size_t memory_size;
@@ -33,11 +33,15 @@
 
 #include "materials.h"
 #include "map.h"
+#include "iomap_otbm.h"
 #include "complexitem.h"
 #include "creature.h"
 
 // Add exception handling includes
+#include <chrono>
 #include <exception>
+#include <limits>
+#include <random>
 #include <fstream>
 #include <wx/datetime.h>
 #include <wx/filename.h>
@@ -146,7 +150,7 @@ bool Application::OnInit() {
 	m_file_to_open = wxEmptyString;
 	ParseCommandLineMap(m_file_to_open);
 	
-	if (g_settings.getInteger(Config::ONLY_ONE_INSTANCE) && m_single_instance_checker->IsAnotherRunning()) {
+	if (!IsCommandLineRun() && g_settings.getInteger(Config::ONLY_ONE_INSTANCE) && m_single_instance_checker->IsAnotherRunning()) {
 		RMEProcessClient client;
 		wxConnectionBase* connection = client.MakeConnection("localhost", "rme_host", "rme_talk");
 		if (connection) {
@@ -162,7 +166,7 @@ bool Application::OnInit() {
 	}
 	// We act as server then
 	m_proc_server = newd RMEProcessServer();
-	if (!m_proc_server->Create("rme_host")) {
+	if (!IsCommandLineRun() && !m_proc_server->Create("rme_host")) {
 		wxLogWarning("Could not register IPC service!");
 	}
 #endif
@@ -208,6 +212,12 @@ bool Application::OnInit() {
 	icon.CopyFromBitmap(iconBitmap);
 	g_gui.root->SetIcon(icon);
 
+	if (IsCommandLineRun()) {
+		// The check runs once the event loop is entered, the window stays hidden
+		m_startup = true;
+		return true;
+	}
+
 	// Create a unique log directory for this session
 	wxDateTime now = wxDateTime::Now();
 	wxString logDir = wxStandardPaths::Get().GetUserDataDir() + wxFileName::GetPathSeparator() + 
@@ -278,6 +288,17 @@ void Application::OnEventLoopEnter(wxEventLoopBase* loop) {
 	}
 	m_startup = false;
 
+	if (!m_verify_parallel_save.empty()) {
+		m_exit_code = VerifyParallelSave(m_verify_parallel_save) ? 0 : 1;
+		g_gui.root->Close(true);
+		return;
+	}
+	if (!m_benchmark_tile_lookup.empty()) {
+		m_exit_code = BenchmarkTileLookup(m_benchmark_tile_lookup) ? 0 : 1;
+		g_gui.root->Close(true);
+		return;
+	}
+
 	// Don't try to create a map if we didn't load the client map.
 	if (ClientVersion::getLatestVersion() == nullptr) {
 		return;
@@ -349,6 +370,11 @@ void Application::Unload() {
 	g_gui.root = nullptr;
 }
 
+int Application::OnRun() {
+	const int code = wxApp::OnRun();
+	return m_exit_code != 0 ? m_exit_code : code;
+}
+
 int Application::OnExit() {
 #ifdef _USE_PROCESS_COM
 	wxDELETE(m_proc_server);
@@ -402,11 +428,149 @@ bool Application::ParseCommandLineMap(wxString& fileName) {
 		} else if (argv[1] == "-multi-instance") {
 			// Allow forcing multiple instances via command line
 			g_settings.setInteger(Config::ONLY_ONE_INSTANCE, argv[2] == "1" ? 0 : 1);
+		} else if (argv[1] == "-verify-parallel-save") {
+			m_verify_parallel_save = wxString(argv[2]);
+		} else if (argv[1] == "-benchmark-tile-lookup") {
+			m_benchmark_tile_lookup = wxString(argv[2]);
 		}
 	}
 	return false;
 }
 
+bool Application::VerifyParallelSave(const wxString& fileName) {
+	std::unique_ptr<Editor> editor;
+	try {
+		editor.reset(newd Editor(g_gui.copybuffer, FileName(fileName)));
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+
+	Map& map = editor->map;
+	// Always run at least two workers, a single one takes the serial path as well
+	const int worker_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 2);
+	IOMapOTBM io(map.getVersion());
+	std::string report;
+	const bool identical = io.verifyParallelSave(map, worker_count, report);
+	std::cout << report;
+	return identical;
+}
+
+namespace {
+	struct LookupTimes {
+		double random_ms;
+		double sequential_ms;
+		uint64_t found;
+	};
+
+	// Best of a few rounds, so a single stall doesn't decide the result
+	LookupTimes TimeTileLookups(BaseMap& map, const std::vector<Position>& positions, int width, int height) {
+		typedef std::chrono::steady_clock Clock;
+		auto elapsed_ms = [](Clock::time_point from, Clock::time_point to) {
+			return std::chrono::duration<double, std::milli>(to - from).count();
+		};
+
+		LookupTimes best = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), 0 };
+		for (int round = 0; round < 5; ++round) {
+			uint64_t found = 0;
+			const Clock::time_point start = Clock::now();
+			for (const Position& pos : positions) {
+				if (map.getTile(pos.x, pos.y, pos.z)) {
+					++found;
+				}
+			}
+			const Clock::time_point middle = Clock::now();
+			for (int z = GROUND_LAYER; z <= GROUND_LAYER + 1; ++z) {
+				for (int y = 0; y < height; ++y) {
+					for (int x = 0; x < width; ++x) {
+						if (map.getTile(x, y, z)) {
+							++found;
+						}
+					}
+				}
+			}
+			const Clock::time_point end = Clock::now();
+
+			best.random_ms = std::min(best.random_ms, elapsed_ms(start, middle));
+			best.sequential_ms = std::min(best.sequential_ms, elapsed_ms(middle, end));
+			best.found = found;
+		}
+		return best;
+	}
+}
+
+bool Application::BenchmarkTileLookup(const wxString& fileName) {
+	const int random_lookups = 4000000;
+	const bool contiguous_setting = g_settings.getBoolean(Config::CONTIGUOUS_TILE_STORAGE);
+
+	std::vector<Position> positions;
+	int width = 1;
+	int height = 1;
+	LookupTimes tree, index, contiguous;
+	size_t tree_bytes = 0, contiguous_bytes = 0;
+
+	// The tree and the chunk index are timed on one load of the map, contiguous storage needs a load of its own
+	for (int pass = 0; pass < 2; ++pass) {
+		g_settings.setInteger(Config::CONTIGUOUS_TILE_STORAGE, pass == 1);
+		std::unique_ptr<Editor> editor;
+		try {
+			editor.reset(newd Editor(g_gui.copybuffer, FileName(fileName)));
+		} catch (std::runtime_error& e) {
+			std::cerr << e.what() << std::endl;
+			g_settings.setInteger(Config::CONTIGUOUS_TILE_STORAGE, contiguous_setting);
+			return false;
+		}
+
+		Map& map = editor->map;
+		map.setChunkIndexEnabled(false);
+		if (pass == 0) {
+			width = std::max<int>(map.getWidth(), 1);
+			height = std::max<int>(map.getHeight(), 1);
+
+			// Fixed seed, every run on the same map looks up the same positions
+			std::mt19937 generator(5489u);
+			std::uniform_int_distribution<int> random_x(0, width - 1);
+			std::uniform_int_distribution<int> random_y(0, height - 1);
+			std::uniform_int_distribution<int> random_z(GROUND_LAYER, GROUND_LAYER + 1);
+			positions.reserve(random_lookups);
+			for (int i = 0; i < random_lookups; ++i) {
+				const int x = random_x(generator);
+				const int y = random_y(generator);
+				positions.emplace_back(x, y, random_z(generator));
+			}
+
+			tree = TimeTileLookups(map, positions, width, height);
+			tree_bytes = map.allocator.getFloorStats().reserved_bytes + map.allocator.getNodeStats().reserved_bytes;
+			map.setChunkIndexEnabled(true);
+			index = TimeTileLookups(map, positions, width, height);
+		} else {
+			contiguous = TimeTileLookups(map, positions, width, height);
+			contiguous_bytes = map.allocator.getFloorStats().reserved_bytes + map.allocator.getNodeStats().reserved_bytes;
+		}
+	}
+	g_settings.setInteger(Config::CONTIGUOUS_TILE_STORAGE, contiguous_setting);
+
+	const int64_t sequential_lookups = int64_t(width) * height * 2; // Ground floor and the one below
+	auto print = [&](const char* name, const LookupTimes& times) {
+		std::cout << "\t" << name << ": random " << times.random_ms << " ms, sequential " << times.sequential_ms << " ms\n";
+	};
+
+	std::cout.setf(std::ios::fixed, std::ios::floatfield);
+	std::cout.precision(2);
+	std::cout << "Tile lookup benchmark for " << nstr(fileName) << " (" << random_lookups << " random, " << sequential_lookups << " sequential lookups, best of 5)\n";
+	print("Map tree", tree);
+	print("Chunk index", index);
+	print("Contiguous storage", contiguous);
+	std::cout << "\tTree structure: " << (tree_bytes / 1024) << " KB, with contiguous storage: " << (contiguous_bytes / 1024) << " KB\n";
+
+	if (tree.found != index.found || tree.found != contiguous.found) {
+		std::cout << "The backends disagree (" << tree.found << ", " << index.found << ", " << contiguous.found << " tiles found)" << std::endl;
+		return false;
+	}
+	std::cout.flush();
+	return true;
+}
+
 MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size) :
 	wxFrame((wxFrame*)nullptr, -1, title, pos, size, wxDEFAULT_FRAME_STYLE) {
 	// Receive idle events
@@ -708,10 +872,11 @@ void MainFrame::OnExit(wxCloseEvent& event) {
 		}
 	}
 	g_gui.aui_manager->UnInit();
-	((Application&)wxGetApp()).Unload();
+	Application& app = (Application&)wxGetApp();
+	app.Unload();
 #ifdef __RELEASE__
 	// Hack, "crash" gracefully in release builds, let OS handle cleanup of windows
-	exit(0);
+	exit(app.GetExitCode());
 #endif
 	Destroy();
 }
@@ -41,15 +41,31 @@ public:
 	virtual bool OnInit();
 	virtual void OnEventLoopEnter(wxEventLoopBase* loop);
 	virtual void MacOpenFiles(const wxArrayString& fileNames);
+	virtual int OnRun();
 	virtual int OnExit();
 	virtual bool OnExceptionInMainLoop();
 	void Unload();
 
+	int GetExitCode() const {
+		return m_exit_code;
+	}
+
 private:
 	bool m_startup;
 	wxString m_file_to_open;
+	wxString m_verify_parallel_save; // Map given with -verify-parallel-save, checked instead of opened
+	wxString m_benchmark_tile_lookup; // Map given with -benchmark-tile-lookup
+	int m_exit_code = 0;
 	void FixVersionDiscrapencies();
 	bool ParseCommandLineMap(wxString& fileName);
+	// Loads the map without showing it and compares its serial and parallel encoding, prints the result
+	bool VerifyParallelSave(const wxString& fileName);
+	// Times tile lookups on the map tree, the chunk index and contiguous storage, prints the result
+	bool BenchmarkTileLookup(const wxString& fileName);
+	// Set by switches that run a single check without showing the editor
+	bool IsCommandLineRun() const {
+		return !m_verify_parallel_save.empty() || !m_benchmark_tile_lookup.empty();
+	}
 
 	virtual void OnFatalException();
 
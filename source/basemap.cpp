@@ -19,26 +19,81 @@
 
 #include "tile.h"
 #include "basemap.h"
+#include "map_snapshot.h"
 
 BaseMap::BaseMap() :
 	allocator(),
 	tilecount(0),
-	root(*this) {
+	root(*this),
+	snapshot(nullptr) {
 	////
 }
 
 BaseMap::~BaseMap() {
-	////
+	releaseTree();
 }
 
 void BaseMap::clear(bool del) {
+	waitForSnapshot();
+	if (del) {
+		// The tiles go with the tree, none of the per-tile bookkeeping of setTile is needed
+		releaseTree();
+		tilecount = 0;
+		if (chunk_index) {
+			chunk_index->clear();
+		}
+		occupancy.clear();
+		generations.clear();
+		return;
+	}
+
 	PositionVector pos_vec;
 	for (MapIterator map_iter = begin(); map_iter != end(); ++map_iter) {
 		Tile* t = (*map_iter)->get();
 		pos_vec.push_back(t->getPosition());
 	}
 	for (PositionVector::iterator pos_iter = pos_vec.begin(); pos_iter != pos_vec.end(); ++pos_iter) {
-		setTile(*pos_iter, nullptr, del);
+		setTile(*pos_iter, nullptr, false);
+	}
+}
+
+void BaseMap::releaseTree() {
+	// Only the tiles need their destructors, the nodes and floors are dropped with their slabs
+	root.releaseTiles();
+	for (int i = 0; i < MAP_LAYERS; ++i) {
+		root.child[i] = nullptr;
+	}
+	allocator.discard();
+}
+
+void BaseMap::setChunkIndexEnabled(bool enabled) {
+	if (enabled == isChunkIndexEnabled()) {
+		return;
+	}
+
+	if (enabled) {
+		chunk_index = std::make_unique<MapChunkIndex>();
+		chunk_index->insertTree(&root, 0, 0, 14);
+	} else {
+		chunk_index.reset();
+	}
+}
+
+bool BaseMap::setContiguousStorage(bool enabled) {
+	waitForSnapshot();
+	return allocator.setFloorStoreEnabled(enabled);
+}
+
+void BaseMap::touchTile(int x, int y, int z) {
+	const uint64_t generation = generations.bump(x, y, z);
+	if (QTreeNode* leaf = getLeaf(x, y)) {
+		leaf->generation = generation;
+	}
+}
+
+void BaseMap::waitForSnapshot() {
+	if (snapshot) {
+		snapshot->wait();
 	}
 }
 
@@ -46,9 +101,27 @@ void BaseMap::clearVisible(uint32_t mask) {
 	root.clearVisible(mask);
 }
 
+uint64_t BaseMap::shareItems() {
+	waitForSnapshot();
+	uint64_t count = 0;
+	forEachTile([&count](Tile* tile) {
+		count += tile->shareItems();
+	});
+	return count;
+}
+
+uint64_t BaseMap::unshareItems() {
+	waitForSnapshot();
+	uint64_t count = 0;
+	forEachTile([&count](Tile* tile) {
+		count += tile->unshareItems();
+	});
+	return count;
+}
+
 Tile* BaseMap::createTile(int x, int y, int z) {
 	ASSERT(z < MAP_LAYERS);
-	QTreeNode* leaf = root.getLeafForce(x, y);
+	QTreeNode* leaf = createLeaf(x, y);
 	TileLocation* loc = leaf->createTile(x, y, z);
 	if (loc->get()) {
 		return loc->get();
@@ -70,7 +143,11 @@ Tile* BaseMap::getOrCreateTile(const Position& pos) {
 
 TileLocation* BaseMap::getTileL(int x, int y, int z) {
 	ASSERT(z < MAP_LAYERS);
-	QTreeNode* leaf = root.getLeaf(x, y);
+	if (const MapFloorStore* floor_store = allocator.getFloorStore()) {
+		return floor_store->getTileL(x, y, z);
+	}
+
+	QTreeNode* leaf = getLeaf(x, y);
 	if (leaf) {
 		Floor* floor = leaf->getFloor(z);
 		if (floor) {
@@ -98,7 +175,7 @@ const TileLocation* BaseMap::getTileL(const Position& pos) const {
 TileLocation* BaseMap::createTileL(int x, int y, int z) {
 	ASSERT(z < MAP_LAYERS);
 
-	QTreeNode* leaf = root.getLeafForce(x, y);
+	QTreeNode* leaf = createLeaf(x, y);
 	Floor* floor = leaf->createFloor(x, y, z);
 	uint32_t offsetX = x & 3;
 	uint32_t offsetY = y & 3;
@@ -115,7 +192,7 @@ void BaseMap::setTile(int x, int y, int z, Tile* newtile, bool remove) {
 	ASSERT(!newtile || newtile->getY() == int(y));
 	ASSERT(!newtile || newtile->getZ() == int(z));
 
-	QTreeNode* leaf = root.getLeafForce(x, y);
+	QTreeNode* leaf = createLeaf(x, y);
 	Tile* old = leaf->setTile(x, y, z, newtile);
 	if (remove) {
 		delete old;
@@ -128,7 +205,7 @@ Tile* BaseMap::swapTile(int x, int y, int z, Tile* newtile) {
 	ASSERT(!newtile || newtile->getY() == int(y));
 	ASSERT(!newtile || newtile->getZ() == int(z));
 
-	QTreeNode* leaf = root.getLeafForce(x, y);
+	QTreeNode* leaf = createLeaf(x, y);
 	return leaf->setTile(x, y, z, newtile);
 }
 
@@ -22,8 +22,13 @@
 #include "position.h"
 #include "filehandle.h"
 #include "map_allocator.h"
+#include "map_chunk_index.h"
+#include "map_occupancy.h"
+#include "map_generation.h"
 #include "tile.h"
 
+#include <memory>
+
 // Class declarations
 class QTreeNode;
 class BaseMap;
@@ -31,6 +36,7 @@ class MapIterator;
 class Floor;
 class QTreeNode;
 class TileLocation;
+class MapSnapshot;
 
 class MapIterator {
 public:
@@ -88,7 +94,7 @@ public:
 	BaseMap();
 	virtual ~BaseMap();
 
-	// This doesn't destroy the map structure, just clears it, if param is true, delete all tiles too.
+	// Removes all tiles from the map, if param is true, delete all tiles too and release the map structure.
 	void clear(bool del = true);
 	MapIterator begin();
 	MapIterator end();
@@ -111,12 +117,49 @@ public:
 	const TileLocation* getTileL(const Position& pos) const;
 
 	// Get a Quad Tree Leaf from the map
-	QTreeNode* getLeaf(int x, int y) {
-		return root.getLeaf(x, y);
+	QTreeNode* getLeaf(int x, int y);
+	QTreeNode* createLeaf(int x, int y);
+
+	// The chunk index mirrors the tree leaves in a flat table, making leaf lookups O(1)
+	// Storage stays in the tree, so this can be switched at any time
+	void setChunkIndexEnabled(bool enabled);
+	bool isChunkIndexEnabled() const {
+		return chunk_index != nullptr;
+	}
+	const MapChunkIndex* getChunkIndex() const {
+		return chunk_index.get();
+	}
+
+	// Contiguous storage keeps the floors of every 32x32 chunk in one block and finds tiles without
+	// the tree, see MapFloorStore. Floors can't be moved, so it can only be switched on an empty map.
+	bool setContiguousStorage(bool enabled);
+	bool hasContiguousStorage() const {
+		return allocator.getFloorStore() != nullptr;
+	}
+
+	// Which positions hold a tile, per floor. Lets callers skip empty space a 32x32 chunk at a time
+	const MapOccupancy& getOccupancy() const {
+		return occupancy;
+	}
+	bool isAreaEmpty(int min_x, int min_y, int max_x, int max_y, int z) const {
+		return occupancy.isAreaEmpty(min_x, min_y, max_x, max_y, z);
+	}
+
+	// Change counters, every tile change stamps its leaf and 32x32 chunk with the next map generation
+	// Caches keep the generation they were built at and compare it against the area they cover
+	uint64_t getGeneration() const {
+		return generations.getGeneration();
+	}
+	const MapGenerationTable& getGenerations() const {
+		return generations;
 	}
-	QTreeNode* createLeaf(int x, int y) {
-		return root.getLeafForce(x, y);
+	// For changes made to a tile in place, setTile and swapTile already do this
+	void touchTile(int x, int y, int z);
+	void touchTile(const Position& pos) {
+		touchTile(pos.x, pos.y, pos.z);
 	}
+	// A snapshot being saved doesn't see changes made in place, passes doing those call this first
+	void waitForSnapshot();
 
 	// Assigns a tile, it might seem pointless to provide position, but it is not, as the passed tile may be nullptr
 	void setTile(int _x, int _y, int _z, Tile* newtile, bool remove = false);
@@ -135,6 +178,22 @@ public:
 	// Clears the visiblity according to the mask passed
 	void clearVisible(uint32_t mask);
 
+	// Runs Tile::shareItems/unshareItems over the whole map, returns the number of items swapped
+	uint64_t shareItems();
+	uint64_t unshareItems();
+
+	// Chunk traversal, hands out every allocated leaf Floor (a 4x4 block of TileLocations)
+	// in the same order as MapIterator, but walks the tree once instead of per tile.
+	// Callbacks may change tiles, but must not free floors or tree nodes.
+	template <typename FloorCallback>
+	void forEachFloor(FloorCallback&& callback, int min_z = 0, int max_z = MAP_MAX_LAYER);
+	// Only visits floors overlapping the box between from and to (inclusive)
+	template <typename FloorCallback>
+	void forEachFloor(const Position& from, const Position& to, FloorCallback&& callback);
+	// Visits every tile on the map, callback takes a Tile*
+	template <typename TileCallback>
+	void forEachTile(TileCallback&& callback, int min_z = 0, int max_z = MAP_MAX_LAYER);
+
 	uint64_t getTileCount() const {
 		return tilecount;
 	}
@@ -146,10 +205,97 @@ protected:
 	uint64_t tilecount;
 
 	QTreeNode root; // The Quad Tree root
+	std::unique_ptr<MapChunkIndex> chunk_index; // Optional, see setChunkIndexEnabled
+	MapOccupancy occupancy; // Maintained by QTreeNode::setTile
+	MapGenerationTable generations; // Bumped by QTreeNode::setTile and touchTile
+	MapSnapshot* snapshot; // Told about every leaf QTreeNode is about to change while set
+
+private:
+	// Deletes every tile and drops the tree in bulk, leaves the root empty
+	void releaseTree();
+
+	struct FloorFilter {
+		int min_x, min_y, max_x, max_y;
+		int min_z, max_z;
+	};
+
+	template <typename FloorCallback>
+	void visitFloors(QTreeNode* node, int x, int y, int size, const FloorFilter& filter, FloorCallback& callback);
 
 	friend class QTreeNode;
+	friend class MapSnapshot;
 };
 
+template <typename FloorCallback>
+void BaseMap::visitFloors(QTreeNode* node, int x, int y, int size, const FloorFilter& filter, FloorCallback& callback) {
+	const int child_size = size >> 2;
+	for (int index = 0; index < MAP_LAYERS; ++index) {
+		QTreeNode* child = node->child[index];
+		if (!child) {
+			continue;
+		}
+
+		const int cx = x + (index & 3) * child_size;
+		const int cy = y + (index >> 2) * child_size;
+		if (cx > filter.max_x || cy > filter.max_y || cx + child_size <= filter.min_x || cy + child_size <= filter.min_y) {
+			continue;
+		}
+
+		if (child->isLeaf) {
+			for (int z = filter.min_z; z <= filter.max_z; ++z) {
+				if (Floor* floor = child->array[z]) {
+					callback(floor);
+				}
+			}
+		} else {
+			visitFloors(child, cx, cy, child_size, filter, callback);
+		}
+	}
+}
+
+template <typename FloorCallback>
+void BaseMap::forEachFloor(FloorCallback&& callback, int min_z, int max_z) {
+	const FloorFilter filter = { 0, 0, 0xFFFF, 0xFFFF, std::max(min_z, 0), std::min(max_z, MAP_MAX_LAYER) };
+	visitFloors(&root, 0, 0, 0x10000, filter, callback);
+}
+
+template <typename FloorCallback>
+void BaseMap::forEachFloor(const Position& from, const Position& to, FloorCallback&& callback) {
+	const FloorFilter filter = {
+		std::min(from.x, to.x), std::min(from.y, to.y),
+		std::max(from.x, to.x), std::max(from.y, to.y),
+		std::max(std::min(from.z, to.z), 0), std::min(std::max(from.z, to.z), MAP_MAX_LAYER)
+	};
+	visitFloors(&root, 0, 0, 0x10000, filter, callback);
+}
+
+template <typename TileCallback>
+void BaseMap::forEachTile(TileCallback&& callback, int min_z, int max_z) {
+	forEachFloor([&callback](Floor* floor) {
+		for (TileLocation& location : floor->locs) {
+			if (Tile* tile = location.get()) {
+				callback(tile);
+			}
+		}
+	}, min_z, max_z);
+}
+
+inline QTreeNode* BaseMap::getLeaf(int x, int y) {
+	if (chunk_index) {
+		return chunk_index->getLeaf(x, y);
+	}
+	return root.getLeaf(x, y);
+}
+
+inline QTreeNode* BaseMap::createLeaf(int x, int y) {
+	if (chunk_index) {
+		if (QTreeNode* leaf = chunk_index->getLeaf(x, y)) {
+			return leaf;
+		}
+	}
+	return root.getLeafForce(x, y);
+}
+
 inline Tile* BaseMap::getTile(int x, int y, int z) {
 	TileLocation* l = getTileL(x, y, z);
 	return l ? l->get() : nullptr;
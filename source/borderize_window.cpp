@@ -65,11 +65,9 @@ void BorderizeWindow::Start() {
         }
     } else {
         processing_whole_map = true;
-        for (TileLocation* tileLocation : editor.map) {
-            if (Tile* tile = tileLocation->get()) {
-                remaining_tiles.push_back(tile);
-            }
-        }
+        editor.map.forEachTile([this](Tile* tile) {
+            remaining_tiles.push_back(tile);
+        });
     }
     
     total_chunks = (remaining_tiles.size() + 499) / 500; // Process 500 tiles per chunk
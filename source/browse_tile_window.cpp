@@ -123,7 +123,7 @@ void BrowseTileListBox::RemoveSelected() {
 	// Delete the items from the tile
 	ItemVector tile_selection = edit_tile->popSelectedItems(true);
 	for (ItemVector::iterator iit = tile_selection.begin(); iit != tile_selection.end(); ++iit) {
-		delete *iit;
+		Item::Release(*iit);
 	}
 
 	UpdateItems();
@@ -162,7 +162,7 @@ void CarpetBrush::undraw(BaseMap* map, Tile* tile) {
 		if (item->isCarpet()) {
 			CarpetBrush* carpetBrush = item->getCarpetBrush();
 			if (carpetBrush) {
-				delete item;
+				Item::Release(item);
 				it = items.erase(it);
 			} else {
 				++it;
@@ -325,6 +325,8 @@ void MapPropertiesWindow::OnClickOK(wxCommandEvent& WXUNUSED(event)) {
     map.setMapDescription(nstr(description_ctrl->GetValue()));
     map.setHouseFilename(nstr(house_filename_ctrl->GetValue()));
     map.setSpawnFilename(nstr(spawn_filename_ctrl->GetValue()));
+    // The header lives in the root node, which only a full save writes
+    map.doChange();
 
     // Only resize if we have to
     int new_map_width = width_spin->GetValue();
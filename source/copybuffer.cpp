@@ -32,6 +32,18 @@ size_t CopyBuffer::GetTileCount() {
 	return tiles ? (size_t)tiles->size() : 0;
 }
 
+size_t CopyBuffer::memsize() const {
+	if (!tiles) {
+		return 0;
+	}
+
+	size_t mem = sizeof(BaseMap) + tiles->allocator.getNodeStats().reserved_bytes + tiles->allocator.getFloorStats().reserved_bytes;
+	tiles->forEachTile([&mem](Tile* tile) {
+		mem += tile->memsize();
+	});
+	return mem;
+}
+
 BaseMap& CopyBuffer::getBufferMap() {
 	ASSERT(tiles);
 	return *tiles;
@@ -42,6 +42,8 @@ public:
 	void clear();
 
 	size_t GetTileCount();
+	// Bytes held by the copied tiles and the tree holding them
+	size_t memsize() const;
 
 	BaseMap& getBufferMap();
 
@@ -59,6 +59,7 @@
 // OS
 
 #define OTGZ_SUPPORT 1
+#define OTBZ_SUPPORT 1
 #define ASSETS_NAME "Tibia"
 
 #ifdef __VISUALC__
@@ -138,11 +139,19 @@ constexpr int TileSize = 32;
 constexpr int ClientMapWidth = 17;
 constexpr int ClientMapHeight = 13;
 
-#define MAP_LOAD_FILE_WILDCARD_OTGZ "OpenTibia Binary Map (*.otbm;*.otgz)|*.otbm;*.otgz"
-#define MAP_SAVE_FILE_WILDCARD_OTGZ "OpenTibia Binary Map (*.otbm)|*.otbm|Compressed OpenTibia Binary Map (*.otgz)|*.otgz"
+#ifdef OTBZ_SUPPORT
+	#define MAP_LOAD_FILE_WILDCARD_OTGZ "OpenTibia Binary Map (*.otbm;*.otbz;*.otgz)|*.otbm;*.otbz;*.otgz"
+	#define MAP_SAVE_FILE_WILDCARD_OTGZ "OpenTibia Binary Map (*.otbm)|*.otbm|Streamed Compressed OpenTibia Binary Map (*.otbz)|*.otbz|Compressed OpenTibia Binary Map (*.otgz)|*.otgz"
 
-#define MAP_LOAD_FILE_WILDCARD "OpenTibia Binary Map (*.otbm)|*.otbm"
-#define MAP_SAVE_FILE_WILDCARD "OpenTibia Binary Map (*.otbm)|*.otbm"
+	#define MAP_LOAD_FILE_WILDCARD "OpenTibia Binary Map (*.otbm;*.otbz)|*.otbm;*.otbz"
+	#define MAP_SAVE_FILE_WILDCARD "OpenTibia Binary Map (*.otbm)|*.otbm|Streamed Compressed OpenTibia Binary Map (*.otbz)|*.otbz"
+#else
+	#define MAP_LOAD_FILE_WILDCARD_OTGZ "OpenTibia Binary Map (*.otbm;*.otgz)|*.otbm;*.otgz"
+	#define MAP_SAVE_FILE_WILDCARD_OTGZ "OpenTibia Binary Map (*.otbm)|*.otbm|Compressed OpenTibia Binary Map (*.otgz)|*.otgz"
+
+	#define MAP_LOAD_FILE_WILDCARD "OpenTibia Binary Map (*.otbm)|*.otbm"
+	#define MAP_SAVE_FILE_WILDCARD "OpenTibia Binary Map (*.otbm)|*.otbm"
+#endif
 
 // Lights
 constexpr int MaxLightIntensity = 8;
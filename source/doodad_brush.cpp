@@ -278,13 +278,13 @@ void DoodadBrush::undraw(BaseMap* map, Tile* tile) {
 			} else if (g_settings.getInteger(Config::DOODAD_BRUSH_ERASE_LIKE)) {
 				// Only delete items of the same doodad brush
 				if (ownsItem(item)) {
-					delete item;
+					Item::Release(item);
 					item_iter = tile->items.erase(item_iter);
 				} else {
 					++item_iter;
 				}
 			} else {
-				delete item;
+				Item::Release(item);
 				item_iter = tile->items.erase(item_iter);
 			}
 		} else {
@@ -296,11 +296,11 @@ void DoodadBrush::undraw(BaseMap* map, Tile* tile) {
 		if (g_settings.getInteger(Config::DOODAD_BRUSH_ERASE_LIKE)) {
 			// Only delete items of the same doodad brush
 			if (ownsItem(tile->ground)) {
-				delete tile->ground;
+				Item::Release(tile->ground);
 				tile->ground = nullptr;
 			}
 		} else {
-			delete tile->ground;
+			Item::Release(tile->ground);
 			tile->ground = nullptr;
 		}
 	}
@@ -42,6 +42,40 @@
 #include "minimap_window.h"
 #include "borderize_window.h"
 
+#include <atomic>
+#include <thread>
+
+// The map is captured on the main thread, then written on a thread of its own while editing goes on.
+// The worker pokes the main thread through GUI::UpdateBackgroundSaves as it makes progress.
+struct Editor::BackgroundSave {
+	BackgroundSave(Map& map, const FileName& filename) :
+		saver(map.getVersion()),
+		snapshot(map),
+		filename(filename),
+		progress(0),
+		done(false),
+		success(false) {
+		saver.captureMap(map, snapshot);
+		thread = std::thread([this]() {
+			success = saver.saveSnapshot(snapshot, this->filename, [this](int percent) {
+				progress = percent;
+				wxTheApp->CallAfter([]() { g_gui.UpdateBackgroundSaves(); });
+			});
+			done = true;
+			wxTheApp->CallAfter([]() { g_gui.UpdateBackgroundSaves(); });
+		});
+	}
+
+	IOMapOTBM saver;
+	OTBMSaveSnapshot snapshot;
+	FileName filename;
+	std::atomic<int> progress;
+	std::atomic<bool> done;
+	bool success; // Valid once done is set
+	std::function<void(bool)> finish; // Runs on the main thread once the file is written
+	std::thread thread;
+};
+
 Editor::Editor(CopyBuffer& copybuffer) :
 	live_server(nullptr),
 	live_client(nullptr),
@@ -160,6 +194,10 @@ Editor::Editor(CopyBuffer& copybuffer, LiveClient* client) :
 }
 
 Editor::~Editor() {
+	if (background_save) {
+		finishBackgroundSave();
+	}
+
 	if (IsLive()) {
 		CloseLiveServer();
 	}
@@ -180,6 +218,12 @@ void Editor::addAction(Action* action, int stacking_delay) {
 }
 
 void Editor::saveMap(FileName filename, bool showdialog) {
+	if (background_save) {
+		// Wait for the running save, then save whatever changed since it started
+		finishBackgroundSave();
+		g_gui.UpdateTitle();
+	}
+
 	std::string savefile = filename.GetFullPath().mb_str(wxConvUTF8).data();
 	bool save_as = false;
 	bool save_otgz = false;
@@ -207,10 +251,22 @@ void Editor::saveMap(FileName filename, bool showdialog) {
 		map.unnamed = false;
 	}
 
+	// Only append the changed areas to the journal when possible, the map file itself
+	// is left untouched so there is nothing to back up
+	if (!save_as && g_settings.getBoolean(Config::JOURNAL_SAVE)) {
+		IOMapOTBM journal(map.getVersion());
+		if (journal.saveJournal(map, wxstr(savefile))) {
+			map.clearChanges();
+			return;
+		}
+	}
+
 	// File object to convert between local paths etc.
 	FileName converter;
 	converter.Assign(wxstr(savefile));
 	std::string map_path = nstr(converter.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME));
+	// Backups keep the extension of the map file, the formats differ
+	std::string map_ext = "." + nstr(converter.GetExt());
 
 	// Make temporary backups
 	// converter.Assign(wxstr(savefile));
@@ -219,13 +275,13 @@ void Editor::saveMap(FileName filename, bool showdialog) {
 	if (converter.GetExt() == "otgz") {
 		save_otgz = true;
 		if (converter.FileExists()) {
-			backup_otbm = map_path + nstr(converter.GetName()) + ".otgz~";
+			backup_otbm = map_path + nstr(converter.GetName()) + map_ext + "~";
 			std::remove(backup_otbm.c_str());
 			std::rename(savefile.c_str(), backup_otbm.c_str());
 		}
 	} else {
 		if (converter.FileExists()) {
-			backup_otbm = map_path + nstr(converter.GetName()) + ".otbm~";
+			backup_otbm = map_path + nstr(converter.GetName()) + map_ext + "~";
 			std::remove(backup_otbm.c_str());
 			std::rename(savefile.c_str(), backup_otbm.c_str());
 		}
@@ -261,24 +317,19 @@ void Editor::saveMap(FileName filename, bool showdialog) {
 		  << backup_spawn << std::endl;
 	}
 
-	{
+	// Set up the Map paths
+	wxFileName fn = wxstr(savefile);
+	map.filename = fn.GetFullPath().mb_str(wxConvUTF8);
+	map.name = fn.GetFullName().mb_str(wxConvUTF8);
 
-		// Set up the Map paths
-		wxFileName fn = wxstr(savefile);
-		map.filename = fn.GetFullPath().mb_str(wxConvUTF8);
-		map.name = fn.GetFullName().mb_str(wxConvUTF8);
+	const bool background = !save_otgz && g_settings.getBoolean(Config::BACKGROUND_SAVE);
+	const uint64_t saved_generation = map.getGeneration();
 
-		if (showdialog) {
-			g_gui.CreateLoadBar("Saving OTBM map...");
-		}
-
-		// Perform the actual save
-		IOMapOTBM mapsaver(map.getVersion());
-		bool success = mapsaver.saveMap(map, fn);
-
-		if (showdialog) {
-			g_gui.DestroyLoadBar();
-		}
+	// Runs once the file is written, right away or when a background save is done
+	auto finish = [this, savefile, map_path, map_ext, save_as, background, saved_generation,
+					  backup_otbm, backup_house, backup_spawn, backup_waypoint](bool success) {
+		FileName converter;
+		converter.Assign(wxstr(savefile));
 
 		// Check for errors...
 		if (!success) {
@@ -286,7 +337,7 @@ void Editor::saveMap(FileName filename, bool showdialog) {
 			if (!backup_otbm.empty()) {
 				converter.SetFullName(wxstr(savefile));
 				std::string otbm_filename = map_path + nstr(converter.GetName());
-				std::rename(backup_otbm.c_str(), std::string(otbm_filename + (save_otgz ? ".otgz" : ".otbm")).c_str());
+				std::rename(backup_otbm.c_str(), std::string(otbm_filename + map_ext).c_str());
 			}
 
 			if (!backup_house.empty()) {
@@ -319,61 +370,124 @@ void Editor::saveMap(FileName filename, bool showdialog) {
 
 		// If failure, don't run the rest of the function
 		if (!success) {
+			if (background) {
+				map.journal_generation = 0;
+			}
 			return;
 		}
-	}
 
-	// Move to permanent backup
-	if (!save_as && g_settings.getInteger(Config::ALWAYS_MAKE_BACKUP)) {
-		// Move temporary backups to their proper files
-		time_t t = time(nullptr);
-		tm* current_time = localtime(&t);
-		ASSERT(current_time);
+		// Move to permanent backup
+		if (!save_as && g_settings.getInteger(Config::ALWAYS_MAKE_BACKUP)) {
+			// Move temporary backups to their proper files
+			time_t t = time(nullptr);
+			tm* current_time = localtime(&t);
+			ASSERT(current_time);
+
+			std::ostringstream date;
+			date << (1900 + current_time->tm_year);
+			if (current_time->tm_mon < 9) {
+				date << "-"
+					 << "0" << current_time->tm_mon + 1;
+			} else {
+				date << "-" << current_time->tm_mon + 1;
+			}
+			date << "-" << current_time->tm_mday;
+			date << "-" << current_time->tm_hour;
+			date << "-" << current_time->tm_min;
+			date << "-" << current_time->tm_sec;
 
-		std::ostringstream date;
-		date << (1900 + current_time->tm_year);
-		if (current_time->tm_mon < 9) {
-			date << "-"
-				 << "0" << current_time->tm_mon + 1;
+			if (!backup_otbm.empty()) {
+				converter.SetFullName(wxstr(savefile));
+				std::string otbm_filename = map_path + nstr(converter.GetName());
+				std::rename(backup_otbm.c_str(), std::string(otbm_filename + "." + date.str() + map_ext).c_str());
+			}
+
+			if (!backup_house.empty()) {
+				converter.SetFullName(wxstr(map.housefile));
+				std::string house_filename = map_path + nstr(converter.GetName());
+				std::rename(backup_house.c_str(), std::string(house_filename + "." + date.str() + ".xml").c_str());
+			}
+
+			if (!backup_spawn.empty()) {
+				converter.SetFullName(wxstr(map.spawnfile));
+				std::string spawn_filename = map_path + nstr(converter.GetName());
+				std::rename(backup_spawn.c_str(), std::string(spawn_filename + "." + date.str() + ".xml").c_str());
+			}
+
+			if (!backup_waypoint.empty()) {
+				converter.SetFullName(wxstr(map.spawnfile));
+				std::string waypoint_filename = map_path + nstr(converter.GetName());
+				std::rename(backup_waypoint.c_str(), std::string(waypoint_filename + "." + date.str() + ".xml").c_str());
+			}
 		} else {
-			date << "-" << current_time->tm_mon + 1;
+			// Delete the temporary files
+			std::remove(backup_otbm.c_str());
+			std::remove(backup_house.c_str());
+			std::remove(backup_spawn.c_str());
 		}
-		date << "-" << current_time->tm_mday;
-		date << "-" << current_time->tm_hour;
-		date << "-" << current_time->tm_min;
-		date << "-" << current_time->tm_sec;
 
-		if (!backup_otbm.empty()) {
-			converter.SetFullName(wxstr(savefile));
-			std::string otbm_filename = map_path + nstr(converter.GetName());
-			std::rename(backup_otbm.c_str(), std::string(otbm_filename + "." + date.str() + (save_otgz ? ".otgz" : ".otbm")).c_str());
+		// Edits made while a background save was running still have to be saved
+		if (!background || (map.getGeneration() == saved_generation && map.journal_generation == saved_generation)) {
+			map.clearChanges();
 		}
+	};
 
-		if (!backup_house.empty()) {
-			converter.SetFullName(wxstr(map.housefile));
-			std::string house_filename = map_path + nstr(converter.GetName());
-			std::rename(backup_house.c_str(), std::string(house_filename + "." + date.str() + ".xml").c_str());
-		}
+	if (background) {
+		// The file now matches the map as it is, any change from here on will move one of these
+		map.journal_generation = saved_generation;
+		background_save.reset(newd BackgroundSave(map, fn));
+		background_save->finish = finish;
+		g_gui.SetStatusText("Saving map...");
+		g_gui.UpdateMenus();
+		return;
+	}
 
-		if (!backup_spawn.empty()) {
-			converter.SetFullName(wxstr(map.spawnfile));
-			std::string spawn_filename = map_path + nstr(converter.GetName());
-			std::rename(backup_spawn.c_str(), std::string(spawn_filename + "." + date.str() + ".xml").c_str());
-		}
+	if (showdialog) {
+		g_gui.CreateLoadBar("Saving OTBM map...");
+	}
 
-		if (!backup_waypoint.empty()) {
-			converter.SetFullName(wxstr(map.spawnfile));
-			std::string waypoint_filename = map_path + nstr(converter.GetName());
-			std::rename(backup_waypoint.c_str(), std::string(waypoint_filename + "." + date.str() + ".xml").c_str());
-		}
-	} else {
-		// Delete the temporary files
-		std::remove(backup_otbm.c_str());
-		std::remove(backup_house.c_str());
-		std::remove(backup_spawn.c_str());
+	// Perform the actual save
+	IOMapOTBM mapsaver(map.getVersion());
+	bool success = mapsaver.saveMap(map, fn);
+
+	if (showdialog) {
+		g_gui.DestroyLoadBar();
 	}
 
-	map.clearChanges();
+	finish(success);
+}
+
+bool Editor::saveMapCopy(const FileName& filename) {
+	if (background_save) {
+		return false;
+	}
+
+	background_save.reset(newd BackgroundSave(map, filename));
+	background_save->finish = [](bool success) {
+		g_gui.SetStatusText(success ? "Autosave complete." : "Autosave failed.");
+	};
+	g_gui.UpdateMenus();
+	return true;
+}
+
+void Editor::updateBackgroundSave() {
+	if (!background_save) {
+		return;
+	}
+	if (!background_save->done) {
+		g_gui.SetStatusText(wxString::Format("Saving map... %d%%", background_save->progress.load()));
+		return;
+	}
+
+	finishBackgroundSave();
+	g_gui.UpdateTitle();
+	g_gui.UpdateMenus();
+}
+
+void Editor::finishBackgroundSave() {
+	std::unique_ptr<BackgroundSave> save(std::move(background_save));
+	save->thread.join();
+	save->finish(save->success);
 }
 
 bool Editor::importMiniMap(FileName filename, int import, int import_x_offset, int import_y_offset, int import_z_offset) {
@@ -836,13 +950,13 @@ void Editor::borderizeSelection() {
 void Editor::borderizeMap(bool showdialog) {
 	if (!showdialog) {
 		// Old immediate processing for automated calls
-		uint64_t tiles_done = 0;
-		for (TileLocation* tileLocation : map) {
-			Tile* tile = tileLocation->get();
-			ASSERT(tile);
+		map.waitForSnapshot();
+		map.forEachTile([this](Tile* tile) {
+			tile->unshareItems();
 			tile->borderize(&map);
-			++tiles_done;
-		}
+			map.touchTile(tile->getPosition());
+		});
+		map.doTrackedChange();
 		return;
 	}
 
@@ -882,17 +996,17 @@ void Editor::randomizeMap(bool showdialog) {
 		g_gui.CreateLoadBar("Randomizing map...");
 	}
 
+	map.waitForSnapshot();
 	uint64_t tiles_done = 0;
-	for (TileLocation* tileLocation : map) {
+	uint64_t tiles_changed = 0;
+	map.forEachTile([&](Tile* tile) {
 		if (showdialog && tiles_done % 4096 == 0) {
 			g_gui.SetLoadDone(static_cast<int32_t>(tiles_done / double(map.tilecount) * 100.0));
 		}
 
-		Tile* tile = tileLocation->get();
-		ASSERT(tile);
-
 		GroundBrush* groundBrush = tile->getGroundBrush();
 		if (groundBrush) {
+			tile->unshareItems();
 			Item* oldGround = tile->ground;
 
 			uint16_t actionId, uniqueId;
@@ -911,8 +1025,15 @@ void Editor::randomizeMap(bool showdialog) {
 				newGround->setUniqueID(uniqueId);
 			}
 			tile->update();
+			map.touchTile(tile->getPosition());
+			++tiles_changed;
 		}
 		++tiles_done;
+	});
+
+	// Edited in place, only the touched chunks have to be journaled
+	if (tiles_changed > 0) {
+		map.doTrackedChange();
 	}
 
 	if (showdialog) {
@@ -925,12 +1046,16 @@ void Editor::clearInvalidHouseTiles(bool showdialog) {
 		g_gui.CreateLoadBar("Clearing invalid house tiles...");
 	}
 
+	map.waitForSnapshot();
 	Houses& houses = map.houses;
+	// houses.xml is rewritten on every save, journal or not
+	bool changed = false;
 
 	HouseMap::iterator iter = houses.begin();
 	while (iter != houses.end()) {
 		House* h = iter->second;
 		if (map.towns.getTown(h->townid) == nullptr) {
+			changed = true;
 #ifdef __VISUALC__ // C++0x compliance to some degree :)
 			iter = houses.erase(iter);
 #else // Bulky, slow way
@@ -953,19 +1078,23 @@ void Editor::clearInvalidHouseTiles(bool showdialog) {
 	}
 
 	uint64_t tiles_done = 0;
-	for (MapIterator map_iter = map.begin(); map_iter != map.end(); ++map_iter) {
+	map.forEachTile([&](Tile* tile) {
 		if (showdialog && tiles_done % 4096 == 0) {
 			g_gui.SetLoadDone(int(tiles_done / double(map.tilecount) * 100.0));
 		}
 
-		Tile* tile = (*map_iter)->get();
-		ASSERT(tile);
 		if (tile->isHouseTile()) {
 			if (houses.getHouse(tile->getHouseID()) == nullptr) {
 				tile->setHouse(nullptr);
+				map.touchTile(tile->getPosition());
+				changed = true;
 			}
 		}
 		++tiles_done;
+	});
+
+	if (changed) {
+		map.doTrackedChange();
 	}
 
 	if (showdialog) {
@@ -979,16 +1108,14 @@ void Editor::clearModifiedTileState(bool showdialog) {
 	}
 
 	uint64_t tiles_done = 0;
-	for (MapIterator map_iter = map.begin(); map_iter != map.end(); ++map_iter) {
+	map.forEachTile([&](Tile* tile) {
 		if (showdialog && tiles_done % 4096 == 0) {
 			g_gui.SetLoadDone(int(tiles_done / double(map.tilecount) * 100.0));
 		}
 
-		Tile* tile = (*map_iter)->get();
-		ASSERT(tile);
 		tile->unmodify();
 		++tiles_done;
-	}
+	});
 
 	if (showdialog) {
 		g_gui.DestroyLoadBar();
@@ -1275,7 +1402,7 @@ void Editor::destroySelection() {
 			for (ItemVector::iterator iit = tile_selection.begin(); iit != tile_selection.end(); ++iit) {
 				++item_count;
 				// Delete the items from the tile
-				delete *iit;
+				Item::Release(*iit);
 			}
 
 			if (newtile->creature && newtile->creature->isSelected()) {
@@ -2065,6 +2192,7 @@ uint32_t Editor::validateGrounds(bool validateStack, bool generateEmpty, bool re
     uint32_t changes = 0;
     actionQueue->clear();
     selection.clear();
+    map.waitForSnapshot();
 
     g_gui.CreateLoadBar("Validating ground tiles...");
 
@@ -2119,6 +2247,7 @@ uint32_t Editor::validateGroundStacks() {
                 Item* ground = tile->ground;
                 tile->ground = nullptr;
                 tile->items.insert(tile->items.begin(), ground);
+                map.touchTile(tile->getPosition());
                 changes++;
             }
         }
@@ -2169,6 +2298,7 @@ uint32_t Editor::generateEmptySurroundedGrounds() {
         if (allSurroundingHaveGround && surroundingGroundId > 0) {
             // Create new ground tile matching surrounding tiles
             tile->ground = Item::Create(surroundingGroundId);
+            map.touchTile(pos);
             changes++;
         }
 
@@ -2215,6 +2345,7 @@ uint32_t Editor::removeDuplicateGrounds() {
                 [](Item* item) { return item && item->isGroundTile(); });
             
             tile->items.erase(it, tile->items.end());
+            map.touchTile(tile->getPosition());
             
             changes += groundTiles.size() - 1;
         }
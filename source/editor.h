@@ -45,6 +45,11 @@ protected:
 	LiveServer* live_server;
 	LiveClient* live_client;
 
+	// Save running on another thread, see Config::BACKGROUND_SAVE
+	struct BackgroundSave;
+	std::unique_ptr<BackgroundSave> background_save;
+	void finishBackgroundSave();
+
 public:
 	// Public members
 	ActionQueue* actionQueue;
@@ -77,6 +82,14 @@ public: // Functions
 
 	// Map handling
 	void saveMap(FileName filename, bool showdialog); // "" means default filename
+	// Writes a copy of the map on a background thread, the map keeps its own file name
+	bool saveMapCopy(const FileName& filename);
+	// True while a save is being written on a background thread
+	bool isSaving() const {
+		return background_save != nullptr;
+	}
+	// Shows the progress of a background save, and finishes it once the file is written
+	void updateBackgroundSave();
 
 	Map& getMap() noexcept {
 		return map;
@@ -51,18 +51,18 @@ void EraserBrush::undraw(BaseMap* map, Tile* tile) {
 		if (item->isComplex() && g_settings.getInteger(Config::ERASER_LEAVE_UNIQUE)) {
 			++item_iter;
 		} else {
-			delete item;
+			Item::Release(item);
 			item_iter = tile->items.erase(item_iter);
 		}
 	}
 	if (tile->ground) {
 		if (g_settings.getInteger(Config::ERASER_LEAVE_UNIQUE)) {
 			if (!tile->ground->isComplex()) {
-				delete tile->ground;
+				Item::Release(tile->ground);
 				tile->ground = nullptr;
 			}
 		} else {
-			delete tile->ground;
+			Item::Release(tile->ground);
 			tile->ground = nullptr;
 		}
 	}
@@ -77,7 +77,7 @@ void EraserBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 			//} else if(item->getDoodadBrush()) {
 			//++item_iter;
 		} else {
-			delete item;
+			Item::Release(item);
 			item_iter = tile->items.erase(item_iter);
 		}
 	}
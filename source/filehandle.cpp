@@ -22,6 +22,167 @@
 #include <stdio.h>
 #include <assert.h>
 
+#ifdef __WINDOWS__
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	// Built for every x86 target, whether it runs is decided once the CPU is known
+	#include <immintrin.h>
+	#define RME_NODE_SCAN_AVX2
+	#if defined(__GNUC__) && !defined(__AVX2__)
+		#define RME_TARGET_AVX2 __attribute__((target("avx2")))
+	#else
+		#define RME_TARGET_AVX2
+	#endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define RME_NODE_SCAN_SSE2
+#endif
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace {
+	// The markers and the escape are the three highest byte values, so a byte
+	// needs attention exactly when it's >= ESCAPE_CHAR
+	static_assert(ESCAPE_CHAR == 0xFD && NODE_START == 0xFE && NODE_END == 0xFF, "node scanning relies on the marker values");
+
+	FORCEINLINE uint32_t countTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	FORCEINLINE const uint8_t* findSpecialByteScalar(const uint8_t* ptr, const uint8_t* end) {
+		for (; ptr < end; ++ptr) {
+			if (*ptr >= ESCAPE_CHAR) {
+				return ptr;
+			}
+		}
+		return end;
+	}
+
+#ifdef RME_NODE_SCAN_SSE2
+	FORCEINLINE const uint8_t* findSpecialByteSSE2(const uint8_t* ptr, const uint8_t* end) {
+		const __m128i threshold = _mm_set1_epi8(static_cast<char>(ESCAPE_CHAR));
+		for (; end - ptr >= 16; ptr += 16) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+			// max(b, 0xFD) == b only for 0xFD, 0xFE and 0xFF
+			const uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, threshold), bytes));
+			if (mask) {
+				return ptr + countTrailingZeros(mask);
+			}
+		}
+		return findSpecialByteScalar(ptr, end);
+	}
+#endif
+
+#ifdef RME_NODE_SCAN_AVX2
+	RME_TARGET_AVX2 const uint8_t* findSpecialByteAVX2(const uint8_t* ptr, const uint8_t* end) {
+		const __m256i threshold = _mm256_set1_epi8(static_cast<char>(ESCAPE_CHAR));
+		for (; end - ptr >= 32; ptr += 32) {
+			const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+			const uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(bytes, threshold), bytes));
+			if (mask) {
+				return ptr + countTrailingZeros(mask);
+			}
+		}
+	#ifdef RME_NODE_SCAN_SSE2
+		return findSpecialByteSSE2(ptr, end);
+	#else
+		return findSpecialByteScalar(ptr, end);
+	#endif
+	}
+
+	bool hasAVX2() {
+	#if defined(__AVX2__)
+		return true;
+	#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		// The OS has to save the upper halves of the registers as well
+		__cpuid(info, 1);
+		const int osxsave_avx = (1 << 27) | (1 << 28);
+		if ((info[2] & osxsave_avx) != osxsave_avx || (_xgetbv(0) & 6) != 6) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		return __builtin_cpu_supports("avx2");
+	#endif
+	}
+
+	const bool use_avx2 = hasAVX2();
+#endif
+
+	// Returns the first marker or escape byte in [begin, end), or end if the run is clean.
+	// Uses the widest vector instructions the CPU has, the tail is done bytewise.
+	FORCEINLINE const uint8_t* findSpecialByte(const uint8_t* begin, const uint8_t* end) {
+#ifdef RME_NODE_SCAN_AVX2
+		if (use_avx2) {
+			return findSpecialByteAVX2(begin, end);
+		}
+#endif
+#ifdef RME_NODE_SCAN_SSE2
+		return findSpecialByteSSE2(begin, end);
+#else
+		return findSpecialByteScalar(begin, end);
+#endif
+	}
+}
+
+bool isNodeScanSupported(NodeScanPath path) {
+	switch (path) {
+		case NODE_SCAN_SCALAR:
+			return true;
+#ifdef RME_NODE_SCAN_SSE2
+		case NODE_SCAN_SSE2:
+			return true;
+#endif
+#ifdef RME_NODE_SCAN_AVX2
+		case NODE_SCAN_AVX2:
+			return use_avx2;
+#endif
+		default:
+			return false;
+	}
+}
+
+const uint8_t* findNodeSpecialByte(const uint8_t* begin, const uint8_t* end, NodeScanPath path) {
+	switch (path) {
+#ifdef RME_NODE_SCAN_SSE2
+		case NODE_SCAN_SSE2:
+			return findSpecialByteSSE2(begin, end);
+#endif
+#ifdef RME_NODE_SCAN_AVX2
+		case NODE_SCAN_AVX2:
+			ASSERT(use_avx2);
+			return findSpecialByteAVX2(begin, end);
+#endif
+		default:
+			return findSpecialByteScalar(begin, end);
+	}
+}
+
+const uint8_t* findNodeSpecialByte(const uint8_t* begin, const uint8_t* end) {
+	return findSpecialByte(begin, end);
+}
+
 uint8_t NodeFileWriteHandle::NODE_START = ::NODE_START;
 uint8_t NodeFileWriteHandle::NODE_END = ::NODE_END;
 uint8_t NodeFileWriteHandle::ESCAPE_CHAR = ::ESCAPE_CHAR;
@@ -65,7 +226,11 @@ std::string FileHandle::getErrorMessage() {
 // File read handle
 
 FileReadHandle::FileReadHandle(const std::string& name) :
-	file_size(0) {
+	file_size(0),
+	buffer(nullptr),
+	buffer_offset(0),
+	buffer_length(0),
+	buffer_index(0) {
 #if defined __VISUALC__ && defined _UNICODE
 	file = _wfopen(string2wstring(name).c_str(), L"rb");
 #else
@@ -77,37 +242,82 @@ FileReadHandle::FileReadHandle(const std::string& name) :
 		fseek(file, 0, SEEK_END);
 		file_size = ftell(file);
 		fseek(file, 0, SEEK_SET);
+		buffer = (uint8_t*)malloc(BUFFER_SIZE);
 	}
 }
 
 FileReadHandle::~FileReadHandle() {
-	////
+	free(buffer);
 }
 
 void FileReadHandle::close() {
 	file_size = 0;
+	buffer_offset = buffer_length = buffer_index = 0;
 	FileHandle::close();
 }
 
+bool FileReadHandle::fillBuffer() {
+	// The file position is always right behind the buffered bytes
+	buffer_offset += buffer_length;
+	buffer_index = 0;
+	buffer_length = fread(buffer, 1, BUFFER_SIZE, file);
+	return buffer_length > 0;
+}
+
+bool FileReadHandle::getU16Array(uint16_t* values, size_t count) {
+	return getRAW(reinterpret_cast<uint8_t*>(values), count * sizeof(uint16_t));
+}
+
+bool FileReadHandle::getU32Array(uint32_t* values, size_t count) {
+	return getRAW(reinterpret_cast<uint8_t*>(values), count * sizeof(uint32_t));
+}
+
 bool FileReadHandle::getRAW(uint8_t* ptr, size_t sz) {
-	size_t o = fread(ptr, 1, sz, file);
-	if (o != sz) {
+	if (!file) {
 		error_code = FILE_READ_ERROR;
 		return false;
 	}
-	return true;
-}
 
-bool FileReadHandle::getRAW(std::string& str, size_t sz) {
-	str.resize(sz);
-	size_t o = fread(const_cast<char*>(str.data()), 1, sz, file);
-	if (o != sz) {
+	const size_t available = buffer_length - buffer_index;
+	if (sz <= available) {
+		memcpy(ptr, buffer + buffer_index, sz);
+		buffer_index += sz;
+		return true;
+	}
+
+	memcpy(ptr, buffer + buffer_index, available);
+	ptr += available;
+	sz -= available;
+	buffer_index = buffer_length;
+
+	if (sz >= BUFFER_SIZE) {
+		// Nothing to gain from buffering, read straight into the target
+		buffer_offset += buffer_length;
+		buffer_length = buffer_index = 0;
+		const size_t o = fread(ptr, 1, sz, file);
+		buffer_offset += o;
+		if (o != sz) {
+			error_code = FILE_READ_ERROR;
+			return false;
+		}
+		return true;
+	}
+
+	if (!fillBuffer() || buffer_length < sz) {
+		buffer_index = buffer_length;
 		error_code = FILE_READ_ERROR;
 		return false;
 	}
+	memcpy(ptr, buffer, sz);
+	buffer_index = sz;
 	return true;
 }
 
+bool FileReadHandle::getRAW(std::string& str, size_t sz) {
+	str.resize(sz);
+	return getRAW(reinterpret_cast<uint8_t*>(&str[0]), sz);
+}
+
 bool FileReadHandle::getString(std::string& str) {
 	uint16_t sz;
 	if (!getU16(sz)) {
@@ -127,11 +337,21 @@ bool FileReadHandle::getLongString(std::string& str) {
 }
 
 bool FileReadHandle::seek(size_t offset) {
-	return fseek(file, long(offset), SEEK_SET) == 0;
+	if (offset >= buffer_offset && offset <= buffer_offset + buffer_length) {
+		buffer_index = offset - buffer_offset;
+		return true;
+	}
+
+	if (fseek(file, long(offset), SEEK_SET) != 0) {
+		return false;
+	}
+	buffer_offset = offset;
+	buffer_length = buffer_index = 0;
+	return true;
 }
 
 bool FileReadHandle::seekRelative(size_t offset) {
-	return fseek(file, long(offset), SEEK_CUR) == 0;
+	return seek(tell() + offset);
 }
 
 //=============================================================================
@@ -139,6 +359,7 @@ bool FileReadHandle::seekRelative(size_t offset) {
 
 NodeFileReadHandle::NodeFileReadHandle() :
 	last_was_start(false),
+	cache_is_file(false),
 	cache(nullptr),
 	cache_size(32768),
 	cache_length(0),
@@ -185,6 +406,7 @@ void MemoryNodeFileReadHandle::assign(const uint8_t* data, size_t size) {
 	// Highly volatile, but we know we're not gonna modify
 	cache = const_cast<uint8_t*>(data);
 	cache_size = cache_length = size;
+	cache_is_file = true;
 	local_read_index = 0;
 }
 
@@ -210,6 +432,330 @@ BinaryNode* MemoryNodeFileReadHandle::getRootNode() {
 	return root_node;
 }
 
+//=============================================================================
+// Memory mapped file read handle
+
+MappedFileReadHandle::MappedFileReadHandle(const std::string& name, bool sequential) :
+	mapping(nullptr),
+	mapping_size(0)
+#ifdef __WINDOWS__
+	,
+	file_handle(INVALID_HANDLE_VALUE),
+	mapping_handle(nullptr)
+#endif
+{
+#ifdef __WINDOWS__
+	const DWORD flags = sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+	#ifdef _UNICODE
+	file_handle = CreateFileW(string2wstring(name).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	#else
+	file_handle = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	#endif
+	LARGE_INTEGER file_size;
+	if (file_handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+		error_code = FILE_COULD_NOT_OPEN;
+		close();
+		return;
+	}
+	mapping_handle = CreateFileMapping(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_handle) {
+		mapping = static_cast<uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!mapping) {
+		error_code = FILE_COULD_NOT_OPEN;
+		close();
+		return;
+	}
+	mapping_size = static_cast<size_t>(file_size.QuadPart);
+#else
+	const int fd = open(name.c_str(), O_RDONLY);
+	struct stat file_stat;
+	if (fd < 0 || fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+		if (fd >= 0) {
+			::close(fd);
+		}
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+	void* view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // The mapping keeps the file alive
+	if (view == MAP_FAILED) {
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+	mapping = static_cast<uint8_t*>(view);
+	mapping_size = file_stat.st_size;
+	madvise(view, mapping_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+}
+
+MappedFileReadHandle::~MappedFileReadHandle() {
+	close();
+}
+
+void MappedFileReadHandle::close() {
+#ifdef __WINDOWS__
+	if (mapping) {
+		UnmapViewOfFile(mapping);
+	}
+	if (mapping_handle) {
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mapping) {
+		munmap(mapping, mapping_size);
+	}
+#endif
+	mapping = nullptr;
+	mapping_size = 0;
+}
+
+//=============================================================================
+// Memory mapped node file read handle
+
+MappedNodeFileReadHandle::MappedNodeFileReadHandle(const std::string& name, const std::vector<std::string>& acceptable_identifiers) :
+	// Nodes are read front to back
+	mapped(name, true) {
+	if (!mapped.isOk()) {
+		error_code = mapped.error_code;
+		return;
+	}
+
+	const uint8_t* mapping = mapped.data();
+	if (mapped.size() < 4) {
+		error_code = FILE_SYNTAX_ERROR;
+		close();
+		return;
+	}
+
+	// 0x00 00 00 00 is accepted as a wildcard version
+	if (mapping[0] != 0 || mapping[1] != 0 || mapping[2] != 0 || mapping[3] != 0) {
+		bool accepted = false;
+		for (const std::string& identifier : acceptable_identifiers) {
+			if (memcmp(mapping, identifier.c_str(), 4) == 0) {
+				accepted = true;
+				break;
+			}
+		}
+
+		if (!accepted) {
+			error_code = FILE_SYNTAX_ERROR;
+			close();
+			return;
+		}
+	}
+
+	// Nodes never write to the cache when it is the file
+	cache = const_cast<uint8_t*>(mapping) + 4;
+	cache_size = cache_length = mapped.size() - 4;
+	cache_is_file = true;
+	local_read_index = 0;
+}
+
+MappedNodeFileReadHandle::~MappedNodeFileReadHandle() {
+	close();
+}
+
+void MappedNodeFileReadHandle::close() {
+	freeNode(root_node);
+	root_node = nullptr;
+	cache = nullptr;
+	cache_size = cache_length = 0;
+	local_read_index = 0;
+	mapped.close();
+}
+
+bool MappedNodeFileReadHandle::renewCache() {
+	// Everything is mapped already
+	return false;
+}
+
+BinaryNode* MappedNodeFileReadHandle::getRootNode() {
+	assert(root_node == nullptr); // You should never do this twice
+
+	if (!mapped.isOpen() || cache_length == 0 || cache[0] != NODE_START) {
+		error_code = FILE_SYNTAX_ERROR;
+		return nullptr;
+	}
+
+	local_read_index = 1;
+	last_was_start = true;
+	root_node = getNode(nullptr);
+	root_node->load();
+	return root_node;
+}
+
+#ifdef OTBZ_SUPPORT
+//=============================================================================
+// Compressed node file read handle
+
+CompressedNodeFileReadHandle::CompressedNodeFileReadHandle(const std::string& name, const std::vector<std::string>& acceptable_identifiers) :
+	compression(FILE_COMPRESSION_ZSTD),
+	zstd(nullptr),
+	lz4(nullptr),
+	file_size(0),
+	input_index(0),
+	input_length(0) {
+#if defined __VISUALC__ && defined _UNICODE
+	file = _wfopen(string2wstring(name).c_str(), L"rb");
+#else
+	file = fopen(name.c_str(), "rb");
+#endif
+	if (!file || ferror(file)) {
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+
+	uint8_t header[8];
+	if (fread(header, 1, 8, file) != 8 || memcmp(header, CompressedNodeFileWriteHandle::CONTAINER_IDENTIFIER, 4) != 0 || header[4] != CompressedNodeFileWriteHandle::CONTAINER_VERSION) {
+		error_code = FILE_SYNTAX_ERROR;
+		close();
+		return;
+	}
+
+	compression = FileCompression(header[5]);
+	if (compression == FILE_COMPRESSION_ZSTD) {
+		zstd = ZSTD_createDCtx();
+		input.resize(ZSTD_DStreamInSize());
+	} else if (compression == FILE_COMPRESSION_LZ4) {
+		if (LZ4F_isError(LZ4F_createDecompressionContext(&lz4, LZ4F_VERSION))) {
+			lz4 = nullptr;
+		}
+		input.resize(64 * 1024);
+	}
+	if (!zstd && !lz4) {
+		error_code = FILE_SYNTAX_ERROR;
+		close();
+		return;
+	}
+
+	fseek(file, 0, SEEK_END);
+	file_size = ftell(file);
+	fseek(file, 8, SEEK_SET);
+
+	// The decompressed stream is a whole node file, identifier included
+	cache_size = 256 * 1024;
+	if (!renewCache() || cache_length < 4) {
+		error_code = FILE_SYNTAX_ERROR;
+		close();
+		return;
+	}
+
+	// 0x00 00 00 00 is accepted as a wildcard version
+	if (cache[0] != 0 || cache[1] != 0 || cache[2] != 0 || cache[3] != 0) {
+		bool accepted = false;
+		for (const std::string& identifier : acceptable_identifiers) {
+			if (memcmp(cache, identifier.c_str(), 4) == 0) {
+				accepted = true;
+				break;
+			}
+		}
+
+		if (!accepted) {
+			error_code = FILE_SYNTAX_ERROR;
+			close();
+			return;
+		}
+	}
+	local_read_index = 4;
+}
+
+CompressedNodeFileReadHandle::~CompressedNodeFileReadHandle() {
+	close();
+}
+
+void CompressedNodeFileReadHandle::close() {
+	freeNode(root_node);
+	root_node = nullptr;
+	file_size = 0;
+	FileHandle::close();
+	free(cache);
+	cache = nullptr;
+	cache_length = 0;
+	local_read_index = 0;
+
+	ZSTD_freeDCtx(zstd);
+	zstd = nullptr;
+	if (lz4) {
+		LZ4F_freeDecompressionContext(lz4);
+		lz4 = nullptr;
+	}
+}
+
+bool CompressedNodeFileReadHandle::renewCache() {
+	if (!file || error_code != FILE_NO_ERROR) {
+		return false;
+	}
+	if (!cache) {
+		cache = (uint8_t*)malloc(cache_size);
+	}
+
+	cache_length = 0;
+	local_read_index = 0;
+	while (cache_length < cache_size) {
+		if (input_index >= input_length && !feof(file)) {
+			input_length = fread(input.data(), 1, input.size(), file);
+			input_index = 0;
+			if (ferror(file)) {
+				error_code = FILE_READ_ERROR;
+				return false;
+			}
+		}
+
+		// Called with no input left as well, the codec may still hold output
+		const size_t decompressed = cache_length;
+		if (compression == FILE_COMPRESSION_ZSTD) {
+			ZSTD_inBuffer in = { input.data(), input_length, input_index };
+			ZSTD_outBuffer out = { cache, cache_size, cache_length };
+			if (ZSTD_isError(ZSTD_decompressStream(zstd, &out, &in))) {
+				error_code = FILE_READ_ERROR;
+				return false;
+			}
+			input_index = in.pos;
+			cache_length = out.pos;
+		} else {
+			size_t in_size = input_length - input_index;
+			size_t out_size = cache_size - cache_length;
+			if (LZ4F_isError(LZ4F_decompress(lz4, cache + cache_length, &out_size, input.data() + input_index, &in_size, nullptr))) {
+				error_code = FILE_READ_ERROR;
+				return false;
+			}
+			input_index += in_size;
+			cache_length += out_size;
+		}
+
+		if (cache_length == decompressed && input_index >= input_length && feof(file)) {
+			break;
+		}
+	}
+	return cache_length > 0;
+}
+
+BinaryNode* CompressedNodeFileReadHandle::getRootNode() {
+	assert(root_node == nullptr); // You should never do this twice
+
+	if (local_read_index >= cache_length && !renewCache()) {
+		error_code = FILE_SYNTAX_ERROR;
+		return nullptr;
+	}
+	if (cache[local_read_index] != NODE_START) {
+		error_code = FILE_SYNTAX_ERROR;
+		return nullptr;
+	}
+
+	++local_read_index;
+	last_was_start = true;
+	root_node = getNode(nullptr);
+	root_node->load();
+	return root_node;
+}
+#endif
+
 //=============================================================================
 // File based node file read handle
 
@@ -296,6 +842,9 @@ BinaryNode* DiskNodeFileReadHandle::getRootNode() {
 // Binary file node
 
 BinaryNode::BinaryNode(NodeFileReadHandle* file, BinaryNode* parent) :
+	payload(nullptr),
+	payload_size(0),
+	raw_offset(0),
 	read_offset(0),
 	file(file),
 	parent(parent),
@@ -320,21 +869,21 @@ BinaryNode* BinaryNode::getChild() {
 }
 
 bool BinaryNode::getRAW(uint8_t* ptr, size_t sz) {
-	if (read_offset + sz > data.size()) {
-		read_offset = data.size();
+	if (read_offset + sz > payload_size) {
+		read_offset = payload_size;
 		return false;
 	}
-	memcpy(ptr, data.data() + read_offset, sz);
+	memcpy(ptr, payload + read_offset, sz);
 	read_offset += sz;
 	return true;
 }
 
 bool BinaryNode::getRAW(std::string& str, size_t sz) {
-	if (read_offset + sz > data.size()) {
-		read_offset = data.size();
+	if (read_offset + sz > payload_size) {
+		read_offset = payload_size;
 		return false;
 	}
-	str.assign(data.data() + read_offset, sz);
+	str.assign(reinterpret_cast<const char*>(payload) + read_offset, sz);
 	read_offset += sz;
 	return true;
 }
@@ -355,6 +904,113 @@ bool BinaryNode::getLongString(std::string& str) {
 	return getRAW(str, len);
 }
 
+bool BinaryNode::getRawSubtree(const uint8_t*& begin, size_t& size) {
+	ASSERT(file);
+	ASSERT(child == nullptr);
+
+	if (!file->cache_is_file || file->error_code != FILE_NO_ERROR) {
+		return false;
+	}
+
+	const uint8_t* cache = file->cache;
+	const size_t cache_length = file->cache_length;
+	size_t& local_read_index = file->local_read_index;
+
+	if (file->last_was_start) {
+		// The first child has been opened already, find the NODE_END of this node
+		size_t index = local_read_index;
+		int depth = 2;
+		while (depth > 0) {
+			index = findSpecialByte(cache + index, cache + cache_length) - cache;
+			if (index >= cache_length) {
+				file->error_code = FILE_PREMATURE_END;
+				return false;
+			}
+
+			const uint8_t op = cache[index++];
+			if (op == ESCAPE_CHAR) {
+				++index;
+			} else if (op == NODE_START) {
+				++depth;
+			} else if (op == NODE_END) {
+				--depth;
+			}
+		}
+		local_read_index = index;
+		file->last_was_start = false;
+	}
+
+	begin = cache + raw_offset;
+	size = local_read_index - raw_offset;
+	return true;
+}
+
+bool BinaryNode::copyRawSubtree(std::vector<uint8_t>& out) {
+	ASSERT(file);
+	ASSERT(child == nullptr);
+
+	out.clear();
+	if (file->error_code != FILE_NO_ERROR) {
+		return false;
+	}
+
+	// The payload has been unescaped already, escape it again
+	out.reserve(payload_size + 2);
+	out.push_back(NODE_START);
+	for (size_t i = 0; i < payload_size; ++i) {
+		const uint8_t byte = payload[i];
+		if (byte == NODE_START || byte == NODE_END || byte == ESCAPE_CHAR) {
+			out.push_back(ESCAPE_CHAR);
+		}
+		out.push_back(byte);
+	}
+
+	if (!file->last_was_start) {
+		out.push_back(NODE_END);
+		return true;
+	}
+
+	// The first child has been opened already, copy up to and including the NODE_END of this node
+	out.push_back(NODE_START);
+	uint8_t*& cache = file->cache;
+	size_t& cache_length = file->cache_length;
+	size_t& local_read_index = file->local_read_index;
+	int depth = 2;
+	bool escaped = false;
+	while (depth > 0) {
+		if (local_read_index >= cache_length && !file->renewCache()) {
+			file->error_code = FILE_PREMATURE_END;
+			return false;
+		}
+
+		if (escaped) {
+			out.push_back(cache[local_read_index++]);
+			escaped = false;
+			continue;
+		}
+
+		const uint8_t* run = cache + local_read_index;
+		const uint8_t* special = findSpecialByte(run, cache + cache_length);
+		out.insert(out.end(), run, special);
+		local_read_index = special - cache;
+		if (local_read_index >= cache_length) {
+			continue;
+		}
+
+		const uint8_t op = cache[local_read_index++];
+		out.push_back(op);
+		if (op == ESCAPE_CHAR) {
+			escaped = true;
+		} else if (op == NODE_START) {
+			++depth;
+		} else if (op == NODE_END) {
+			--depth;
+		}
+	}
+	file->last_was_start = false;
+	return true;
+}
+
 BinaryNode* BinaryNode::advance() {
 	// Advance this to the next position
 	ASSERT(file);
@@ -398,8 +1054,6 @@ BinaryNode* BinaryNode::advance() {
 		if (op == NODE_START) {
 			// Another node follows this.
 			// Load this node as the next one
-			read_offset = 0;
-			data.clear();
 			load();
 			return this;
 		} else if (op == NODE_END) {
@@ -417,6 +1071,15 @@ BinaryNode* BinaryNode::advance() {
 
 void BinaryNode::load() {
 	ASSERT(file);
+	read_offset = 0;
+	payload = nullptr;
+	payload_size = 0;
+	data.clear();
+	if (file->cache_is_file) {
+		loadInPlace();
+		return;
+	}
+
 	// Read until next node starts
 	uint8_t*& cache = file->cache;
 	size_t& cache_length = file->cache_length;
@@ -430,17 +1093,30 @@ void BinaryNode::load() {
 			}
 		}
 
+		// Take everything up to the next marker or escape in one go
+		const uint8_t* run = cache + local_read_index;
+		const uint8_t* special = findSpecialByte(run, cache + cache_length);
+		data.append(reinterpret_cast<const char*>(run), special - run);
+		local_read_index = special - cache;
+		if (local_read_index >= cache_length) {
+			continue;
+		}
+
 		uint8_t op = cache[local_read_index];
 		++local_read_index;
 
 		switch (op) {
 			case NODE_START: {
 				file->last_was_start = true;
+				payload = reinterpret_cast<const uint8_t*>(data.data());
+				payload_size = data.size();
 				return;
 			}
 
 			case NODE_END: {
 				file->last_was_start = false;
+				payload = reinterpret_cast<const uint8_t*>(data.data());
+				payload_size = data.size();
 				return;
 			}
 
@@ -466,14 +1142,70 @@ void BinaryNode::load() {
 	}
 }
 
+size_t BinaryNode::findNodeDelimiter(const uint8_t* buffer, size_t begin, size_t end, bool& escaped) {
+	size_t index = begin;
+	while (index < end) {
+		index = findSpecialByte(buffer + index, buffer + end) - buffer;
+		if (index >= end) {
+			break;
+		}
+		if (buffer[index] != ESCAPE_CHAR) {
+			return index;
+		}
+		escaped = true;
+		index += 2;
+	}
+	return end;
+}
+
+void BinaryNode::loadInPlace() {
+	const uint8_t* cache = file->cache;
+	const size_t cache_length = file->cache_length;
+	size_t& local_read_index = file->local_read_index;
+
+	// Find where the next node starts or this one ends
+	const size_t start = local_read_index;
+	raw_offset = start - 1;
+	bool escaped = false;
+	const size_t end = findNodeDelimiter(cache, start, cache_length, escaped);
+	if (end >= cache_length) {
+		file->error_code = FILE_PREMATURE_END;
+		return;
+	}
+	file->last_was_start = cache[end] == NODE_START;
+	local_read_index = end + 1;
+
+	if (!escaped) {
+		payload = cache + start;
+		payload_size = end - start;
+		return;
+	}
+
+	data.reserve(end - start);
+	size_t index = start;
+	while (index < end) {
+		// Only escapes are left in the payload, copy the runs between them
+		const uint8_t* escape = findSpecialByte(cache + index, cache + end);
+		data.append(reinterpret_cast<const char*>(cache + index), escape - (cache + index));
+		index = escape - cache;
+		if (index >= end) {
+			break;
+		}
+		data.push_back(static_cast<char>(cache[index + 1]));
+		index += 2;
+	}
+	payload = reinterpret_cast<const uint8_t*>(data.data());
+	payload_size = data.size();
+}
+
 //=============================================================================
 // node file binary write handle
 
-FileWriteHandle::FileWriteHandle(const std::string& name) {
+FileWriteHandle::FileWriteHandle(const std::string& name, bool append) {
 #if defined __VISUALC__ && defined _UNICODE
-	file = _wfopen(string2wstring(name).c_str(), L"wb");
+	file = _wfopen(string2wstring(name).c_str(), append ? L"ab" : L"wb");
 #else
-	file = fopen(name.c_str(), "wb");
+	file = fopen(name.c_str(), append ? "ab" : "wb");
 #endif
 	if (file == nullptr || ferror(file)) {
 		error_code = FILE_COULD_NOT_OPEN;
@@ -615,6 +1347,155 @@ void MemoryNodeFileWriteHandle::renewCache() {
 	}
 }
 
+#ifdef OTBZ_SUPPORT
+//=============================================================================
+// Compressed node file write handle
+
+const char* CompressedNodeFileWriteHandle::CONTAINER_IDENTIFIER = "OTBZ";
+
+CompressedNodeFileWriteHandle::CompressedNodeFileWriteHandle(const std::string& name, const std::string& identifier, FileCompression compression, int threads) :
+	compression(compression),
+	zstd(nullptr),
+	lz4(nullptr) {
+#if defined __VISUALC__ && defined _UNICODE
+	file = _wfopen(string2wstring(name).c_str(), L"wb");
+#else
+	file = fopen(name.c_str(), "wb");
+#endif
+	if (!file || ferror(file)) {
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+	if (identifier.length() != 4) {
+		error_code = FILE_INVALID_IDENTIFIER;
+		return;
+	}
+
+	// Hand the compressor big blocks, every call has some overhead
+	cache_size = 1024 * 1024;
+	cache = (uint8_t*)malloc(cache_size + 1);
+	local_write_index = 0;
+
+	const uint8_t header[4] = { CONTAINER_VERSION, uint8_t(compression), 0, 0 };
+	writeOutput(reinterpret_cast<const uint8_t*>(CONTAINER_IDENTIFIER), 4);
+	writeOutput(header, 4);
+
+	if (compression == FILE_COMPRESSION_ZSTD) {
+		zstd = ZSTD_createCCtx();
+		if (zstd) {
+			ZSTD_CCtx_setParameter(zstd, ZSTD_c_compressionLevel, 3);
+			ZSTD_CCtx_setParameter(zstd, ZSTD_c_checksumFlag, 1);
+			if (threads > 1) {
+				// Fails on a library built without threading support, it then compresses on this thread
+				ZSTD_CCtx_setParameter(zstd, ZSTD_c_nbWorkers, threads);
+			}
+			output.resize(ZSTD_CStreamOutSize());
+		}
+	} else if (compression == FILE_COMPRESSION_LZ4) {
+		if (LZ4F_isError(LZ4F_createCompressionContext(&lz4, LZ4F_VERSION))) {
+			lz4 = nullptr;
+		} else {
+			LZ4F_preferences_t preferences;
+			memset(&preferences, 0, sizeof(preferences));
+			preferences.frameInfo.blockSizeID = LZ4F_max4MB;
+			preferences.frameInfo.blockMode = LZ4F_blockIndependent;
+			preferences.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+
+			output.resize(std::max<size_t>(LZ4F_compressBound(cache_size, &preferences), LZ4F_HEADER_SIZE_MAX));
+			const size_t written = LZ4F_compressBegin(lz4, output.data(), output.size(), &preferences);
+			if (LZ4F_isError(written)) {
+				error_code = FILE_WRITE_ERROR;
+				return;
+			}
+			writeOutput(output.data(), written);
+		}
+	}
+	if (!zstd && !lz4) {
+		error_code = FILE_WRITE_ERROR;
+		return;
+	}
+
+	// The identifier goes in compressed, so the stream holds a complete node file
+	compress(reinterpret_cast<const uint8_t*>(identifier.data()), 4, false);
+}
+
+CompressedNodeFileWriteHandle::~CompressedNodeFileWriteHandle() {
+	close();
+}
+
+void CompressedNodeFileWriteHandle::close() {
+	if (file) {
+		compress(cache, local_write_index, true);
+		local_write_index = 0;
+		// Buffered data only reaches the disk here, a full disk may first show up now
+		if (fclose(file) != 0) {
+			error_code = FILE_WRITE_ERROR;
+		}
+		file = nullptr;
+	}
+
+	ZSTD_freeCCtx(zstd);
+	zstd = nullptr;
+	if (lz4) {
+		LZ4F_freeCompressionContext(lz4);
+		lz4 = nullptr;
+	}
+}
+
+void CompressedNodeFileWriteHandle::renewCache() {
+	if (cache) {
+		compress(cache, local_write_index, false);
+	} else {
+		cache = (uint8_t*)malloc(cache_size + 1);
+	}
+	local_write_index = 0;
+}
+
+void CompressedNodeFileWriteHandle::compress(const uint8_t* data, size_t size, bool last) {
+	if (!file || error_code != FILE_NO_ERROR) {
+		return;
+	}
+
+	if (compression == FILE_COMPRESSION_ZSTD) {
+		ZSTD_inBuffer in = { data, size, 0 };
+		size_t remaining;
+		do {
+			ZSTD_outBuffer out = { output.data(), output.size(), 0 };
+			remaining = ZSTD_compressStream2(zstd, &out, &in, last ? ZSTD_e_end : ZSTD_e_continue);
+			if (ZSTD_isError(remaining)) {
+				error_code = FILE_WRITE_ERROR;
+				return;
+			}
+			if (!writeOutput(output.data(), out.pos)) {
+				return;
+			}
+		} while (last ? remaining != 0 : in.pos < in.size);
+	} else {
+		size_t written = LZ4F_compressUpdate(lz4, output.data(), output.size(), data, size, nullptr);
+		if (!LZ4F_isError(written) && writeOutput(output.data(), written) && last) {
+			written = LZ4F_compressEnd(lz4, output.data(), output.size(), nullptr);
+			if (!LZ4F_isError(written)) {
+				writeOutput(output.data(), written);
+			}
+		}
+		if (LZ4F_isError(written)) {
+			error_code = FILE_WRITE_ERROR;
+		}
+	}
+}
+
+bool CompressedNodeFileWriteHandle::writeOutput(const uint8_t* data, size_t size) {
+	if (error_code != FILE_NO_ERROR) {
+		return false;
+	}
+	if (size > 0 && fwrite(data, 1, size, file) != size) {
+		error_code = FILE_WRITE_ERROR;
+		return false;
+	}
+	return true;
+}
+#endif
+
 //=============================================================================
 // Node file write handle
 
@@ -702,3 +1583,46 @@ bool NodeFileWriteHandle::addRAW(const uint8_t* ptr, size_t sz) {
 	writeBytes(ptr, sz);
 	return error_code == FILE_NO_ERROR;
 }
+
+void NodeFileWriteHandle::writeEscapedRun(const uint8_t* ptr, size_t sz) {
+	const uint8_t* end = ptr + sz;
+	while (ptr < end) {
+		// Copy the clean run up to the next byte that needs an escape in one go
+		const uint8_t* special = findSpecialByte(ptr, end);
+		while (ptr < special) {
+			const size_t count = std::min<size_t>(special - ptr, cache_size - local_write_index);
+			memcpy(cache + local_write_index, ptr, count);
+			local_write_index += count;
+			ptr += count;
+			if (local_write_index >= cache_size) {
+				renewCache();
+			}
+		}
+		if (ptr == end) {
+			break;
+		}
+
+		cache[local_write_index++] = ESCAPE_CHAR;
+		if (local_write_index >= cache_size) {
+			renewCache();
+		}
+		cache[local_write_index++] = *ptr++;
+		if (local_write_index >= cache_size) {
+			renewCache();
+		}
+	}
+}
+
+bool NodeFileWriteHandle::addNodeData(const uint8_t* ptr, size_t sz) {
+	while (sz > 0) {
+		const size_t count = std::min(sz, cache_size - local_write_index);
+		memcpy(cache + local_write_index, ptr, count);
+		local_write_index += count;
+		if (local_write_index >= cache_size) {
+			renewCache();
+		}
+		ptr += count;
+		sz -= count;
+	}
+	return error_code == FILE_NO_ERROR;
+}
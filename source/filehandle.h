@@ -20,9 +20,11 @@
 
 #include "definitions.h"
 
+#include <cstring>
 #include <stdexcept>
 #include <string>
 #include <stack>
+#include <vector>
 #include <stdio.h>
 
 #ifndef FORCEINLINE
@@ -44,6 +46,12 @@ enum FileHandleError {
 	FILE_PREMATURE_END,
 };
 
+// Codecs of the compressed node file container
+enum FileCompression {
+	FILE_COMPRESSION_ZSTD = 1,
+	FILE_COMPRESSION_LZ4 = 2,
+};
+
 enum NodeType {
 	NODE_START = 0xfe,
 	NODE_END = 0xff,
@@ -95,6 +103,12 @@ public:
 	FORCEINLINE bool get32(int32_t& i32) {
 		return getType(i32);
 	}
+	FORCEINLINE bool getU64(uint64_t& u64) {
+		return getType(u64);
+	}
+	// Arrays of integers in file byte order, like the single reads above
+	bool getU16Array(uint16_t* values, size_t count);
+	bool getU32Array(uint32_t* values, size_t count);
 	bool getRAW(uint8_t* ptr, size_t sz);
 	bool getRAW(std::string& str, size_t sz);
 	bool getString(std::string& str);
@@ -111,24 +125,73 @@ public:
 	}
 	size_t tell() {
 		if (file) {
-			return ftell(file);
+			return buffer_offset + buffer_index;
 		}
 		return 0;
 	}
 
 protected:
+	static const size_t BUFFER_SIZE = 64 * 1024;
+
+	// Reads the next block of the file into the buffer, returns false at end of file
+	bool fillBuffer();
+
 	size_t file_size;
 
+	// Small reads are served from here instead of going to the file one field at a time
+	uint8_t* buffer;
+	size_t buffer_offset; // File offset of the first byte in the buffer
+	size_t buffer_length; // Bytes valid in the buffer
+	size_t buffer_index; // Read position in the buffer
+
 	template <class T>
 	bool getType(T& ref) {
-		fread(&ref, sizeof(ref), 1, file);
-		return ferror(file) == 0;
+		if (buffer_index + sizeof(ref) <= buffer_length) {
+			memcpy(&ref, buffer + buffer_index, sizeof(ref));
+			buffer_index += sizeof(ref);
+			return true;
+		}
+		return getRAW(reinterpret_cast<uint8_t*>(&ref), sizeof(ref));
+	}
+};
+
+// Maps a whole file read-only, the data stays valid until the handle is closed.
+// Pages are read in as they are touched and can be dropped again under memory pressure.
+class MappedFileReadHandle : public FileHandle {
+public:
+	// A file that is read front to back gets read ahead
+	explicit MappedFileReadHandle(const std::string& name, bool sequential = false);
+	virtual ~MappedFileReadHandle();
+
+	virtual void close();
+	virtual bool isOpen() {
+		return mapping != nullptr;
+	}
+	virtual bool isOk() {
+		return isOpen() && error_code == FILE_NO_ERROR;
+	}
+
+	const uint8_t* data() const {
+		return mapping;
 	}
+	size_t size() const {
+		return mapping_size;
+	}
+
+protected:
+	uint8_t* mapping;
+	size_t mapping_size;
+#ifdef __WINDOWS__
+	void* file_handle;
+	void* mapping_handle;
+#endif
 };
 
 class NodeFileReadHandle;
 class DiskNodeFileReadHandle;
 class MemoryNodeFileReadHandle;
+class MappedNodeFileReadHandle;
+class CompressedNodeFileReadHandle;
 
 class BinaryNode {
 public:
@@ -151,8 +214,8 @@ public:
 		return getType(u64);
 	}
 	FORCEINLINE bool skip(size_t sz) {
-		if (read_offset + sz > data.size()) {
-			read_offset = data.size();
+		if (read_offset + sz > payload_size) {
+			read_offset = payload_size;
 			return false;
 		}
 		read_offset += sz;
@@ -167,21 +230,45 @@ public:
 	// Returns this on success, nullptr on failure
 	BinaryNode* advance();
 
+	// Skips the children of this node and returns the raw (still escaped) bytes of the
+	// node and everything below it, from its NODE_START to its NODE_END. The range can be
+	// read again through a MemoryNodeFileReadHandle. Only works while the whole file is
+	// in memory and before any child was read, returns false otherwise.
+	bool getRawSubtree(const uint8_t*& begin, size_t& size);
+	// Same as getRawSubtree, but copies the bytes into out, so it works on any handle
+	bool copyRawSubtree(std::vector<uint8_t>& out);
+
+	// The unescaped properties of the node, valid until the node advances or is freed
+	const uint8_t* getPayload() const {
+		return payload;
+	}
+	size_t getPayloadSize() const {
+		return payload_size;
+	}
+
 protected:
 	template <class T>
 	bool getType(T& ref) {
-		if (read_offset + sizeof(ref) > data.size()) {
-			read_offset = data.size();
+		if (read_offset + sizeof(ref) > payload_size) {
+			read_offset = payload_size;
 			return false;
 		}
-		ref = *(T*)(data.data() + read_offset);
+		memcpy(&ref, payload + read_offset, sizeof(ref));
 
 		read_offset += sizeof(ref);
 		return true;
 	}
 
 	void load();
-	std::string data;
+	// For handles whose whole file stays in memory, references the payload in place unless it has to be unescaped
+	void loadInPlace();
+	// Returns the index of the first unescaped NODE_START/NODE_END in [begin, end), or end if there is none
+	static size_t findNodeDelimiter(const uint8_t* buffer, size_t begin, size_t end, bool& escaped);
+
+	const uint8_t* payload; // Into the file buffer or into data
+	size_t payload_size;
+	size_t raw_offset; // Of the NODE_START in the file buffer, only set when loaded in place
+	std::string data; // Unescaped copy of the payload, unused when it can be referenced in place
 	size_t read_offset;
 	NodeFileReadHandle* file;
 	BinaryNode* parent;
@@ -189,6 +276,8 @@ protected:
 
 	friend class DiskNodeFileReadHandle;
 	friend class MemoryNodeFileReadHandle;
+	friend class MappedNodeFileReadHandle;
+	friend class CompressedNodeFileReadHandle;
 };
 
 class NodeFileReadHandle : public FileHandle {
@@ -208,6 +297,7 @@ protected:
 	virtual bool renewCache() = 0;
 
 	bool last_was_start;
+	bool cache_is_file; // The cache holds the whole file and never moves, nodes may point into it
 	uint8_t* cache;
 	size_t cache_size;
 	size_t cache_length;
@@ -271,9 +361,81 @@ protected:
 	uint8_t* index;
 };
 
+// Maps the whole file into memory, nodes reference their payload in the mapping
+// and only nodes containing escaped bytes get a copy.
+class MappedNodeFileReadHandle : public NodeFileReadHandle {
+public:
+	MappedNodeFileReadHandle(const std::string& name, const std::vector<std::string>& acceptable_identifiers);
+	virtual ~MappedNodeFileReadHandle();
+
+	virtual void close();
+	virtual BinaryNode* getRootNode();
+
+	virtual bool isOpen() {
+		return mapped.isOpen();
+	}
+	virtual bool isOk() {
+		return isOpen() && error_code == FILE_NO_ERROR;
+	}
+
+	virtual size_t size() {
+		return mapped.size();
+	}
+	virtual size_t tell() {
+		return local_read_index + 4;
+	}
+
+protected:
+	virtual bool renewCache();
+
+	MappedFileReadHandle mapped;
+};
+
+#ifdef OTBZ_SUPPORT
+struct ZSTD_DCtx_s;
+struct ZSTD_CCtx_s;
+struct LZ4F_dctx_s;
+struct LZ4F_cctx_s;
+
+// Reads a node file from the compressed container written by CompressedNodeFileWriteHandle,
+// decompressing one cache at a time so the whole file never has to be in memory.
+class CompressedNodeFileReadHandle : public NodeFileReadHandle {
+public:
+	CompressedNodeFileReadHandle(const std::string& name, const std::vector<std::string>& acceptable_identifiers);
+	virtual ~CompressedNodeFileReadHandle();
+
+	virtual void close();
+	virtual BinaryNode* getRootNode();
+
+	// Size and position are those of the compressed file, good enough for progress
+	virtual size_t size() {
+		return file_size;
+	}
+	virtual size_t tell() {
+		if (file) {
+			return ftell(file);
+		}
+		return 0;
+	}
+
+protected:
+	virtual bool renewCache();
+
+	FileCompression compression;
+	ZSTD_DCtx_s* zstd;
+	LZ4F_dctx_s* lz4;
+	size_t file_size;
+
+	std::vector<uint8_t> input; // Compressed bytes read from the file
+	size_t input_index;
+	size_t input_length;
+};
+#endif
+
 class FileWriteHandle : public FileHandle {
 public:
-	explicit FileWriteHandle(const std::string& name);
+	// With append set, writes go to the end of an existing file instead of replacing it
+	explicit FileWriteHandle(const std::string& name, bool append = false);
 	virtual ~FileWriteHandle();
 
 	FORCEINLINE bool addU8(uint8_t u8) {
@@ -328,6 +490,8 @@ public:
 	bool addRAW(const char* c) {
 		return addRAW(reinterpret_cast<const uint8_t*>(c), strlen(c));
 	}
+	// Appends bytes that are node encoded already, like the output of a MemoryNodeFileWriteHandle
+	bool addNodeData(const uint8_t* ptr, size_t sz);
 
 protected:
 	virtual void renewCache() = 0;
@@ -340,8 +504,13 @@ protected:
 	size_t cache_size;
 	size_t local_write_index;
 
+	// writeBytes for longer runs, copies the stretches without special bytes in bulk
+	void writeEscapedRun(const uint8_t* ptr, size_t sz);
+
 	FORCEINLINE void writeBytes(const uint8_t* ptr, size_t sz) {
-		if (sz) {
+		if (sz >= 16) {
+			writeEscapedRun(ptr, sz);
+		} else if (sz) {
 			do {
 				if (*ptr == NODE_START || *ptr == NODE_END || *ptr == ESCAPE_CHAR) {
 					cache[local_write_index++] = ESCAPE_CHAR;
@@ -360,6 +529,19 @@ protected:
 	}
 };
 
+// Ways to find the bytes that need escaping, the node handles use the widest the CPU has
+enum NodeScanPath {
+	NODE_SCAN_SCALAR,
+	NODE_SCAN_SSE2,
+	NODE_SCAN_AVX2,
+};
+
+// The scan the node handles use, the first marker or escape byte in [begin, end) or end.
+// A path can be forced for benchmarks, it has to be supported by the build and the CPU.
+bool isNodeScanSupported(NodeScanPath path);
+const uint8_t* findNodeSpecialByte(const uint8_t* begin, const uint8_t* end);
+const uint8_t* findNodeSpecialByte(const uint8_t* begin, const uint8_t* end, NodeScanPath path);
+
 class DiskNodeFileWriteHandle : public NodeFileWriteHandle {
 public:
 	DiskNodeFileWriteHandle(const std::string& name, const std::string& identifier);
@@ -386,4 +568,32 @@ protected:
 	virtual void renewCache();
 };
 
+#ifdef OTBZ_SUPPORT
+// Writes a node file into a compressed container: a header naming the codec followed by
+// the same bytes DiskNodeFileWriteHandle would write, streamed through the compressor.
+// Zstandard compresses on `threads` worker threads, LZ4 emits independent 4 MB blocks.
+class CompressedNodeFileWriteHandle : public NodeFileWriteHandle {
+public:
+	CompressedNodeFileWriteHandle(const std::string& name, const std::string& identifier, FileCompression compression, int threads);
+	virtual ~CompressedNodeFileWriteHandle();
+
+	virtual void close();
+
+	static const char* CONTAINER_IDENTIFIER;
+	static const uint8_t CONTAINER_VERSION = 1;
+
+protected:
+	virtual void renewCache();
+	// Feeds bytes to the compressor and writes whatever it hands back, finishing the stream with last set
+	void compress(const uint8_t* data, size_t size, bool last);
+	// Writes to the file, returns false and sets error_code on a short write
+	bool writeOutput(const uint8_t* data, size_t size);
+
+	FileCompression compression;
+	ZSTD_CCtx_s* zstd;
+	LZ4F_cctx_s* lz4;
+	std::vector<uint8_t> output;
+};
+#endif
+
 #endif
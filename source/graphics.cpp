@@ -19,6 +19,7 @@
 
 #include "sprites.h"
 #include "graphics.h"
+#include "sprite_prefetch.h"
 #include "filehandle.h"
 #include "settings.h"
 #include "gui.h"
@@ -182,6 +183,8 @@ static uint32_t TemplateOutfitLookupTable[] = {
 GraphicManager::GraphicManager() :
 	client_version(nullptr),
 	unloaded(true),
+	sprite_count(0),
+	atlas(&GraphicManager::getFreeTextureID),
 	dat_format(DAT_FORMAT_UNKNOWN),
 	otfi_found(false),
 	is_extended(false),
@@ -189,12 +192,18 @@ GraphicManager::GraphicManager() :
 	has_frame_durations(false),
 	has_frame_groups(false),
 	loaded_textures(0),
-	lastclean(0) {
+	loaded_dumps(0),
+	loaded_dump_bytes(0),
+	prefetcher(std::make_unique<SpritePrefetcher>()),
+	frame(1) {
 	animation_timer = newd wxStopWatch();
 	animation_timer->Start();
 }
 
 GraphicManager::~GraphicManager() {
+	// The workers may still be reading sprite dumps
+	prefetcher.reset();
+
 	for (SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
 		delete iter->second;
 	}
@@ -214,12 +223,36 @@ bool GraphicManager::isUnloaded() const {
 	return unloaded;
 }
 
+GraphicManager::MemoryStats GraphicManager::getMemoryStats() const {
+	MemoryStats stats;
+	stats.sprites = sprite_space.size();
+	stats.images = image_space.size();
+	stats.dumps = loaded_dumps;
+	stats.dump_bytes = loaded_dump_bytes;
+	stats.mapped_bytes = sprite_mapping ? sprite_mapping->size() : 0;
+	stats.textures = std::max(loaded_textures, 0);
+	stats.texture_bytes = stats.textures * SPRITE_PIXELS_SIZE * 4;
+	stats.atlas_sprites = atlas.getSpriteCount();
+	stats.atlas_bytes = atlas.getByteSize();
+	stats.software_sprites = cleanup_list.size();
+	stats.texture_budget = getTextureBudget();
+	stats.dump_budget = getDumpBudget();
+	stats.texture_cache = texture_stats;
+	stats.texture_cache.hits += atlas_stats.hits;
+	stats.texture_cache.misses += atlas_stats.misses;
+	stats.texture_cache.evictions += atlas.getEvictionCount();
+	stats.dump_cache = dump_stats;
+	return stats;
+}
+
 GLuint GraphicManager::getFreeTextureID() {
 	static GLuint id_counter = 0x10000000;
 	return id_counter++; // This should (hopefully) never run out
 }
 
 void GraphicManager::clear() {
+	prefetcher->clear();
+
 	SpriteMap new_sprite_space;
 	for (SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
 		if (iter->first >= 0) { // Don't clean internal sprites
@@ -236,12 +269,14 @@ void GraphicManager::clear() {
 	sprite_space.swap(new_sprite_space);
 	image_space.clear();
 	cleanup_list.clear();
+	atlas.clear();
 
 	item_count = 0;
 	creature_count = 0;
 	loaded_textures = 0;
-	lastclean = time(nullptr);
 	spritefile = "";
+	sprite_mapping.reset();
+	sprite_count = 0;
 
 	unloaded = true;
 }
@@ -529,6 +564,10 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 		has_frame_groups = dat_format >= DAT_FORMAT_1057;
 	}
 
+	std::vector<uint32_t> sprite_ids;
+	std::vector<uint16_t> short_sprite_ids;
+	std::vector<uint32_t> frame_durations;
+
 	uint16_t id = minID;
 	// loop through all ItemDatabase until we reach the end of file
 	while (id <= maxID) {
@@ -586,13 +625,12 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 				}
 				sType->animator = newd Animator(sType->frames, start_frame, loop_count, async == 1);
 				if (has_frame_durations) {
+					// Minimum and maximum duration of each frame
+					frame_durations.assign(sType->frames * 2, 0);
+					file.getU32Array(frame_durations.data(), frame_durations.size());
 					for (int i = 0; i < sType->frames; i++) {
-						uint32_t min;
-						uint32_t max;
-						file.getU32(min);
-						file.getU32(max);
 						FrameDuration* frame_duration = sType->animator->getFrameDuration(i);
-						frame_duration->setValues(int(min), int(max));
+						frame_duration->setValues(int(frame_durations[i * 2]), int(frame_durations[i * 2 + 1]));
 					}
 					sType->animator->reset();
 				}
@@ -601,22 +639,18 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 			sType->numsprites = (int)sType->width * (int)sType->height * (int)sType->layers * (int)sType->pattern_x * (int)sType->pattern_y * sType->pattern_z * (int)sType->frames;
 
 			// Read the sprite ids
-			for (uint32_t i = 0; i < sType->numsprites; ++i) {
-				uint32_t sprite_id;
-				if (is_extended) {
-					file.getU32(sprite_id);
-				} else {
-					uint16_t u16 = 0;
-					file.getU16(u16);
-					sprite_id = u16;
-				}
+			if (is_extended) {
+				sprite_ids.assign(sType->numsprites, 0);
+				file.getU32Array(sprite_ids.data(), sprite_ids.size());
+			} else {
+				short_sprite_ids.assign(sType->numsprites, 0);
+				file.getU16Array(short_sprite_ids.data(), short_sprite_ids.size());
+				sprite_ids.assign(short_sprite_ids.begin(), short_sprite_ids.end());
+			}
+			sType->spriteList.reserve(sType->spriteList.size() + sprite_ids.size());
 
-				if (image_space[sprite_id] == nullptr) {
-					GameSprite::NormalImage* img = newd GameSprite::NormalImage();
-					img->id = sprite_id;
-					image_space[sprite_id] = img;
-				}
-				sType->spriteList.push_back(static_cast<GameSprite::NormalImage*>(image_space[sprite_id]));
+			for (uint32_t sprite_id : sprite_ids) {
+				sType->spriteList.push_back(getNormalImage(sprite_id));
 			}
 		}
 		++id;
@@ -625,6 +659,16 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 	return true;
 }
 
+GameSprite::NormalImage* GraphicManager::getNormalImage(uint32_t sprite_id) {
+	GameSprite::Image*& image = image_space[sprite_id];
+	if (image == nullptr) {
+		GameSprite::NormalImage* img = newd GameSprite::NormalImage();
+		img->id = sprite_id;
+		image = img;
+	}
+	return static_cast<GameSprite::NormalImage*>(image);
+}
+
 bool GraphicManager::loadSpriteMetadataFlags(FileReadHandle& file, GameSprite* sType, wxString& error, wxArrayString& warnings) {
 	uint8_t prev_flag = 0;
 	uint8_t flag = DatFlagLast;
@@ -810,6 +854,141 @@ bool GraphicManager::loadSpriteMetadataFlags(FileReadHandle& file, GameSprite* s
 	return true;
 }
 
+bool GraphicManager::loadSpriteMetadataCache(FileReadHandle& file) {
+	uint32_t format;
+	if (!file.getU32(format) || !file.getU16(item_count) || !file.getU16(creature_count)) {
+		return false;
+	}
+	dat_format = DatFormat(format);
+
+	if (!otfi_found) {
+		is_extended = dat_format >= DAT_FORMAT_96;
+		has_frame_durations = dat_format >= DAT_FORMAT_1050;
+		has_frame_groups = dat_format >= DAT_FORMAT_1057;
+	}
+
+	// Read in full before any of it is installed
+	SpriteMap sprites;
+	auto fail = [&sprites]() {
+		for (SpriteMap::value_type& entry : sprites) {
+			delete entry.second;
+		}
+		return false;
+	};
+
+	std::vector<uint32_t> sprite_ids;
+	const uint32_t maxID = item_count + creature_count;
+	for (uint32_t id = 100; id <= maxID; ++id) {
+		GameSprite* sType = newd GameSprite();
+		sprites[id] = sType;
+		sType->id = id;
+
+		uint8_t has_light, has_animator;
+		if (!file.getU8(sType->width) || !file.getU8(sType->height) || !file.getU8(sType->layers) || !file.getU8(sType->pattern_x) || !file.getU8(sType->pattern_y) || !file.getU8(sType->pattern_z) || !file.getU8(sType->frames)
+			|| !file.getU16(sType->draw_height) || !file.getU16(sType->drawoffset_x) || !file.getU16(sType->drawoffset_y) || !file.getU16(sType->minimap_color)
+			|| !file.getU8(has_light) || !file.getU8(sType->light.intensity) || !file.getU8(sType->light.color) || !file.getU8(has_animator)) {
+			return fail();
+		}
+		sType->has_light = has_light != 0;
+
+		if (has_animator) {
+			uint32_t frame_count;
+			int32_t start_frame, loop_count;
+			uint8_t async;
+			if (!file.getU32(frame_count) || !file.get32(start_frame) || !file.get32(loop_count) || !file.getU8(async)) {
+				return fail();
+			}
+			if (frame_count == 0 || frame_count > 0xFF || start_frame < -1 || start_frame >= static_cast<int32_t>(frame_count)) {
+				return fail();
+			}
+			sType->animator = newd Animator(frame_count, start_frame, loop_count, async != 0);
+			for (uint32_t i = 0; i < frame_count; ++i) {
+				int32_t min, max;
+				if (!file.get32(min) || !file.get32(max) || min > max) {
+					return fail();
+				}
+				sType->animator->getFrameDuration(i)->setValues(min, max);
+			}
+			sType->animator->reset();
+		}
+
+		uint32_t count;
+		if (!file.getU32(sType->numsprites) || !file.getU32(count) || count > (file.size() - file.tell()) / sizeof(uint32_t)) {
+			return fail();
+		}
+		// As the .dat loader counts them, outfits with frame groups list the sprites of every group
+		// while the sizes are those of the last one
+		const uint64_t size = uint64_t(sType->width) * sType->height * sType->layers * sType->pattern_x * sType->pattern_y * sType->pattern_z * sType->frames;
+		const bool grouped = has_frame_groups && id > item_count;
+		if (sType->numsprites != size || (grouped ? count < size : count != size)) {
+			return fail();
+		}
+		sprite_ids.resize(count);
+		if (!file.getU32Array(sprite_ids.data(), count)) {
+			return fail();
+		}
+		sType->spriteList.reserve(count);
+		for (uint32_t sprite_id : sprite_ids) {
+			sType->spriteList.push_back(getNormalImage(sprite_id));
+		}
+	}
+
+	for (SpriteMap::value_type& entry : sprites) {
+		sprite_space[entry.first] = entry.second;
+	}
+	return true;
+}
+
+void GraphicManager::saveSpriteMetadataCache(FileWriteHandle& file) const {
+	file.addU32(dat_format);
+	file.addU16(item_count);
+	file.addU16(creature_count);
+
+	std::vector<uint32_t> sprite_ids;
+	const uint32_t maxID = item_count + creature_count;
+	for (uint32_t id = 100; id <= maxID; ++id) {
+		SpriteMap::const_iterator it = sprite_space.find(id);
+		ASSERT(it != sprite_space.end());
+		const GameSprite* sType = static_cast<const GameSprite*>(it->second);
+
+		file.addU8(sType->width);
+		file.addU8(sType->height);
+		file.addU8(sType->layers);
+		file.addU8(sType->pattern_x);
+		file.addU8(sType->pattern_y);
+		file.addU8(sType->pattern_z);
+		file.addU8(sType->frames);
+		file.addU16(sType->draw_height);
+		file.addU16(sType->drawoffset_x);
+		file.addU16(sType->drawoffset_y);
+		file.addU16(sType->minimap_color);
+		file.addU8(sType->has_light);
+		file.addU8(sType->light.intensity);
+		file.addU8(sType->light.color);
+
+		const Animator* animator = sType->animator;
+		file.addU8(animator != nullptr);
+		if (animator) {
+			file.addU32(animator->frame_count);
+			file.addU32(animator->start_frame);
+			file.addU32(animator->loop_count);
+			file.addU8(animator->async);
+			for (const FrameDuration* duration : animator->durations) {
+				file.addU32(duration->min);
+				file.addU32(duration->max);
+			}
+		}
+
+		sprite_ids.clear();
+		for (const GameSprite::NormalImage* image : sType->spriteList) {
+			sprite_ids.push_back(image->id);
+		}
+		file.addU32(sType->numsprites);
+		file.addU32(sprite_ids.size());
+		file.addRAW(reinterpret_cast<const uint8_t*>(sprite_ids.data()), sprite_ids.size() * sizeof(uint32_t));
+	}
+}
+
 bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, wxArrayString& warnings) {
 	FileReadHandle fh(nstr(datafile.GetFullPath()));
 
@@ -838,6 +1017,19 @@ bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, w
 		total_pics = u16;
 	}
 
+	if (g_settings.getInteger(Config::USE_MAPPED_SPRITES)) {
+		// The offset table and the sprites are read from the mapping when they are needed
+		std::unique_ptr<MappedFileReadHandle> mapping(newd MappedFileReadHandle(nstr(datafile.GetFullPath())));
+		const size_t table_end = fh.tell() + size_t(total_pics) * sizeof(uint32_t);
+		if (mapping->isOk() && mapping->size() >= table_end) {
+			sprite_mapping = std::move(mapping);
+			sprite_count = total_pics;
+			unloaded = false;
+			return true;
+		}
+		warnings.push_back("Couldn't map the sprite file into memory, sprites are read from the file instead.");
+	}
+
 	if (!g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
 		spritefile = nstr(datafile.GetFullPath());
 		unloaded = false;
@@ -872,6 +1064,8 @@ bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, w
 					spr->id = id;
 					spr->size = size;
 					spr->dump = newd uint8_t[size];
+					++loaded_dumps;
+					loaded_dump_bytes += size;
 					if (!fh.getRAW(spr->dump, size)) {
 						error = wxstr(fh.getErrorMessage());
 						return false;
@@ -899,11 +1093,28 @@ bool GraphicManager::loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite
 		return true;
 	}
 
+	if (!readSpriteDump(target, size, sprite_id)) {
+		return false;
+	}
+	unloaded = false;
+
+	++loaded_dumps;
+	loaded_dump_bytes += size;
+	return true;
+}
+
+bool GraphicManager::readSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id) const {
+	if (sprite_id == 0) {
+		// Empty GameSprite
+		size = 0;
+		target = nullptr;
+		return true;
+	}
+
 	FileReadHandle fh(spritefile);
 	if (!fh.isOk()) {
 		return false;
 	}
-	unloaded = false;
 
 	if (!fh.seek((is_extended ? 4 : 2) + sprite_id * sizeof(uint32_t))) {
 		return false;
@@ -926,6 +1137,43 @@ bool GraphicManager::loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite
 	return false;
 }
 
+bool GraphicManager::getMappedSpriteDump(const uint8_t*& target, uint16_t& size, int sprite_id) const {
+	if (sprite_id == 0) {
+		// Empty GameSprite
+		size = 0;
+		target = nullptr;
+		return true;
+	}
+	if (sprite_id < 0 || static_cast<uint32_t>(sprite_id) > sprite_count) {
+		return false;
+	}
+
+	const uint8_t* data = sprite_mapping->data();
+	const size_t data_size = sprite_mapping->size();
+
+	uint32_t offset;
+	memcpy(&offset, data + (is_extended ? 4 : 2) + sprite_id * sizeof(uint32_t), sizeof(offset));
+	if (offset == 0) {
+		// Not stored in the file
+		size = 0;
+		target = nullptr;
+		return true;
+	}
+
+	// The pixels follow the color key and their size
+	uint16_t sprite_size;
+	if (size_t(offset) + 5 > data_size) {
+		return false;
+	}
+	memcpy(&sprite_size, data + offset + 3, sizeof(sprite_size));
+	if (size_t(offset) + 5 + sprite_size > data_size) {
+		return false;
+	}
+	target = data + offset + 5;
+	size = sprite_size;
+	return true;
+}
+
 void GraphicManager::addSpriteToCleanup(GameSprite* spr) {
 	cleanup_list.push_back(spr);
 	// Clean if needed
@@ -937,25 +1185,75 @@ void GraphicManager::addSpriteToCleanup(GameSprite* spr) {
 	}
 }
 
-void GraphicManager::garbageCollection() {
-	if (g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
-		int t = time(nullptr);
-		if (loaded_textures > g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD) && t - lastclean > g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)) {
-			ImageMap::iterator iit = image_space.begin();
-			while (iit != image_space.end()) {
-				iit->second->clean(t);
-				++iit;
-			}
-			SpriteMap::iterator sit = sprite_space.begin();
-			while (sit != sprite_space.end()) {
-				GameSprite* gs = dynamic_cast<GameSprite*>(sit->second);
-				if (gs) {
-					gs->clean(t);
-				}
-				++sit;
-			}
-			lastclean = t;
+void GraphicManager::prefetchSprite(GameSprite* sprite) {
+	prefetcher->request(sprite);
+}
+
+void GraphicManager::uploadPrefetchedSprites() {
+	prefetcher->upload();
+}
+
+void GraphicManager::nextFrame() {
+	++frame;
+	atlas.nextFrame();
+	atlas.setMaxBytes(getAtlasBudget());
+}
+
+size_t GraphicManager::getTextureBudget() const {
+	if (!g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
+		return 0;
+	}
+	return static_cast<size_t>(std::max(g_settings.getInteger(Config::TEXTURE_CACHE_SIZE), 1)) * 1024 * 1024;
+}
+
+size_t GraphicManager::getAtlasBudget() const {
+	// Half of the budget, so a full atlas can't push every other texture out each frame.
+	// Without texture management the atlas gets what it would from the default budget.
+	const size_t budget = getTextureBudget();
+	return budget > 0 ? budget / 2 : SpriteAtlas::DEFAULT_MAX_BYTES;
+}
+
+size_t GraphicManager::getDumpBudget() const {
+	if (!g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
+		return 0;
+	}
+	return static_cast<size_t>(std::max(g_settings.getInteger(Config::SPRITE_CACHE_SIZE), 1)) * 1024 * 1024;
+}
+
+void GraphicManager::addTexture(GameSprite::Image* image) {
+	++texture_stats.misses;
+	texture_cache.insert(image, SPRITE_PIXELS_SIZE * 4, frame);
+
+	const size_t budget = getTextureBudget();
+	if (budget == 0) {
+		return;
+	}
+	// Textures used this frame may still be queued in the sprite batch
+	while (texture_cache.bytes() > budget - getAtlasBudget()) {
+		GameSprite::Image* oldest = texture_cache.back();
+		if (oldest == image || oldest->texture_hook.lastuse == frame) {
+			break;
 		}
+		oldest->unloadTexture();
+		++texture_stats.evictions;
+	}
+}
+
+void GraphicManager::addDump(GameSprite::NormalImage* image) {
+	++dump_stats.misses;
+	dump_cache.insert(image, image->size, frame);
+
+	const size_t budget = getDumpBudget();
+	if (budget == 0) {
+		return;
+	}
+	while (dump_cache.bytes() > budget) {
+		GameSprite::NormalImage* oldest = dump_cache.back();
+		if (oldest == image) {
+			break;
+		}
+		oldest->releaseDump();
+		++dump_stats.evictions;
 	}
 }
 
@@ -1019,14 +1317,6 @@ GameSprite::~GameSprite() {
 	delete animator;
 }
 
-void GameSprite::clean(int time) {
-	for (std::list<TemplateImage*>::iterator iter = instanced_templates.begin();
-		 iter != instanced_templates.end();
-		 ++iter) {
-		(*iter)->clean(time);
-	}
-}
-
 void GameSprite::unloadDC() {
 	delete dc[SPRITE_SIZE_16x16];
 	delete dc[SPRITE_SIZE_32x32];
@@ -1050,7 +1340,7 @@ int GameSprite::getIndex(int width, int height, int layer, int pattern_x, int pa
 	return ((((((frame % this->frames) * this->pattern_z + pattern_z) * this->pattern_y + pattern_y) * this->pattern_x + pattern_x) * this->layers + layer) * this->height + height) * this->width + width;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
+GameSprite::Image* GameSprite::getImage(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
 	uint32_t v;
 	if (_count >= 0 && height <= 1 && width <= 1) {
 		v = _count;
@@ -1064,7 +1354,15 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pa
 			v %= numsprites;
 		}
 	}
-	return spriteList[v]->getHardwareID();
+	return spriteList[v];
+}
+
+GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
+	return getImage(_x, _y, _layer, _count, _pattern_x, _pattern_y, _pattern_z, _frame)->getHardwareID();
+}
+
+SpriteTexture GameSprite::getTexture(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame) {
+	return getImage(_x, _y, _layer, _count, _pattern_x, _pattern_y, _pattern_z, _frame)->getTexture();
 }
 
 GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const Outfit& outfit) {
@@ -1088,7 +1386,7 @@ GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const
 	return img;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame) {
+GameSprite::Image* GameSprite::getImage(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame) {
 	uint32_t v = getIndex(_x, _y, 0, _dir, _addon, _pattern_z, _frame);
 	if (v >= numsprites) {
 		if (numsprites == 1) {
@@ -1098,10 +1396,17 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _patt
 		}
 	}
 	if (layers > 1) { // Template
-		TemplateImage* img = getTemplateImage(v, _outfit);
-		return img->getHardwareID();
+		return getTemplateImage(v, _outfit);
 	}
-	return spriteList[v]->getHardwareID();
+	return spriteList[v];
+}
+
+GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame) {
+	return getImage(_x, _y, _dir, _addon, _pattern_z, _outfit, _frame)->getHardwareID();
+}
+
+SpriteTexture GameSprite::getTexture(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame) {
+	return getImage(_x, _y, _dir, _addon, _pattern_z, _outfit, _frame)->getTexture();
 }
 
 wxMemoryDC* GameSprite::getDC(SpriteSize size) {
@@ -1248,8 +1553,7 @@ void GameSprite::DrawOutfit(wxDC* dc, SpriteSize sz, int start_x, int start_y, c
 }
 
 GameSprite::Image::Image() :
-	isGLLoaded(false),
-	lastaccess(0) {
+	isGLLoaded(false) {
 	////
 }
 
@@ -1265,6 +1569,11 @@ void GameSprite::Image::createGLTexture(GLuint whatid) {
 		return;
 	}
 
+	loadGLTexture(whatid, rgba);
+	delete[] rgba;
+}
+
+void GameSprite::Image::loadGLTexture(GLuint whatid, const uint8_t* rgba) {
 	isGLLoaded = true;
 	g_gui.gfx.loaded_textures += 1;
 
@@ -1274,25 +1583,27 @@ void GameSprite::Image::createGLTexture(GLuint whatid) {
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SPRITE_PIXELS, SPRITE_PIXELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
-
-	delete[] rgba;
 #undef SPRITE_SIZE
+
+	g_gui.gfx.addTexture(this);
 }
 
 void GameSprite::Image::unloadGLTexture(GLuint whatid) {
+	if (isGLLoaded) {
+		g_gui.gfx.loaded_textures -= 1;
+		g_gui.gfx.texture_cache.remove(this);
+	}
 	isGLLoaded = false;
-	g_gui.gfx.loaded_textures -= 1;
 	glDeleteTextures(1, &whatid);
 }
 
-void GameSprite::Image::visit() {
-	lastaccess = time(nullptr);
+SpriteTexture GameSprite::Image::getTexture() {
+	return SpriteTexture(getHardwareID());
 }
 
-void GameSprite::Image::clean(int time) {
-	if (isGLLoaded && time - lastaccess > g_settings.getInteger(Config::TEXTURE_LONGEVITY)) {
-		unloadGLTexture(0);
-	}
+void GameSprite::Image::visit() {
+	++g_gui.gfx.texture_stats.hits;
+	g_gui.gfx.texture_cache.touch(this, g_gui.gfx.frame);
 }
 
 GameSprite::NormalImage::NormalImage() :
@@ -1303,26 +1614,49 @@ GameSprite::NormalImage::NormalImage() :
 }
 
 GameSprite::NormalImage::~NormalImage() {
-	delete[] dump;
+	releaseDump();
 }
 
-void GameSprite::NormalImage::clean(int time) {
-	Image::clean(time);
-	if (time - lastaccess > 5 && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) { // We keep dumps around for 5 seconds.
+void GameSprite::NormalImage::releaseDump() {
+	if (dump) {
+		--g_gui.gfx.loaded_dumps;
+		g_gui.gfx.loaded_dump_bytes -= size;
+		g_gui.gfx.dump_cache.remove(this);
 		delete[] dump;
 		dump = nullptr;
 	}
 }
 
-uint8_t* GameSprite::NormalImage::getRGBData() {
+bool GameSprite::NormalImage::getDump(const uint8_t*& pixels, uint16_t& pixels_size) {
+	if (g_gui.gfx.sprite_mapping) {
+		return g_gui.gfx.getMappedSpriteDump(pixels, pixels_size, id);
+	}
+
 	if (!dump) {
 		if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-			return nullptr;
+			return false;
 		}
 
 		if (!g_gui.gfx.loadSpriteDump(dump, size, id)) {
-			return nullptr;
+			return false;
 		}
+		if (dump) {
+			g_gui.gfx.addDump(this);
+		}
+	} else if (dump_hook.linked) {
+		++g_gui.gfx.dump_stats.hits;
+		g_gui.gfx.dump_cache.touch(this, g_gui.gfx.frame);
+	}
+	pixels = dump;
+	pixels_size = size;
+	return true;
+}
+
+uint8_t* GameSprite::NormalImage::getRGBData() {
+	const uint8_t* pixels;
+	uint16_t pixels_size;
+	if (!getDump(pixels, pixels_size)) {
+		return nullptr;
 	}
 
 	const int pixels_data_size = SPRITE_PIXELS * SPRITE_PIXELS * 3;
@@ -1332,8 +1666,8 @@ uint8_t* GameSprite::NormalImage::getRGBData() {
 	int read = 0;
 
 	// decompress pixels
-	while (read < size && write < pixels_data_size) {
-		int transparent = dump[read] | dump[read + 1] << 8;
+	while (read < pixels_size && write < pixels_data_size) {
+		int transparent = pixels[read] | pixels[read + 1] << 8;
 		read += 2;
 		for (int i = 0; i < transparent && write < pixels_data_size; i++) {
 			data[write + 0] = 0xFF; // red
@@ -1342,12 +1676,12 @@ uint8_t* GameSprite::NormalImage::getRGBData() {
 			write += 3;
 		}
 
-		int colored = dump[read] | dump[read + 1] << 8;
+		int colored = pixels[read] | pixels[read + 1] << 8;
 		read += 2;
 		for (int i = 0; i < colored && write < pixels_data_size; i++) {
-			data[write + 0] = dump[read + 0]; // red
-			data[write + 1] = dump[read + 1]; // green
-			data[write + 2] = dump[read + 2]; // blue
+			data[write + 0] = pixels[read + 0]; // red
+			data[write + 1] = pixels[read + 1]; // green
+			data[write + 2] = pixels[read + 2]; // blue
 			write += 3;
 			read += bpp;
 		}
@@ -1364,26 +1698,26 @@ uint8_t* GameSprite::NormalImage::getRGBData() {
 }
 
 uint8_t* GameSprite::NormalImage::getRGBAData() {
-	if (!dump) {
-		if (g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-			return nullptr;
-		}
-
-		if (!g_gui.gfx.loadSpriteDump(dump, size, id)) {
-			return nullptr;
-		}
+	const uint8_t* pixels;
+	uint16_t pixels_size;
+	if (!getDump(pixels, pixels_size)) {
+		return nullptr;
 	}
 
+	uint8_t* data = newd uint8_t[SPRITE_PIXELS_SIZE * 4];
+	decodeRGBA(pixels, pixels_size, g_gui.gfx.hasTransparency(), data);
+	return data;
+}
+
+void GameSprite::NormalImage::decodeRGBA(const uint8_t* pixels, uint16_t pixels_size, bool use_alpha, uint8_t* data) {
 	const int pixels_data_size = SPRITE_PIXELS_SIZE * 4;
-	uint8_t* data = newd uint8_t[pixels_data_size];
-	bool use_alpha = g_gui.gfx.hasTransparency();
 	uint8_t bpp = use_alpha ? 4 : 3;
 	int write = 0;
 	int read = 0;
 
 	// decompress pixels
-	while (read < size && write < pixels_data_size) {
-		int transparent = dump[read] | dump[read + 1] << 8;
+	while (read < pixels_size && write < pixels_data_size) {
+		int transparent = pixels[read] | pixels[read + 1] << 8;
 		if (use_alpha && transparent >= SPRITE_PIXELS_SIZE) { // Corrupted sprite?
 			break;
 		}
@@ -1396,13 +1730,13 @@ uint8_t* GameSprite::NormalImage::getRGBAData() {
 			write += 4;
 		}
 
-		int colored = dump[read] | dump[read + 1] << 8;
+		int colored = pixels[read] | pixels[read + 1] << 8;
 		read += 2;
 		for (int i = 0; i < colored && write < pixels_data_size; i++) {
-			data[write + 0] = dump[read + 0]; // red
-			data[write + 1] = dump[read + 1]; // green
-			data[write + 2] = dump[read + 2]; // blue
-			data[write + 3] = use_alpha ? dump[read + 3] : 0xFF; // alpha
+			data[write + 0] = pixels[read + 0]; // red
+			data[write + 1] = pixels[read + 1]; // green
+			data[write + 2] = pixels[read + 2]; // blue
+			data[write + 3] = use_alpha ? pixels[read + 3] : 0xFF; // alpha
 			write += 4;
 			read += bpp;
 		}
@@ -1416,17 +1750,56 @@ uint8_t* GameSprite::NormalImage::getRGBAData() {
 		data[write + 3] = 0x00; // alpha
 		write += 4;
 	}
-	return data;
 }
 
 GLuint GameSprite::NormalImage::getHardwareID() {
 	if (!isGLLoaded) {
 		createGLTexture(id);
+	} else {
+		visit();
 	}
-	visit();
 	return id;
 }
 
+SpriteTexture GameSprite::NormalImage::getTexture() {
+	// A sprite that already has its own texture keeps using it until the texture gets cleaned
+	if (!isGLLoaded && g_settings.getInteger(Config::USE_SPRITE_ATLAS)) {
+		SpriteTexture texture;
+		if (g_gui.gfx.atlas.find(atlas_region, texture)) {
+			++g_gui.gfx.atlas_stats.hits;
+			return texture;
+		}
+
+		uint8_t* rgba = getRGBAData();
+		if (rgba) {
+			// No room left this frame, fall back to a texture of its own
+			if (g_gui.gfx.atlas.insert(atlas_region, rgba, texture)) {
+				++g_gui.gfx.atlas_stats.misses;
+			} else {
+				loadGLTexture(id, rgba);
+				texture = SpriteTexture(id);
+			}
+			delete[] rgba;
+			return texture;
+		}
+	}
+	return SpriteTexture(getHardwareID());
+}
+
+bool GameSprite::NormalImage::isLoaded() const {
+	return isGLLoaded || g_gui.gfx.atlas.contains(atlas_region);
+}
+
+bool GameSprite::NormalImage::loadRGBAData(const uint8_t* rgba) {
+	if (g_settings.getInteger(Config::USE_SPRITE_ATLAS)) {
+		// Prefetched sprites never push out pages that are in use
+		SpriteTexture texture;
+		return g_gui.gfx.atlas.hasRoom() && g_gui.gfx.atlas.insert(atlas_region, rgba, texture);
+	}
+	loadGLTexture(id, rgba);
+	return true;
+}
+
 void GameSprite::NormalImage::createGLTexture(GLuint ignored) {
 	Image::createGLTexture(id);
 }
@@ -1571,8 +1944,9 @@ GLuint GameSprite::TemplateImage::getHardwareID() {
 		if (!isGLLoaded) {
 			return 0;
 		}
+	} else {
+		visit();
 	}
-	visit();
 	return gl_tid;
 }
 
@@ -23,6 +23,8 @@
 #include <deque>
 
 #include "client_version.h"
+#include "sprite_atlas.h"
+#include "lru_list.h"
 
 enum SpriteSize {
 	SPRITE_SIZE_16x16,
@@ -44,7 +46,11 @@ enum ItemAnimationDuration {
 class MapCanvas;
 class GraphicManager;
 class FileReadHandle;
+class FileWriteHandle;
+class MappedFileReadHandle;
 class Animator;
+class SpritePrefetcher;
+class MetadataCache;
 
 struct SpriteLight {
 	uint8_t intensity = 0;
@@ -84,6 +90,9 @@ public:
 	int getIndex(int width, int height, int layer, int pattern_x, int pattern_y, int pattern_z, int frame) const;
 	GLuint getHardwareID(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
 	GLuint getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
+	// Same as getHardwareID, but the sprite may sit on an atlas page
+	SpriteTexture getTexture(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
+	SpriteTexture getTexture(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame);
 	virtual void DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int width = -1, int height = -1);
 
 	// Method to draw creatures with outfit colors
@@ -91,8 +100,6 @@ public:
 
 	virtual void unloadDC();
 
-	void clean(int time);
-
 	int getDrawHeight() const;
 	std::pair<int, int> getDrawOffset() const;
 	uint8_t getMiniMapColor() const;
@@ -111,6 +118,8 @@ protected:
 
 	wxMemoryDC* getDC(SpriteSize size);
 	TemplateImage* getTemplateImage(int sprite_index, const Outfit& outfit);
+	Image* getImage(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
+	Image* getImage(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame);
 
 	class Image {
 	public:
@@ -118,17 +127,23 @@ protected:
 		virtual ~Image();
 
 		bool isGLLoaded;
-		int lastaccess;
+		// Position in the texture cache while the image has a texture of its own
+		LRUHook<Image> texture_hook;
 
+		// Marks the texture as used by the current frame
 		void visit();
-		virtual void clean(int time);
+		void unloadTexture() {
+			unloadGLTexture(0);
+		}
 
 		virtual GLuint getHardwareID() = 0;
+		virtual SpriteTexture getTexture();
 		virtual uint8_t* getRGBData() = 0;
 		virtual uint8_t* getRGBAData() = 0;
 
 	protected:
 		virtual void createGLTexture(GLuint whatid);
+		void loadGLTexture(GLuint whatid, const uint8_t* rgba);
 		virtual void unloadGLTexture(GLuint whatid);
 	};
 
@@ -143,16 +158,32 @@ protected:
 		// This contains the pixel data
 		uint16_t size;
 		uint8_t* dump;
+		// Position in the sprite cache while a dump read from the file is held
+		LRUHook<NormalImage> dump_hook;
 
-		virtual void clean(int time);
+		// Where the sprite sits in the atlas, if it still does
+		SpriteAtlas::Region atlas_region;
 
 		virtual GLuint getHardwareID();
+		virtual SpriteTexture getTexture();
 		virtual uint8_t* getRGBData();
 		virtual uint8_t* getRGBAData();
 
+		// True when drawing it won't need decoding
+		bool isLoaded() const;
+		// Puts pixels decoded elsewhere on the GPU, fails if the atlas has no free slot
+		bool loadRGBAData(const uint8_t* rgba);
+		// Decompresses a sprite dump into 32x32 RGBA pixels, safe to call from any thread
+		static void decodeRGBA(const uint8_t* pixels, uint16_t pixels_size, bool use_alpha, uint8_t* data);
+
+		void releaseDump();
+
 	protected:
 		virtual void createGLTexture(GLuint ignored = 0);
 		virtual void unloadGLTexture(GLuint ignored = 0);
+
+		// Compressed pixels of the sprite, read from the sprite file when they aren't held already
+		bool getDump(const uint8_t*& pixels, uint16_t& pixels_size);
 	};
 
 	class TemplateImage : public Image {
@@ -208,6 +239,7 @@ public:
 	std::list<TemplateImage*> instanced_templates; // Templates that use this sprite
 
 	friend class GraphicManager;
+	friend class SpritePrefetcher;
 };
 
 struct FrameDuration {
@@ -265,6 +297,8 @@ private:
 	AnimationDirection direction;
 	long last_time;
 	bool is_complete;
+
+	friend class GraphicManager;
 };
 
 class GraphicManager {
@@ -286,7 +320,7 @@ public:
 	uint16_t getCreatureSpriteMaxID() const;
 
 	// Get an unused texture id (this is acquired by simply increasing a value starting from 0x10000000)
-	GLuint getFreeTextureID();
+	static GLuint getFreeTextureID();
 
 	// This is part of the binary
 	bool loadEditorSprites();
@@ -296,10 +330,16 @@ public:
 	bool loadSpriteMetadata(const FileName& datafile, wxString& error, wxArrayString& warnings);
 	bool loadSpriteMetadataFlags(FileReadHandle& file, GameSprite* sType, wxString& error, wxArrayString& warnings);
 	bool loadSpriteData(const FileName& datafile, wxString& error, wxArrayString& warnings);
+	// The state loadSpriteMetadata leaves behind, as stored by MetadataCache
+	bool loadSpriteMetadataCache(FileReadHandle& file);
+	void saveSpriteMetadataCache(FileWriteHandle& file) const;
 
-	// Cleans old & unused textures according to config settings
-	void garbageCollection();
 	void addSpriteToCleanup(GameSprite* spr);
+	// Called before every frame is drawn, textures used by it are kept until the next one
+	void nextFrame();
+	// Decodes the images of a sprite on worker threads, they get uploaded by uploadPrefetchedSprites
+	void prefetchSprite(GameSprite* sprite);
+	void uploadPrefetchedSprites();
 
 	wxFileName getMetadataFileName() const {
 		return metadata_file;
@@ -311,6 +351,31 @@ public:
 	bool hasTransparency() const;
 	bool isUnloaded() const;
 
+	struct CacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+	};
+
+	// Counters for the memory window
+	struct MemoryStats {
+		size_t sprites = 0;
+		size_t images = 0;
+		size_t dumps = 0; // Compressed sprite data held in memory
+		size_t dump_bytes = 0;
+		size_t mapped_bytes = 0; // Sprite file mapped into memory, its pages belong to the file cache
+		size_t textures = 0; // Images uploaded to the GPU
+		size_t texture_bytes = 0;
+		size_t atlas_sprites = 0; // Sprites packed into shared atlas pages
+		size_t atlas_bytes = 0;
+		size_t software_sprites = 0; // Sprites with cached wxDC bitmaps
+		size_t texture_budget = 0; // Textures and atlas pages together, 0 when unlimited
+		size_t dump_budget = 0;
+		CacheStats texture_cache;
+		CacheStats dump_cache;
+	};
+	MemoryStats getMemoryStats() const;
+
 	ClientVersion* client_version;
 
 private:
@@ -318,6 +383,30 @@ private:
 	// This is used if memcaching is NOT on
 	std::string spritefile;
 	bool loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id);
+	// Reads a dump from the sprite file without touching any state, safe to call from any thread
+	bool readSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id) const;
+	// With mapped sprites the whole file is mapped once and sprites point into it
+	std::unique_ptr<MappedFileReadHandle> sprite_mapping;
+	uint32_t sprite_count;
+	bool getMappedSpriteDump(const uint8_t*& target, uint16_t& size, int sprite_id) const;
+	// Images are shared by every sprite that uses the same sprite id
+	GameSprite::NormalImage* getNormalImage(uint32_t sprite_id);
+	SpriteAtlas atlas;
+	std::unique_ptr<SpritePrefetcher> prefetcher;
+
+	// Images with a texture of their own and dumps read from the sprite file, least recently used last
+	// Both are kept within the sizes set in the preferences, replacing the old timed cleanup.
+	LRUList<GameSprite::Image, &GameSprite::Image::texture_hook> texture_cache;
+	LRUList<GameSprite::NormalImage, &GameSprite::NormalImage::dump_hook> dump_cache;
+	CacheStats texture_stats;
+	CacheStats atlas_stats; // Evictions are counted by the atlas itself
+	CacheStats dump_stats;
+	uint64_t frame;
+	size_t getTextureBudget() const;
+	size_t getAtlasBudget() const;
+	size_t getDumpBudget() const;
+	void addTexture(GameSprite::Image* image);
+	void addDump(GameSprite::NormalImage* image);
 
 	typedef std::map<int, Sprite*> SpriteMap;
 	SpriteMap sprite_space;
@@ -337,13 +426,16 @@ private:
 	wxFileName sprites_file;
 
 	int loaded_textures;
-	int lastclean;
+	size_t loaded_dumps;
+	size_t loaded_dump_bytes;
 
 	wxStopWatch* animation_timer;
 
 	friend class GameSprite::Image;
 	friend class GameSprite::NormalImage;
 	friend class GameSprite::TemplateImage;
+	friend class SpritePrefetcher;
+	friend class MetadataCache;
 };
 
 struct RGBQuad {
@@ -536,7 +536,7 @@ bool GroundBrush::load(pugi::xml_node node, wxArrayString& warnings) {
 void GroundBrush::undraw(BaseMap* map, Tile* tile) {
 	ASSERT(tile);
 	if (tile->hasGround() && tile->ground->getGroundBrush() == this) {
-		delete tile->ground;
+		Item::Release(tile->ground);
 		tile->ground = nullptr;
 	}
 }
@@ -578,7 +578,7 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 	// Always properly handle ground items
 	// First remove any existing ground
 	if (tile->ground) {
-		delete tile->ground;
+		Item::Release(tile->ground);
 		tile->ground = nullptr;
 	}
 	
@@ -590,7 +590,7 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 #ifdef __WXDEBUG__
 			printf("DEBUG: Removing misplaced ground item with ID %d from tile items\n", item->getID());
 #endif
-			delete item;
+			Item::Release(item);
 			it = tile->items.erase(it);
 		} else {
 			++it;
@@ -702,7 +702,7 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile) {
 					}
 					
 					if (found) {
-						delete *it;
+						Item::Release(*it);
 						it = tile->items.erase(it);
 					} else {
 						++it;
@@ -1203,7 +1203,7 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile) {
 				
 				if (is_current_border) {
 					// Remove only borders from the current border group
-					delete *it;
+					Item::Release(*it);
 					it = tile->items.erase(it);
 				} else {
 					// Keep borders from other border groups
@@ -1380,7 +1380,7 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile) {
 								replaced = true;
 							} else {
 								if (specificCaseBlock->delete_all || !specificCaseBlock->keepBorder) {
-									delete item;
+									Item::Release(item);
 									it = tileItems.erase(it);
 									inc = false;
 									break;
@@ -1412,7 +1412,7 @@ void GroundBrush::reborderizeTile(BaseMap* map, Tile* tile) {
 			if ((*it)->isBorder() && (*it) != tile->ground) {
 				// For each border item, check if it belongs to a non-current border group
 				// For now, just remove all borders for simplicity
-				delete *it;
+				Item::Release(*it);
 				it = tile->items.erase(it);
 			} else {
 				++it;
@@ -165,6 +165,8 @@
 #include "common_windows.h"
 #include "result_window.h"
 #include "map_summary_window.h"
+#include "memory_window.h"
+#include "metadata_cache.h"
 #include "minimap_window.h"
 #include "palette_window.h"
 #include "map_display.h"
@@ -196,6 +198,7 @@ GUI::GUI() :
 	hotkeys_enabled(true),
 	search_result_window(nullptr),
 	map_summary_window(nullptr),
+	memory_window(nullptr),
 	loaded_version(CLIENT_VERSION_NONE),
 	secondary_map(nullptr),
 	minimap(nullptr),
@@ -528,22 +531,48 @@ bool GUI::LoadDataFiles(wxString& error, wxArrayString& warnings) {
 
 	g_gui.gfx.client_version = getLoadedVersion();
 
+	// Startup log, one line per asset file
+	wxStopWatch file_timer;
+	auto logLoadTime = [&file_timer](const wxString& file) {
+		std::cout << "Loaded " << nstr(file) << " in " << file_timer.Time() << " ms" << std::endl;
+		file_timer.Start();
+	};
+
 	if (!g_gui.gfx.loadOTFI(client_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR), error, warnings)) {
 		error = "Couldn't load otfi file: " + error;
 		g_gui.DestroyLoadBar();
 		UnloadVersion();
 		return false;
 	}
+	logLoadTime("otfi file");
+
+	// The parsed .dat and items files of a version loaded before, hashing the files decides if it still applies
+	std::unique_ptr<MetadataCache> metadata_cache;
+	if (g_settings.getBoolean(Config::METADATA_CACHE)) {
+		metadata_cache.reset(newd MetadataCache(*getLoadedVersion(), g_gui.gfx, data_path));
+		metadata_cache->open();
+		logLoadTime("metadata cache check");
+	}
 
 	g_gui.CreateLoadBar("Loading asset files");
 	g_gui.SetLoadDone(0, "Loading metadata file...");
 
 	wxFileName metadata_path = g_gui.gfx.getMetadataFileName();
-	if (!g_gui.gfx.loadSpriteMetadata(metadata_path, error, warnings)) {
-		error = "Couldn't load metadata: " + error;
-		g_gui.DestroyLoadBar();
-		UnloadVersion();
-		return false;
+	wxArrayString sprite_warnings;
+	const bool sprites_cached = metadata_cache && metadata_cache->loadSprites(g_gui.gfx, sprite_warnings);
+	if (sprites_cached) {
+		logLoadTime(metadata_path.GetFullName() + " (cached)");
+	} else {
+		if (!g_gui.gfx.loadSpriteMetadata(metadata_path, error, sprite_warnings)) {
+			error = "Couldn't load metadata: " + error;
+			g_gui.DestroyLoadBar();
+			UnloadVersion();
+			return false;
+		}
+		logLoadTime(metadata_path.GetFullName());
+	}
+	for (const wxString& warning : sprite_warnings) {
+		warnings.push_back(warning);
 	}
 
 	g_gui.SetLoadDone(10, "Loading sprites file...");
@@ -555,24 +584,43 @@ bool GUI::LoadDataFiles(wxString& error, wxArrayString& warnings) {
 		UnloadVersion();
 		return false;
 	}
+	logLoadTime(sprites_path.GetFullName());
 
 	g_gui.SetLoadDone(20, "Loading items.otb file...");
-	if (!g_items.loadFromOtb(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.otb"), error, warnings)) {
-		error = "Couldn't load items.otb: " + error;
-		g_gui.DestroyLoadBar();
-		UnloadVersion();
-		return false;
-	}
+	wxArrayString item_warnings;
+	const bool items_cached = sprites_cached && metadata_cache->loadItems(g_items, item_warnings);
+	if (items_cached) {
+		logLoadTime("items.otb and items.xml (cached)");
+	} else {
+		if (!g_items.loadFromOtb(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.otb"), error, item_warnings)) {
+			error = "Couldn't load items.otb: " + error;
+			g_gui.DestroyLoadBar();
+			UnloadVersion();
+			return false;
+		}
+		logLoadTime("items.otb");
+
+		g_gui.SetLoadDone(30, "Loading items.xml ...");
+		if (!g_items.loadFromGameXml(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.xml"), error, item_warnings)) {
+			item_warnings.push_back("Couldn't load items.xml: " + error);
+		}
+		logLoadTime("items.xml");
 
-	g_gui.SetLoadDone(30, "Loading items.xml ...");
-	if (!g_items.loadFromGameXml(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.xml"), error, warnings)) {
-		warnings.push_back("Couldn't load items.xml: " + error);
+		// Written before the brushes are loaded, they change the item types
+		if (metadata_cache) {
+			metadata_cache->save(g_gui.gfx, sprite_warnings, g_items, item_warnings);
+			logLoadTime("metadata cache");
+		}
+	}
+	for (const wxString& warning : item_warnings) {
+		warnings.push_back(warning);
 	}
 
 	g_gui.SetLoadDone(45, "Loading creatures.xml ...");
 	if (!g_creatures.loadFromXML(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "creatures.xml"), true, error, warnings)) {
 		warnings.push_back("Couldn't load creatures.xml: " + error);
 	}
+	logLoadTime("creatures.xml");
 
 	g_gui.SetLoadDone(45, "Loading user creatures.xml ...");
 	{
@@ -582,11 +630,13 @@ bool GUI::LoadDataFiles(wxString& error, wxArrayString& warnings) {
 		wxArrayString nwarn;
 		g_creatures.loadFromXML(cdb, false, nerr, nwarn);
 	}
+	logLoadTime("user creatures.xml");
 
 	g_gui.SetLoadDone(50, "Loading materials.xml ...");
 	if (!g_materials.loadMaterials(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "materials.xml"), error, warnings)) {
 		warnings.push_back("Couldn't load materials.xml: " + error);
 	}
+	logLoadTime("materials.xml");
 	
 	g_gui.SetLoadDone(60, "Loading collections.xml ...");
 	if (!g_materials.loadMaterials(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "collections.xml"), error, warnings)) {
@@ -1360,6 +1410,18 @@ MapSummaryWindow* GUI::ShowMapSummaryWindow() {
 	return map_summary_window;
 }
 
+MemoryWindow* GUI::ShowMemoryWindow() {
+	if (memory_window == nullptr) {
+		memory_window = newd MemoryWindow(root);
+		aui_manager->AddPane(memory_window, wxAuiPaneInfo().Caption("Memory Usage").Float());
+	} else {
+		aui_manager->GetPane(memory_window).Show();
+		memory_window->RefreshReport();
+	}
+	aui_manager->Update();
+	return memory_window;
+}
+
 //=============================================================================
 // Palette Window Interface implementation
 
@@ -2591,6 +2653,18 @@ int GUI::GetHotkeyEventId(const std::string& action) {
 	return -1; // Temporary return until implementation
 }
 
+void GUI::UpdateBackgroundSaves() {
+	if (!tabbook) {
+		return;
+	}
+	for (int i = 0; i < tabbook->GetTabCount(); ++i) {
+		auto* mapTab = dynamic_cast<MapTab*>(tabbook->GetTab(i));
+		if (mapTab && mapTab->GetEditor()) {
+			mapTab->GetEditor()->updateBackgroundSave();
+		}
+	}
+}
+
 void GUI::CheckAutoSave() {
 	uint32_t now = time(nullptr);
 	
@@ -2620,7 +2694,8 @@ void GUI::CheckAutoSave() {
 	
 	if (now - last_autosave >= interval) {
 		Editor* editor = GetCurrentEditor();
-		if (editor) {
+		// Try again on the next check if a save is still running
+		if (editor && !editor->isSaving()) {
 			OutputDebugStringA("Performing autosave...\n");
 			
 			// Create autosave directory in RME data folder
@@ -2669,22 +2744,18 @@ void GUI::CheckAutoSave() {
 			*/
 			}
 
-			wxString ext = current.GetExt();
-			if (ext.empty()) {
-				ext = "otbm";
-			}
-			
+			// Autosaves are written by the background saver, which only writes OTBM
 			wxString autosave_name = autosave_dir + name + "_autosave_" + 
-				wxDateTime::Now().Format("%Y-%m-%d_%H-%M-%S") + "." + ext;
+				wxDateTime::Now().Format("%Y-%m-%d_%H-%M-%S") + ".otbm";
 
 			OutputDebugStringA("Saving to: ");
 			OutputDebugStringA(autosave_name.c_str());
 			OutputDebugStringA("\n");
 
-			// Use existing SaveCurrentMap with our autosave filename
-			SaveCurrentMap(autosave_name, false);
+			// Write a copy in the background, the map keeps its own file name and unsaved state
+			editor->saveMapCopy(autosave_name);
 			last_autosave = now;
-			OutputDebugStringA("Autosave complete\n");
+			OutputDebugStringA("Autosave started\n");
 		}
 	}
 }
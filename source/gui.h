@@ -52,6 +52,7 @@ class MapCanvas;
 
 class SearchResultWindow;
 class MapSummaryWindow;
+class MemoryWindow;
 class MinimapWindow;
 class PaletteWindow;
 class OldPropertiesWindow;
@@ -227,6 +228,9 @@ public:
 	MapSummaryWindow* GetMapSummaryWindow();
 	MapSummaryWindow* ShowMapSummaryWindow();
 	void HideMapSummaryWindow();
+
+	// Memory usage breakdown
+	MemoryWindow* ShowMemoryWindow();
 	
 	// Search state persistence
 	void StoreSearchState(uint16_t itemId, bool onSelection);
@@ -378,6 +382,8 @@ public:
 	void SaveCurrentMap(bool showdialog = true) {
 		SaveCurrentMap(wxString(""), showdialog);
 	}
+	// Progress and completion of saves running in the background, called on the main thread
+	void UpdateBackgroundSaves();
 	bool NewMap();
 	void OpenMap();
 	void SaveMap();
@@ -437,6 +443,7 @@ public:
 	DCButton* gem; // The small gem in the lower-right corner
 	SearchResultWindow* search_result_window;
 	MapSummaryWindow* map_summary_window;
+	MemoryWindow* memory_window;
 	GraphicManager gfx;
 
 	BaseMap* secondary_map; // A non-owning pointer to doodad_buffer_map when needed
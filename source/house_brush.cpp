@@ -75,7 +75,7 @@ void HouseBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 			 /*..*/) {
 			Item* item = *it;
 			if (item->isNotMoveable() == 0) {
-				delete item;
+				Item::Release(item);
 				it = tile->items.erase(it);
 			} else {
 				++it;
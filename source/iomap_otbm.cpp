@@ -23,6 +23,9 @@
 #include <wx/mstream.h>
 #include <wx/datstrm.h>
 
+#include <filesystem>
+#include <functional>
+
 #include "settings.h"
 #include "gui.h" // Loadbar
 
@@ -36,6 +39,9 @@
 #include "wall_brush.h"
 
 #include "iomap_otbm.h"
+#include "map_snapshot.h"
+#include "ordered_job_queue.h"
+#include "xml_stream_writer.h"
 
 typedef uint8_t attribute_t;
 typedef uint32_t flags_t;
@@ -517,6 +523,467 @@ void Podium::serializeItemAttributes_OTBM(const IOMap& maphandle, NodeFileWriteH
 	|--- OTBM_ITEM_DEF (not implemented)
 */
 
+namespace {
+	// The tiles of one OTBM_TILE_AREA node. They are decoded without touching the map,
+	// so areas can be decoded on worker threads and then merged into the map in file order.
+	struct LoadedTileArea {
+		struct Entry {
+			Position pos;
+			Tile* tile; // nullptr if the tile was discarded
+			uint32_t house_id;
+			// Warnings raised while reading the tile, dropped along with it if it's a duplicate
+			size_t first_warning;
+			size_t end_warning;
+		};
+
+		LoadedTileArea() = default;
+		LoadedTileArea(const LoadedTileArea&) = delete;
+		LoadedTileArea& operator=(const LoadedTileArea&) = delete;
+		~LoadedTileArea() {
+			for (Entry& entry : tiles) {
+				delete entry.tile;
+			}
+		}
+
+		void warning(const wxString& message) {
+			warnings.push_back(message);
+		}
+
+		std::vector<Entry> tiles;
+		wxArrayString warnings;
+	};
+
+	// Reads the tiles of an area node whose type byte has been read already
+	void decodeTileArea(const IOMap& maphandle, BinaryNode* mapNode, LoadedTileArea& area) {
+		uint16_t base_x, base_y;
+		uint8_t base_z;
+		if (!mapNode->getU16(base_x) || !mapNode->getU16(base_y) || !mapNode->getU8(base_z)) {
+			area.warning("Invalid map node, no base coordinate");
+			return;
+		}
+
+		for (BinaryNode* tileNode = mapNode->getChild(); tileNode != nullptr; tileNode = tileNode->advance()) {
+			uint8_t tile_type;
+			if (!tileNode->getByte(tile_type)) {
+				area.warning("Invalid tile type");
+				continue;
+			}
+			if (tile_type != OTBM_TILE && tile_type != OTBM_HOUSETILE) {
+				area.warning("Unknown type of tile node");
+				continue;
+			}
+
+			uint8_t x_offset, y_offset;
+			if (!tileNode->getU8(x_offset) || !tileNode->getU8(y_offset)) {
+				area.warning("Could not read position of tile");
+				continue;
+			}
+			const Position pos(base_x + x_offset, base_y + y_offset, base_z);
+
+			area.tiles.push_back({ pos, nullptr, 0, area.warnings.size(), 0 });
+			LoadedTileArea::Entry& entry = area.tiles.back();
+
+			if (tile_type == OTBM_HOUSETILE) {
+				if (!tileNode->getU32(entry.house_id)) {
+					area.warning("House tile without house data, discarding tile");
+					entry.end_warning = area.warnings.size();
+					continue;
+				}
+				if (entry.house_id == 0) {
+					area.warning(wxString::Format("Invalid house id from tile %d:%d:%d", pos.x, pos.y, pos.z));
+				}
+			}
+
+			// The location is only known once the tile is merged into the map
+			Tile* tile = newd Tile(pos.x, pos.y, pos.z);
+
+			uint8_t attribute;
+			while (tileNode->getU8(attribute)) {
+				switch (attribute) {
+					case OTBM_ATTR_TILE_FLAGS: {
+						uint32_t flags = 0;
+						if (!tileNode->getU32(flags)) {
+							area.warning(wxString::Format("Invalid tile flags of tile on %d:%d:%d", pos.x, pos.y, pos.z));
+						}
+						tile->setMapFlags(flags);
+						if (flags & TILESTATE_ZONE_BRUSH) {
+							uint16_t zoneId = 0;
+							do {
+								if (!tileNode->getU16(zoneId)) {
+									area.warning(wxString::Format("Invalid zone id of tile on %d:%d:%d", pos.x, pos.y, pos.z));
+								}
+
+								if (zoneId != 0) {
+									tile->addZoneId(zoneId);
+								}
+							} while (zoneId != 0);
+						}
+						break;
+					}
+					case OTBM_ATTR_ITEM: {
+						Item* item = Item::Create_OTBM(maphandle, tileNode);
+						if (item == nullptr) {
+							area.warning(wxString::Format("Invalid item at tile %d:%d:%d", pos.x, pos.y, pos.z));
+						}
+						tile->addItem(item);
+						break;
+					}
+					default: {
+						area.warning(wxString::Format("Unknown tile attribute at %d:%d:%d", pos.x, pos.y, pos.z));
+						break;
+					}
+				}
+			}
+
+			for (BinaryNode* itemNode = tileNode->getChild(); itemNode != nullptr; itemNode = itemNode->advance()) {
+				uint8_t item_type;
+				if (!itemNode->getByte(item_type)) {
+					area.warning(wxString::Format("Unknown item type %d:%d:%d", pos.x, pos.y, pos.z));
+					continue;
+				}
+				if (item_type == OTBM_ITEM) {
+					Item* item = Item::Create_OTBM(maphandle, itemNode);
+					if (item) {
+						if (!item->unserializeItemNode_OTBM(maphandle, itemNode)) {
+							area.warning(wxString::Format("Couldn't unserialize item attributes at %d:%d:%d", pos.x, pos.y, pos.z));
+						}
+						tile->addItem(item);
+					}
+				} else {
+					area.warning("Unknown type of tile child node");
+				}
+			}
+
+			tile->update();
+			entry.tile = tile;
+			entry.end_warning = area.warnings.size();
+		}
+	}
+
+	// Puts the tiles of a decoded area on the map, in the order they were read.
+	// Gives the same tiles and warnings as if the area had been loaded in place.
+	void mergeTileArea(Map& map, LoadedTileArea& area, wxArrayString& warnings) {
+		size_t next_warning = 0;
+		for (LoadedTileArea::Entry& entry : area.tiles) {
+			for (; next_warning < entry.first_warning; ++next_warning) {
+				warnings.push_back(area.warnings[next_warning]);
+			}
+			next_warning = entry.end_warning;
+
+			const Position& pos = entry.pos;
+			if (map.getTile(pos)) {
+				warnings.push_back(wxString::Format("Duplicate tile at %d:%d:%d, discarding duplicate", pos.x, pos.y, pos.z));
+				continue;
+			}
+			for (size_t i = entry.first_warning; i < entry.end_warning; ++i) {
+				warnings.push_back(area.warnings[i]);
+			}
+
+			Tile* tile = entry.tile;
+			if (!tile) {
+				continue;
+			}
+			entry.tile = nullptr;
+			tile->setLocation(map.createTileL(pos));
+
+			if (entry.house_id) {
+				House* house = map.houses.getHouse(entry.house_id);
+				if (!house) {
+					house = newd House(map);
+					house->setID(entry.house_id);
+					map.houses.addHouse(house);
+				}
+				house->addTile(tile);
+			}
+
+			map.setTile(pos.x, pos.y, pos.z, tile);
+		}
+		for (; next_warning < area.warnings.size(); ++next_warning) {
+			warnings.push_back(area.warnings[next_warning]);
+		}
+	}
+
+	// A tile area cut out of the map file, decoded on a worker thread
+	struct TileAreaLoadJob {
+		TileAreaLoadJob(const uint8_t* data, size_t size, size_t file_offset) :
+			data(data), size(size), file_offset(file_offset) { }
+		TileAreaLoadJob(std::vector<uint8_t>&& bytes, size_t file_offset) :
+			bytes(std::move(bytes)), data(this->bytes.data()), size(this->bytes.size()), file_offset(file_offset) { }
+
+		std::vector<uint8_t> bytes; // Owned copy of the area, when the file isn't in memory as a whole
+		const uint8_t* data; // Raw area node, from its NODE_START to its NODE_END
+		size_t size;
+		size_t file_offset;
+		LoadedTileArea area;
+	};
+
+	// Writes one tile node
+	void serializeTile(const IOMap& self, Tile* save_tile, NodeFileWriteHandle& f) {
+		f.addNode(save_tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
+
+		f.addU8(save_tile->getX() & 0xFF);
+		f.addU8(save_tile->getY() & 0xFF);
+
+		if (save_tile->isHouseTile()) {
+			f.addU32(save_tile->getHouseID());
+		}
+
+		if (save_tile->getMapFlags()) {
+			f.addByte(OTBM_ATTR_TILE_FLAGS);
+			f.addU32(save_tile->getMapFlags());
+			if (save_tile->getMapFlags() & TILESTATE_ZONE_BRUSH) {
+				for (const auto& zoneId : save_tile->getZoneIds()) {
+					f.addU16(zoneId);
+				}
+				f.addU16(0);
+			}
+		}
+
+		if (save_tile->ground) {
+			Item* ground = save_tile->ground;
+			if (ground->isMetaItem()) {
+				// Do nothing, we don't save metaitems...
+			} else if (ground->hasBorderEquivalent()) {
+				bool found = false;
+				for (Item* item : save_tile->items) {
+					if (item->getGroundEquivalent() == ground->getID()) {
+						// Do nothing
+						// Found equivalent
+						found = true;
+						break;
+					}
+				}
+
+				if (!found) {
+					ground->serializeItemNode_OTBM(self, f);
+				}
+			} else if (ground->isComplex()) {
+				ground->serializeItemNode_OTBM(self, f);
+			} else {
+				f.addByte(OTBM_ATTR_ITEM);
+				ground->serializeItemCompact_OTBM(self, f);
+			}
+		}
+
+		for (Item* item : save_tile->items) {
+			if (!item->isMetaItem()) {
+				item->serializeItemNode_OTBM(self, f);
+			}
+		}
+
+		f.endNode();
+	}
+
+	// Writes an area node holding tiles that all lie in the same 256x256 block of a floor
+	void serializeTileArea(const IOMap& self, const std::vector<Tile*>& tiles, NodeFileWriteHandle& f) {
+		const Position& pos = tiles.front()->getPosition();
+		f.addNode(OTBM_TILE_AREA);
+		f.addU16(pos.x & 0xFF00);
+		f.addU16(pos.y & 0xFF00);
+		f.addU8(pos.z);
+		for (Tile* save_tile : tiles) {
+			serializeTile(self, save_tile, f);
+		}
+		f.endNode();
+	}
+
+	// A run of tiles that share an area node, encoded on a worker thread
+	struct TileAreaSaveJob {
+		std::vector<Tile*> tiles;
+		MemoryNodeFileWriteHandle buffer;
+		uint32_t encoded_key; // Handed to the encoded callback once the area is in the buffer
+	};
+
+	// Cuts tiles into area nodes and writes them to f. With more than one worker thread, each area
+	// is encoded into its own buffer in the background and the buffers are written out in the order
+	// the areas were cut, so the file is the same either way.
+	// Tiles are added with a key that never decreases, encoded is called with a key once every tile
+	// added with a lower one has been encoded, possibly on a worker thread. Until then the tiles must
+	// not change, the file write doesn't need them anymore.
+	class TileAreaWriter {
+	public:
+		TileAreaWriter(const IOMap& self, NodeFileWriteHandle& f, int worker_count, std::function<void(uint32_t)> encoded = nullptr) :
+			self(self),
+			f(f),
+			max_queued_areas(worker_count * 4),
+			encoded(std::move(encoded)),
+			local_x(-1),
+			local_y(-1),
+			local_z(-1) {
+			if (worker_count > 1) {
+				std::function<void(TileAreaSaveJob&)> finished;
+				if (this->encoded) {
+					finished = [this](TileAreaSaveJob& job) {
+						this->encoded(job.encoded_key);
+					};
+				}
+				encoder.reset(newd OrderedJobQueue<TileAreaSaveJob>(worker_count, [&self](TileAreaSaveJob& job) {
+					serializeTileArea(self, job.tiles, job.buffer);
+				}, std::move(finished)));
+			}
+		}
+
+		void add(Tile* tile, uint32_t key = 0) {
+			const Position& pos = tile->getPosition();
+			// Decide if newd node should be created
+			if (pos.x < local_x || pos.x >= local_x + 256 || pos.y < local_y || pos.y >= local_y + 256 || pos.z != local_z) {
+				flushArea(key);
+				local_x = pos.x & 0xFF00;
+				local_y = pos.y & 0xFF00;
+				local_z = pos.z;
+			}
+			area_tiles.push_back(tile);
+		}
+
+		// Writes out every tile added so far
+		void finish() {
+			flushArea(std::numeric_limits<uint32_t>::max());
+			if (encoder) {
+				writeEncodedAreas(true);
+			}
+		}
+
+	private:
+		void flushArea(uint32_t key) {
+			if (area_tiles.empty()) {
+				return;
+			}
+			if (!encoder) {
+				if (!encoded) {
+					serializeTileArea(self, area_tiles, f);
+				} else {
+					// Hand the tiles back before the slower file write
+					MemoryNodeFileWriteHandle buffer;
+					serializeTileArea(self, area_tiles, buffer);
+					encoded(key);
+					f.addNodeData(buffer.getMemory(), buffer.getSize());
+				}
+				area_tiles.clear();
+				return;
+			}
+
+			std::unique_ptr<TileAreaSaveJob> job(newd TileAreaSaveJob);
+			job->tiles.swap(area_tiles);
+			job->encoded_key = key;
+			encoder->push(std::move(job));
+			writeEncodedAreas(false);
+			// Don't let the finished buffers pile up in memory
+			while (encoder->size() >= max_queued_areas) {
+				write(*encoder->pop(true));
+			}
+		}
+
+		void writeEncodedAreas(bool wait) {
+			while (std::unique_ptr<TileAreaSaveJob> job = encoder->pop(wait)) {
+				write(*job);
+			}
+		}
+
+		void write(TileAreaSaveJob& job) {
+			f.addNodeData(job.buffer.getMemory(), job.buffer.getSize());
+		}
+
+		const IOMap& self;
+		NodeFileWriteHandle& f;
+		const size_t max_queued_areas;
+		std::function<void(uint32_t)> encoded;
+		std::unique_ptr<OrderedJobQueue<TileAreaSaveJob>> encoder;
+		std::vector<Tile*> area_tiles;
+		int local_x, local_y, local_z;
+	};
+
+	// The auxiliary files only hold elements and attributes, leave out the rest of the parsing
+	const unsigned int XML_INPLACE_PARSE_OPTIONS = pugi::parse_minimal | pugi::parse_escapes | pugi::parse_eol;
+
+	// Reads a whole XML file into buffer and parses it there, the document keeps pointing into
+	// the buffer instead of copying out every name and value. The path is UTF-8.
+	bool loadXMLInPlace(const std::string& path, std::vector<char>& buffer, pugi::xml_document& doc) {
+		FileReadHandle f(path);
+		if (!f.isOk()) {
+			return false;
+		}
+		buffer.resize(f.size());
+		if (!f.getRAW(reinterpret_cast<uint8_t*>(buffer.data()), buffer.size())) {
+			return false;
+		}
+		return doc.load_buffer_inplace(buffer.data(), buffer.size(), XML_INPLACE_PARSE_OPTIONS);
+	}
+
+	// Opens the writer for a map file, .otbz streams the same nodes through a compressor
+	std::unique_ptr<NodeFileWriteHandle> createMapWriteHandle(const FileName& identifier) {
+		const std::string magic = g_settings.getInteger(Config::SAVE_WITH_OTB_MAGIC_NUMBER) ? "OTBM" : std::string(4, '\0');
+#ifdef OTBZ_SUPPORT
+		if (identifier.GetExt() == "otbz") {
+			const FileCompression compression = g_settings.getBoolean(Config::OTBZ_USE_LZ4) ? FILE_COMPRESSION_LZ4 : FILE_COMPRESSION_ZSTD;
+			const int threads = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+			return std::unique_ptr<NodeFileWriteHandle>(newd CompressedNodeFileWriteHandle(nstr(identifier.GetFullPath()), magic, compression, threads));
+		}
+#endif
+		return std::unique_ptr<NodeFileWriteHandle>(newd DiskNodeFileWriteHandle(nstr(identifier.GetFullPath()), magic));
+	}
+
+	// The journal is a header followed by one record per save, each record is a node tree
+	// prefixed with its size. Records hold every tile of the chunks changed since the save
+	// before, the towns, the waypoints and the map attributes.
+	const char OTBM_JOURNAL_IDENTIFIER[4] = { 'O', 'T', 'B', 'J' };
+	const uint32_t OTBM_JOURNAL_VERSION = 1;
+	// Once the journal would grow past this fraction of the map file, the map is saved in full
+	const uint64_t OTBM_JOURNAL_COMPACT_DIVISOR = 4;
+
+	struct JournalHeader {
+		uint32_t version;
+		uint64_t map_size; // Size and modification time of the map file the journal applies to
+		uint64_t map_time;
+	};
+
+	std::string getJournalPath(const FileName& identifier) {
+		return nstr(identifier.GetFullPath()) + ".journal";
+	}
+
+	bool getJournalHeader(const FileName& identifier, JournalHeader& header) {
+		if (!identifier.FileExists()) {
+			return false;
+		}
+		const wxULongLong size = identifier.GetSize();
+		if (size == wxInvalidSize) {
+			return false;
+		}
+		header.version = OTBM_JOURNAL_VERSION;
+		header.map_size = size.GetValue();
+		header.map_time = static_cast<uint64_t>(identifier.GetModificationTime().GetTicks());
+		return true;
+	}
+
+	// Reads the header of an existing journal, returns false if it is missing or damaged
+	bool readJournalHeader(FileReadHandle& f, JournalHeader& header) {
+		char identifier[4];
+		return f.getRAW(reinterpret_cast<uint8_t*>(identifier), 4) && memcmp(identifier, OTBM_JOURNAL_IDENTIFIER, 4) == 0
+			&& f.getU32(header.version) && f.getU64(header.map_size) && f.getU64(header.map_time);
+	}
+
+	bool matchesJournalHeader(const JournalHeader& a, const JournalHeader& b) {
+		return a.version == b.version && a.map_size == b.map_size && a.map_time == b.map_time;
+	}
+
+	// Deletes every tile of a chunk, a journal record replaces the chunk as a whole
+	void clearJournalChunk(Map& map, int chunk_x, int chunk_y, int z) {
+		for (int x = chunk_x; x < chunk_x + MapGenerationTable::CHUNK_SIZE; ++x) {
+			for (int y = chunk_y; y < chunk_y + MapGenerationTable::CHUNK_SIZE; ++y) {
+				Tile* tile = map.getTile(x, y, z);
+				if (!tile) {
+					continue;
+				}
+				if (tile->isHouseTile()) {
+					if (House* house = map.houses.getHouse(tile->getHouseID())) {
+						house->removeTile(tile);
+					}
+				}
+				map.setTile(x, y, z, nullptr, true);
+			}
+		}
+	}
+}
+
 bool IOMapOTBM::getVersionInfo(const FileName& filename, MapVersion& out_ver) {
 #ifdef OTGZ_SUPPORT
 	if (filename.GetExt() == "otgz") {
@@ -559,6 +1026,16 @@ bool IOMapOTBM::getVersionInfo(const FileName& filename, MapVersion& out_ver) {
 	}
 #endif
 
+#ifdef OTBZ_SUPPORT
+	if (filename.GetExt() == "otbz") {
+		CompressedNodeFileReadHandle f(nstr(filename.GetFullPath()), StringVector(1, "OTBM"));
+		if (!f.isOk()) {
+			return false;
+		}
+		return getVersionInfo(&f, out_ver);
+	}
+#endif
+
 	// Just open a disk-based read handle
 	DiskNodeFileReadHandle f(nstr(filename.GetFullPath()), StringVector(1, "OTBM"));
 	if (!f.isOk()) {
@@ -690,7 +1167,7 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 		// Load the houses from the stored buffer
 		if (house_buffer.get() && house_buffer_size > 0) {
 			pugi::xml_document doc;
-			pugi::xml_parse_result result = doc.load_buffer(house_buffer.get(), house_buffer_size);
+			pugi::xml_parse_result result = doc.load_buffer_inplace(house_buffer.get(), house_buffer_size, XML_INPLACE_PARSE_OPTIONS);
 			if (result) {
 				if (!loadHouses(map, doc)) {
 					warning("Failed to load houses.");
@@ -703,7 +1180,7 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 		// Load the spawns from the stored buffer
 		if (spawn_buffer.get() && spawn_buffer_size > 0) {
 			pugi::xml_document doc;
-			pugi::xml_parse_result result = doc.load_buffer(spawn_buffer.get(), spawn_buffer_size);
+			pugi::xml_parse_result result = doc.load_buffer_inplace(spawn_buffer.get(), spawn_buffer_size, XML_INPLACE_PARSE_OPTIONS);
 			if (result) {
 				if (!loadSpawns(map, doc)) {
 					warning("Failed to load spawns.");
@@ -717,16 +1194,36 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 	}
 #endif
 
-	DiskNodeFileReadHandle f(nstr(filename.GetFullPath()), StringVector(1, "OTBM"));
-	if (!f.isOk()) {
-		error(("Couldn't open file for reading\nThe error reported was: " + wxstr(f.getErrorMessage())).wc_str());
+	std::unique_ptr<NodeFileReadHandle> f;
+#ifdef OTBZ_SUPPORT
+	// Nodes are read straight from the decompressor, tile areas handed to the worker
+	// threads are copied out of its window one at a time
+	if (filename.GetExt() == "otbz") {
+		f.reset(newd CompressedNodeFileReadHandle(nstr(filename.GetFullPath()), StringVector(1, "OTBM")));
+	}
+#endif
+
+	// Map the whole file so node payloads can be read in place, fall back to
+	// buffered reads if the file can't be mapped (e.g. on some network shares)
+	if (!f) {
+		f.reset(newd MappedNodeFileReadHandle(nstr(filename.GetFullPath()), StringVector(1, "OTBM")));
+		if (!f->isOk()) {
+			f.reset(newd DiskNodeFileReadHandle(nstr(filename.GetFullPath()), StringVector(1, "OTBM")));
+		}
+	}
+	if (!f->isOk()) {
+		error(("Couldn't open file for reading\nThe error reported was: " + wxstr(f->getErrorMessage())).wc_str());
 		return false;
 	}
 
-	if (!loadMap(map, f)) {
+	if (!loadMap(map, *f)) {
 		return false;
 	}
 
+	// Changes saved to the journal go on top of the map file, before the
+	// auxilliary files which were written along with the latest of them
+	const bool journal_loaded = loadJournal(map, filename);
+
 	// Read auxilliary files
 	if (!loadHouses(map, filename)) {
 		warning("Failed to load houses.");
@@ -741,6 +1238,9 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename) {
 		// warning("Failed to load waypoints.");
 		map.waypointfile = nstr(filename.GetName()) + "-waypoint.xml";
 	}
+
+	// A journal that couldn't be applied is left alone until the next full save replaces it
+	map.journal_generation = journal_loaded ? map.getGeneration() : 0;
 	return true;
 }
 
@@ -809,6 +1309,91 @@ bool IOMapOTBM::loadMap(Map& map, NodeFileReadHandle& f) {
 		return false;
 	}
 
+	loadMapAttributes(map, mapHeaderNode);
+
+	// With more than one worker thread, tile areas are cut out of the file and decoded in
+	// the background while this thread keeps scanning and merges the results in order
+	const int worker_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+	std::unique_ptr<OrderedJobQueue<TileAreaLoadJob>> decoder;
+	if (worker_count > 1) {
+		decoder.reset(newd OrderedJobQueue<TileAreaLoadJob>(worker_count, [this](TileAreaLoadJob& job) {
+			MemoryNodeFileReadHandle handle(job.data, job.size);
+			BinaryNode* mapNode = handle.getRootNode();
+			uint8_t node_type;
+			if (mapNode && mapNode->getByte(node_type)) {
+				decodeTileArea(*this, mapNode, job.area);
+			}
+		}));
+	}
+
+	int areas_merged = 0;
+	auto mergeDecodedAreas = [&](bool wait) {
+		while (std::unique_ptr<TileAreaLoadJob> job = decoder->pop(wait)) {
+			mergeTileArea(map, job->area, warnings);
+			if (++areas_merged % 15 == 0) {
+				g_gui.SetLoadDone(static_cast<int32_t>(100.0 * job->file_offset / f.size()));
+			}
+		}
+	};
+
+	int nodes_loaded = 0;
+
+	for (BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
+		++nodes_loaded;
+		if (!decoder && nodes_loaded % 15 == 0) {
+			g_gui.SetLoadDone(static_cast<int32_t>(100.0 * f.tell() / f.size()));
+		}
+
+		uint8_t node_type;
+		const bool has_type = mapNode->getByte(node_type);
+		if (decoder) {
+			if (has_type && node_type == OTBM_TILE_AREA) {
+				const uint8_t* raw_area;
+				size_t raw_size;
+				std::unique_ptr<TileAreaLoadJob> job;
+				if (mapNode->getRawSubtree(raw_area, raw_size)) {
+					job.reset(newd TileAreaLoadJob(raw_area, raw_size, f.tell()));
+				} else {
+					std::vector<uint8_t> bytes;
+					if (mapNode->copyRawSubtree(bytes)) {
+						job.reset(newd TileAreaLoadJob(std::move(bytes), f.tell()));
+					}
+				}
+				if (job) {
+					decoder->push(std::move(job));
+					mergeDecodedAreas(false);
+					continue;
+				}
+			}
+			// Anything read right here goes after the areas queued before it
+			mergeDecodedAreas(true);
+		}
+
+		if (!has_type) {
+			warning("Invalid map node");
+			continue;
+		}
+		if (node_type == OTBM_TILE_AREA) {
+			LoadedTileArea area;
+			decodeTileArea(*this, mapNode, area);
+			mergeTileArea(map, area, warnings);
+		} else if (node_type == OTBM_TOWNS) {
+			loadTownNodes(map, mapNode);
+		} else if (node_type == OTBM_WAYPOINTS) {
+			loadWaypointNodes(map, mapNode);
+		}
+	}
+	if (decoder) {
+		mergeDecodedAreas(true);
+	}
+
+	if (!f.isOk()) {
+		warning(wxstr(f.getErrorMessage()).wc_str());
+	}
+	return true;
+}
+
+void IOMapOTBM::loadMapAttributes(Map& map, BinaryNode* mapHeaderNode) {
 	uint8_t attribute;
 	while (mapHeaderNode->getU8(attribute)) {
 		switch (attribute) {
@@ -845,228 +1430,210 @@ bool IOMapOTBM::loadMap(Map& map, NodeFileReadHandle& f) {
 			}
 		}
 	}
+}
 
-	int nodes_loaded = 0;
-
-	for (BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
-		++nodes_loaded;
-		if (nodes_loaded % 15 == 0) {
-			g_gui.SetLoadDone(static_cast<int32_t>(100.0 * f.tell() / f.size()));
+void IOMapOTBM::loadTownNodes(Map& map, BinaryNode* townsNode) {
+	for (BinaryNode* townNode = townsNode->getChild(); townNode != nullptr; townNode = townNode->advance()) {
+		Town* town = nullptr;
+		uint8_t town_type;
+		if (!townNode->getByte(town_type)) {
+			warning("Invalid town type (1)");
+			continue;
 		}
-
-		uint8_t node_type;
-		if (!mapNode->getByte(node_type)) {
-			warning("Invalid map node");
+		if (town_type != OTBM_TOWN) {
+			warning("Invalid town type (2)");
 			continue;
 		}
-		if (node_type == OTBM_TILE_AREA) {
-			uint16_t base_x, base_y;
-			uint8_t base_z;
-			if (!mapNode->getU16(base_x) || !mapNode->getU16(base_y) || !mapNode->getU8(base_z)) {
-				warning("Invalid map node, no base coordinate");
+		uint32_t town_id;
+		if (!townNode->getU32(town_id)) {
+			warning("Invalid town id");
+			continue;
+		}
+
+		town = map.towns.getTown(town_id);
+		if (town) {
+			warning("Duplicate town id %d, discarding duplicate", town_id);
+			continue;
+		} else {
+			town = newd Town(town_id);
+			if (!map.towns.addTown(town)) {
+				delete town;
 				continue;
 			}
+		}
+		std::string town_name;
+		if (!townNode->getString(town_name)) {
+			warning("Invalid town name");
+			continue;
+		}
+		town->setName(town_name);
+		Position pos;
+		uint16_t x;
+		uint16_t y;
+		uint8_t z;
+		if (!townNode->getU16(x) || !townNode->getU16(y) || !townNode->getU8(z)) {
+			warning("Invalid town temple position");
+			continue;
+		}
+		pos.x = x;
+		pos.y = y;
+		pos.z = z;
+		town->setTemplePosition(pos);
+		map.getOrCreateTile(pos)->getLocation()->increaseTownCount();
+	}
+}
 
-			for (BinaryNode* tileNode = mapNode->getChild(); tileNode != nullptr; tileNode = tileNode->advance()) {
-				Tile* tile = nullptr;
-				uint8_t tile_type;
-				if (!tileNode->getByte(tile_type)) {
-					warning("Invalid tile type");
-					continue;
-				}
-				if (tile_type == OTBM_TILE || tile_type == OTBM_HOUSETILE) {
-					// printf("Start\n");
-					uint8_t x_offset, y_offset;
-					if (!tileNode->getU8(x_offset) || !tileNode->getU8(y_offset)) {
-						warning("Could not read position of tile");
-						continue;
-					}
-					const Position pos(base_x + x_offset, base_y + y_offset, base_z);
+void IOMapOTBM::loadWaypointNodes(Map& map, BinaryNode* waypointsNode) {
+	for (BinaryNode* waypointNode = waypointsNode->getChild(); waypointNode != nullptr; waypointNode = waypointNode->advance()) {
+		uint8_t waypoint_type;
+		if (!waypointNode->getByte(waypoint_type)) {
+			warning("Invalid waypoint type (1)");
+			continue;
+		}
+		if (waypoint_type != OTBM_WAYPOINT) {
+			warning("Invalid waypoint type (2)");
+			continue;
+		}
 
-					if (map.getTile(pos)) {
-						warning("Duplicate tile at %d:%d:%d, discarding duplicate", pos.x, pos.y, pos.z);
-						continue;
-					}
+		Waypoint wp;
 
-					tile = map.allocator(map.createTileL(pos));
-					House* house = nullptr;
-					if (tile_type == OTBM_HOUSETILE) {
-						uint32_t house_id;
-						if (!tileNode->getU32(house_id)) {
-							warning("House tile without house data, discarding tile");
-							continue;
-						}
-						if (house_id) {
-							house = map.houses.getHouse(house_id);
-							if (!house) {
-								house = newd House(map);
-								house->setID(house_id);
-								map.houses.addHouse(house);
-							}
-						} else {
-							warning("Invalid house id from tile %d:%d:%d", pos.x, pos.y, pos.z);
-						}
-					}
+		if (!waypointNode->getString(wp.name)) {
+			warning("Invalid waypoint name");
+			continue;
+		}
+		uint16_t x;
+		uint16_t y;
+		uint8_t z;
+		if (!waypointNode->getU16(x) || !waypointNode->getU16(y) || !waypointNode->getU8(z)) {
+			warning("Invalid waypoint position");
+			continue;
+		}
+		wp.pos.x = x;
+		wp.pos.y = y;
+		wp.pos.z = z;
 
-					// printf("So far so good\n");
+		map.waypoints.addWaypoint(newd Waypoint(wp));
+	}
+}
 
-					uint8_t attribute;
-					while (tileNode->getU8(attribute)) {
-						switch (attribute) {
-							case OTBM_ATTR_TILE_FLAGS: {
-								uint32_t flags = 0;
-								if (!tileNode->getU32(flags)) {
-									warning("Invalid tile flags of tile on %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								tile->setMapFlags(flags);
-								if (flags & TILESTATE_ZONE_BRUSH) {
-									uint16_t zoneId = 0;
-									do {
-										if (!tileNode->getU16(zoneId)) {
-											warning("Invalid zone id of tile on %d:%d:%d", pos.x, pos.y, pos.z);
-										}
-
-										if (zoneId != 0) {
-											tile->addZoneId(zoneId);
-										}
-									} while (zoneId != 0);
-								}
-								break;
-							}
-							case OTBM_ATTR_ITEM: {
-								Item* item = Item::Create_OTBM(*this, tileNode);
-								if (item == nullptr) {
-									warning("Invalid item at tile %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								tile->addItem(item);
-								break;
-							}
-							default: {
-								warning("Unknown tile attribute at %d:%d:%d", pos.x, pos.y, pos.z);
-								break;
-							}
-						}
-					}
+bool IOMapOTBM::loadJournal(Map& map, const FileName& identifier) {
+	const std::string journal_path = getJournalPath(identifier);
+	FileReadHandle f(journal_path);
+	if (!f.isOk()) {
+		// No journal, the map file is all there is
+		return true;
+	}
 
-					// printf("Didn't die in loop\n");
+	JournalHeader header, expected;
+	if (!readJournalHeader(f, header)) {
+		warning("The map journal is damaged, changes saved to it were not loaded.");
+		return false;
+	}
+	if (!getJournalHeader(identifier, expected) || !matchesJournalHeader(header, expected)) {
+		warning("The map journal belongs to another version of the map file, changes saved to it were not loaded.");
+		return false;
+	}
 
-					for (BinaryNode* itemNode = tileNode->getChild(); itemNode != nullptr; itemNode = itemNode->advance()) {
-						Item* item = nullptr;
-						uint8_t item_type;
-						if (!itemNode->getByte(item_type)) {
-							warning("Unknown item type %d:%d:%d", pos.x, pos.y, pos.z);
-							continue;
-						}
-						if (item_type == OTBM_ITEM) {
-							item = Item::Create_OTBM(*this, itemNode);
-							if (item) {
-								if (!item->unserializeItemNode_OTBM(*this, itemNode)) {
-									warning("Couldn't unserialize item attributes at %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								// reform(&map, tile, item);
-								tile->addItem(item);
-							}
-						} else {
-							warning("Unknown type of tile child node");
-						}
-					}
+	std::vector<uint8_t> record;
+	size_t complete_size = f.tell();
+	while (f.tell() < f.size()) {
+		uint32_t record_size;
+		if (!f.getU32(record_size) || record_size > f.size() - f.tell()) {
+			// A save that didn't finish, everything before it is fine. The partial bytes are cut
+			// off so the next journal save doesn't append after them.
+			warning("The last save in the map journal is incomplete and was skipped.");
+			f.close();
+
+			std::error_code ec;
+			std::filesystem::resize_file(journal_path, complete_size, ec);
+			if (ec) {
+				// Let the next save write the whole map and drop the journal
+				std::remove(journal_path.c_str());
+				map.doChange();
+				return false;
+			}
+			return true;
+		}
+		record.resize(record_size);
+		if (!f.getRAW(record.data(), record_size)) {
+			warning("Could not read the map journal.");
+			return false;
+		}
 
-					tile->update();
-					if (house) {
-						house->addTile(tile);
-					}
+		MemoryNodeFileReadHandle handle(record.data(), record.size());
+		if (!loadJournalRecord(map, handle)) {
+			warning("The map journal is damaged, some changes saved to it were not loaded.");
+			return false;
+		}
+		complete_size = f.tell();
+	}
+	return true;
+}
 
-					map.setTile(pos.x, pos.y, pos.z, tile);
-				} else {
-					warning("Unknown type of tile node");
-				}
-			}
-		} else if (node_type == OTBM_TOWNS) {
-			for (BinaryNode* townNode = mapNode->getChild(); townNode != nullptr; townNode = townNode->advance()) {
-				Town* town = nullptr;
-				uint8_t town_type;
-				if (!townNode->getByte(town_type)) {
-					warning("Invalid town type (1)");
-					continue;
-				}
-				if (town_type != OTBM_TOWN) {
-					warning("Invalid town type (2)");
-					continue;
-				}
-				uint32_t town_id;
-				if (!townNode->getU32(town_id)) {
-					warning("Invalid town id");
-					continue;
-				}
+bool IOMapOTBM::loadJournalRecord(Map& map, NodeFileReadHandle& f) {
+	BinaryNode* root = f.getRootNode();
+	if (!root) {
+		return false;
+	}
+	root->skip(1); // Skip the type byte
 
-				town = map.towns.getTown(town_id);
-				if (town) {
-					warning("Duplicate town id %d, discarding duplicate", town_id);
-					continue;
-				} else {
-					town = newd Town(town_id);
-					if (!map.towns.addTown(town)) {
-						delete town;
-						continue;
-					}
-				}
-				std::string town_name;
-				if (!townNode->getString(town_name)) {
-					warning("Invalid town name");
-					continue;
-				}
-				town->setName(town_name);
-				Position pos;
-				uint16_t x;
-				uint16_t y;
-				uint8_t z;
-				if (!townNode->getU16(x) || !townNode->getU16(y) || !townNode->getU8(z)) {
-					warning("Invalid town temple position");
-					continue;
-				}
-				pos.x = x;
-				pos.y = y;
-				pos.z = z;
-				town->setTemplePosition(pos);
-				map.getOrCreateTile(pos)->getLocation()->increaseTownCount();
-			}
-		} else if (node_type == OTBM_WAYPOINTS) {
-			for (BinaryNode* waypointNode = mapNode->getChild(); waypointNode != nullptr; waypointNode = waypointNode->advance()) {
-				uint8_t waypoint_type;
-				if (!waypointNode->getByte(waypoint_type)) {
-					warning("Invalid waypoint type (1)");
-					continue;
-				}
-				if (waypoint_type != OTBM_WAYPOINT) {
-					warning("Invalid waypoint type (2)");
-					continue;
-				}
+	uint32_t otbm_version;
+	uint16_t width, height;
+	uint32_t chunk_count;
+	if (!root->getU32(otbm_version) || otbm_version != version.otbm || !root->getU16(width) || !root->getU16(height) || !root->getU32(chunk_count)) {
+		return false;
+	}
+	map.width = width;
+	map.height = height;
+
+	// The record holds the current state of these chunks, including the ones that are empty now
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		uint16_t x, y;
+		uint8_t z;
+		if (!root->getU16(x) || !root->getU16(y) || !root->getU8(z) || z >= MAP_LAYERS) {
+			return false;
+		}
+		clearJournalChunk(map, x, y, z);
+	}
 
-				Waypoint wp;
+	uint8_t node_type;
+	BinaryNode* mapHeaderNode = root->getChild();
+	if (!mapHeaderNode || !mapHeaderNode->getByte(node_type) || node_type != OTBM_MAP_DATA) {
+		return false;
+	}
+	loadMapAttributes(map, mapHeaderNode);
 
-				if (!waypointNode->getString(wp.name)) {
-					warning("Invalid waypoint name");
-					continue;
+	for (BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
+		if (!mapNode->getByte(node_type)) {
+			warning("Invalid map node");
+			continue;
+		}
+		if (node_type == OTBM_TILE_AREA) {
+			LoadedTileArea area;
+			decodeTileArea(*this, mapNode, area);
+			mergeTileArea(map, area, warnings);
+		} else if (node_type == OTBM_TOWNS) {
+			for (const auto& townEntry : map.towns) {
+				if (TileLocation* location = map.getTileL(townEntry.second->getTemplePosition())) {
+					location->decreaseTownCount();
 				}
-				uint16_t x;
-				uint16_t y;
-				uint8_t z;
-				if (!waypointNode->getU16(x) || !waypointNode->getU16(y) || !waypointNode->getU8(z)) {
-					warning("Invalid waypoint position");
-					continue;
+			}
+			map.towns.clear();
+			loadTownNodes(map, mapNode);
+		} else if (node_type == OTBM_WAYPOINTS) {
+			for (const auto& waypointEntry : map.waypoints) {
+				Waypoint* waypoint = waypointEntry.second;
+				if (waypoint->pos != Position()) {
+					if (TileLocation* location = map.getTileL(waypoint->pos)) {
+						location->decreaseWaypointCount();
+					}
 				}
-				wp.pos.x = x;
-				wp.pos.y = y;
-				wp.pos.z = z;
-
-				map.waypoints.addWaypoint(newd Waypoint(wp));
+				delete waypoint;
 			}
+			map.waypoints.waypoints.clear();
+			loadWaypointNodes(map, mapNode);
 		}
 	}
-
-	if (!f.isOk()) {
-		warning(wxstr(f.getErrorMessage()).wc_str());
-	}
 	return true;
 }
 
@@ -1080,12 +1647,9 @@ bool IOMapOTBM::loadSpawns(Map& map, const FileName& dir) {
 		return false;
 	}
 
-	// has to be declared again as encoding-specific characters break loading there
-	std::string encoded_path = (const char*)(dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME).mb_str(wxConvWhateverWorks));
-	encoded_path += map.spawnfile;
+	std::vector<char> buffer;
 	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(encoded_path.c_str());
-	if (!result) {
+	if (!loadXMLInPlace(fn, buffer, doc)) {
 		warnings.push_back("IOMapOTBM::loadSpawns: File loading error.");
 		return false;
 	}
@@ -1232,12 +1796,9 @@ bool IOMapOTBM::loadHouses(Map& map, const FileName& dir) {
 		return false;
 	}
 
-	// has to be declared again as encoding-specific characters break loading there
-	std::string encoded_path = (const char*)(dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME).mb_str(wxConvWhateverWorks));
-	encoded_path += map.housefile;
+	std::vector<char> buffer;
 	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(encoded_path.c_str());
-	if (!result) {
+	if (!loadXMLInPlace(fn, buffer, doc)) {
 		warnings.push_back("IOMapOTBM::loadHouses: File loading error.");
 		return false;
 	}
@@ -1306,9 +1867,9 @@ bool IOMapOTBM::loadWaypoints(Map& map, const FileName& dir) {
 		return false;
 	}
 
+	std::vector<char> buffer;
 	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(fn.c_str());
-	if (!result) {
+	if (!loadXMLInPlace(fn, buffer, doc)) {
 		return false;
 	}
 	return loadWaypoints(map, doc);
@@ -1323,7 +1884,6 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 		// Create the archive
 		struct archive* a = archive_write_new();
 		struct archive_entry* entry = nullptr;
-		std::ostringstream streamData;
 
 		archive_write_set_compression_gzip(a);
 		archive_write_set_format_pax_restricted(a);
@@ -1331,11 +1891,9 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 
 		g_gui.SetLoadDone(0, "Saving spawns...");
 
-		pugi::xml_document spawnDoc;
-		if (saveSpawns(map, spawnDoc)) {
-			// Write the data
-			spawnDoc.save(streamData, "", pugi::format_raw, pugi::encoding_utf8);
-			std::string xmlData = streamData.str();
+		XMLStreamWriter spawnWriter;
+		if (saveSpawns(map, spawnWriter) && spawnWriter.close()) {
+			const std::string& xmlData = spawnWriter.getData();
 
 			// Write to the arhive
 			entry = archive_entry_new();
@@ -1350,16 +1908,13 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 
 			// Free the entry
 			archive_entry_free(entry);
-			streamData.str("");
 		}
 
 		g_gui.SetLoadDone(0, "Saving houses...");
 
-		pugi::xml_document houseDoc;
-		if (saveHouses(map, houseDoc)) {
-			// Write the data
-			houseDoc.save(streamData, "", pugi::format_raw, pugi::encoding_utf8);
-			std::string xmlData = streamData.str();
+		XMLStreamWriter houseWriter;
+		if (saveHouses(map, houseWriter) && houseWriter.close()) {
+			const std::string& xmlData = houseWriter.getData();
 
 			// Write to the arhive
 			entry = archive_entry_new();
@@ -1374,17 +1929,14 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 
 			// Free the entry
 			archive_entry_free(entry);
-			streamData.str("");
 		}
 		// to do
 		/*
 		g_gui.SetLoadDone(0, "Saving waypoints...");
 
-		pugi::xml_document wpDoc;
-		if (saveWaypoints(map, wpDoc)) {
-			// Write the data
-			wpDoc.save(streamData, "", pugi::format_raw, pugi::encoding_utf8);
-			std::string xmlData = streamData.str();
+		XMLStreamWriter wpWriter;
+		if (saveWaypoints(map, wpWriter) && wpWriter.close()) {
+			const std::string& xmlData = wpWriter.getData();
 
 			// Write to the arhive
 			entry = archive_entry_new();
@@ -1399,7 +1951,6 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 
 			// Free the entry
 			archive_entry_free(entry);
-			streamData.str("");
 		}
 		*/
 		g_gui.SetLoadDone(0, "Saving OTBM map...");
@@ -1434,17 +1985,19 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 	}
 #endif
 
-	DiskNodeFileWriteHandle f(
-		nstr(identifier.GetFullPath()),
-		(g_settings.getInteger(Config::SAVE_WITH_OTB_MAGIC_NUMBER) ? "OTBM" : std::string(4, '\0'))
-	);
-
-	if (!f.isOk()) {
+	std::unique_ptr<NodeFileWriteHandle> f = createMapWriteHandle(identifier);
+	if (!f->isOk()) {
 		error("Can not open file %s for writing", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
 		return false;
 	}
 
-	if (!saveMap(map, f)) {
+	if (!saveMap(map, *f)) {
+		return false;
+	}
+	// A compressed file is only complete once the stream is finished
+	f->close();
+	if (f->error_code != FILE_NO_ERROR) {
+		error("Could not write %s", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
 		return false;
 	}
 
@@ -1454,6 +2007,10 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier) {
 	g_gui.SetLoadDone(99, "Saving houses...");
 	saveHouses(map, identifier);
 
+	// Everything the journal held is in the map file now
+	std::remove(getJournalPath(identifier).c_str());
+	map.journal_generation = map.getGeneration();
+
 	// to do
 	// g_gui.SetLoadDone(99, "Saving waypoints...");
 	// saveWaypoints(map, identifier);
@@ -1474,9 +2031,6 @@ bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f) {
 
 	bool waypointsWarning = false;
 
-	const IOMapOTBM& self = *this;
-
-	FileName tmpName;
 	MapVersion mapVersion = map.getVersion();
 
 	f.addNode(0);
@@ -1491,187 +2045,410 @@ bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f) {
 
 		f.addNode(OTBM_MAP_DATA);
 		{
-			f.addByte(OTBM_ATTR_DESCRIPTION);
-			// Neither SimOne's nor OpenTibia cares for additional description tags
-			f.addString("Saved with " + __RME_APPLICATION_NAME__ + " " + __RME_VERSION__);
+			saveMapAttributes(map, f);
 
-			f.addU8(OTBM_ATTR_DESCRIPTION);
-			f.addString(map.description);
+			saveTileAreas(map, f, std::max(g_settings.getInteger(Config::WORKER_THREADS), 1), [](int done) {
+				g_gui.SetLoadDone(done);
+			});
 
-			tmpName.Assign(wxstr(map.spawnfile));
-			f.addU8(OTBM_ATTR_EXT_SPAWN_FILE);
-			f.addString(nstr(tmpName.GetFullName()));
+			saveTownNodes(map, f);
 
-			tmpName.Assign(wxstr(map.housefile));
-			f.addU8(OTBM_ATTR_EXT_HOUSE_FILE);
-			f.addString(nstr(tmpName.GetFullName()));
+			bool supportWaypoints = version.otbm >= MAP_OTBM_3;
+			if (supportWaypoints || map.waypoints.waypoints.size() > 0) {
+				if (!supportWaypoints) {
+					waypointsWarning = true;
+				}
+				saveWaypointNodes(map, f);
+			}
+		}
+		f.endNode();
+	}
+	f.endNode();
 
-			// Start writing tiles
-			uint32_t tiles_saved = 0;
-			bool first = true;
+	if (waypointsWarning) {
+		g_gui.PopupDialog(g_gui.root, "Warning", "Waypoints were saved, but they are not supported in OTBM 2!\nIf your map fails to load, consider removing all waypoints and saving again.\n\nThis warning can be disabled in file->preferences.", wxOK);
+	}
+	return true;
+}
 
-			int local_x = -1, local_y = -1, local_z = -1;
+void IOMapOTBM::saveTileAreas(Map& map, NodeFileWriteHandle& f, int worker_count, const std::function<void(int)>& progress) {
+	// Start writing tiles
+	uint32_t tiles_saved = 0;
+	TileAreaWriter areas(*this, f, worker_count);
+
+	MapIterator map_iterator = map.begin();
+	while (map_iterator != map.end()) {
+		// Update progressbar
+		++tiles_saved;
+		if (progress && tiles_saved % 8192 == 0) {
+			progress(int(tiles_saved / double(map.getTileCount()) * 100.0));
+		}
 
-			MapIterator map_iterator = map.begin();
-			while (map_iterator != map.end()) {
-				// Update progressbar
-				++tiles_saved;
-				if (tiles_saved % 8192 == 0) {
-					g_gui.SetLoadDone(int(tiles_saved / double(map.getTileCount()) * 100.0));
-				}
+		// Get tile
+		Tile* save_tile = (*map_iterator)->get();
 
-				// Get tile
-				Tile* save_tile = (*map_iterator)->get();
+		// Is it an empty tile that we can skip? (Leftovers...)
+		if (!save_tile || save_tile->size() == 0) {
+			++map_iterator;
+			continue;
+		}
 
-				// Is it an empty tile that we can skip? (Leftovers...)
-				if (!save_tile || save_tile->size() == 0) {
-					++map_iterator;
-					continue;
-				}
+		areas.add(save_tile);
+		++map_iterator;
+	}
+	areas.finish();
+}
 
-				const Position& pos = save_tile->getPosition();
+bool IOMapOTBM::verifyParallelSave(Map& map, int worker_count, std::string& report, const std::function<void(int)>& progress) {
+	MemoryNodeFileWriteHandle serial;
+	MemoryNodeFileWriteHandle parallel;
+
+	// The serial pass is the first half of the progress, the parallel one the second
+	std::function<void(int)> serial_progress, parallel_progress;
+	if (progress) {
+		serial_progress = [&progress](int done) {
+			progress(done / 2);
+		};
+		parallel_progress = [&progress](int done) {
+			progress(50 + done / 2);
+		};
+	}
+
+	wxStopWatch watch;
+	saveTileAreas(map, serial, 1, serial_progress);
+	const double serial_ms = watch.TimeInMicro().ToDouble() / 1000.0;
+
+	watch.Start();
+	saveTileAreas(map, parallel, worker_count, parallel_progress);
+	const double parallel_ms = watch.TimeInMicro().ToDouble() / 1000.0;
+
+	const size_t size = std::min(serial.getSize(), parallel.getSize());
+	size_t mismatch = 0;
+	while (mismatch < size && serial.getMemory()[mismatch] == parallel.getMemory()[mismatch]) {
+		++mismatch;
+	}
+	const bool identical = mismatch == size && serial.getSize() == parallel.getSize();
+
+	std::ostringstream os;
+	os.setf(std::ios::fixed, std::ios::floatfield);
+	os.precision(2);
+	os << "Parallel save check for \"" << map.getName() << "\"\n";
+	os << "\tSerial: " << serial.getSize() << " bytes in " << serial_ms << " ms\n";
+	os << "\tParallel (" << worker_count << " workers): " << parallel.getSize() << " bytes in " << parallel_ms << " ms\n";
+	if (identical) {
+		os << "\tThe outputs are identical.\n";
+	} else {
+		os << "\tError: the outputs differ from byte " << mismatch << " on!\n";
+	}
+	report = os.str();
+	return identical;
+}
 
-				// Decide if newd node should be created
-				if (pos.x < local_x || pos.x >= local_x + 256 || pos.y < local_y || pos.y >= local_y + 256 || pos.z != local_z) {
-					// End last node
-					if (!first) {
-						f.endNode();
-					}
-					first = false;
+OTBMSaveSnapshot::OTBMSaveSnapshot(Map& map) :
+	tiles(newd MapSnapshot(map)),
+	width(0),
+	height(0),
+	has_spawns(false),
+	has_houses(false) {
+	////
+}
 
-					// Start newd node
-					f.addNode(OTBM_TILE_AREA);
-					f.addU16(local_x = pos.x & 0xFF00);
-					f.addU16(local_y = pos.y & 0xFF00);
-					f.addU8(local_z = pos.z);
-				}
-				f.addNode(save_tile->isHouseTile() ? OTBM_HOUSETILE : OTBM_TILE);
+OTBMSaveSnapshot::~OTBMSaveSnapshot() {
+	////
+}
 
-				f.addU8(save_tile->getX() & 0xFF);
-				f.addU8(save_tile->getY() & 0xFF);
+void IOMapOTBM::captureMap(Map& map, OTBMSaveSnapshot& snapshot) {
+	snapshot.version = map.getVersion();
+	snapshot.width = map.width;
+	snapshot.height = map.height;
 
-				if (save_tile->isHouseTile()) {
-					f.addU32(save_tile->getHouseID());
-				}
+	saveMapAttributes(map, snapshot.attributes);
+	saveTownNodes(map, snapshot.trailer);
+	if (snapshot.version.otbm >= MAP_OTBM_3 || map.waypoints.waypoints.size() > 0) {
+		if (snapshot.version.otbm < MAP_OTBM_3) {
+			warning("Waypoints were saved, but they are not supported in OTBM 2!");
+		}
+		saveWaypointNodes(map, snapshot.trailer);
+	}
 
-				if (save_tile->getMapFlags()) {
-					f.addByte(OTBM_ATTR_TILE_FLAGS);
-					f.addU32(save_tile->getMapFlags());
-					if (save_tile->getMapFlags() & TILESTATE_ZONE_BRUSH) {
-						for (const auto& zoneId : save_tile->getZoneIds()) {
-							f.addU16(zoneId);
-						}
-						f.addU16(0);
-					}
-				}
+	XMLStreamWriter spawns;
+	snapshot.has_spawns = saveSpawns(map, spawns) && spawns.close();
+	snapshot.spawns = std::move(spawns.getData());
 
-				if (save_tile->ground) {
-					Item* ground = save_tile->ground;
-					if (ground->isMetaItem()) {
-						// Do nothing, we don't save metaitems...
-					} else if (ground->hasBorderEquivalent()) {
-						bool found = false;
-						for (Item* item : save_tile->items) {
-							if (item->getGroundEquivalent() == ground->getID()) {
-								// Do nothing
-								// Found equivalent
-								found = true;
-								break;
-							}
-						}
+	XMLStreamWriter houses;
+	snapshot.has_houses = saveHouses(map, houses) && houses.close();
+	snapshot.houses = std::move(houses.getData());
+	snapshot.spawnfile = map.spawnfile;
+	snapshot.housefile = map.housefile;
+}
 
-						if (!found) {
-							ground->serializeItemNode_OTBM(self, f);
-						}
-					} else if (ground->isComplex()) {
-						ground->serializeItemNode_OTBM(self, f);
-					} else {
-						f.addByte(OTBM_ATTR_ITEM);
-						ground->serializeItemCompact_OTBM(self, f);
-					}
-				}
+bool IOMapOTBM::saveSnapshot(OTBMSaveSnapshot& snapshot, const FileName& identifier, const std::function<void(int)>& progress) {
+	std::unique_ptr<NodeFileWriteHandle> handle = createMapWriteHandle(identifier);
+	NodeFileWriteHandle& f = *handle;
+	if (!f.isOk()) {
+		error("Can not open file %s for writing", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
+		return false;
+	}
 
-				for (Item* item : save_tile->items) {
-					if (!item->isMetaItem()) {
-						item->serializeItemNode_OTBM(self, f);
+	MapSnapshot& tiles = *snapshot.tiles;
+	// Whatever happens, the map must not wait on the snapshot past this
+	struct ReleaseGuard {
+		MapSnapshot& tiles;
+		~ReleaseGuard() {
+			tiles.release(MapSnapshot::END_KEY);
+		}
+	} release_guard { tiles };
+
+	f.addNode(0);
+	{
+		f.addU32(snapshot.version.otbm);
+		f.addU16(snapshot.width);
+		f.addU16(snapshot.height);
+		f.addU32(g_items.MajorVersion);
+		f.addU32(g_items.MinorVersion);
+
+		f.addNode(OTBM_MAP_DATA);
+		{
+			f.addNodeData(snapshot.attributes.getMemory(), snapshot.attributes.getSize());
+
+			// Same area writer as saveTileAreas, leaves go back to the map as soon as their areas are encoded
+			const int worker_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+			TileAreaWriter areas(*this, f, worker_count, [&tiles](uint32_t key) {
+				tiles.release(key);
+			});
+
+			// The map waits for a leaf that is being written, so keep batches short
+			const size_t tiles_per_batch = 1024;
+			std::vector<MapSnapshot::Entry> batch;
+			uint64_t tiles_read = 0;
+			int last_progress = -1;
+			bool more = true;
+			while (more) {
+				batch.clear();
+				more = tiles.read(batch, tiles_per_batch);
+				for (const MapSnapshot::Entry& entry : batch) {
+					if (entry.tile->size() != 0) {
+						areas.add(entry.tile, entry.key);
 					}
 				}
 
-				f.endNode();
-				++map_iterator;
+				tiles_read += batch.size();
+				const int done = tiles.size() == 0 ? 100 : static_cast<int>(std::min<uint64_t>(100 * tiles_read / tiles.size(), 99));
+				if (done != last_progress) {
+					last_progress = done;
+					progress(done);
+				}
 			}
+			areas.finish();
+			tiles.release(MapSnapshot::END_KEY);
 
-			// Only close the last node if one has actually been created
-			if (!first) {
-				f.endNode();
-			}
+			f.addNodeData(snapshot.trailer.getMemory(), snapshot.trailer.getSize());
+		}
+		f.endNode();
+	}
+	f.endNode();
 
-			f.addNode(OTBM_TOWNS);
-			for (const auto& townEntry : map.towns) {
-				Town* town = townEntry.second;
-				const Position& townPosition = town->getTemplePosition();
-				f.addNode(OTBM_TOWN);
-				f.addU32(town->getID());
-				f.addString(town->getName());
-				f.addU16(townPosition.x);
-				f.addU16(townPosition.y);
-				f.addU8(townPosition.z);
-				f.endNode();
-			}
-			f.endNode();
+	if (!f.isOk()) {
+		error("Could not write %s", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
+		return false;
+	}
+	// A compressed file is only complete once the stream is finished
+	f.close();
+	if (f.error_code != FILE_NO_ERROR) {
+		error("Could not write %s", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
+		return false;
+	}
 
-			bool supportWaypoints = version.otbm >= MAP_OTBM_3;
-			if (supportWaypoints || map.waypoints.waypoints.size() > 0) {
-				if (!supportWaypoints) {
-					waypointsWarning = true;
-				}
+	const std::string path = nstr(identifier.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME));
+	if (snapshot.has_spawns) {
+		FileWriteHandle spawns(path + snapshot.spawnfile);
+		spawns.addRAW(snapshot.spawns);
+	}
+	if (snapshot.has_houses) {
+		FileWriteHandle houses(path + snapshot.housefile);
+		houses.addRAW(snapshot.houses);
+	}
+
+	// Everything the journal held is in the map file now
+	std::remove(getJournalPath(identifier).c_str());
+	progress(100);
+	return true;
+}
+
+void IOMapOTBM::saveMapAttributes(Map& map, NodeFileWriteHandle& f) {
+	f.addByte(OTBM_ATTR_DESCRIPTION);
+	// Neither SimOne's nor OpenTibia cares for additional description tags
+	f.addString("Saved with " + __RME_APPLICATION_NAME__ + " " + __RME_VERSION__);
+
+	f.addU8(OTBM_ATTR_DESCRIPTION);
+	f.addString(map.description);
+
+	FileName tmpName;
+	tmpName.Assign(wxstr(map.spawnfile));
+	f.addU8(OTBM_ATTR_EXT_SPAWN_FILE);
+	f.addString(nstr(tmpName.GetFullName()));
+
+	tmpName.Assign(wxstr(map.housefile));
+	f.addU8(OTBM_ATTR_EXT_HOUSE_FILE);
+	f.addString(nstr(tmpName.GetFullName()));
+}
+
+void IOMapOTBM::saveTownNodes(Map& map, NodeFileWriteHandle& f) {
+	f.addNode(OTBM_TOWNS);
+	for (const auto& townEntry : map.towns) {
+		Town* town = townEntry.second;
+		const Position& townPosition = town->getTemplePosition();
+		f.addNode(OTBM_TOWN);
+		f.addU32(town->getID());
+		f.addString(town->getName());
+		f.addU16(townPosition.x);
+		f.addU16(townPosition.y);
+		f.addU8(townPosition.z);
+		f.endNode();
+	}
+	f.endNode();
+}
+
+void IOMapOTBM::saveWaypointNodes(Map& map, NodeFileWriteHandle& f) {
+	f.addNode(OTBM_WAYPOINTS);
+	for (const auto& waypointEntry : map.waypoints) {
+		Waypoint* waypoint = waypointEntry.second;
+		f.addNode(OTBM_WAYPOINT);
+		f.addString(waypoint->name);
+		f.addU16(waypoint->pos.x);
+		f.addU16(waypoint->pos.y);
+		f.addU8(waypoint->pos.z);
+		f.endNode();
+	}
+	f.endNode();
+}
+
+void IOMapOTBM::saveJournalRecord(Map& map, NodeFileWriteHandle& f) {
+	std::vector<Position> chunks;
+	map.getGenerations().forEachChangedChunk(map.journal_generation, [&chunks](int x, int y, int z) {
+		chunks.push_back(Position(x, y, z));
+	});
+
+	f.addNode(0);
+	{
+		f.addU32(map.getVersion().otbm);
+		f.addU16(map.width);
+		f.addU16(map.height);
 
-				f.addNode(OTBM_WAYPOINTS);
-				for (const auto& waypointEntry : map.waypoints) {
-					Waypoint* waypoint = waypointEntry.second;
-					f.addNode(OTBM_WAYPOINT);
-					f.addString(waypoint->name);
-					f.addU16(waypoint->pos.x);
-					f.addU16(waypoint->pos.y);
-					f.addU8(waypoint->pos.z);
-					f.endNode();
+		f.addU32(chunks.size());
+		for (const Position& chunk : chunks) {
+			f.addU16(chunk.x);
+			f.addU16(chunk.y);
+			f.addU8(chunk.z);
+		}
+
+		f.addNode(OTBM_MAP_DATA);
+		{
+			saveMapAttributes(map, f);
+
+			// A chunk lies inside a single 256x256 block, so it fits in one area node
+			std::vector<Tile*> area_tiles;
+			for (const Position& chunk : chunks) {
+				for (int x = chunk.x; x < chunk.x + MapGenerationTable::CHUNK_SIZE; ++x) {
+					for (int y = chunk.y; y < chunk.y + MapGenerationTable::CHUNK_SIZE; ++y) {
+						Tile* tile = map.getTile(x, y, chunk.z);
+						if (tile && tile->size() > 0) {
+							area_tiles.push_back(tile);
+						}
+					}
+				}
+				if (!area_tiles.empty()) {
+					serializeTileArea(*this, area_tiles, f);
+					area_tiles.clear();
 				}
-				f.endNode();
 			}
+
+			saveTownNodes(map, f);
+			saveWaypointNodes(map, f);
 		}
 		f.endNode();
 	}
 	f.endNode();
+}
 
-	if (waypointsWarning) {
-		g_gui.PopupDialog(g_gui.root, "Warning", "Waypoints were saved, but they are not supported in OTBM 2!\nIf your map fails to load, consider removing all waypoints and saving again.\n\nThis warning can be disabled in file->preferences.", wxOK);
+bool IOMapOTBM::saveJournal(Map& map, const FileName& identifier) {
+	// Changes made in place, a cleared map or another target file all need a full save
+	if (identifier.GetExt() != "otbm" || nstr(identifier.GetFullPath()) != map.filename) {
+		return false;
+	}
+	if (map.journal_generation == 0 || map.getGenerations().getClearGeneration() > map.journal_generation) {
+		return false;
 	}
-	return true;
-}
 
-bool IOMapOTBM::saveSpawns(Map& map, const FileName& dir) {
-	wxString filepath = dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME);
-	filepath += wxString(map.spawnfile.c_str(), wxConvUTF8);
+	JournalHeader header;
+	if (!getJournalHeader(identifier, header)) {
+		return false;
+	}
 
-	// Create the XML file
-	pugi::xml_document doc;
-	if (saveSpawns(map, doc)) {
-		return doc.save_file(filepath.wc_str(), "\t", pugi::format_default, pugi::encoding_utf8);
+	const std::string journal_path = getJournalPath(identifier);
+	size_t journal_size = 0;
+	{
+		FileReadHandle journal(journal_path);
+		if (journal.isOk()) {
+			JournalHeader existing;
+			if (!readJournalHeader(journal, existing) || !matchesJournalHeader(existing, header)) {
+				return false;
+			}
+			journal_size = journal.size();
+		}
+	}
+
+	MemoryNodeFileWriteHandle record;
+	saveJournalRecord(map, record);
+	if (journal_size + record.getSize() > header.map_size / OTBM_JOURNAL_COMPACT_DIVISOR) {
+		// Time to fold the journal back into the map file
+		return false;
 	}
-	return false;
+
+	{
+		FileWriteHandle f(journal_path, true);
+		if (!f.isOk()) {
+			return false;
+		}
+		if (journal_size == 0) {
+			f.addRAW(reinterpret_cast<const uint8_t*>(OTBM_JOURNAL_IDENTIFIER), 4);
+			f.addU32(header.version);
+			f.addU64(header.map_size);
+			f.addU64(header.map_time);
+		}
+		f.addU32(record.getSize());
+		f.addRAW(record.getMemory(), record.getSize());
+		if (!f.isOk()) {
+			// The full save that follows replaces whatever made it into the journal
+			return false;
+		}
+	}
+
+	saveSpawns(map, identifier);
+	saveHouses(map, identifier);
+
+	map.journal_generation = map.getGeneration();
+	return true;
 }
 
-bool IOMapOTBM::saveSpawns(Map& map, pugi::xml_document& doc) {
-	pugi::xml_node decl = doc.prepend_child(pugi::node_declaration);
-	if (!decl) {
+bool IOMapOTBM::saveSpawns(Map& map, const FileName& dir) {
+	std::string filepath = nstr(dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME));
+	filepath += map.spawnfile;
+
+	// Stream the XML file straight to disk
+	XMLStreamWriter writer(filepath);
+	if (!writer.isOk() || !saveSpawns(map, writer)) {
 		return false;
 	}
+	return writer.close();
+}
 
-	decl.append_attribute("version") = "1.0";
+bool IOMapOTBM::saveSpawns(Map& map, XMLStreamWriter& writer) {
+	writer.declaration();
 
 	CreatureList creatureList;
 
-	pugi::xml_node spawnNodes = doc.append_child("spawns");
+	writer.startElement("spawns");
 	for (const auto& spawnPosition : map.spawns) {
 		Tile* tile = map.getTile(spawnPosition);
 		if (tile == nullptr) {
@@ -1681,14 +2458,14 @@ bool IOMapOTBM::saveSpawns(Map& map, pugi::xml_document& doc) {
 		Spawn* spawn = tile->spawn;
 		ASSERT(spawn);
 
-		pugi::xml_node spawnNode = spawnNodes.append_child("spawn");
+		writer.startElement("spawn");
 
-		spawnNode.append_attribute("centerx") = spawnPosition.x;
-		spawnNode.append_attribute("centery") = spawnPosition.y;
-		spawnNode.append_attribute("centerz") = spawnPosition.z;
+		writer.attribute("centerx", spawnPosition.x);
+		writer.attribute("centery", spawnPosition.y);
+		writer.attribute("centerz", spawnPosition.z);
 
 		int32_t radius = spawn->getSize();
-		spawnNode.append_attribute("radius") = radius;
+		writer.attribute("radius", radius);
 
 		for (int32_t y = -radius; y <= radius; ++y) {
 			for (int32_t x = -radius; x <= radius; ++x) {
@@ -1696,16 +2473,17 @@ bool IOMapOTBM::saveSpawns(Map& map, pugi::xml_document& doc) {
 				if (creature_tile) {
 					Creature* creature = creature_tile->creature;
 					if (creature && !creature->isSaved()) {
-						pugi::xml_node creatureNode = spawnNode.append_child(creature->isNpc() ? "npc" : "monster");
+						writer.startElement(creature->isNpc() ? "npc" : "monster");
 
-						creatureNode.append_attribute("name") = creature->getName().c_str();
-						creatureNode.append_attribute("x") = x;
-						creatureNode.append_attribute("y") = y;
-						creatureNode.append_attribute("z") = spawnPosition.z;
-						creatureNode.append_attribute("spawntime") = creature->getSpawnTime();
+						writer.attribute("name", creature->getName());
+						writer.attribute("x", x);
+						writer.attribute("y", y);
+						writer.attribute("z", spawnPosition.z);
+						writer.attribute("spawntime", creature->getSpawnTime());
 						if (creature->getDirection() != NORTH) {
-							creatureNode.append_attribute("direction") = creature->getDirection();
+							writer.attribute("direction", creature->getDirection());
 						}
+						writer.endElement();
 
 						// Mark as saved
 						creature->save();
@@ -1714,7 +2492,9 @@ bool IOMapOTBM::saveSpawns(Map& map, pugi::xml_document& doc) {
 				}
 			}
 		}
+		writer.endElement();
 	}
+	writer.endElement();
 
 	for (Creature* creature : creatureList) {
 		creature->reset();
@@ -1723,84 +2503,78 @@ bool IOMapOTBM::saveSpawns(Map& map, pugi::xml_document& doc) {
 }
 
 bool IOMapOTBM::saveHouses(Map& map, const FileName& dir) {
-	wxString filepath = dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME);
-	filepath += wxString(map.housefile.c_str(), wxConvUTF8);
+	std::string filepath = nstr(dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME));
+	filepath += map.housefile;
 
-	// Create the XML file
-	pugi::xml_document doc;
-	if (saveHouses(map, doc)) {
-		return doc.save_file(filepath.wc_str(), "\t", pugi::format_default, pugi::encoding_utf8);
-	}
-	return false;
-}
-
-bool IOMapOTBM::saveHouses(Map& map, pugi::xml_document& doc) {
-	pugi::xml_node decl = doc.prepend_child(pugi::node_declaration);
-	if (!decl) {
+	// Stream the XML file straight to disk
+	XMLStreamWriter writer(filepath);
+	if (!writer.isOk() || !saveHouses(map, writer)) {
 		return false;
 	}
+	return writer.close();
+}
 
-	decl.append_attribute("version") = "1.0";
+bool IOMapOTBM::saveHouses(Map& map, XMLStreamWriter& writer) {
+	writer.declaration();
 
-	pugi::xml_node houseNodes = doc.append_child("houses");
+	writer.startElement("houses");
 	for (const auto& houseEntry : map.houses) {
 		const House* house = houseEntry.second;
-		pugi::xml_node houseNode = houseNodes.append_child("house");
+		writer.startElement("house");
 
-		houseNode.append_attribute("name") = house->name.c_str();
-		houseNode.append_attribute("houseid") = house->getID();
+		writer.attribute("name", house->name);
+		writer.attribute("houseid", house->getID());
 
 		const Position& exitPosition = house->getExit();
-		houseNode.append_attribute("entryx") = exitPosition.x;
-		houseNode.append_attribute("entryy") = exitPosition.y;
-		houseNode.append_attribute("entryz") = exitPosition.z;
+		writer.attribute("entryx", exitPosition.x);
+		writer.attribute("entryy", exitPosition.y);
+		writer.attribute("entryz", exitPosition.z);
 
-		houseNode.append_attribute("rent") = house->rent;
+		writer.attribute("rent", house->rent);
 		if (house->guildhall) {
-			houseNode.append_attribute("guildhall") = true;
+			writer.attribute("guildhall", true);
 		}
 
-		houseNode.append_attribute("townid") = house->townid;
-		houseNode.append_attribute("size") = static_cast<int32_t>(house->size());
+		writer.attribute("townid", house->townid);
+		writer.attribute("size", static_cast<int32_t>(house->size()));
+		writer.endElement();
 	}
+	writer.endElement();
 	return true;
 }
 
 bool IOMapOTBM::saveWaypoints(Map& map, const FileName& dir) {
-	wxString filepath = dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME);
-	filepath += wxString(map.waypointfile.c_str(), wxConvUTF8);
+	std::string filepath = nstr(dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME));
+	filepath += map.waypointfile;
 
-	// Create the XML file
-	pugi::xml_document doc;
-	if (saveWaypoints(map, doc)) {
-		return doc.save_file(filepath.wc_str(), "\t", pugi::format_default, pugi::encoding_utf8);
-	}
-	return false;
-}
-
-bool IOMapOTBM::saveWaypoints(Map& map, pugi::xml_document& doc) {
-	pugi::xml_node decl = doc.prepend_child(pugi::node_declaration);
-	if (!decl) {
+	// Stream the XML file straight to disk
+	XMLStreamWriter writer(filepath);
+	if (!writer.isOk() || !saveWaypoints(map, writer)) {
 		return false;
 	}
+	return writer.close();
+}
 
-	decl.append_attribute("version") = "1.0";
+bool IOMapOTBM::saveWaypoints(Map& map, XMLStreamWriter& writer) {
+	writer.declaration();
 
-	pugi::xml_node houseNodes = doc.append_child("waypoints");
+	writer.startElement("waypoints");
 	for (const auto& houseEntry : map.houses) {
 		const House* house = houseEntry.second;
-		pugi::xml_node houseNode = houseNodes.append_child("waypoint");
+		writer.startElement("waypoint");
 
-		houseNode.append_attribute("name") = house->name.c_str();
-		houseNode.append_attribute("id") = house->getID();
-		houseNode.append_attribute("icon") = house->getID();
+		writer.attribute("name", house->name);
+		writer.attribute("id", house->getID());
+		writer.attribute("icon", house->getID());
 
 		const Position& exitPosition = house->getExit();
-		houseNode.append_attribute("x") = exitPosition.x;
-		houseNode.append_attribute("y") = exitPosition.y;
-		houseNode.append_attribute("z") = exitPosition.z;
+		writer.attribute("x", exitPosition.x);
+		writer.attribute("y", exitPosition.y);
+		writer.attribute("z", exitPosition.z);
 
-		houseNode.append_attribute("townid") = house->townid;
+		writer.attribute("townid", house->townid);
+		writer.endElement();
 	}
+	writer.endElement();
 	return true;
 }
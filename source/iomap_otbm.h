@@ -20,6 +20,12 @@
 
 #include "iomap.h"
 
+#include <functional>
+#include <memory>
+
+class MapSnapshot;
+class XMLStreamWriter;
+
 // Pragma pack is VERY important since otherwise it won't be able to load the structs correctly
 #pragma pack(1)
 
@@ -123,6 +129,27 @@ struct OTBM_HouseTile_coords {
 
 #pragma pack()
 
+// Everything a map save writes, taken on the thread that edits the map so the file can be written
+// from another one meanwhile. Tiles are copied lazily by the MapSnapshot, the rest is serialized
+// up front by IOMapOTBM::captureMap.
+struct OTBMSaveSnapshot {
+	explicit OTBMSaveSnapshot(Map& map);
+	~OTBMSaveSnapshot();
+
+	std::unique_ptr<MapSnapshot> tiles;
+	MapVersion version;
+	uint16_t width;
+	uint16_t height;
+	MemoryNodeFileWriteHandle attributes; // Map data attributes
+	MemoryNodeFileWriteHandle trailer; // Town and waypoint nodes, written after the tiles
+	std::string spawns; // Contents of the XML files
+	std::string houses;
+	bool has_spawns;
+	bool has_houses;
+	std::string spawnfile;
+	std::string housefile;
+};
+
 class IOMapOTBM : public IOMap {
 public:
 	IOMapOTBM(MapVersion ver) {
@@ -134,11 +161,31 @@ public:
 
 	virtual bool loadMap(Map& map, const FileName& identifier);
 	virtual bool saveMap(Map& map, const FileName& identifier);
+	// Appends the areas changed since the last save to the journal kept next to the map file.
+	// Returns false without writing anything if the map has to be saved in full instead.
+	bool saveJournal(Map& map, const FileName& identifier);
+
+	// Fills in a snapshot, on the thread that edits the map
+	void captureMap(Map& map, OTBMSaveSnapshot& snapshot);
+	// Writes a captured map like saveMap does, from any thread, progress is called with 0-100
+	bool saveSnapshot(OTBMSaveSnapshot& snapshot, const FileName& identifier, const std::function<void(int)>& progress);
+	// Writes the tile area nodes of a map, encoded on worker_count threads. A single worker
+	// encodes in place, any other count must give the same bytes (see verifyParallelSave).
+	// progress, if set, is called with 0-100.
+	void saveTileAreas(Map& map, NodeFileWriteHandle& handle, int worker_count, const std::function<void(int)>& progress = nullptr);
+	// Encodes the tile areas serially and on worker_count threads and compares the bytes.
+	// Returns true if they are identical, report describes the sizes and timings.
+	bool verifyParallelSave(Map& map, int worker_count, std::string& report, const std::function<void(int)>& progress = nullptr);
 
 protected:
 	static bool getVersionInfo(NodeFileReadHandle* f, MapVersion& out_ver);
 
 	virtual bool loadMap(Map& map, NodeFileReadHandle& handle);
+	void loadMapAttributes(Map& map, BinaryNode* mapHeaderNode);
+	void loadTownNodes(Map& map, BinaryNode* townsNode);
+	void loadWaypointNodes(Map& map, BinaryNode* waypointsNode);
+	bool loadJournal(Map& map, const FileName& identifier);
+	bool loadJournalRecord(Map& map, NodeFileReadHandle& handle);
 	bool loadSpawns(Map& map, const FileName& dir);
 	bool loadSpawns(Map& map, pugi::xml_document& doc);
 	bool loadHouses(Map& map, const FileName& dir);
@@ -147,12 +194,16 @@ protected:
 	bool loadWaypoints(Map& map, pugi::xml_document& doc);
 
 	virtual bool saveMap(Map& map, NodeFileWriteHandle& handle);
+	void saveMapAttributes(Map& map, NodeFileWriteHandle& handle);
+	void saveTownNodes(Map& map, NodeFileWriteHandle& handle);
+	void saveWaypointNodes(Map& map, NodeFileWriteHandle& handle);
+	void saveJournalRecord(Map& map, NodeFileWriteHandle& handle);
 	bool saveSpawns(Map& map, const FileName& dir);
-	bool saveSpawns(Map& map, pugi::xml_document& doc);
+	bool saveSpawns(Map& map, XMLStreamWriter& writer);
 	bool saveHouses(Map& map, const FileName& dir);
-	bool saveHouses(Map& map, pugi::xml_document& doc);
+	bool saveHouses(Map& map, XMLStreamWriter& writer);
 	bool saveWaypoints(Map& map, const FileName& dir);
-	bool saveWaypoints(Map& map, pugi::xml_document& doc);
+	bool saveWaypoints(Map& map, XMLStreamWriter& writer);
 };
 
 #endif
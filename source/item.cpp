@@ -30,6 +30,177 @@
 #include "table_brush.h"
 #include "wall_brush.h"
 
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace {
+	// Size classes with 16 byte granularity, this covers Item and all of its subclasses
+	constexpr size_t ITEM_POOL_GRANULARITY = 16;
+	constexpr size_t ITEM_POOL_CLASSES = 16;
+	constexpr size_t ITEM_POOL_MAX_SIZE = ITEM_POOL_GRANULARITY * ITEM_POOL_CLASSES;
+	constexpr size_t ITEM_CACHE_SIZE = 64;
+
+	size_t itemPoolClass(size_t size) {
+		return (size + ITEM_POOL_GRANULARITY - 1) / ITEM_POOL_GRANULARITY - 1;
+	}
+
+	MemoryPool& getItemPool(size_t index) {
+		// Never destroyed, items may still be released from static destructors at exit
+		static MemoryPool** pools = [] {
+			MemoryPool** p = newd MemoryPool*[ITEM_POOL_CLASSES];
+			for (size_t i = 0; i < ITEM_POOL_CLASSES; ++i) {
+				p[i] = newd MemoryPool((i + 1) * ITEM_POOL_GRANULARITY, 2048, true);
+			}
+			return p;
+		}();
+		return *pools[index];
+	}
+
+	// Trivially destructible, so it stays usable even after the flusher below has run
+	struct ItemPoolCache {
+		void* slots[ITEM_POOL_CLASSES][ITEM_CACHE_SIZE];
+		size_t counts[ITEM_POOL_CLASSES];
+		bool disabled;
+
+		void flush(size_t index, size_t keep) {
+			size_t& count = counts[index];
+			if (count > keep) {
+				getItemPool(index).release(&slots[index][keep], count - keep);
+				count = keep;
+			}
+		}
+	};
+	thread_local ItemPoolCache item_cache;
+
+	// Gives the cached objects of a thread back when it exits
+	struct ItemPoolCacheFlusher {
+		~ItemPoolCacheFlusher() {
+			for (size_t i = 0; i < ITEM_POOL_CLASSES; ++i) {
+				item_cache.flush(i, 0);
+			}
+			item_cache.disabled = true;
+		}
+	};
+	thread_local ItemPoolCacheFlusher item_cache_flusher;
+
+	// Shared plain items, keyed by id << 16 | subtype. Instances are never released.
+	struct SharedItemRegistry {
+		std::mutex lock;
+		std::unordered_map<uint32_t, Item*> by_key;
+	};
+
+	SharedItemRegistry& getSharedItems() {
+		static SharedItemRegistry* registry = newd SharedItemRegistry;
+		return *registry;
+	}
+}
+
+void* Item::operator new(size_t size) {
+	if (size > ITEM_POOL_MAX_SIZE) {
+		return ::operator new(size);
+	}
+
+	const size_t index = itemPoolClass(size);
+	ItemPoolCache& cache = item_cache;
+	if (cache.disabled) {
+		return getItemPool(index).allocate();
+	}
+
+	size_t& count = cache.counts[index];
+	if (count == 0) {
+		(void)&item_cache_flusher; // Make sure this thread flushes its cache on exit
+		// Refill half of the cache with a single trip to the shared pool
+		getItemPool(index).allocate(cache.slots[index], ITEM_CACHE_SIZE / 2);
+		count = ITEM_CACHE_SIZE / 2;
+	}
+	return cache.slots[index][--count];
+}
+
+void Item::operator delete(void* ptr, size_t size) {
+	if (!ptr) {
+		return;
+	}
+
+	if (size > ITEM_POOL_MAX_SIZE) {
+		::operator delete(ptr);
+		return;
+	}
+
+	const size_t index = itemPoolClass(size);
+	ItemPoolCache& cache = item_cache;
+	if (cache.disabled) {
+		getItemPool(index).release(ptr);
+		return;
+	}
+
+	if (cache.counts[index] == 0) {
+		(void)&item_cache_flusher;
+	} else if (cache.counts[index] == ITEM_CACHE_SIZE) {
+		cache.flush(index, ITEM_CACHE_SIZE / 2);
+	}
+	cache.slots[index][cache.counts[index]++] = ptr;
+}
+
+MemoryPoolStats Item::getPoolStats() {
+	MemoryPoolStats total;
+	for (size_t i = 0; i < ITEM_POOL_CLASSES; ++i) {
+		total += getItemPool(i).getStats();
+	}
+	return total;
+}
+
+size_t Item::trimPool() {
+	size_t released = 0;
+	for (size_t i = 0; i < ITEM_POOL_CLASSES; ++i) {
+		if (!item_cache.disabled) {
+			item_cache.flush(i, 0);
+		}
+		released += getItemPool(i).trim();
+	}
+	return released;
+}
+
+void Item::Release(Item* const* items, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		Item* item = items[i];
+		if (!item || item->shared) {
+			continue;
+		}
+		if (!item->attributes && typeid(*item) == typeid(Item)) {
+			Item::operator delete(item, sizeof(Item));
+		} else {
+			delete item;
+		}
+	}
+}
+
+Item* Item::GetShared(const Item* item) {
+	ASSERT(item->isShared() || item->isShareable());
+	SharedItemRegistry& registry = getSharedItems();
+	const uint32_t key = (uint32_t(item->id) << 16) | item->subtype;
+
+	std::lock_guard<std::mutex> guard(registry.lock);
+	Item*& shared = registry.by_key[key];
+	if (!shared) {
+		shared = newd Item(item->id, 0);
+		shared->subtype = item->subtype;
+		shared->shared = true;
+	}
+	return shared;
+}
+
+size_t Item::GetSharedCount() {
+	SharedItemRegistry& registry = getSharedItems();
+	std::lock_guard<std::mutex> guard(registry.lock);
+	return registry.by_key.size();
+}
+
+bool Item::isShareable() const {
+	// Subclasses carry state of their own (contents, destinations, door ids...)
+	return !shared && !selected && !locked && !attributes && typeid(*this) == typeid(Item);
+}
+
 Item* Item::Create(uint16_t _type, uint16_t _subtype /*= 0xFFFF*/) {
 	if (_type == 0) {
 		return nullptr;
@@ -73,14 +244,17 @@ Item::Item(unsigned short _type, unsigned short _count) :
 	id(_type),
 	subtype(1),
 	selected(false),
-	frame(0) {
+	frame(0),
+	locked(false),
+	shared(false) {
 	if (hasSubtype()) {
 		subtype = _count;
 	}
 }
 
 Item::~Item() {
-	////
+	// Shared instances belong to the registry, see Item::Release
+	ASSERT(!shared);
 }
 
 Item* Item::deepCopy() const {
@@ -99,13 +273,22 @@ Item* transformItem(Item* old_item, uint16_t new_id, Tile* parent) {
 		return nullptr;
 	}
 
-	old_item->setID(new_id);
-	// Through the magic of deepCopy, this will now be a pointer to an item of the correct type.
-	Item* new_item = old_item->deepCopy();
+	// The old item is looked up by address, which only works for items the tile owns.
+	// Tiles being edited are deep copies, they never hold shared instances.
+	ASSERT(!old_item->isShared());
+	Item* new_item;
+	if (old_item->isShared()) {
+		// Never change a shared instance, it has no attributes or selection to carry over
+		new_item = Item::Create(new_id, old_item->getSubtype());
+	} else {
+		old_item->setID(new_id);
+		// Through the magic of deepCopy, this will now be a pointer to an item of the correct type.
+		new_item = old_item->deepCopy();
+	}
 	if (parent) {
 		// Find the old item and remove it from the tile, insert this one instead!
 		if (old_item == parent->ground) {
-			delete old_item;
+			Item::Release(old_item);
 			parent->ground = new_item;
 			return new_item;
 		}
@@ -113,7 +296,7 @@ Item* transformItem(Item* old_item, uint16_t new_id, Tile* parent) {
 		std::queue<Container*> containers;
 		for (ItemVector::iterator item_iter = parent->items.begin(); item_iter != parent->items.end(); ++item_iter) {
 			if (*item_iter == old_item) {
-				delete old_item;
+				Item::Release(old_item);
 				item_iter = parent->items.erase(item_iter);
 				parent->items.insert(item_iter, new_item);
 				return new_item;
@@ -271,23 +454,23 @@ double Item::getWeight() const {
 }
 
 void Item::setUniqueID(unsigned short n) {
-	setAttribute("uid", n);
+	setAttribute(ATTRIBUTE_UNIQUE_ID, n);
 }
 
 void Item::setActionID(unsigned short n) {
-	setAttribute("aid", n);
+	setAttribute(ATTRIBUTE_ACTION_ID, n);
 }
 
 void Item::setText(const std::string& str) {
-	setAttribute("text", str);
+	setAttribute(ATTRIBUTE_TEXT, str);
 }
 
 void Item::setDescription(const std::string& str) {
-	setAttribute("desc", str);
+	setAttribute(ATTRIBUTE_DESCRIPTION, str);
 }
 
 void Item::setTier(unsigned short n) {
-	setAttribute("tier", n);
+	setAttribute(ATTRIBUTE_TIER, n);
 }
 
 double Item::getWeight() {
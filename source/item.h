@@ -24,6 +24,7 @@
 #include "item_attributes.h"
 #include "doodad_brush.h"
 #include "raw_brush.h"
+#include "memory_pool.h"
 
 class Creature;
 class Border;
@@ -83,6 +84,40 @@ public:
 	static Item* Create_OTBM(const IOMap& maphandle, BinaryNode* stream);
 	// static Item* Create_OTMM(const IOMap& maphandle, BinaryNode* stream);
 
+	// Items and their subclasses are recycled through size-classed pools,
+	// with a small per-thread cache in front so worker threads don't contend on them
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+#ifdef DEBUG_MEM
+	static void* operator new(size_t size, const char*, int) {
+		return operator new(size);
+	}
+#endif
+	// Sum over all size classes, objects sitting in thread caches count as live
+	static MemoryPoolStats getPoolStats();
+	// Hands back the memory of every pool slab that no longer holds any item,
+	// called after a whole map has been destroyed. Returns the number of bytes released.
+	static size_t trimPool();
+
+	// Flyweights, plain items (a bare Item with no attributes) can point at one shared,
+	// immutable instance per (id, subtype) instead of each tile owning its own.
+	// Shared instances must never be modified or deleted, deepCopy always returns a private
+	// item. Items taken off map tiles are freed with Release, which leaves shared ones alone.
+	static Item* GetShared(const Item* item); // Shared twin of a plain item
+	static void Release(Item* item) {
+		if (item && !item->shared) {
+			delete item;
+		}
+	}
+	// Release for all items of a tile being destroyed. Plain items have nothing to tear down,
+	// their memory goes straight back to the pool without the virtual destructor call.
+	static void Release(Item* const* items, size_t count);
+	static size_t GetSharedCount();
+	bool isShared() const {
+		return shared;
+	}
+	bool isShareable() const;
+
 protected:
 	// Constructor for items
 	Item(unsigned short _type, unsigned short _count);
@@ -354,6 +389,7 @@ public:
 		return selected;
 	}
 	void select() {
+		ASSERT(!shared);
 		selected = true;
 	}
 	void deselect() {
@@ -475,6 +511,7 @@ protected:
 	bool selected;
 	int frame;
 	bool locked;
+	bool shared;
 
 private:
 	Item& operator=(const Item& i); // Can't copy
@@ -482,7 +519,6 @@ private:
 	Item& operator==(const Item& i); // Can't compare
 };
 
-typedef std::vector<Item*> ItemVector;
 typedef std::list<Item*> ItemList;
 
 Item* transformItem(Item* old_item, uint16_t new_id, Tile* parent = nullptr);
@@ -495,7 +531,7 @@ inline int Item::getCount() const {
 }
 
 inline uint16_t Item::getUniqueID() const {
-	const int32_t* a = getIntegerAttribute("uid");
+	const int32_t* a = getIntegerAttribute(ATTRIBUTE_UNIQUE_ID);
 	if (a) {
 		return *a;
 	}
@@ -503,7 +539,7 @@ inline uint16_t Item::getUniqueID() const {
 }
 
 inline uint16_t Item::getActionID() const {
-	const int32_t* a = getIntegerAttribute("aid");
+	const int32_t* a = getIntegerAttribute(ATTRIBUTE_ACTION_ID);
 	if (a) {
 		return *a;
 	}
@@ -511,7 +547,7 @@ inline uint16_t Item::getActionID() const {
 }
 
 inline uint16_t Item::getTier() const {
-	const int32_t* a = getIntegerAttribute("tier");
+	const int32_t* a = getIntegerAttribute(ATTRIBUTE_TIER);
 	if (a) {
 		return *a;
 	}
@@ -519,7 +555,7 @@ inline uint16_t Item::getTier() const {
 }
 
 inline std::string Item::getText() const {
-	const std::string* a = getStringAttribute("text");
+	const std::string* a = getStringAttribute(ATTRIBUTE_TEXT);
 	if (a) {
 		return *a;
 	}
@@ -527,7 +563,7 @@ inline std::string Item::getText() const {
 }
 
 inline std::string Item::getDescription() const {
-	const std::string* a = getStringAttribute("desc");
+	const std::string* a = getStringAttribute(ATTRIBUTE_DESCRIPTION);
 	if (a) {
 		return *a;
 	}
@@ -20,12 +20,167 @@
 #include "item_attributes.h"
 #include "filehandle.h"
 
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	const char* const builtin_attribute_names[ATTRIBUTE_FIRST_CUSTOM] = {
+		"aid", "uid", "text", "desc", "tier", "keyid"
+	};
+
+	// Never change, so the save workers can read them without taking the lock
+	const std::string* getBuiltinAttributeNames() {
+		static const std::vector<std::string> names(std::begin(builtin_attribute_names), std::end(builtin_attribute_names));
+		return names.data();
+	}
+
+	struct AttributeNameTable {
+		std::mutex lock;
+		std::deque<std::string> names; // Deque so references handed out stay valid
+		std::unordered_map<std::string, ItemAttributeKey> ids;
+
+		AttributeNameTable() {
+			for (const char* name : builtin_attribute_names) {
+				ids.emplace(name, static_cast<ItemAttributeKey>(names.size()));
+				names.emplace_back(name);
+			}
+		}
+	};
+
+	AttributeNameTable& getAttributeNames() {
+		static AttributeNameTable table;
+		return table;
+	}
+
+	ItemAttributeKey findBuiltinAttribute(const std::string& name) {
+		for (uint16_t key = 0; key < ATTRIBUTE_FIRST_CUSTOM; ++key) {
+			if (name == builtin_attribute_names[key]) {
+				return static_cast<ItemAttributeKey>(key);
+			}
+		}
+		return ATTRIBUTE_NONE;
+	}
+}
+
+ItemAttributeKey ItemAttributeNames::intern(const std::string& name) {
+	ItemAttributeKey key = findBuiltinAttribute(name);
+	if (key != ATTRIBUTE_NONE) {
+		return key;
+	}
+
+	AttributeNameTable& table = getAttributeNames();
+	std::lock_guard<std::mutex> guard(table.lock);
+	auto it = table.ids.find(name);
+	if (it != table.ids.end()) {
+		return it->second;
+	}
+	if (table.names.size() >= ATTRIBUTE_NONE) {
+		// Out of ids, shouldn't happen with any real map
+		return ATTRIBUTE_NONE;
+	}
+	key = static_cast<ItemAttributeKey>(table.names.size());
+	table.names.push_back(name);
+	table.ids.emplace(name, key);
+	return key;
+}
+
+ItemAttributeKey ItemAttributeNames::find(const std::string& name) {
+	ItemAttributeKey key = findBuiltinAttribute(name);
+	if (key != ATTRIBUTE_NONE) {
+		return key;
+	}
+
+	AttributeNameTable& table = getAttributeNames();
+	std::lock_guard<std::mutex> guard(table.lock);
+	auto it = table.ids.find(name);
+	return it != table.ids.end() ? it->second : ATTRIBUTE_NONE;
+}
+
+const std::string& ItemAttributeNames::name(ItemAttributeKey key) {
+	if (key < ATTRIBUTE_FIRST_CUSTOM) {
+		return getBuiltinAttributeNames()[key];
+	}
+
+	AttributeNameTable& table = getAttributeNames();
+	std::lock_guard<std::mutex> guard(table.lock);
+	ASSERT(key < table.names.size());
+	return table.names[key];
+}
+
+// Flat attribute storage
+
+namespace {
+	struct AttributeKeyLess {
+		bool operator()(const ItemAttributeMap::value_type& entry, ItemAttributeKey key) const {
+			return entry.first < key;
+		}
+	};
+}
+
+std::atomic<size_t> ItemAttributeMap::live_maps(0);
+std::atomic<size_t> ItemAttributeMap::live_entries(0);
+
+ItemAttributeMap::ItemAttributeMap() {
+	++live_maps;
+}
+
+ItemAttributeMap::ItemAttributeMap(const ItemAttributeMap& other) :
+	entries(other.entries) {
+	++live_maps;
+	live_entries += entries.size();
+}
+
+ItemAttributeMap& ItemAttributeMap::operator=(const ItemAttributeMap& other) {
+	if (this != &other) {
+		live_entries -= entries.size();
+		entries = other.entries;
+		live_entries += entries.size();
+	}
+	return *this;
+}
+
+ItemAttributeMap::~ItemAttributeMap() {
+	--live_maps;
+	live_entries -= entries.size();
+}
+
+ItemAttributeMap::iterator ItemAttributeMap::find(ItemAttributeKey key) {
+	iterator it = std::lower_bound(entries.begin(), entries.end(), key, AttributeKeyLess());
+	if (it != entries.end() && it->first == key) {
+		return it;
+	}
+	return entries.end();
+}
+
+ItemAttributeMap::const_iterator ItemAttributeMap::find(ItemAttributeKey key) const {
+	const_iterator it = std::lower_bound(entries.begin(), entries.end(), key, AttributeKeyLess());
+	if (it != entries.end() && it->first == key) {
+		return it;
+	}
+	return entries.end();
+}
+
+ItemAttribute& ItemAttributeMap::operator[](ItemAttributeKey key) {
+	if (entries.empty()) {
+		entries.reserve(2);
+	}
+	iterator it = std::lower_bound(entries.begin(), entries.end(), key, AttributeKeyLess());
+	if (it != entries.end() && it->first == key) {
+		return it->second;
+	}
+	++live_entries;
+	return entries.insert(it, value_type(key, ItemAttribute()))->second;
+}
+
 ItemAttributes::ItemAttributes() :
 	attributes(nullptr) {
 	////
 }
 
-ItemAttributes::ItemAttributes(const ItemAttributes& o) {
+ItemAttributes::ItemAttributes(const ItemAttributes& o) :
+	attributes(nullptr) {
 	if (o.attributes) {
 		attributes = newd ItemAttributeMap(*o.attributes);
 	}
@@ -55,32 +210,47 @@ ItemAttributeMap ItemAttributes::getAttributes() const {
 	return ItemAttributeMap();
 }
 
-void ItemAttributes::setAttribute(const std::string& key, const ItemAttribute& value) {
+void ItemAttributes::setAttribute(ItemAttributeKey key, const ItemAttribute& value) {
+	if (key == ATTRIBUTE_NONE) {
+		return;
+	}
 	createAttributes();
 	(*attributes)[key] = value;
 }
 
-void ItemAttributes::setAttribute(const std::string& key, const std::string& value) {
+void ItemAttributes::setAttribute(ItemAttributeKey key, const std::string& value) {
+	if (key == ATTRIBUTE_NONE) {
+		return;
+	}
 	createAttributes();
 	(*attributes)[key].set(value);
 }
 
-void ItemAttributes::setAttribute(const std::string& key, int32_t value) {
+void ItemAttributes::setAttribute(ItemAttributeKey key, int32_t value) {
+	if (key == ATTRIBUTE_NONE) {
+		return;
+	}
 	createAttributes();
 	(*attributes)[key].set(value);
 }
 
-void ItemAttributes::setAttribute(const std::string& key, double value) {
+void ItemAttributes::setAttribute(ItemAttributeKey key, double value) {
+	if (key == ATTRIBUTE_NONE) {
+		return;
+	}
 	createAttributes();
 	(*attributes)[key].set(value);
 }
 
-void ItemAttributes::setAttribute(const std::string& key, bool value) {
+void ItemAttributes::setAttribute(ItemAttributeKey key, bool value) {
+	if (key == ATTRIBUTE_NONE) {
+		return;
+	}
 	createAttributes();
 	(*attributes)[key].set(value);
 }
 
-void ItemAttributes::eraseAttribute(const std::string& key) {
+void ItemAttributes::eraseAttribute(ItemAttributeKey key) {
 	if (!attributes) {
 		return;
 	}
@@ -92,54 +262,96 @@ void ItemAttributes::eraseAttribute(const std::string& key) {
 	}
 }
 
-const std::string* ItemAttributes::getStringAttribute(const std::string& key) const {
+const std::string* ItemAttributes::getStringAttribute(ItemAttributeKey key) const {
 	if (!attributes) {
 		return nullptr;
 	}
 
-	ItemAttributeMap::iterator iter = attributes->find(key);
+	ItemAttributeMap::const_iterator iter = attributes->find(key);
 	if (iter != attributes->end()) {
 		return iter->second.getString();
 	}
 	return nullptr;
 }
 
-const int32_t* ItemAttributes::getIntegerAttribute(const std::string& key) const {
+const int32_t* ItemAttributes::getIntegerAttribute(ItemAttributeKey key) const {
 	if (!attributes) {
 		return nullptr;
 	}
 
-	ItemAttributeMap::iterator iter = attributes->find(key);
+	ItemAttributeMap::const_iterator iter = attributes->find(key);
 	if (iter != attributes->end()) {
 		return iter->second.getInteger();
 	}
 	return nullptr;
 }
 
-const double* ItemAttributes::getFloatAttribute(const std::string& key) const {
+const double* ItemAttributes::getFloatAttribute(ItemAttributeKey key) const {
 	if (!attributes) {
 		return nullptr;
 	}
 
-	ItemAttributeMap::iterator iter = attributes->find(key);
+	ItemAttributeMap::const_iterator iter = attributes->find(key);
 	if (iter != attributes->end()) {
 		return iter->second.getFloat();
 	}
 	return nullptr;
 }
 
-const bool* ItemAttributes::getBooleanAttribute(const std::string& key) const {
+const bool* ItemAttributes::getBooleanAttribute(ItemAttributeKey key) const {
 	if (!attributes) {
 		return nullptr;
 	}
 
-	ItemAttributeMap::iterator iter = attributes->find(key);
+	ItemAttributeMap::const_iterator iter = attributes->find(key);
 	if (iter != attributes->end()) {
 		return iter->second.getBoolean();
 	}
 	return nullptr;
 }
 
+void ItemAttributes::setAttribute(const std::string& key, const ItemAttribute& value) {
+	setAttribute(ItemAttributeNames::intern(key), value);
+}
+
+void ItemAttributes::setAttribute(const std::string& key, const std::string& value) {
+	setAttribute(ItemAttributeNames::intern(key), value);
+}
+
+void ItemAttributes::setAttribute(const std::string& key, int32_t value) {
+	setAttribute(ItemAttributeNames::intern(key), value);
+}
+
+void ItemAttributes::setAttribute(const std::string& key, double value) {
+	setAttribute(ItemAttributeNames::intern(key), value);
+}
+
+void ItemAttributes::setAttribute(const std::string& key, bool value) {
+	setAttribute(ItemAttributeNames::intern(key), value);
+}
+
+void ItemAttributes::eraseAttribute(const std::string& key) {
+	if (attributes) {
+		eraseAttribute(ItemAttributeNames::find(key));
+	}
+}
+
+const std::string* ItemAttributes::getStringAttribute(const std::string& key) const {
+	return attributes ? getStringAttribute(ItemAttributeNames::find(key)) : nullptr;
+}
+
+const int32_t* ItemAttributes::getIntegerAttribute(const std::string& key) const {
+	return attributes ? getIntegerAttribute(ItemAttributeNames::find(key)) : nullptr;
+}
+
+const double* ItemAttributes::getFloatAttribute(const std::string& key) const {
+	return attributes ? getFloatAttribute(ItemAttributeNames::find(key)) : nullptr;
+}
+
+const bool* ItemAttributes::getBooleanAttribute(const std::string& key) const {
+	return attributes ? getBooleanAttribute(ItemAttributeNames::find(key)) : nullptr;
+}
+
 bool ItemAttributes::hasStringAttribute(const std::string& key) const {
 	return getStringAttribute(key) != nullptr;
 }
@@ -282,16 +494,22 @@ bool ItemAttributes::unserializeAttributeMap(const IOMap& maphandle, BinaryNode*
 		createAttributes();
 
 		std::string key;
-		ItemAttribute attrib;
-
 		while (n--) {
 			if (!stream->getString(key)) {
 				return false;
 			}
-			if (!attrib.unserialize(maphandle, stream)) {
+			const ItemAttributeKey id = ItemAttributeNames::intern(key);
+			if (id == ATTRIBUTE_NONE) {
+				ItemAttribute discarded;
+				if (!discarded.unserialize(maphandle, stream)) {
+					return false;
+				}
+				continue;
+			}
+			// Read straight into the slot, no temporary attribute to copy
+			if (!(*attributes)[id].unserialize(maphandle, stream)) {
 				return false;
 			}
-			(*attributes)[key] = attrib;
 		}
 	}
 	return true;
@@ -301,18 +519,26 @@ void ItemAttributes::serializeAttributeMap(const IOMap& maphandle, NodeFileWrite
 	// Maximum of 65535 attributes per item
 	f.addU16(std::min((size_t)0xFFFF, attributes->size()));
 
-	ItemAttributeMap::const_iterator attribute = attributes->begin();
+	// Written in name order, like the files saved before keys were interned
+	std::vector<std::pair<const std::string*, const ItemAttribute*>> sorted;
+	sorted.reserve(attributes->size());
+	for (const ItemAttributeMap::value_type& attribute : *attributes) {
+		sorted.emplace_back(&ItemAttributeNames::name(attribute.first), &attribute.second);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<const std::string*, const ItemAttribute*>& a, const std::pair<const std::string*, const ItemAttribute*>& b) {
+		return *a.first < *b.first;
+	});
+
 	int i = 0;
-	while (attribute != attributes->end() && i <= 0xFFFF) {
-		const std::string& key = attribute->first;
+	for (auto attribute = sorted.begin(); attribute != sorted.end() && i <= 0xFFFF; ++attribute, ++i) {
+		const std::string& key = *attribute->first;
 		if (key.size() > 0xFFFF) {
 			f.addString(key.substr(0, 65535));
 		} else {
 			f.addString(key);
 		}
 
-		attribute->second.serialize(maphandle, f);
-		++attribute, ++i;
+		attribute->second->serialize(maphandle, f);
 	}
 }
 
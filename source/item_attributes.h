@@ -18,7 +18,9 @@
 #ifndef RME_ITEM_ATTRIBUTES_H_
 #define RME_ITEM_ATTRIBUTES_H_
 
+#include <atomic>
 #include <string>
+#include <vector>
 #include <map>
 
 #include "filehandle.h"
@@ -70,7 +72,84 @@ private:
 	char data[sizeof(std::string) > sizeof(double) ? sizeof(std::string) : sizeof(double)];
 };
 
-typedef std::map<std::string, ItemAttribute> ItemAttributeMap;
+// Attribute names are interned into small ids, so lookups compare integers instead of strings.
+// The keys the editor itself uses have fixed ids, any other name gets one the first time it's seen.
+enum ItemAttributeKey : uint16_t {
+	ATTRIBUTE_ACTION_ID, // "aid"
+	ATTRIBUTE_UNIQUE_ID, // "uid"
+	ATTRIBUTE_TEXT, // "text"
+	ATTRIBUTE_DESCRIPTION, // "desc"
+	ATTRIBUTE_TIER, // "tier"
+	ATTRIBUTE_KEY_ID, // "keyid"
+
+	ATTRIBUTE_FIRST_CUSTOM,
+	ATTRIBUTE_NONE = 0xFFFF
+};
+
+class ItemAttributeNames {
+public:
+	// Returns the id of the name, registering it if needed
+	static ItemAttributeKey intern(const std::string& name);
+	// Returns ATTRIBUTE_NONE for names that were never registered, no item can have those
+	static ItemAttributeKey find(const std::string& name);
+	static const std::string& name(ItemAttributeKey key);
+};
+
+// Attributes of one item, kept in a vector sorted by key. Items rarely have more than
+// two or three attributes, so this beats a tree both in lookups and in memory.
+class ItemAttributeMap {
+public:
+	typedef std::pair<ItemAttributeKey, ItemAttribute> value_type;
+	typedef std::vector<value_type>::iterator iterator;
+	typedef std::vector<value_type>::const_iterator const_iterator;
+
+	ItemAttributeMap();
+	ItemAttributeMap(const ItemAttributeMap& other);
+	ItemAttributeMap& operator=(const ItemAttributeMap& other);
+	~ItemAttributeMap();
+
+	iterator begin() {
+		return entries.begin();
+	}
+	iterator end() {
+		return entries.end();
+	}
+	const_iterator begin() const {
+		return entries.begin();
+	}
+	const_iterator end() const {
+		return entries.end();
+	}
+	size_t size() const {
+		return entries.size();
+	}
+	bool empty() const {
+		return entries.empty();
+	}
+
+	iterator find(ItemAttributeKey key);
+	const_iterator find(ItemAttributeKey key) const;
+	// Inserts an empty attribute if there is none for this key
+	ItemAttribute& operator[](ItemAttributeKey key);
+	void erase(iterator where) {
+		entries.erase(where);
+		--live_entries;
+	}
+
+	// Maps and attributes alive across the whole editor, for the memory window
+	static size_t getLiveCount() {
+		return live_maps;
+	}
+	static size_t getLiveEntries() {
+		return live_entries;
+	}
+
+private:
+	std::vector<value_type> entries;
+
+	static std::atomic<size_t> live_maps;
+	static std::atomic<size_t> live_entries;
+};
 
 class ItemAttributes {
 public:
@@ -83,6 +162,20 @@ public:
 	bool unserializeAttributeMap(const IOMap& maphandle, BinaryNode* node);
 
 public:
+	void setAttribute(ItemAttributeKey key, const ItemAttribute& attr);
+	void setAttribute(ItemAttributeKey key, const std::string& value);
+	void setAttribute(ItemAttributeKey key, int32_t value);
+	void setAttribute(ItemAttributeKey key, double value);
+	void setAttribute(ItemAttributeKey key, bool set);
+
+	const std::string* getStringAttribute(ItemAttributeKey key) const;
+	const int32_t* getIntegerAttribute(ItemAttributeKey key) const;
+	const double* getFloatAttribute(ItemAttributeKey key) const;
+	const bool* getBooleanAttribute(ItemAttributeKey key) const;
+
+	void eraseAttribute(ItemAttributeKey key);
+
+	// Same as above, by name
 	void setAttribute(const std::string& key, const ItemAttribute& attr);
 	void setAttribute(const std::string& key, const std::string& value);
 	void setAttribute(const std::string& key, int32_t value);
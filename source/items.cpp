@@ -755,7 +755,12 @@ bool ItemDatabase::loadFromOtbVer3(BinaryNode* itemNode, wxString& error, wxArra
 
 bool ItemDatabase::loadFromOtb(const FileName& datafile, wxString& error, wxArrayString& warnings) {
 	std::string filename = nstr((datafile.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + datafile.GetFullName()));
-	DiskNodeFileReadHandle f(filename, StringVector(1, "OTBI"));
+	// Read in place from a mapping when possible, every item is a separate node
+	std::unique_ptr<NodeFileReadHandle> handle(newd MappedNodeFileReadHandle(filename, StringVector(1, "OTBI")));
+	if (!handle->isOk()) {
+		handle.reset(newd DiskNodeFileReadHandle(filename, StringVector(1, "OTBI")));
+	}
+	NodeFileReadHandle& f = *handle;
 
 	if (!f.isOk()) {
 		error = "Couldn't open file \"" + wxstr(filename) + "\":" + wxstr(f.getErrorMessage());
@@ -1058,6 +1063,141 @@ bool ItemDatabase::loadFromGameXml(const FileName& identifier, wxString& error,
 	return true;
 }
 
+namespace {
+	// Every flag items.otb and items.xml can set, in the order of the cache bit mask
+	bool ItemType::* const cached_item_flags[] = {
+		&ItemType::client_chargeable,
+		&ItemType::extra_chargeable,
+		&ItemType::ignoreLook,
+		&ItemType::isHangable,
+		&ItemType::hookEast,
+		&ItemType::hookSouth,
+		&ItemType::canReadText,
+		&ItemType::canWriteText,
+		&ItemType::allowDistRead,
+		&ItemType::replaceable,
+		&ItemType::decays,
+		&ItemType::stackable,
+		&ItemType::moveable,
+		&ItemType::alwaysOnBottom,
+		&ItemType::pickupable,
+		&ItemType::rotable,
+		&ItemType::floorChangeDown,
+		&ItemType::floorChangeNorth,
+		&ItemType::floorChangeSouth,
+		&ItemType::floorChangeEast,
+		&ItemType::floorChangeWest,
+		&ItemType::floorChange,
+		&ItemType::unpassable,
+		&ItemType::blockPickupable,
+		&ItemType::blockMissiles,
+		&ItemType::blockPathfinder,
+		&ItemType::hasElevation,
+	};
+}
+
+bool ItemDatabase::loadFromCache(FileReadHandle& file) {
+	uint16_t max_id;
+	uint32_t count;
+	if (!file.getU32(MajorVersion) || !file.getU32(MinorVersion) || !file.getU32(BuildNumber) || !file.getU16(max_id) || !file.getU32(count)) {
+		return false;
+	}
+
+	// Same check as loadFromOtb, the parser reports the error if it fails
+	if (g_settings.getInteger(Config::CHECK_SIGNATURES)) {
+		if (g_gui.GetCurrentVersion().getOTBVersion().format_version != MajorVersion) {
+			return false;
+		}
+	}
+	max_item_id = std::max(max_item_id, max_id);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		std::unique_ptr<ItemType> t(newd ItemType());
+		uint8_t group, type;
+		uint32_t weight, attack, defense, armor, top_order, flags;
+		if (!file.getU16(t->id) || !file.getU16(t->clientID) || !file.getU8(group) || !file.getU8(type)
+			|| !file.getU16(t->volume) || !file.getU16(t->maxTextLen) || !file.getU16(t->slot_position) || !file.getU8(t->weapon_type) || !file.getU8(t->classification)
+			|| !file.getString(t->name) || !file.getString(t->editorsuffix) || !file.getLongString(t->description)
+			|| !file.getU32(weight) || !file.getU32(attack) || !file.getU32(defense) || !file.getU32(armor) || !file.getU32(t->charges)
+			|| !file.getU32(top_order) || !file.getU16(t->rotateTo) || !file.getU32(flags)) {
+			return false;
+		}
+		t->group = ItemGroup_t(group);
+		t->type = ItemTypes_t(type);
+		memcpy(&t->weight, &weight, sizeof(t->weight));
+		t->attack = attack;
+		t->defense = defense;
+		t->armor = armor;
+		t->alwaysOnTopOrder = top_order;
+		uint32_t bit = 1;
+		for (bool ItemType::*flag : cached_item_flags) {
+			(*t).*flag = (flags & bit) != 0;
+			bit <<= 1;
+		}
+		t->sprite = static_cast<GameSprite*>(g_gui.gfx.getSprite(t->clientID));
+
+		if (items[t->id]) {
+			delete items[t->id];
+		}
+		items.set(t->id, t.release());
+	}
+	return true;
+}
+
+void ItemDatabase::saveToCache(FileWriteHandle& file) {
+	file.addU32(MajorVersion);
+	file.addU32(MinorVersion);
+	file.addU32(BuildNumber);
+	file.addU16(max_item_id);
+
+	uint32_t count = 0;
+	for (size_t id = 0; id < items.size(); ++id) {
+		if (items[id]) {
+			++count;
+		}
+	}
+	file.addU32(count);
+
+	for (size_t id = 0; id < items.size(); ++id) {
+		const ItemType* t = items[id];
+		if (!t) {
+			continue;
+		}
+
+		uint32_t weight;
+		memcpy(&weight, &t->weight, sizeof(weight));
+		uint32_t flags = 0;
+		uint32_t bit = 1;
+		for (bool ItemType::*flag : cached_item_flags) {
+			if (t->*flag) {
+				flags |= bit;
+			}
+			bit <<= 1;
+		}
+
+		file.addU16(t->id);
+		file.addU16(t->clientID);
+		file.addU8(t->group);
+		file.addU8(t->type);
+		file.addU16(t->volume);
+		file.addU16(t->maxTextLen);
+		file.addU16(t->slot_position);
+		file.addU8(t->weapon_type);
+		file.addU8(t->classification);
+		file.addString(t->name);
+		file.addString(t->editorsuffix);
+		file.addLongString(t->description);
+		file.addU32(weight);
+		file.addU32(t->attack);
+		file.addU32(t->defense);
+		file.addU32(t->armor);
+		file.addU32(t->charges);
+		file.addU32(t->alwaysOnTopOrder);
+		file.addU16(t->rotateTo);
+		file.addU32(flags);
+	}
+}
+
 bool ItemDatabase::loadMetaItem(pugi::xml_node node) {
 	if (const pugi::xml_attribute attribute = node.attribute("id")) {
 		const uint16_t id = attribute.as_ushort();
@@ -441,6 +441,9 @@ public:
 	bool loadFromGameXml(const FileName& datafile, wxString& error, wxArrayString& warnings);
 	bool loadItemFromGameXml(pugi::xml_node itemNode, int id);
 	bool loadMetaItem(pugi::xml_node node);
+	// The state loadFromOtb and loadFromGameXml leave behind, as stored by MetadataCache
+	bool loadFromCache(FileReadHandle& file);
+	void saveToCache(FileWriteHandle& file);
 
 	// typedef std::map<int32_t, ItemType*> ItemMap;
 	typedef contigous_vector<ItemType*> ItemMap;
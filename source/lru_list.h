@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_LRU_LIST_H_
+#define RME_LRU_LIST_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Links an object into an LRUList, lives inside the object so nothing gets allocated
+template <typename T>
+struct LRUHook {
+	T* prev = nullptr;
+	T* next = nullptr;
+	size_t bytes = 0;
+	uint64_t lastuse = 0; // Frame the object was last used in
+	bool linked = false;
+};
+
+// Intrusive least recently used list, every operation is O(1)
+// The front holds the object used last, evictions take from the back.
+template <typename T, LRUHook<T> T::*Hook>
+class LRUList {
+public:
+	LRUList() = default;
+	LRUList(const LRUList&) = delete;
+	LRUList& operator=(const LRUList&) = delete;
+
+	void insert(T* object, size_t bytes, uint64_t frame) {
+		LRUHook<T>& hook = object->*Hook;
+		if (hook.linked) {
+			remove(object);
+		}
+		hook.bytes = bytes;
+		hook.lastuse = frame;
+		hook.linked = true;
+		link(object);
+		++count;
+		total_bytes += bytes;
+	}
+
+	// Moves a linked object to the front
+	void touch(T* object, uint64_t frame) {
+		LRUHook<T>& hook = object->*Hook;
+		if (!hook.linked) {
+			return;
+		}
+		hook.lastuse = frame;
+		if (head != object) {
+			unlink(object);
+			link(object);
+		}
+	}
+
+	void remove(T* object) {
+		LRUHook<T>& hook = object->*Hook;
+		if (!hook.linked) {
+			return;
+		}
+		unlink(object);
+		hook.linked = false;
+		--count;
+		total_bytes -= hook.bytes;
+	}
+
+	T* back() const {
+		return tail;
+	}
+	size_t size() const {
+		return count;
+	}
+	size_t bytes() const {
+		return total_bytes;
+	}
+
+private:
+	void link(T* object) {
+		LRUHook<T>& hook = object->*Hook;
+		hook.prev = nullptr;
+		hook.next = head;
+		if (head) {
+			(head->*Hook).prev = object;
+		} else {
+			tail = object;
+		}
+		head = object;
+	}
+
+	void unlink(T* object) {
+		LRUHook<T>& hook = object->*Hook;
+		if (hook.prev) {
+			(hook.prev->*Hook).next = hook.next;
+		} else {
+			head = hook.next;
+		}
+		if (hook.next) {
+			(hook.next->*Hook).prev = hook.prev;
+		} else {
+			tail = hook.prev;
+		}
+		hook.prev = nullptr;
+		hook.next = nullptr;
+	}
+
+	T* head = nullptr;
+	T* tail = nullptr;
+	size_t count = 0;
+	size_t total_bytes = 0;
+};
+
+#endif
@@ -94,6 +94,12 @@ _Ret_bytecap_(_Size) inline void* __CRTDECL operator new[](size_t _Size, const c
 	#include <archive_entry.h>
 #endif
 
+// Zstandard and LZ4, for OTBZ
+#ifdef OTBZ_SUPPORT
+	#include <zstd.h>
+	#include <lz4frame.h>
+#endif
+
 // This has annoyed me one time too many
 #define wxANY_ID (wxID_ANY)
 
@@ -130,6 +136,7 @@ typedef wxFileName FileName;
 #include "json.h"
 
 #include "con_vector.h"
+#include "small_vector.h"
 #include "common.h"
 #include "threads.h"
 
@@ -68,6 +68,8 @@
 #include "map.h"
 #include "editor.h"
 #include "gui.h"
+#include "iomap_otbm.h"
+#include "filehandle.h"
 #include "border_editor_window.h"
 #include "map_summary_window.h"
 #include "otmapgen_dialog.h"
@@ -222,8 +224,18 @@ MainMenuBar::MainMenuBar(MainFrame* frame) :
 	MAKE_ACTION(EXT_HOUSE_SHADER, wxITEM_CHECK, OnChangeViewSettings);
 
 	MAKE_ACTION(EXPERIMENTAL_FOG, wxITEM_CHECK, OnChangeViewSettings); // experimental
+	MAKE_ACTION(EXPERIMENTAL_CHUNK_INDEX, wxITEM_CHECK, OnChangeChunkIndex);
+	MAKE_ACTION(EXPERIMENTAL_CONTIGUOUS_STORAGE, wxITEM_CHECK, OnChangeContiguousStorage);
+	MAKE_ACTION(EXPERIMENTAL_SHARE_ITEMS, wxITEM_CHECK, OnChangeShareItems);
+	MAKE_ACTION(EXPERIMENTAL_JOURNAL_SAVE, wxITEM_CHECK, OnChangeJournalSave);
+	MAKE_ACTION(EXPERIMENTAL_BACKGROUND_SAVE, wxITEM_CHECK, OnChangeBackgroundSave);
+	MAKE_ACTION(EXPERIMENTAL_OTBZ_LZ4, wxITEM_CHECK, OnChangeOtbzLz4);
+	MAKE_ACTION(VERIFY_PARALLEL_SAVE, wxITEM_NORMAL, OnVerifyParallelSave);
+	MAKE_ACTION(BENCHMARK_NODE_ESCAPING, wxITEM_NORMAL, OnBenchmarkNodeEscaping);
+	MAKE_ACTION(EXPERIMENTAL_METADATA_CACHE, wxITEM_CHECK, OnChangeMetadataCache);
 
 	MAKE_ACTION(WIN_MINIMAP, wxITEM_NORMAL, OnMinimapWindow);
+	MAKE_ACTION(WIN_MEMORY_USAGE, wxITEM_NORMAL, OnMemoryWindow);
 	MAKE_ACTION(NEW_PALETTE, wxITEM_NORMAL, OnNewPalette);
 	MAKE_ACTION(TAKE_SCREENSHOT, wxITEM_NORMAL, OnTakeScreenshot);
 
@@ -393,20 +405,23 @@ void MainMenuBar::Update() {
 	bool is_live = editor && editor->IsLive();
 	bool is_host = has_map && !editor->IsLiveClient();
 	bool is_local = has_map && !is_live;
+	// Whole map operations edit tiles in place, which a background save can't snapshot
+	bool is_saving = has_map && editor->isSaving();
+	bool is_idle = is_local && !is_saving;
 
-	EnableItem(CLOSE, is_local);
-	EnableItem(SAVE, is_host);
-	EnableItem(SAVE_AS, is_host);
+	EnableItem(CLOSE, is_idle);
+	EnableItem(SAVE, is_host && !is_saving);
+	EnableItem(SAVE_AS, is_host && !is_saving);
 	EnableItem(GENERATE_MAP, false);
 
-	EnableItem(IMPORT_MAP, is_local);
+	EnableItem(IMPORT_MAP, is_idle);
 	EnableItem(IMPORT_MONSTERS, is_local);
 	EnableItem(IMPORT_MINIMAP, false);
 	EnableItem(EXPORT_MINIMAP, is_local);
 	EnableItem(EXPORT_TILESETS, loaded);
 
 	EnableItem(FIND_ITEM, is_host);
-	EnableItem(REPLACE_ITEMS, is_local);
+	EnableItem(REPLACE_ITEMS, is_idle);
 	EnableItem(SEARCH_ON_MAP_EVERYTHING, is_host);
 	EnableItem(SEARCH_ON_MAP_UNIQUE, is_host);
 	EnableItem(SEARCH_ON_MAP_ACTION, is_host);
@@ -425,29 +440,31 @@ void MainMenuBar::Update() {
 	EnableItem(COPY, has_map);
 
 	EnableItem(BORDERIZE_SELECTION, has_map && has_selection);
-	EnableItem(BORDERIZE_MAP, is_local);
+	EnableItem(BORDERIZE_MAP, is_idle);
 	EnableItem(RANDOMIZE_SELECTION, has_map && has_selection);
-	EnableItem(RANDOMIZE_MAP, is_local);
+	EnableItem(RANDOMIZE_MAP, is_idle);
 
 	EnableItem(GOTO_PREVIOUS_POSITION, has_map);
 	EnableItem(GOTO_POSITION, has_map);
 	EnableItem(JUMP_TO_BRUSH, loaded);
 	EnableItem(JUMP_TO_ITEM_BRUSH, loaded);
 
-	EnableItem(MAP_REMOVE_ITEMS, is_host);
-	EnableItem(MAP_REMOVE_CORPSES, is_local);
-	EnableItem(MAP_REMOVE_DUPLICATES, is_local);
-	EnableItem(MAP_REMOVE_UNREACHABLE_TILES, is_local);
-	EnableItem(CLEAR_INVALID_HOUSES, is_local);
-	EnableItem(CLEAR_MODIFIED_STATE, is_local);
+	EnableItem(MAP_REMOVE_ITEMS, is_host && !is_saving);
+	EnableItem(MAP_REMOVE_CORPSES, is_idle);
+	EnableItem(MAP_REMOVE_DUPLICATES, is_idle);
+	EnableItem(MAP_REMOVE_UNREACHABLE_TILES, is_idle);
+	EnableItem(CLEAR_INVALID_HOUSES, is_idle);
+	EnableItem(CLEAR_MODIFIED_STATE, is_idle);
 
-	EnableItem(EDIT_TOWNS, is_local);
+	EnableItem(EDIT_TOWNS, is_idle);
 	EnableItem(EDIT_ITEMS, false);
 	EnableItem(EDIT_MONSTERS, false);
 
-	EnableItem(MAP_CLEANUP, is_local);
-	EnableItem(MAP_PROPERTIES, is_local);
+	EnableItem(MAP_CLEANUP, is_idle);
+	EnableItem(MAP_PROPERTIES, is_idle);
 	EnableItem(MAP_STATISTICS, is_local);
+	EnableItem(VERIFY_PARALLEL_SAVE, is_local);
+	EnableItem(BENCHMARK_NODE_ESCAPING, is_local);
 
 	EnableItem(NEW_VIEW, has_map);
 	EnableItem(NEW_DETACHED_VIEW, has_map);
@@ -470,10 +487,10 @@ void MainMenuBar::Update() {
 	EnableItem(SELECT_WAYPOINT, loaded);
 	EnableItem(SELECT_RAW, loaded);
 
-	EnableItem(LIVE_START, is_local);
+	EnableItem(LIVE_START, is_idle);
 	EnableItem(LIVE_JOIN, loaded);
 	EnableItem(LIVE_CLOSE, is_live);
-	EnableItem(ID_MENU_SERVER_HOST, is_local);
+	EnableItem(ID_MENU_SERVER_HOST, is_idle);
 	EnableItem(ID_MENU_SERVER_CONNECT, loaded);
 
 	EnableItem(DEBUG_VIEW_DAT, loaded);
@@ -545,6 +562,13 @@ void MainMenuBar::LoadValues() {
 	CheckItem(EXT_HOUSE_SHADER, g_settings.getBoolean(Config::EXT_HOUSE_SHADER));
 
 	CheckItem(EXPERIMENTAL_FOG, g_settings.getBoolean(Config::EXPERIMENTAL_FOG));
+	CheckItem(EXPERIMENTAL_CHUNK_INDEX, g_settings.getBoolean(Config::USE_CHUNK_INDEX));
+	CheckItem(EXPERIMENTAL_CONTIGUOUS_STORAGE, g_settings.getBoolean(Config::CONTIGUOUS_TILE_STORAGE));
+	CheckItem(EXPERIMENTAL_SHARE_ITEMS, g_settings.getBoolean(Config::SHARE_PLAIN_ITEMS));
+	CheckItem(EXPERIMENTAL_JOURNAL_SAVE, g_settings.getBoolean(Config::JOURNAL_SAVE));
+	CheckItem(EXPERIMENTAL_BACKGROUND_SAVE, g_settings.getBoolean(Config::BACKGROUND_SAVE));
+	CheckItem(EXPERIMENTAL_OTBZ_LZ4, g_settings.getBoolean(Config::OTBZ_USE_LZ4));
+	CheckItem(EXPERIMENTAL_METADATA_CACHE, g_settings.getBoolean(Config::METADATA_CACHE));
 }
 
 void MainMenuBar::LoadRecentFiles() {
@@ -1974,6 +1998,7 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 	uint64_t action_item_count = 0;
 	uint64_t unique_item_count = 0;
 	uint64_t container_count = 0; // Only includes containers containing more than 1 item
+	uint64_t shared_item_refs = 0;
 
 	int town_count = map->towns.count();
 	int house_count = map->houses.count();
@@ -1987,12 +2012,28 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 	double sqm_per_house = 0.0;
 	double sqm_per_town = 0.0;
 
+	// Estimate of the heap blocks a plain std::vector would have needed for the
+	// item stacks that now fit in ItemVector's inline storage, minus the extra inline bytes
+	int64_t item_stack_saved = 0;
+	auto account_item_stack = [&item_stack_saved](const ItemVector& v) {
+		item_stack_saved -= int64_t(sizeof(ItemVector)) - int64_t(sizeof(std::vector<Item*>));
+		if (!v.empty() && v.isInline()) {
+			size_t capacity = 1;
+			while (capacity < v.size()) {
+				capacity <<= 1;
+			}
+			// Allocator header, rounded to 16 bytes
+			item_stack_saved += (capacity * sizeof(Item*) + sizeof(size_t) + 15) & ~size_t(15);
+		}
+	};
+
 	for (MapIterator mit = map->begin(); mit != map->end(); ++mit) {
 		Tile* tile = (*mit)->get();
 		if (load_counter % 8192 == 0) {
 			g_gui.SetLoadDone((unsigned int)(int64_t(load_counter) * 95ll / int64_t(map->getTileCount())));
 		}
 
+		account_item_stack(tile->items);
 		if (tile->empty()) {
 			continue;
 		}
@@ -2003,6 +2044,9 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 #define ANALYZE_ITEM(_item)                                         \
 	{                                                               \
 		item_count += 1;                                            \
+		if ((_item)->isShared()) {                                  \
+			shared_item_refs += 1;                                  \
+		}                                                           \
 		if (!(_item)->isGroundTile() && !(_item)->isBorder()) {     \
 			is_detailed = true;                                     \
 			ItemType& it = g_items[(_item)->getID()];               \
@@ -2019,6 +2063,7 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 				unique_item_count += 1;                             \
 			}                                                       \
 			if (Container* c = dynamic_cast<Container*>((_item))) { \
+				account_item_stack(c->getVector());                 \
 				if (c->getVector().size()) {                        \
 					container_count += 1;                           \
 				}                                                   \
@@ -2178,6 +2223,23 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 	os << "\t\tClient version: " << map->getVersion().client << "\n";
 	os << "\t\tFile size (approximate): " << (map->getTileCount() * 512 / 1024) << " KB\n";
 
+	// Pool counters of the map structure
+	const MemoryPoolStats tile_stats = MapAllocator::getTileStats();
+	const MemoryPoolStats floor_stats = map->allocator.getFloorStats();
+	const MemoryPoolStats node_stats = map->allocator.getNodeStats();
+	const MemoryPoolStats item_stats = Item::getPoolStats();
+	os << "\tAllocator data:\n";
+	os << "\t\tTiles (all maps): " << tile_stats.live << " live, " << tile_stats.peak << " peak, " << (tile_stats.reserved_bytes / 1024) << " KB reserved\n";
+	os << "\t\tItems (all maps): " << item_stats.live << " live, " << item_stats.peak << " peak, " << (item_stats.reserved_bytes / 1024) << " KB reserved\n";
+	os << "\t\tFloors: " << floor_stats.live << " live, " << floor_stats.slabs << " slabs, " << (floor_stats.reserved_bytes / 1024) << " KB reserved\n";
+	os << "\t\tTree nodes: " << node_stats.live << " live, " << node_stats.slabs << " slabs, " << (node_stats.reserved_bytes / 1024) << " KB reserved\n";
+	os << "\t\tShared items: " << Item::GetSharedCount() << " instances, " << shared_item_refs << " references on this map\n";
+	os << "\t\tItem stacks: " << ItemVector::inline_capacity << " items inline, " << (item_stack_saved / 1024) << " KB saved";
+	if (map->getTileCount() > 0) {
+		os << " (" << (item_stack_saved * 1000000ll / int64_t(map->getTileCount()) / 1024) << " KB per million tiles)";
+	}
+	os << "\n";
+
 	os << "\n";
 	os << "Generated by Remere's Map Editor version OTARMEIE " + __RME_VERSION__ + "\n";
 
@@ -2205,6 +2267,193 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event)) {
 	}
 }
 
+void MainMenuBar::OnChangeChunkIndex(wxCommandEvent& WXUNUSED(event)) {
+	const bool enabled = IsItemChecked(MenuBar::EXPERIMENTAL_CHUNK_INDEX);
+	g_settings.setInteger(Config::USE_CHUNK_INDEX, enabled);
+
+	for (int i = 0; i < g_gui.tabbook->GetTabCount(); ++i) {
+		auto* mapTab = dynamic_cast<MapTab*>(g_gui.tabbook->GetTab(i));
+		if (mapTab && mapTab->GetMap()) {
+			mapTab->GetMap()->setChunkIndexEnabled(enabled);
+		}
+	}
+}
+
+void MainMenuBar::OnChangeContiguousStorage(wxCommandEvent& WXUNUSED(event)) {
+	// Floors can't be moved into blocks, so this applies to maps created or opened from now on
+	g_settings.setInteger(Config::CONTIGUOUS_TILE_STORAGE, IsItemChecked(MenuBar::EXPERIMENTAL_CONTIGUOUS_STORAGE));
+}
+
+void MainMenuBar::OnChangeShareItems(wxCommandEvent& WXUNUSED(event)) {
+	const bool enabled = IsItemChecked(MenuBar::EXPERIMENTAL_SHARE_ITEMS);
+	// Swapping items touches every tile in place, wait for background saves to finish
+	for (int i = 0; i < g_gui.tabbook->GetTabCount(); ++i) {
+		auto* mapTab = dynamic_cast<MapTab*>(g_gui.tabbook->GetTab(i));
+		if (mapTab && mapTab->GetEditor() && mapTab->GetEditor()->isSaving()) {
+			CheckItem(MenuBar::EXPERIMENTAL_SHARE_ITEMS, !enabled);
+			g_gui.SetStatusText("Wait for the map to finish saving.");
+			return;
+		}
+	}
+	g_settings.setInteger(Config::SHARE_PLAIN_ITEMS, enabled);
+
+	uint64_t swapped = 0;
+	for (int i = 0; i < g_gui.tabbook->GetTabCount(); ++i) {
+		auto* mapTab = dynamic_cast<MapTab*>(g_gui.tabbook->GetTab(i));
+		if (mapTab && mapTab->GetMap()) {
+			Map* map = mapTab->GetMap();
+			swapped += enabled ? map->shareItems() : map->unshareItems();
+		}
+	}
+	g_gui.SetStatusText(wxString::Format("%s %llu items.", enabled ? "Shared" : "Unshared", (unsigned long long)swapped));
+}
+
+void MainMenuBar::OnChangeJournalSave(wxCommandEvent& WXUNUSED(event)) {
+	g_settings.setInteger(Config::JOURNAL_SAVE, IsItemChecked(MenuBar::EXPERIMENTAL_JOURNAL_SAVE));
+}
+
+void MainMenuBar::OnChangeBackgroundSave(wxCommandEvent& WXUNUSED(event)) {
+	g_settings.setInteger(Config::BACKGROUND_SAVE, IsItemChecked(MenuBar::EXPERIMENTAL_BACKGROUND_SAVE));
+}
+
+void MainMenuBar::OnChangeOtbzLz4(wxCommandEvent& WXUNUSED(event)) {
+	g_settings.setInteger(Config::OTBZ_USE_LZ4, IsItemChecked(MenuBar::EXPERIMENTAL_OTBZ_LZ4));
+}
+
+void MainMenuBar::OnChangeMetadataCache(wxCommandEvent& WXUNUSED(event)) {
+	g_settings.setInteger(Config::METADATA_CACHE, IsItemChecked(MenuBar::EXPERIMENTAL_METADATA_CACHE));
+}
+
+void MainMenuBar::OnVerifyParallelSave(wxCommandEvent& WXUNUSED(event)) {
+	if (!g_gui.IsEditorOpen()) {
+		return;
+	}
+
+	Map& map = g_gui.GetCurrentMap();
+	// Always run at least two workers, a single one takes the serial path as well
+	const int worker_count = std::max(g_settings.getInteger(Config::WORKER_THREADS), 2);
+	IOMapOTBM io(map.getVersion());
+
+	g_gui.CreateLoadBar("Encoding map serially and in parallel...");
+	std::string report;
+	io.verifyParallelSave(map, worker_count, report, [](int done) {
+		g_gui.SetLoadDone(done);
+	});
+	g_gui.DestroyLoadBar();
+
+	g_gui.ShowTextBox(frame, "Verify Parallel Save", wxstr(report));
+}
+
+void MainMenuBar::OnBenchmarkNodeEscaping(wxCommandEvent& WXUNUSED(event)) {
+	if (!g_gui.IsEditorOpen()) {
+		return;
+	}
+
+	Map& map = g_gui.GetCurrentMap();
+	IOMapOTBM io(map.getVersion());
+
+	// The payload is the map's own tile areas under a root node, as they are written to disk
+	g_gui.CreateLoadBar("Encoding map...");
+	MemoryNodeFileWriteHandle encoded;
+	encoded.addNode(0);
+	io.saveTileAreas(map, encoded, std::max(g_settings.getInteger(Config::WORKER_THREADS), 1), [](int done) {
+		g_gui.SetLoadDone(done);
+	});
+	encoded.endNode();
+	g_gui.DestroyLoadBar();
+
+	const uint8_t* payload = encoded.getMemory();
+	const size_t payload_size = encoded.getSize();
+	// Enough passes over small maps for the timings to mean something
+	const int passes = int(std::max<size_t>(1, (size_t(256) << 20) / std::max<size_t>(payload_size, 1)));
+
+	struct Result {
+		double ms;
+		uint64_t count;
+	};
+
+	auto scan = [&](NodeScanPath path) {
+		Result result = { 0.0, 0 };
+		wxStopWatch watch;
+		for (int pass = 0; pass < passes; ++pass) {
+			const uint8_t* end = payload + payload_size;
+			const uint8_t* ptr = findNodeSpecialByte(payload, end, path);
+			while (ptr != end) {
+				++result.count;
+				ptr = findNodeSpecialByte(ptr + 1, end, path);
+			}
+		}
+		result.ms = watch.TimeInMicro().ToDouble() / 1000.0;
+		return result;
+	};
+
+	static const std::pair<NodeScanPath, const char*> paths[] = {
+		{ NODE_SCAN_SCALAR, "Bytewise" },
+		{ NODE_SCAN_SSE2, "SSE2" },
+		{ NODE_SCAN_AVX2, "AVX2" },
+	};
+
+	g_gui.CreateLoadBar("Benchmarking node escaping...");
+	std::vector<std::pair<const char*, Result>> scans;
+	for (const auto& path : paths) {
+		if (isNodeScanSupported(path.first)) {
+			scans.emplace_back(path.second, scan(path.first));
+		}
+	}
+	g_gui.SetLoadDone(50);
+
+	// The writer escaping the payload as if it were plain node data
+	Result write = { 0.0, 0 };
+	{
+		wxStopWatch watch;
+		for (int pass = 0; pass < passes; ++pass) {
+			MemoryNodeFileWriteHandle output;
+			output.addRAW(payload, payload_size);
+			write.count += output.getSize();
+		}
+		write.ms = watch.TimeInMicro().ToDouble() / 1000.0;
+	}
+	g_gui.SetLoadDone(75);
+
+	// The reader walking every node, which unescapes all of them
+	Result read = { 0.0, 0 };
+	{
+		wxStopWatch watch;
+		for (int pass = 0; pass < passes; ++pass) {
+			MemoryNodeFileReadHandle input(payload, payload_size);
+			BinaryNode* root = input.getRootNode();
+			for (BinaryNode* area = root->getChild(); area; area = area->advance()) {
+				++read.count;
+			}
+		}
+		read.ms = watch.TimeInMicro().ToDouble() / 1000.0;
+	}
+	g_gui.DestroyLoadBar();
+
+	const double megabytes = double(payload_size) * passes / (1024.0 * 1024.0);
+	auto throughput = [megabytes](double ms) {
+		return ms > 0.0 ? megabytes / ms * 1000.0 : 0.0;
+	};
+
+	std::ostringstream os;
+	os.setf(std::ios::fixed, std::ios::floatfield);
+	os.precision(2);
+	os << "Node escaping benchmark for \"" << map.getName() << "\"\n";
+	os << "\tPayload: " << payload_size << " bytes, " << passes << " passes\n";
+	const Result& scalar = scans.front().second;
+	os << "\tFinding special bytes (" << (scalar.count / passes) << " per pass):\n";
+	for (const auto& entry : scans) {
+		os << "\t\t" << entry.first << ": " << entry.second.ms << " ms (" << throughput(entry.second.ms) << " MB/s)\n";
+		if (entry.second.count != scalar.count) {
+			os << "\t\tWarning: found " << entry.second.count << " bytes, bytewise found " << scalar.count << "\n";
+		}
+	}
+	os << "\tWriting escaped: " << write.ms << " ms (" << throughput(write.ms) << " MB/s)\n";
+	os << "\tReading " << (read.count / passes) << " areas: " << read.ms << " ms (" << throughput(read.ms) << " MB/s)\n";
+
+	g_gui.ShowTextBox(frame, "Node Escaping Benchmark", wxstr(os.str()));
+}
+
 void MainMenuBar::OnMapCleanup(wxCommandEvent& WXUNUSED(event)) {
     if (!g_gui.IsEditorOpen()) {
         return;
@@ -2307,6 +2556,7 @@ void MainMenuBar::OnMapCleanup(wxCommandEvent& WXUNUSED(event)) {
 
         int64_t totalCount = 0;
         Map& currentMap = g_gui.GetCurrentMap();
+        currentMap.waitForSnapshot();
 
         g_gui.CreateLoadBar("Cleaning map...");
 
@@ -2353,6 +2603,7 @@ void MainMenuBar::OnMapCleanup(wxCommandEvent& WXUNUSED(event)) {
                             delete tile->creature;
                             tile->creature = nullptr;
                             tile->modify(); // Mark as modified for saving
+                            map.touchTile(tile->getPosition());
                             removedCount++;
                             return true;
                         }
@@ -2420,6 +2671,7 @@ void MainMenuBar::OnMapCleanup(wxCommandEvent& WXUNUSED(event)) {
                                 tile->deselect(); // Make sure tile is not selected
                                 tile->update();  // Update tile to refresh display state
                                 tile->modify(); // Mark as modified for saving
+                                map.touchTile(pos);
                                 removedCount++;
                                 return true;
                             }
@@ -2745,6 +2997,10 @@ void MainMenuBar::OnMinimapWindow(wxCommandEvent& event) {
 	g_gui.CreateMinimap();
 }
 
+void MainMenuBar::OnMemoryWindow(wxCommandEvent& WXUNUSED(event)) {
+	g_gui.ShowMemoryWindow();
+}
+
 void MainMenuBar::OnNewPalette(wxCommandEvent& event) {
 	g_gui.NewPalette();
 }
@@ -3504,6 +3760,7 @@ void MainMenuBar::OnRefreshItems(wxCommandEvent& WXUNUSED(event)) {
     if (dialog.ShowModal() == wxID_OK) {
         Editor* editor = g_gui.GetCurrentEditor();
         if (!editor) return;
+        editor->map.waitForSnapshot();
 
         g_gui.CreateLoadBar("Refreshing items...");
         
@@ -3524,6 +3781,9 @@ void MainMenuBar::OnRefreshItems(wxCommandEvent& WXUNUSED(event)) {
             size_t containerIndex; // Store index in container
         };
         std::vector<ItemData> itemsToRecreate;
+        // Results come in stack order, a shared item can fill several slots of one stack
+        Tile* lastTile = nullptr;
+        size_t nextStackpos = 0;
 
         for(const auto& pair : items) {
             Tile* tile = pair.first;
@@ -3559,9 +3819,14 @@ void MainMenuBar::OnRefreshItems(wxCommandEvent& WXUNUSED(event)) {
             
             // If not in container, find position in tile
             if(!found) {
-                for(size_t idx = 0; idx < tile->items.size(); ++idx) {
+                if(tile != lastTile) {
+                    lastTile = tile;
+                    nextStackpos = 0;
+                }
+                for(size_t idx = nextStackpos; idx < tile->items.size(); ++idx) {
                     if(tile->items[idx] == item) {
                         data.stackpos = idx;
+                        nextStackpos = idx + 1;
                         break;
                     }
                 }
@@ -3593,7 +3858,7 @@ void MainMenuBar::OnRefreshItems(wxCommandEvent& WXUNUSED(event)) {
             }
             
             if(oldItem) {
-                delete oldItem;
+                Item::Release(oldItem);
             }
 
             Item* newItem = Item::Create(data.id);
@@ -131,6 +131,7 @@ namespace MenuBar {
 		REFRESH_ITEMS,
 
 		WIN_MINIMAP,
+		WIN_MEMORY_USAGE,
 		NEW_PALETTE,
 		TAKE_SCREENSHOT,
 		LIVE_START,
@@ -168,6 +169,15 @@ namespace MenuBar {
 		ID_MENU_SERVER_CONNECT,
 
 		EXPERIMENTAL_FOG,
+		EXPERIMENTAL_CHUNK_INDEX,
+		EXPERIMENTAL_CONTIGUOUS_STORAGE,
+		EXPERIMENTAL_SHARE_ITEMS,
+		EXPERIMENTAL_JOURNAL_SAVE,
+		EXPERIMENTAL_BACKGROUND_SAVE,
+		EXPERIMENTAL_OTBZ_LZ4,
+		VERIFY_PARALLEL_SAVE,
+		BENCHMARK_NODE_ESCAPING,
+		EXPERIMENTAL_METADATA_CACHE,
 		MAP_REMOVE_DUPLICATES,
 		SHOW_HOTKEYS,
 		MAP_MENU_REPLACE_ITEMS,
@@ -298,6 +308,7 @@ public:
 
 	// Window Menu
 	void OnMinimapWindow(wxCommandEvent& event);
+	void OnMemoryWindow(wxCommandEvent& event);
 	void OnNewPalette(wxCommandEvent& event);
 	void OnTakeScreenshot(wxCommandEvent& event);
 	void OnSelectTerrainPalette(wxCommandEvent& event);
@@ -325,6 +336,17 @@ public:
 	void OnCreateBorder(wxCommandEvent& event);
 	void OnMapSummarize(wxCommandEvent& event);
 
+	// Experimental menu
+	void OnChangeChunkIndex(wxCommandEvent& event);
+	void OnChangeContiguousStorage(wxCommandEvent& event);
+	void OnChangeShareItems(wxCommandEvent& event);
+	void OnChangeJournalSave(wxCommandEvent& event);
+	void OnChangeBackgroundSave(wxCommandEvent& event);
+	void OnChangeOtbzLz4(wxCommandEvent& event);
+	void OnVerifyParallelSave(wxCommandEvent& event);
+	void OnBenchmarkNodeEscaping(wxCommandEvent& event);
+	void OnChangeMetadataCache(wxCommandEvent& event);
+
 protected:
 	// Load and returns a menu item, also sets accelerator
 	wxObject* LoadItem(pugi::xml_node node, wxMenu* parent, wxArrayString& warnings, wxString& error);
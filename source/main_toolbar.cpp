@@ -200,9 +200,10 @@ void MainToolBar::UpdateButtons() {
 
 	bool has_map = editor != nullptr;
 	bool is_host = has_map && !editor->IsLiveClient();
+	bool is_saving = has_map && editor->isSaving();
 
-	standard_toolbar->EnableTool(wxID_SAVE, is_host);
-	standard_toolbar->EnableTool(wxID_SAVEAS, is_host);
+	standard_toolbar->EnableTool(wxID_SAVE, is_host && !is_saving);
+	standard_toolbar->EnableTool(wxID_SAVEAS, is_host && !is_saving);
 	standard_toolbar->EnableTool(wxID_CUT, has_map);
 	standard_toolbar->EnableTool(wxID_COPY, has_map);
 
@@ -31,11 +31,15 @@ Map::Map() :
 	houses(*this),
 	has_changed(false),
 	unnamed(false),
+	journal_generation(0),
 	waypoints(*this) {
 	// Earliest version possible
 	// Caller is responsible for converting us to proper version
 	mapVersion.otbm = MAP_OTBM_1;
 	mapVersion.client = CLIENT_VERSION_NONE;
+
+	setChunkIndexEnabled(g_settings.getBoolean(Config::USE_CHUNK_INDEX));
+	setContiguousStorage(g_settings.getBoolean(Config::CONTIGUOUS_TILE_STORAGE));
 }
 
 Map::~Map() {
@@ -64,6 +68,10 @@ bool Map::open(const std::string file) {
 
 	has_changed = false;
 
+	if (g_settings.getBoolean(Config::SHARE_PLAIN_ITEMS)) {
+		shareItems();
+	}
+
 	wxFileName fn = wxstr(file);
 	filename = fn.GetFullPath().mb_str(wxConvUTF8);
 	name = fn.GetFullName().mb_str(wxConvUTF8);
@@ -120,6 +128,7 @@ bool Map::convert(MapVersion to, bool showdialog) {
 		// Only OTBM version differs
 		// No changes necessary
 		mapVersion = to;
+		journal_generation = 0;
 		return true;
 	}
 
@@ -138,11 +147,14 @@ bool Map::convert(MapVersion to, bool showdialog) {
 		convert(getReplacementMapFrom854To854(), showdialog);
 	*/
 	mapVersion = to;
+	journal_generation = 0;
 
 	return true;
 }
 
 bool Map::convert(const ConversionMap& rm, bool showdialog) {
+	waitForSnapshot();
+	journal_generation = 0;
 	if (showdialog) {
 		g_gui.CreateLoadBar("Converting map ...");
 	}
@@ -187,17 +199,19 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 		// Keep track of how many items have been inserted at the bottom
 		size_t inserted_items = 0;
 
+		bool converted = false;
 		if (cfmtm != rm.mtm.end()) {
+			converted = true;
 			const std::vector<uint16_t>& v = cfmtm->first;
 
 			if (tile->ground && std::find(v.begin(), v.end(), tile->ground->getID()) != v.end()) {
-				delete tile->ground;
+				Item::Release(tile->ground);
 				tile->ground = nullptr;
 			}
 
 			for (ItemVector::iterator item_iter = tile->items.begin(); item_iter != tile->items.end();) {
 				if (std::find(v.begin(), v.end(), (*item_iter)->getID()) != v.end()) {
-					delete *item_iter;
+					Item::Release(*item_iter);
 					item_iter = tile->items.erase(item_iter);
 				} else {
 					++item_iter;
@@ -219,9 +233,10 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 		if (tile->ground) {
 			ConversionMap::STM::const_iterator cfstm = rm.stm.find(tile->ground->getID());
 			if (cfstm != rm.stm.end()) {
+				converted = true;
 				uint16_t aid = tile->ground->getActionID();
 				uint16_t uid = tile->ground->getUniqueID();
-				delete tile->ground;
+				Item::Release(tile->ground);
 				tile->ground = nullptr;
 
 				const std::vector<uint16_t>& v = cfstm->second;
@@ -246,9 +261,10 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 			uint16_t id = (*replace_item_iter)->getID();
 			ConversionMap::STM::const_iterator cf = rm.stm.find(id);
 			if (cf != rm.stm.end()) {
+				converted = true;
 				// uint16_t aid = (*replace_item_iter)->getActionID();
 				// uint16_t uid = (*replace_item_iter)->getUniqueID();
-				delete *replace_item_iter;
+				Item::Release(*replace_item_iter);
 
 				replace_item_iter = tile->items.erase(replace_item_iter);
 				const std::vector<uint16_t>& v = cf->second;
@@ -262,6 +278,10 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 			}
 		}
 
+		if (converted) {
+			touchTile(tile->getPosition());
+		}
+
 		++tiles_done;
 		if (showdialog && tiles_done % 0x10000 == 0) {
 			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
@@ -276,6 +296,8 @@ bool Map::convert(const ConversionMap& rm, bool showdialog) {
 }
 
 void Map::cleanInvalidTiles(bool showdialog) {
+	waitForSnapshot();
+	journal_generation = 0;
 	uint64_t tiles_done = 0;
 	uint64_t removed_count = 0;
 	bool has_invalid_tiles = false;
@@ -321,9 +343,10 @@ void Map::cleanInvalidTiles(bool showdialog) {
 			if (g_items.typeExists((*item_iter)->getID())) {
 				++item_iter;
 			} else {
-				delete *item_iter;
+				Item::Release(*item_iter);
 				item_iter = tile->items.erase(item_iter);
 				++removed_count;
+				touchTile(tile->getPosition());
 			}
 		}
 
@@ -341,6 +364,7 @@ void Map::cleanInvalidTiles(bool showdialog) {
 }
 
 void Map::convertHouseTiles(uint32_t fromId, uint32_t toId) {
+	waitForSnapshot();
 	g_gui.CreateLoadBar("Converting house tiles...");
 	uint64_t tiles_done = 0;
 
@@ -354,12 +378,17 @@ void Map::convertHouseTiles(uint32_t fromId, uint32_t toId) {
 		}
 
 		tile->setHouseID(toId);
+		touchTile(tile->getPosition());
 		++tiles_done;
 		if (tiles_done % 0x10000 == 0) {
 			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
 		}
 	}
 
+	if (tiles_done > 0) {
+		doTrackedChange();
+	}
+
 	g_gui.DestroyLoadBar();
 }
 
@@ -372,6 +401,11 @@ bool Map::hasChanged() const {
 }
 
 bool Map::doChange() {
+	journal_generation = 0;
+	return doTrackedChange();
+}
+
+bool Map::doTrackedChange() {
 	bool doupdate = !has_changed;
 	has_changed = true;
 	return doupdate;
@@ -563,13 +597,16 @@ bool Map::exportMinimap(FileName filename, int floor, bool displaydialog) {
 		};
 
 		// First pass - collect all initial areas using the existing flood fill
+		if (occupancy.getFloorTileCount(floor) == 0) {
+			return true;
+		}
+
 		std::vector<Position> tiles_on_floor;
-		for (MapIterator mit = begin(); mit != end(); ++mit) {
-			if ((*mit)->get() == nullptr || (*mit)->empty() || (*mit)->getZ() != floor) {
-				continue;
+		forEachTile([&tiles_on_floor](Tile* tile) {
+			if (!tile->empty()) {
+				tiles_on_floor.push_back(tile->getPosition());
 			}
-			tiles_on_floor.push_back((*mit)->getPosition());
-		}
+		}, floor, floor);
 
 		// Sort tiles for efficient processing
 		std::sort(tiles_on_floor.begin(), tiles_on_floor.end(),
@@ -706,29 +743,40 @@ bool Map::exportMinimap(FileName filename, int floor, bool displaydialog) {
 			pic = newd uint8_t[minimap_width * minimap_height];
 			memset(pic, 0, minimap_width * minimap_height);
 
-			// Fill the bitmap
-			for (int y = min_pos.y; y <= max_pos.y; y++) {
-				for (int x = min_pos.x; x <= max_pos.x; x++) {
-					Tile* tile = getTile(x, y, floor);
-					if (!tile || tile->empty()) {
+			// Fill the bitmap, a chunk at a time so empty chunks are skipped whole
+			const int chunk_mask = MapOccupancy::CHUNK_SIZE - 1;
+			for (int chunk_y = min_pos.y; chunk_y <= max_pos.y; chunk_y = (chunk_y | chunk_mask) + 1) {
+				const int last_y = std::min(chunk_y | chunk_mask, max_pos.y);
+				for (int chunk_x = min_pos.x; chunk_x <= max_pos.x; chunk_x = (chunk_x | chunk_mask) + 1) {
+					const int last_x = std::min(chunk_x | chunk_mask, max_pos.x);
+					if (occupancy.isAreaEmpty(chunk_x, chunk_y, last_x, last_y, floor)) {
 						continue;
 					}
 
-					uint32_t pixelpos = (y - min_pos.y) * minimap_width + (x - min_pos.x);
-					uint8_t& pixel = pic[pixelpos];
+					for (int y = chunk_y; y <= last_y; y++) {
+						for (int x = chunk_x; x <= last_x; x++) {
+							Tile* tile = getTile(x, y, floor);
+							if (!tile || tile->empty()) {
+								continue;
+							}
 
-					// Get color from items
-					for (ItemVector::const_reverse_iterator item_iter = tile->items.rbegin(); 
-						 item_iter != tile->items.rend(); ++item_iter) {
-						if ((*item_iter)->getMiniMapColor()) {
-							pixel = (*item_iter)->getMiniMapColor();
-							break;
-						}
-					}
+							uint32_t pixelpos = (y - min_pos.y) * minimap_width + (x - min_pos.x);
+							uint8_t& pixel = pic[pixelpos];
+
+							// Get color from items
+							for (ItemVector::const_reverse_iterator item_iter = tile->items.rbegin();
+								 item_iter != tile->items.rend(); ++item_iter) {
+								if ((*item_iter)->getMiniMapColor()) {
+									pixel = (*item_iter)->getMiniMapColor();
+									break;
+								}
+							}
 
-					// If no item color, check ground
-					if (pixel == 0 && tile->hasGround()) {
-						pixel = tile->ground->getMiniMapColor();
+							// If no item color, check ground
+							if (pixel == 0 && tile->hasGround()) {
+								pixel = tile->ground->getMiniMapColor();
+							}
+						}
 					}
 				}
 			}
@@ -820,6 +868,7 @@ bool Map::exportMinimap(FileName filename, int floor, bool displaydialog) {
 }
 
 uint32_t Map::cleanDuplicateItems(const std::vector<std::pair<uint16_t, uint16_t>>& ranges, const PropertyFlags& flags) {
+	waitForSnapshot();
 	uint32_t duplicates_removed = 0;
 	uint32_t tiles_affected = 0;
 
@@ -863,26 +912,10 @@ uint32_t Map::cleanDuplicateItems(const std::vector<std::pair<uint16_t, uint16_t
 		if (!tile) continue;
 
 		bool tile_modified = false;
-		std::set<Item*> kept_items; // Track first instances
+		// Decided slot by slot in one pass, a shared item puts the same
+		// address in several slots so it can't tell kept and duplicate apart
+		std::vector<Item*> kept_items; // First instances
 
-		// First pass: identify items to keep
-		for (Item* item : tile->items) {
-			if (!isInRanges(item->getID())) continue;
-
-			bool is_duplicate = false;
-			for (Item* kept : kept_items) {
-				if (compareItems(item, kept)) {
-					is_duplicate = true;
-					break;
-				}
-			}
-
-			if (!is_duplicate) {
-				kept_items.insert(item);
-			}
-		}
-
-		// Second pass: remove duplicates
 		auto iit = tile->items.begin();
 		while (iit != tile->items.end()) {
 			Item* item = *iit;
@@ -891,28 +924,33 @@ uint32_t Map::cleanDuplicateItems(const std::vector<std::pair<uint16_t, uint16_t
 				continue;
 			}
 
-			bool should_remove = true;
+			bool is_duplicate = false;
 			for (Item* kept : kept_items) {
-				if (item == kept) {
-					should_remove = false;
+				if (compareItems(item, kept)) {
+					is_duplicate = true;
 					break;
 				}
 			}
 
-			if (should_remove) {
-				delete item;
+			if (is_duplicate) {
+				Item::Release(item);
 				iit = tile->items.erase(iit);
 				duplicates_removed++;
 				tile_modified = true;
 			} else {
+				kept_items.push_back(item);
 				++iit;
 			}
 		}
 
 		if (tile_modified) {
+			touchTile(tile->getPosition());
 			tiles_affected++;
 		}
 	}
 
+	if (duplicates_removed > 0) {
+		doTrackedChange();
+	}
 	return duplicates_removed;
 }
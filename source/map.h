@@ -97,7 +97,11 @@ public:
 	// Returns true if any change has been done since last save
 	bool hasChanged() const;
 	// Makes a change, doesn't matter what. Just so that it asks when saving (Also adds a * to the window title)
+	// The change can't be traced to any area, so the next save rewrites the whole map
 	bool doChange();
+	// Same as doChange, for changes made through setTile, swapTile or touchTile
+	// Those are stamped in the generation table and can be saved to the journal
+	bool doTrackedChange();
 	// Clears any changes
 	bool clearChanges();
 
@@ -210,6 +214,8 @@ public:
 protected:
 	bool has_changed; // If the map has changed
 	bool unnamed; // If the map has yet to receive a name
+	// Generation the map file and its journal were in sync with, 0 if the next save has to be a full one
+	uint64_t journal_generation;
 
 	friend class IOMapOTBM;
 	friend class IOMapOTMM;
@@ -221,16 +227,13 @@ public:
 
 template <typename ForeachType>
 inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles) {
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
 	long long done = 0;
+	std::queue<Container*> containers;
 
-	while (tileiter != end) {
+	map.forEachTile([&](Tile* tile) {
 		++done;
-		Tile* tile = (*tileiter)->get();
 		if (selectedTiles && !tile->isSelected()) {
-			++tileiter;
-			continue;
+			return;
 		}
 
 		if (tile->ground) {
@@ -238,7 +241,6 @@ inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles
 				;
 		}
 
-		std::queue<Container*> containers;
 		for (ItemVector::iterator itemiter = tile->items.begin(); itemiter != tile->items.end(); ++itemiter) {
 			Item* item = *itemiter;
 			Container* container = dynamic_cast<Container*>(item);
@@ -263,39 +265,31 @@ inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles
 				} while (containers.size());
 			}
 		}
-		++tileiter;
-	}
+	});
 }
 
 template <typename ForeachType>
 inline void foreach_TileOnMap(Map& map, ForeachType& foreach) {
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
 	long long done = 0;
-
-	while (tileiter != end) {
-		foreach (map, (*tileiter++)->get(), ++done)
+	map.forEachTile([&](Tile* tile) {
+		foreach (map, tile, ++done)
 			;
-	}
+	});
 }
 
 template <typename RemoveIfType>
 inline long long remove_if_TileOnMap(Map& map, RemoveIfType& remove_if) {
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
 	long long done = 0;
 	long long removed = 0;
 	long long total = map.getTileCount();
 
-	while (tileiter != end) {
-		Tile* tile = (*tileiter)->get();
+	map.forEachTile([&](Tile* tile) {
 		if (remove_if(map, tile, removed, done, total)) {
 			map.setTile(tile->getPosition(), nullptr, true);
 			++removed;
 		}
-		++tileiter;
 		++done;
-	}
+	});
 
 	return removed;
 }
@@ -305,20 +299,17 @@ inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedO
 	int64_t done = 0;
 	int64_t removed = 0;
 
-	MapIterator it = map.begin();
-	MapIterator end = map.end();
-
-	while (it != end) {
+	map.waitForSnapshot();
+	map.forEachTile([&](Tile* tile) {
 		++done;
-		Tile* tile = (*it)->get();
 		if (selectedOnly && !tile->isSelected()) {
-			++it;
-			continue;
+			return;
 		}
 
+		const int64_t removed_before = removed;
 		if (tile->ground) {
 			if (condition(map, tile->ground, removed, done)) {
-				delete tile->ground;
+				Item::Release(tile->ground);
 				tile->ground = nullptr;
 				++removed;
 			}
@@ -328,14 +319,17 @@ inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedO
 			Item* item = *iit;
 			if (condition(map, item, removed, done)) {
 				iit = tile->items.erase(iit);
-				delete item;
+				Item::Release(item);
 				++removed;
 			} else {
 				++iit;
 			}
 		}
-		++it;
-	}
+
+		if (removed != removed_before) {
+			map.touchTile(tile->getPosition());
+		}
+	});
 	return removed;
 }
 
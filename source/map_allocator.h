@@ -20,15 +20,30 @@
 
 #include "tile.h"
 #include "map_region.h"
+#include "memory_pool.h"
+#include "map_floor_store.h"
+
+#include <memory>
 
 class BaseMap;
 
+// Hands out the tree structure (nodes and floors) of a single map from per-map slabs,
+// these are owned by the map and go away in bulk when it is cleared or destroyed.
+// Tiles move freely between maps (undo history, copy buffer), so they come from one shared
+// pool instead, see Tile::operator new.
+// Floors either come one at a time from the floor pool, or from the per-chunk blocks of a
+// MapFloorStore when contiguous storage is enabled.
 class MapAllocator {
 
 public:
-	MapAllocator() { }
+	MapAllocator() :
+		floor_pool(sizeof(Floor), 256),
+		node_pool(sizeof(QTreeNode), 256) { }
 	~MapAllocator() { }
 
+	MapAllocator(const MapAllocator&) = delete;
+	MapAllocator& operator=(const MapAllocator&) = delete;
+
 	// shorthands for tiles
 	Tile* operator()(TileLocation* location) {
 		return allocateTile(location);
@@ -48,19 +63,89 @@ public:
 
 	//
 	Floor* allocateFloor(int x, int y, int z) {
-		return newd Floor(x, y, z);
+		if (floor_store) {
+			return floor_store->allocate(x, y, z);
+		}
+		return new (floor_pool.allocate()) Floor(x, y, z);
 	}
 	void freeFloor(Floor* f) {
-		delete f;
+		if (!f) {
+			return;
+		}
+		if (floor_store) {
+			floor_store->release(f);
+		} else {
+			f->~Floor();
+			floor_pool.release(f);
+		}
+	}
+
+	// Floors can't move once handed out, so this fails while any floor is allocated
+	bool setFloorStoreEnabled(bool enabled) {
+		if (enabled == (floor_store != nullptr)) {
+			return true;
+		}
+		if (getFloorStats().live != 0) {
+			return false;
+		}
+		if (enabled) {
+			floor_store = std::make_unique<MapFloorStore>();
+		} else {
+			floor_store.reset();
+		}
+		return true;
+	}
+	const MapFloorStore* getFloorStore() const {
+		return floor_store.get();
 	}
 
 	//
 	QTreeNode* allocateNode(BaseMap& map) {
-		return newd QTreeNode(map);
+		return new (node_pool.allocate()) QTreeNode(map);
 	}
 	void freeNode(QTreeNode* qt) {
-		delete qt;
+		if (qt) {
+			qt->~QTreeNode();
+			node_pool.release(qt);
+		}
+	}
+
+	// Gives all slabs back to the system, only succeeds once every node and floor has been freed
+	bool purge() {
+		bool floors = floor_store ? floor_store->purge() : floor_pool.purge();
+		bool nodes = node_pool.purge();
+		return floors && nodes;
 	}
+
+	// Gives all slabs back at once, nodes and floors still in the tree included, without
+	// running their destructors. The tiles in the tree have to be freed first.
+	void discard() {
+		if (floor_store) {
+			floor_store->discard();
+		}
+		floor_pool.discard();
+		node_pool.discard();
+	}
+
+	// Counters for the statistics view
+	static MemoryPoolStats getTileStats() {
+		return Tile::getPoolStats();
+	}
+	// With contiguous storage these are the stats of the blocks
+	MemoryPoolStats getFloorStats() const {
+		if (floor_store) {
+			return floor_store->getStats();
+		}
+		return floor_pool.getStats();
+	}
+	MemoryPoolStats getNodeStats() const {
+		return node_pool.getStats();
+	}
+
+private:
+	MemoryPool floor_pool;
+	MemoryPool node_pool;
+	std::unique_ptr<MapFloorStore> floor_store; // Optional, see setFloorStoreEnabled
 };
 
 #endif
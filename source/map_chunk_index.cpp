@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_chunk_index.h"
+#include "map_region.h"
+
+MapChunkIndex::MapChunkIndex() :
+	region_count(0),
+	chunk_count(0) {
+	for (int i = 0; i < REGIONS * REGIONS; ++i) {
+		regions[i] = nullptr;
+	}
+}
+
+MapChunkIndex::~MapChunkIndex() {
+	clear();
+}
+
+void MapChunkIndex::setLeaf(int x, int y, QTreeNode* leaf) {
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	Region*& region = regions[(ux >> REGION_BITS) * REGIONS + (uy >> REGION_BITS)];
+	if (!region) {
+		region = newd Region();
+		++region_count;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	Chunk*& chunk = region->chunks[((ux >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((uy >> CHUNK_BITS) & chunk_mask)];
+	if (!chunk) {
+		chunk = newd Chunk();
+		++chunk_count;
+	}
+
+	const uint32_t leaf_mask = LEAVES_PER_CHUNK - 1;
+	chunk->leaves[((ux >> LEAF_BITS) & leaf_mask) * LEAVES_PER_CHUNK + ((uy >> LEAF_BITS) & leaf_mask)] = leaf;
+}
+
+void MapChunkIndex::insertTree(QTreeNode* node, uint32_t x, uint32_t y, int shift) {
+	for (int i = 0; i < MAP_LAYERS; ++i) {
+		QTreeNode* child = node->child[i];
+		if (!child) {
+			continue;
+		}
+
+		// Same child layout as QTreeNode::getLeaf, low two bits select x and high two bits y
+		const uint32_t cx = x | ((i & 3) << shift);
+		const uint32_t cy = y | ((i >> 2) << shift);
+		if (child->isLeaf) {
+			setLeaf(cx, cy, child);
+		} else {
+			insertTree(child, cx, cy, shift - 2);
+		}
+	}
+}
+
+void MapChunkIndex::clear() {
+	for (int i = 0; i < REGIONS * REGIONS; ++i) {
+		Region* region = regions[i];
+		if (!region) {
+			continue;
+		}
+		for (Chunk* chunk : region->chunks) {
+			delete chunk;
+		}
+		delete region;
+		regions[i] = nullptr;
+	}
+	region_count = 0;
+	chunk_count = 0;
+}
+
+size_t MapChunkIndex::memsize() const {
+	return sizeof(*this) + region_count * sizeof(Region) + chunk_count * sizeof(Chunk);
+}
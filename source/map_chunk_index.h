@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_CHUNK_INDEX_H_
+#define RME_MAP_CHUNK_INDEX_H_
+
+#include <cstdint>
+#include <cstddef>
+
+class QTreeNode;
+
+// Flat lookup table for the leaves of the HexTree
+// The map plane is split into regions of 1024x1024 tiles, every region into 32x32 chunks of 32x32 tiles,
+// and a chunk points at the 8x8 leaves (4x4 tiles each, all floors) covering it.
+// Finding the leaf of a position is three array lookups instead of a descent through seven tree levels.
+// The tree still owns the nodes, this only mirrors where they are.
+class MapChunkIndex {
+public:
+	static const int LEAF_BITS = 2;
+	static const int CHUNK_BITS = 5;
+	static const int REGION_BITS = 10;
+
+	static const int CHUNK_SIZE = 1 << CHUNK_BITS; // Tiles per chunk side
+	static const int LEAVES_PER_CHUNK = 1 << (CHUNK_BITS - LEAF_BITS); // Leaves per chunk side
+	static const int CHUNKS_PER_REGION = 1 << (REGION_BITS - CHUNK_BITS); // Chunks per region side
+	static const int REGIONS = 1 << (16 - REGION_BITS); // Regions per map side
+
+	MapChunkIndex();
+	~MapChunkIndex();
+
+	MapChunkIndex(const MapChunkIndex&) = delete;
+	MapChunkIndex& operator=(const MapChunkIndex&) = delete;
+
+	// Coordinates wrap at 16 bits, the same way the tree treats them
+	QTreeNode* getLeaf(int x, int y) const;
+	void setLeaf(int x, int y, QTreeNode* leaf);
+
+	// Mirrors every leaf below the node, (x, y) is the origin of the node and shift the bit its children are selected by
+	void insertTree(QTreeNode* node, uint32_t x, uint32_t y, int shift);
+
+	void clear();
+
+	size_t getChunkCount() const {
+		return chunk_count;
+	}
+	size_t memsize() const;
+
+protected:
+	struct Chunk {
+		QTreeNode* leaves[LEAVES_PER_CHUNK * LEAVES_PER_CHUNK];
+	};
+	struct Region {
+		Chunk* chunks[CHUNKS_PER_REGION * CHUNKS_PER_REGION];
+	};
+
+	Region* regions[REGIONS * REGIONS];
+	size_t region_count;
+	size_t chunk_count;
+};
+
+inline QTreeNode* MapChunkIndex::getLeaf(int x, int y) const {
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	const Region* region = regions[(ux >> REGION_BITS) * REGIONS + (uy >> REGION_BITS)];
+	if (!region) {
+		return nullptr;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	const Chunk* chunk = region->chunks[((ux >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((uy >> CHUNK_BITS) & chunk_mask)];
+	if (!chunk) {
+		return nullptr;
+	}
+
+	const uint32_t leaf_mask = LEAVES_PER_CHUNK - 1;
+	return chunk->leaves[((ux >> LEAF_BITS) & leaf_mask) * LEAVES_PER_CHUNK + ((uy >> LEAF_BITS) & leaf_mask)];
+}
+
+#endif
@@ -268,9 +268,6 @@ void MapCanvas::OnPaint(wxPaintEvent& event) {
 		drawer->Release();
 	}
 
-	// Clean unused textures
-	g_gui.gfx.garbageCollection();
-
 	// Swap buffer
 	SwapBuffers();
 
@@ -155,7 +155,9 @@ bool DrawingOptions::isDrawLight() const noexcept {
 }
 
 MapDrawer::MapDrawer(MapCanvas* canvas) :
-	canvas(canvas), editor(canvas->editor) {
+	canvas(canvas), editor(canvas->editor),
+	last_start_x(0), last_start_y(0),
+	prefetch_x(0), prefetch_y(0), prefetch_floor(-1) {
 	light_drawer = std::make_shared<LightDrawer>();
 }
 
@@ -236,6 +238,10 @@ void MapDrawer::Release() {
 }
 
 void MapDrawer::Draw() {
+	g_gui.gfx.nextFrame();
+	g_gui.gfx.uploadPrefetchedSprites();
+	PrefetchSprites();
+
 	DrawBackground();
 	DrawMap();
 	if (options.isDrawLight()) {
@@ -257,6 +263,7 @@ void MapDrawer::Draw() {
 	if (options.show_tooltips) {
 		DrawTooltips();
 	}
+	sprite_batch.flush();
 }
 
 void MapDrawer::DrawBackground() {
@@ -314,6 +321,7 @@ void MapDrawer::DrawMap() {
 	for (int map_z = start_z; map_z >= superend_z; map_z--) {
 		if (map_z == end_z && start_z != end_z && options.show_shade) {
 			// Draw shade
+			sprite_batch.flush();
 			if (!only_colors) {
 				glDisable(GL_TEXTURE_2D);
 			}
@@ -337,9 +345,46 @@ void MapDrawer::DrawMap() {
 			int nd_end_x = (end_x & ~3) + 4;
 			int nd_end_y = (end_y & ~3) + 4;
 
+			// Which 32x32 chunks of this floor are empty, looked up once per chunk. The live client still
+			// has to request empty nodes. Leaves are walked column by column as before, the drawing
+			// order depends on it, but the rest of an empty chunk is jumped over.
+			const int chunk_mask = ~(MapOccupancy::CHUNK_SIZE - 1);
+			const int chunk_start_x = nd_start_x & chunk_mask;
+			const int chunk_start_y = nd_start_y & chunk_mask;
+			const int chunk_columns = ((nd_end_x - chunk_start_x) >> MapOccupancy::CHUNK_BITS) + 1;
+			const int chunk_rows = ((nd_end_y - chunk_start_y) >> MapOccupancy::CHUNK_BITS) + 1;
+			std::vector<uint8_t> empty_chunks(chunk_columns * chunk_rows, 0);
+			std::vector<uint8_t> empty_columns(chunk_columns, 0);
+			if (!live_client) {
+				for (int column = 0; column < chunk_columns; ++column) {
+					const int chunk_x = chunk_start_x + (column << MapOccupancy::CHUNK_BITS);
+					bool column_empty = true;
+					for (int row = 0; row < chunk_rows; ++row) {
+						const int chunk_y = chunk_start_y + (row << MapOccupancy::CHUNK_BITS);
+						const bool empty = editor.map.isAreaEmpty(chunk_x, chunk_y, chunk_x + MapOccupancy::CHUNK_SIZE - 1, chunk_y + MapOccupancy::CHUNK_SIZE - 1, map_z);
+						empty_chunks[column * chunk_rows + row] = empty;
+						column_empty = column_empty && empty;
+					}
+					empty_columns[column] = column_empty;
+				}
+			}
+
 			zoneTiles.clear();
 			for (int nd_map_x = nd_start_x; nd_map_x <= nd_end_x; nd_map_x += 4) {
+				const int column = (nd_map_x - chunk_start_x) >> MapOccupancy::CHUNK_BITS;
+				if (empty_columns[column]) {
+					// On to the first leaf column of the next chunk
+					nd_map_x = (nd_map_x & chunk_mask) + MapOccupancy::CHUNK_SIZE - 4;
+					continue;
+				}
+
 				for (int nd_map_y = nd_start_y; nd_map_y <= nd_end_y; nd_map_y += 4) {
+					const int row = (nd_map_y - chunk_start_y) >> MapOccupancy::CHUNK_BITS;
+					if (empty_chunks[column * chunk_rows + row]) {
+						nd_map_y = (nd_map_y & chunk_mask) + MapOccupancy::CHUNK_SIZE - 4;
+						continue;
+					}
+
 					QTreeNode* nd = editor.map.getLeaf(nd_map_x, nd_map_y);
 					if (!nd) {
 						if (live_client) {
@@ -370,6 +415,7 @@ void MapDrawer::DrawMap() {
 						int cy = (nd_map_y)*TileSize - view_scroll_y - getFloorAdjustment(floor);
 						int cx = (nd_map_x)*TileSize - view_scroll_x - getFloorAdjustment(floor);
 
+						sprite_batch.flush();
 						glColor4ub(255, 0, 255, 128);
 						glBegin(GL_QUADS);
 						glVertex2f(cx, cy + TileSize * 4);
@@ -418,6 +464,7 @@ void MapDrawer::DrawMap() {
 		}
 
 		if (only_colors) {
+			sprite_batch.flush();
 			glEnable(GL_TEXTURE_2D);
 		}
 
@@ -531,6 +578,76 @@ void MapDrawer::DrawMap() {
 	}
 }
 
+void MapDrawer::PrefetchSprites() {
+	const int move_x = start_x - last_start_x;
+	const int move_y = start_y - last_start_y;
+	last_start_x = start_x;
+	last_start_y = start_y;
+
+	if (!g_settings.getInteger(Config::SPRITE_PREFETCH) || options.show_as_minimap || options.show_only_colors) {
+		return;
+	}
+	// Only while the camera moves, there is no telling where it goes next otherwise
+	if (move_x == 0 && move_y == 0) {
+		return;
+	}
+
+	// The screen ahead of the camera holds everything that scrolls in next
+	const int width = end_x - start_x;
+	const int height = end_y - start_y;
+	const int ahead_x = start_x + (move_x > 0 ? width : (move_x < 0 ? -width : 0));
+	const int ahead_y = start_y + (move_y > 0 ? height : (move_y < 0 ? -height : 0));
+	if (floor == prefetch_floor && std::abs(ahead_x - prefetch_x) < width / 4 && std::abs(ahead_y - prefetch_y) < height / 4) {
+		return;
+	}
+	prefetch_x = ahead_x;
+	prefetch_y = ahead_y;
+	prefetch_floor = floor;
+
+	// Floors above are drawn shifted, widen the area by one tile per floor like DrawMap does
+	const int margin = start_z - end_z;
+	const int min_x = std::max(0, ahead_x - margin) & ~3;
+	const int min_y = std::max(0, ahead_y - margin) & ~3;
+	const int max_x = std::min(MAP_MAX_WIDTH, ahead_x + width + margin);
+	const int max_y = std::min(MAP_MAX_HEIGHT, ahead_y + height + margin);
+
+	std::unordered_set<GameSprite*> requested;
+	auto request = [&requested](const Item* item) {
+		GameSprite* spr = g_items[item->getID()].sprite;
+		if (spr && requested.insert(spr).second) {
+			g_gui.gfx.prefetchSprite(spr);
+		}
+	};
+
+	for (int nd_x = min_x; nd_x <= max_x; nd_x += 4) {
+		for (int nd_y = min_y; nd_y <= max_y; nd_y += 4) {
+			QTreeNode* nd = editor.map.getLeaf(nd_x, nd_y);
+			if (!nd) {
+				continue;
+			}
+			for (int map_z = start_z; map_z >= end_z; --map_z) {
+				if (!nd->getFloor(map_z)) {
+					continue;
+				}
+				for (int map_x = 0; map_x < 4; ++map_x) {
+					for (int map_y = 0; map_y < 4; ++map_y) {
+						const Tile* tile = nd->getTile(nd_x + map_x, nd_y + map_y, map_z)->get();
+						if (!tile) {
+							continue;
+						}
+						if (tile->ground) {
+							request(tile->ground);
+						}
+						for (const Item* item : tile->items) {
+							request(item);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
 void MapDrawer::DrawIngameBox() {
 	int center_x = start_x + int(screensize_x * zoom / 64);
 	int center_y = start_y + int(screensize_y * zoom / 64);
@@ -548,6 +665,7 @@ void MapDrawer::DrawIngameBox() {
 
 	static wxColor side_color(0, 0, 0, 200);
 
+	sprite_batch.flush();
 	glDisable(GL_TEXTURE_2D);
 
 	// left side
@@ -670,6 +788,7 @@ void MapDrawer::DrawDraggingShadow() {
 		}
 	}
 
+	sprite_batch.flush();
 	glDisable(GL_TEXTURE_2D);
 }
 
@@ -713,6 +832,7 @@ void MapDrawer::DrawHigherFloors() {
 		}
 	}
 
+	sprite_batch.flush();
 	glDisable(GL_TEXTURE_2D);
 }
 
@@ -1045,6 +1165,7 @@ void MapDrawer::DrawBrush() {
 			}
 
 			if (brush->isRaw()) {
+				sprite_batch.flush();
 				glDisable(GL_TEXTURE_2D);
 			}
 		}
@@ -1114,6 +1235,7 @@ void MapDrawer::DrawBrush() {
 			} else {
 				BlitCreature(cx, cy, creature_brush->getType()->outfit, SOUTH, 255, 64, 64, 160);
 			}
+			sprite_batch.flush();
 			glDisable(GL_TEXTURE_2D);
 		} else if (!brush->isDoodad()) {
 			RAWBrush* raw_brush = nullptr;
@@ -1182,6 +1304,7 @@ void MapDrawer::DrawBrush() {
 			}
 
 			if (brush->isRaw()) { // Textured brush
+				sprite_batch.flush();
 				glDisable(GL_TEXTURE_2D);
 			}
 		}
@@ -1316,8 +1439,8 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, Item* it
 	for (int cx = 0; cx != spr->width; cx++) {
 		for (int cy = 0; cy != spr->height; cy++) {
 			for (int cf = 0; cf != spr->layers; cf++) {
-				int texnum = spr->getHardwareID(cx, cy, cf, subtype, pattern_x, pattern_y, pattern_z, frame);
-				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+				const SpriteTexture texture = spr->getTexture(cx, cy, cf, subtype, pattern_x, pattern_y, pattern_z, frame);
+				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1366,6 +1489,7 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, Item* it
 
 			int startOffset = std::max<int>(16, 32 - light.intensity);
 			int sqSize = TileSize - startOffset;
+			sprite_batch.flush();
 			glDisable(GL_TEXTURE_2D);
 			glBlitSquare(draw_x + startOffset - 2, draw_y + startOffset - 2, 0, 0, 0, byteA, sqSize + 2);
 			glBlitSquare(draw_x + startOffset - 1, draw_y + startOffset - 1, byteR, byteG, byteB, byteA, sqSize);
@@ -1386,9 +1510,9 @@ void MapDrawer::BlitSpriteType(int screenx, int screeny, uint32_t spriteid, int
 	for (int cx = 0; cx != spr->width; ++cx) {
 		for (int cy = 0; cy != spr->height; ++cy) {
 			for (int cf = 0; cf != spr->layers; ++cf) {
-				int texnum = spr->getHardwareID(cx, cy, cf, -1, 0, 0, 0, tme);
+				const SpriteTexture texture = spr->getTexture(cx, cy, cf, -1, 0, 0, 0, tme);
 				// printf("CF: %d\tTexturenum: %d\n", cf, texnum);
-				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1405,9 +1529,9 @@ void MapDrawer::BlitSpriteType(int screenx, int screeny, GameSprite* spr, int re
 	for (int cx = 0; cx != spr->width; ++cx) {
 		for (int cy = 0; cy != spr->height; ++cy) {
 			for (int cf = 0; cf != spr->layers; ++cf) {
-				int texnum = spr->getHardwareID(cx, cy, cf, -1, 0, 0, 0, tme);
+				const SpriteTexture texture = spr->getTexture(cx, cy, cf, -1, 0, 0, 0, tme);
 				// printf("CF: %d\tTexturenum: %d\n", cf, texnum);
-				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+				glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1441,8 +1565,8 @@ void MapDrawer::BlitCreature(int screenx, int screeny, const Outfit& outfit, Dir
 
 				for (int cx = 0; cx != mountSpr->width; ++cx) {
 					for (int cy = 0; cy != mountSpr->height; ++cy) {
-						int texnum = mountSpr->getHardwareID(cx, cy, (int)dir, 0, 0, mountOutfit, tme);
-						glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+						const SpriteTexture texture = mountSpr->getTexture(cx, cy, (int)dir, 0, 0, mountOutfit, tme);
+						glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texture, red, green, blue, alpha);
 					}
 				}
 
@@ -1460,8 +1584,8 @@ void MapDrawer::BlitCreature(int screenx, int screeny, const Outfit& outfit, Dir
 
 			for (int cx = 0; cx != spr->width; ++cx) {
 				for (int cy = 0; cy != spr->height; ++cy) {
-					int texnum = spr->getHardwareID(cx, cy, (int)dir, pattern_y, pattern_z, outfit, tme);
-					glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texnum, red, green, blue, alpha);
+					const SpriteTexture texture = spr->getTexture(cx, cy, (int)dir, pattern_y, pattern_z, outfit, tme);
+					glBlitTexture(screenx - cx * TileSize, screeny - cy * TileSize, texture, red, green, blue, alpha);
 				}
 			}
 		}
@@ -1487,23 +1611,7 @@ void MapDrawer::BlitSquare(int sx, int sy, int red, int green, int blue, int alp
 		return;
 	}
 
-	int texnum = spr->getHardwareID(0, 0, 0, -1, 0, 0, 0, 0);
-	if (texnum == 0) {
-		return;
-	}
-
-	glBindTexture(GL_TEXTURE_2D, texnum);
-	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
-	glBegin(GL_QUADS);
-	glTexCoord2f(0.f, 0.f);
-	glVertex2f(sx, sy);
-	glTexCoord2f(1.f, 0.f);
-	glVertex2f(sx + TileSize, sy);
-	glTexCoord2f(1.f, 1.f);
-	glVertex2f(sx + TileSize, sy + TileSize);
-	glTexCoord2f(0.f, 1.f);
-	glVertex2f(sx, sy + TileSize);
-	glEnd();
+	glBlitTexture(sx, sy, spr->getTexture(0, 0, 0, -1, 0, 0, 0, 0), red, green, blue, alpha);
 }
 
 void MapDrawer::DrawRawBrush(int screenx, int screeny, ItemType* itemType, uint8_t r, uint8_t g, uint8_t b, uint8_t alpha) {
@@ -1883,6 +1991,7 @@ void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_
 	};
 
 	// circle
+	sprite_batch.flush();
 	glBegin(GL_TRIANGLE_FAN);
 	glColor4ub(0x00, 0x00, 0x00, 0x50);
 	glVertex2i(x, y);
@@ -1912,6 +2021,7 @@ void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_
 }
 
 void MapDrawer::DrawHookIndicator(int x, int y, const ItemType& type) {
+	sprite_batch.flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor4ub(uint8_t(0), uint8_t(0), uint8_t(255), uint8_t(200));
 	glBegin(GL_QUADS);
@@ -2042,6 +2152,7 @@ void MapDrawer::DrawTooltips() {
 
 void MapDrawer::DrawLight() {
 	// draw in-game light
+	sprite_batch.flush();
 	light_drawer->draw(start_x, start_y, end_x, end_y, view_scroll_x, view_scroll_y, options.experimental_fog);
 }
 
@@ -2108,20 +2219,9 @@ void MapDrawer::TakeScreenshot(uint8_t* screenshot_buffer) {
 	}
 }
 
-void MapDrawer::glBlitTexture(int sx, int sy, int texture_number, int red, int green, int blue, int alpha) {
-	if (texture_number != 0) {
-		glBindTexture(GL_TEXTURE_2D, texture_number);
-		glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
-		glBegin(GL_QUADS);
-		glTexCoord2f(0.f, 0.f);
-		glVertex2f(sx, sy);
-		glTexCoord2f(1.f, 0.f);
-		glVertex2f(sx + TileSize, sy);
-		glTexCoord2f(1.f, 1.f);
-		glVertex2f(sx + TileSize, sy + TileSize);
-		glTexCoord2f(0.f, 1.f);
-		glVertex2f(sx, sy + TileSize);
-		glEnd();
+void MapDrawer::glBlitTexture(int sx, int sy, const SpriteTexture& texture, int red, int green, int blue, int alpha) {
+	if (texture.id != 0) {
+		sprite_batch.add(texture, sx, sy, TileSize, uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 	}
 }
 
@@ -2130,6 +2230,7 @@ void MapDrawer::glBlitSquare(int sx, int sy, int red, int green, int blue, int a
 		size = TileSize;
 	}
 
+	sprite_batch.flush();
 	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 	glBegin(GL_QUADS);
 	glVertex2f(sx, sy);
@@ -2195,6 +2296,7 @@ void MapDrawer::glColorCheck(Brush* brush, const Position& pos) {
 }
 
 void MapDrawer::drawRect(int x, int y, int w, int h, const wxColor& color, int width) {
+	sprite_batch.flush();
 	glLineWidth(width);
 	glColor4ub(color.Red(), color.Green(), color.Blue(), color.Alpha());
 	glBegin(GL_LINE_STRIP);
@@ -2207,6 +2309,7 @@ void MapDrawer::drawRect(int x, int y, int w, int h, const wxColor& color, int w
 }
 
 void MapDrawer::drawFilledRect(int x, int y, int w, int h, const wxColor& color) {
+	sprite_batch.flush();
 	glColor4ub(color.Red(), color.Green(), color.Blue(), color.Alpha());
 	glBegin(GL_QUADS);
 	glVertex2f(x, y);
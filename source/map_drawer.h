@@ -24,6 +24,8 @@
 #include <unordered_map>
 #include <memory>
 
+#include "sprite_atlas.h"
+
 class GameSprite;
 
 struct MapTooltip {
@@ -198,6 +200,7 @@ class MapDrawer {
 	DrawingOptions options;
 	std::shared_ptr<LightDrawer> light_drawer;
 	LODManager lod_manager;
+	SpriteBatch sprite_batch;
 
 	float zoom;
 
@@ -211,6 +214,10 @@ class MapDrawer {
 	int tile_size;
 	int floor;
 
+	// Camera position of the last frame and the area last handed to the sprite prefetcher
+	int last_start_x, last_start_y;
+	int prefetch_x, prefetch_y, prefetch_floor;
+
 protected:
 	std::unordered_map<uint16_t, std::vector<FinderPosition>> zoneTiles;
 	std::vector<MapTooltip*> tooltips;
@@ -230,6 +237,7 @@ public:
 	void Draw();
 	void DrawBackground();
 	void DrawMap();
+	void PrefetchSprites();
 	void DrawDraggingShadow();
 	void DrawHigherFloors();
 	void DrawSelectionBox();
@@ -277,7 +285,7 @@ protected:
 	};
 
 	void getColor(Brush* brush, const Position& position, uint8_t& r, uint8_t& g, uint8_t& b);
-	void glBlitTexture(int sx, int sy, int texture_number, int red, int green, int blue, int alpha);
+	void glBlitTexture(int sx, int sy, const SpriteTexture& texture, int red, int green, int blue, int alpha);
 	void glBlitSquare(int sx, int sy, int red, int green, int blue, int alpha, int size = 0);
 	void glColor(wxColor color);
 	void glColor(BrushColor color);
@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_floor_store.h"
+#include "tile.h"
+
+static_assert(MapFloorStore::FLOORS_PER_BLOCK <= 64, "Block::live has one bit per floor");
+
+MapFloorStore::MapFloorStore() :
+	block_pool(sizeof(Block), 16),
+	region_count(0),
+	floor_count(0) {
+	for (auto& floor_regions : regions) {
+		for (Region*& region : floor_regions) {
+			region = nullptr;
+		}
+	}
+}
+
+MapFloorStore::~MapFloorStore() {
+	clearRegions();
+}
+
+Floor* MapFloorStore::allocate(int x, int y, int z) {
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	Region*& region = regions[z][getRegionIndex(ux, uy)];
+	if (!region) {
+		region = newd Region();
+		++region_count;
+	}
+
+	Block*& block = region->blocks[getBlockIndex(ux, uy)];
+	if (!block) {
+		block = static_cast<Block*>(block_pool.allocate());
+		block->live = 0;
+	}
+
+	const int index = getFloorIndex(ux, uy);
+	ASSERT((block->live & (uint64_t(1) << index)) == 0);
+	block->live |= uint64_t(1) << index;
+	++floor_count;
+	return new (block->getFloor(index)) Floor(x, y, z);
+}
+
+void MapFloorStore::release(Floor* floor) {
+	// The first location carries the position the floor was created for
+	const Position position = floor->locs[0].getPosition();
+	const uint32_t ux = static_cast<uint32_t>(position.x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(position.y) & 0xFFFF;
+
+	Region* region = regions[position.z][getRegionIndex(ux, uy)];
+	ASSERT(region);
+	Block*& block = region->blocks[getBlockIndex(ux, uy)];
+	ASSERT(block && block->getFloor(getFloorIndex(ux, uy)) == floor);
+
+	floor->~Floor();
+	block->live &= ~(uint64_t(1) << getFloorIndex(ux, uy));
+	--floor_count;
+	if (block->live == 0) {
+		block_pool.release(block);
+		block = nullptr;
+	}
+}
+
+bool MapFloorStore::purge() {
+	if (floor_count != 0) {
+		return false;
+	}
+	clearRegions();
+	return block_pool.purge();
+}
+
+void MapFloorStore::discard() {
+	clearRegions();
+	block_pool.discard();
+	floor_count = 0;
+}
+
+void MapFloorStore::clearRegions() {
+	for (auto& floor_regions : regions) {
+		for (Region*& region : floor_regions) {
+			delete region;
+			region = nullptr;
+		}
+	}
+	region_count = 0;
+}
+
+MemoryPoolStats MapFloorStore::getStats() const {
+	return block_pool.getStats();
+}
+
+size_t MapFloorStore::memsize() const {
+	return sizeof(*this) + region_count * sizeof(Region) + block_pool.getStats().reserved_bytes;
+}
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_FLOOR_STORE_H_
+#define RME_MAP_FLOOR_STORE_H_
+
+#include "map_region.h"
+#include "memory_pool.h"
+
+// Contiguous storage for the floors of a map, the alternative to taking them one by one from the floor pool
+// Every 32x32 chunk of a floor is a single block of 8x8 Floors, so the 1024 TileLocations of the chunk sit
+// next to each other, and a two-level table (region, chunk) per floor finds the block of a position.
+// A tile lookup is then three array reads without going through the tree or its leaves.
+// The tree still points at the floors, whatever walks it doesn't notice the difference.
+// Dense maps come out about even on memory, sparse ones pay for whole blocks.
+class MapFloorStore {
+public:
+	static const int LEAF_BITS = 2;
+	static const int CHUNK_BITS = 5;
+	static const int REGION_BITS = 10;
+
+	static const int LEAVES_PER_CHUNK = 1 << (CHUNK_BITS - LEAF_BITS); // Floors per block side
+	static const int FLOORS_PER_BLOCK = LEAVES_PER_CHUNK * LEAVES_PER_CHUNK;
+	static const int CHUNKS_PER_REGION = 1 << (REGION_BITS - CHUNK_BITS); // Blocks per region side
+	static const int REGIONS = 1 << (16 - REGION_BITS); // Regions per map side
+
+	MapFloorStore();
+	~MapFloorStore();
+
+	MapFloorStore(const MapFloorStore&) = delete;
+	MapFloorStore& operator=(const MapFloorStore&) = delete;
+
+	// Same contract as MapAllocator::allocateFloor/freeFloor, a block goes away with its last floor
+	Floor* allocate(int x, int y, int z);
+	void release(Floor* floor);
+
+	// nullptr unless the floor holding the position has been allocated
+	TileLocation* getTileL(int x, int y, int z) const;
+
+	// Fails if any floor is still allocated
+	bool purge();
+	// Drops every block, the floors in them included, without running their destructors
+	void discard();
+
+	// Counts blocks, not floors
+	MemoryPoolStats getStats() const;
+	size_t getFloorCount() const {
+		return floor_count;
+	}
+	size_t memsize() const;
+
+protected:
+	struct Block {
+		uint64_t live; // One bit per floor handed out
+		alignas(Floor) unsigned char storage[FLOORS_PER_BLOCK * sizeof(Floor)];
+
+		Floor* getFloor(int index) {
+			return reinterpret_cast<Floor*>(storage) + index;
+		}
+	};
+	struct Region {
+		Block* blocks[CHUNKS_PER_REGION * CHUNKS_PER_REGION];
+	};
+
+	static int getRegionIndex(uint32_t x, uint32_t y) {
+		return (x >> REGION_BITS) * REGIONS + (y >> REGION_BITS);
+	}
+	static int getBlockIndex(uint32_t x, uint32_t y) {
+		const uint32_t mask = CHUNKS_PER_REGION - 1;
+		return ((x >> CHUNK_BITS) & mask) * CHUNKS_PER_REGION + ((y >> CHUNK_BITS) & mask);
+	}
+	static int getFloorIndex(uint32_t x, uint32_t y) {
+		const uint32_t mask = LEAVES_PER_CHUNK - 1;
+		return ((x >> LEAF_BITS) & mask) * LEAVES_PER_CHUNK + ((y >> LEAF_BITS) & mask);
+	}
+
+	void clearRegions();
+
+	Region* regions[MAP_LAYERS][REGIONS * REGIONS];
+	MemoryPool block_pool;
+	size_t region_count;
+	size_t floor_count;
+};
+
+inline TileLocation* MapFloorStore::getTileL(int x, int y, int z) const {
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	const Region* region = regions[z][getRegionIndex(ux, uy)];
+	if (!region) {
+		return nullptr;
+	}
+	Block* block = region->blocks[getBlockIndex(ux, uy)];
+	if (!block) {
+		return nullptr;
+	}
+
+	const int index = getFloorIndex(ux, uy);
+	if ((block->live & (uint64_t(1) << index)) == 0) {
+		return nullptr;
+	}
+	return &block->getFloor(index)->locs[(ux & 3) * 4 + (uy & 3)];
+}
+
+#endif
@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_generation.h"
+
+MapGenerationTable::MapGenerationTable() :
+	generation(0),
+	cleared(0),
+	region_count(0) {
+	for (int z = 0; z < FLOORS; ++z) {
+		layers[z] = nullptr;
+	}
+}
+
+MapGenerationTable::~MapGenerationTable() {
+	clear();
+}
+
+uint64_t MapGenerationTable::bump(int x, int y, int z) {
+	ASSERT(z >= 0 && z < FLOORS);
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	Layer*& layer = layers[z];
+	if (!layer) {
+		layer = newd Layer();
+	}
+
+	Region*& region = layer->regions[(ux >> REGION_BITS) * REGIONS + (uy >> REGION_BITS)];
+	if (!region) {
+		region = newd Region();
+		++region_count;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	region->chunks[((ux >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((uy >> CHUNK_BITS) & chunk_mask)] = ++generation;
+	return generation;
+}
+
+void MapGenerationTable::clear() {
+	for (int z = 0; z < FLOORS; ++z) {
+		Layer* layer = layers[z];
+		if (!layer) {
+			continue;
+		}
+		for (Region* region : layer->regions) {
+			delete region;
+		}
+		delete layer;
+		layers[z] = nullptr;
+	}
+	region_count = 0;
+	cleared = ++generation;
+}
+
+uint64_t MapGenerationTable::getChunkGeneration(int x, int y, int z) const {
+	if (z < 0 || z >= FLOORS || !layers[z]) {
+		return cleared;
+	}
+
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+	const Region* region = layers[z]->regions[(ux >> REGION_BITS) * REGIONS + (uy >> REGION_BITS)];
+	if (!region) {
+		return cleared;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	return std::max(cleared, region->chunks[((ux >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((uy >> CHUNK_BITS) & chunk_mask)]);
+}
+
+uint64_t MapGenerationTable::getAreaGeneration(int min_x, int min_y, int max_x, int max_y, int z) const {
+	min_x = std::max(min_x, 0);
+	min_y = std::max(min_y, 0);
+	max_x = std::min(max_x, 0xFFFF);
+	max_y = std::min(max_y, 0xFFFF);
+	if (z < 0 || z >= FLOORS || !layers[z] || min_x > max_x || min_y > max_y) {
+		return cleared;
+	}
+
+	const Layer* layer = layers[z];
+	const int chunk_mask = CHUNKS_PER_REGION - 1;
+	uint64_t result = cleared;
+	for (int rx = min_x >> REGION_BITS; rx <= (max_x >> REGION_BITS); ++rx) {
+		for (int ry = min_y >> REGION_BITS; ry <= (max_y >> REGION_BITS); ++ry) {
+			const Region* region = layer->regions[rx * REGIONS + ry];
+			if (!region) {
+				continue;
+			}
+
+			const int cx_begin = std::max(min_x, rx << REGION_BITS) >> CHUNK_BITS;
+			const int cx_end = std::min(max_x, ((rx + 1) << REGION_BITS) - 1) >> CHUNK_BITS;
+			const int cy_begin = std::max(min_y, ry << REGION_BITS) >> CHUNK_BITS;
+			const int cy_end = std::min(max_y, ((ry + 1) << REGION_BITS) - 1) >> CHUNK_BITS;
+			for (int cx = cx_begin; cx <= cx_end; ++cx) {
+				for (int cy = cy_begin; cy <= cy_end; ++cy) {
+					result = std::max(result, region->chunks[(cx & chunk_mask) * CHUNKS_PER_REGION + (cy & chunk_mask)]);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+size_t MapGenerationTable::memsize() const {
+	size_t layer_count = 0;
+	for (const Layer* layer : layers) {
+		if (layer) {
+			++layer_count;
+		}
+	}
+	return sizeof(*this) + layer_count * sizeof(Layer) + region_count * sizeof(Region);
+}
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_GENERATION_H_
+#define RME_MAP_GENERATION_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Change stamps for 32x32 tile chunks, one table per floor
+// Every change takes the next value of a map wide counter and stores it on the chunk it touched,
+// so the counters only ever grow. A cache remembers the value of getGeneration() when it was built
+// and is still valid for an area as long as getAreaGeneration() has not moved past it.
+class MapGenerationTable {
+public:
+	static const int CHUNK_BITS = 5;
+	static const int REGION_BITS = 10;
+
+	static const int CHUNK_SIZE = 1 << CHUNK_BITS; // Tiles per chunk side
+	static const int CHUNKS_PER_REGION = 1 << (REGION_BITS - CHUNK_BITS); // Chunks per region side
+	static const int REGIONS = 1 << (16 - REGION_BITS); // Regions per map side
+	static const int FLOORS = 16;
+
+	MapGenerationTable();
+	~MapGenerationTable();
+
+	MapGenerationTable(const MapGenerationTable&) = delete;
+	MapGenerationTable& operator=(const MapGenerationTable&) = delete;
+
+	// Stamps the chunk holding the position, returns the new generation
+	uint64_t bump(int x, int y, int z);
+	// Invalidates everything, the counter keeps going so no stamp handed out before is reused
+	void clear();
+
+	// Latest generation handed out on the whole map
+	uint64_t getGeneration() const {
+		return generation;
+	}
+	uint64_t getChunkGeneration(int x, int y, int z) const;
+	// Highest chunk generation inside the inclusive box, clamped to the map
+	uint64_t getAreaGeneration(int min_x, int min_y, int max_x, int max_y, int z) const;
+	bool hasChangedSince(int min_x, int min_y, int max_x, int max_y, int z, uint64_t since) const {
+		return getAreaGeneration(min_x, min_y, max_x, max_y, z) > since;
+	}
+	// Generation of the last clear, after it the stamps no longer cover the whole map
+	uint64_t getClearGeneration() const {
+		return cleared;
+	}
+
+	// Calls f(x, y, z) with the first tile of every chunk stamped after since
+	// A clear after since isn't reported, check getClearGeneration for that
+	template <typename F>
+	void forEachChangedChunk(uint64_t since, F&& f) const {
+		for (int z = 0; z < FLOORS; ++z) {
+			const Layer* layer = layers[z];
+			if (!layer) {
+				continue;
+			}
+			for (int region_index = 0; region_index < REGIONS * REGIONS; ++region_index) {
+				const Region* region = layer->regions[region_index];
+				if (!region) {
+					continue;
+				}
+				const int region_x = (region_index / REGIONS) << REGION_BITS;
+				const int region_y = (region_index % REGIONS) << REGION_BITS;
+				for (int chunk_index = 0; chunk_index < CHUNKS_PER_REGION * CHUNKS_PER_REGION; ++chunk_index) {
+					if (region->chunks[chunk_index] > since) {
+						f(region_x + ((chunk_index / CHUNKS_PER_REGION) << CHUNK_BITS), region_y + ((chunk_index % CHUNKS_PER_REGION) << CHUNK_BITS), z);
+					}
+				}
+			}
+		}
+	}
+
+	size_t memsize() const;
+
+protected:
+	struct Region {
+		uint64_t chunks[CHUNKS_PER_REGION * CHUNKS_PER_REGION];
+	};
+	struct Layer {
+		Region* regions[REGIONS * REGIONS];
+	};
+
+	uint64_t generation;
+	uint64_t cleared; // Generation of the last clear, every chunk counts as changed at it
+	Layer* layers[FLOORS];
+	size_t region_count;
+};
+
+#endif
@@ -0,0 +1,281 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_occupancy.h"
+
+namespace {
+	inline uint32_t popcount(uint32_t v) {
+		v = v - ((v >> 1) & 0x55555555);
+		v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+		return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+	}
+
+	// Bits low..high (inclusive) set
+	inline uint32_t rangeMask(uint32_t low, uint32_t high) {
+		const uint32_t upper = high >= 31 ? 0xFFFFFFFF : (1u << (high + 1)) - 1;
+		return upper & ~((1u << low) - 1);
+	}
+
+	inline bool clampArea(int& min_x, int& min_y, int& max_x, int& max_y) {
+		min_x = std::max(min_x, 0);
+		min_y = std::max(min_y, 0);
+		max_x = std::min(max_x, 0xFFFF);
+		max_y = std::min(max_y, 0xFFFF);
+		return min_x <= max_x && min_y <= max_y;
+	}
+}
+
+MapOccupancy::MapOccupancy() :
+	region_count(0),
+	chunk_count(0) {
+	for (int z = 0; z < FLOORS; ++z) {
+		layers[z] = nullptr;
+	}
+}
+
+MapOccupancy::~MapOccupancy() {
+	clear();
+}
+
+bool MapOccupancy::set(int x, int y, int z) {
+	ASSERT(z >= 0 && z < FLOORS);
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	Layer*& layer = layers[z];
+	if (!layer) {
+		layer = newd Layer();
+	}
+
+	Region*& region = layer->regions[(ux >> REGION_BITS) * REGIONS + (uy >> REGION_BITS)];
+	if (!region) {
+		region = newd Region();
+		++region_count;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	Chunk*& chunk = region->chunks[((ux >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((uy >> CHUNK_BITS) & chunk_mask)];
+	if (!chunk) {
+		chunk = newd Chunk();
+		++chunk_count;
+	}
+
+	uint32_t& row = chunk->rows[uy & (CHUNK_SIZE - 1)];
+	const uint32_t bit = 1u << (ux & (CHUNK_SIZE - 1));
+	if (row & bit) {
+		return false;
+	}
+	row |= bit;
+	++chunk->count;
+	++region->count;
+	++layer->count;
+	return true;
+}
+
+bool MapOccupancy::reset(int x, int y, int z) {
+	ASSERT(z >= 0 && z < FLOORS);
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+
+	Layer*& layer = layers[z];
+	if (!layer) {
+		return false;
+	}
+
+	Region*& region = layer->regions[(ux >> REGION_BITS) * REGIONS + (uy >> REGION_BITS)];
+	if (!region) {
+		return false;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	Chunk*& chunk = region->chunks[((ux >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((uy >> CHUNK_BITS) & chunk_mask)];
+	if (!chunk) {
+		return false;
+	}
+
+	uint32_t& row = chunk->rows[uy & (CHUNK_SIZE - 1)];
+	const uint32_t bit = 1u << (ux & (CHUNK_SIZE - 1));
+	if (!(row & bit)) {
+		return false;
+	}
+	row &= ~bit;
+
+	// Drop empty blocks right away, a null pointer is what lets queries skip them
+	if (--chunk->count == 0) {
+		delete chunk;
+		chunk = nullptr;
+		--chunk_count;
+	}
+	if (--region->count == 0) {
+		delete region;
+		region = nullptr;
+		--region_count;
+	}
+	if (--layer->count == 0) {
+		delete layer;
+		layer = nullptr;
+	}
+	return true;
+}
+
+const MapOccupancy::Chunk* MapOccupancy::getChunk(uint32_t x, uint32_t y, int z) const {
+	if (z < 0 || z >= FLOORS || !layers[z]) {
+		return nullptr;
+	}
+
+	const Region* region = layers[z]->regions[(x >> REGION_BITS) * REGIONS + (y >> REGION_BITS)];
+	if (!region) {
+		return nullptr;
+	}
+
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	return region->chunks[((x >> CHUNK_BITS) & chunk_mask) * CHUNKS_PER_REGION + ((y >> CHUNK_BITS) & chunk_mask)];
+}
+
+bool MapOccupancy::isOccupied(int x, int y, int z) const {
+	const uint32_t ux = static_cast<uint32_t>(x) & 0xFFFF;
+	const uint32_t uy = static_cast<uint32_t>(y) & 0xFFFF;
+	const Chunk* chunk = getChunk(ux, uy, z);
+	return chunk && (chunk->rows[uy & (CHUNK_SIZE - 1)] & (1u << (ux & (CHUNK_SIZE - 1)))) != 0;
+}
+
+uint32_t MapOccupancy::getChunkTileCount(int x, int y, int z) const {
+	const Chunk* chunk = getChunk(static_cast<uint32_t>(x) & 0xFFFF, static_cast<uint32_t>(y) & 0xFFFF, z);
+	return chunk ? chunk->count : 0;
+}
+
+template <typename ChunkCallback>
+void MapOccupancy::visitChunks(int min_x, int min_y, int max_x, int max_y, int z, ChunkCallback&& callback) const {
+	if (z < 0 || z >= FLOORS || !layers[z] || !clampArea(min_x, min_y, max_x, max_y)) {
+		return;
+	}
+
+	const Layer* layer = layers[z];
+	const uint32_t chunk_mask = CHUNKS_PER_REGION - 1;
+	for (int rx = min_x >> REGION_BITS; rx <= (max_x >> REGION_BITS); ++rx) {
+		for (int ry = min_y >> REGION_BITS; ry <= (max_y >> REGION_BITS); ++ry) {
+			const Region* region = layer->regions[rx * REGIONS + ry];
+			if (!region) {
+				continue;
+			}
+
+			// Chunk range of the box inside this region
+			const int cx_begin = std::max(min_x, rx << REGION_BITS) >> CHUNK_BITS;
+			const int cx_end = std::min(max_x, ((rx + 1) << REGION_BITS) - 1) >> CHUNK_BITS;
+			const int cy_begin = std::max(min_y, ry << REGION_BITS) >> CHUNK_BITS;
+			const int cy_end = std::min(max_y, ((ry + 1) << REGION_BITS) - 1) >> CHUNK_BITS;
+			for (int cx = cx_begin; cx <= cx_end; ++cx) {
+				for (int cy = cy_begin; cy <= cy_end; ++cy) {
+					const Chunk* chunk = region->chunks[(cx & chunk_mask) * CHUNKS_PER_REGION + (cy & chunk_mask)];
+					if (!chunk) {
+						continue;
+					}
+
+					// Part of the chunk inside the box, in chunk local coordinates
+					const int chunk_x = cx << CHUNK_BITS;
+					const int chunk_y = cy << CHUNK_BITS;
+					const uint32_t low_x = std::max(min_x - chunk_x, 0);
+					const uint32_t high_x = std::min(max_x - chunk_x, CHUNK_SIZE - 1);
+					const uint32_t low_y = std::max(min_y - chunk_y, 0);
+					const uint32_t high_y = std::min(max_y - chunk_y, CHUNK_SIZE - 1);
+					if (!callback(*chunk, low_x, high_x, low_y, high_y)) {
+						return;
+					}
+				}
+			}
+		}
+	}
+}
+
+uint64_t MapOccupancy::countTiles(int min_x, int min_y, int max_x, int max_y, int z) const {
+	uint64_t count = 0;
+	visitChunks(min_x, min_y, max_x, max_y, z, [&count](const Chunk& chunk, uint32_t low_x, uint32_t high_x, uint32_t low_y, uint32_t high_y) {
+		if (low_x == 0 && low_y == 0 && high_x == CHUNK_SIZE - 1 && high_y == CHUNK_SIZE - 1) {
+			count += chunk.count;
+			return true;
+		}
+
+		const uint32_t mask = rangeMask(low_x, high_x);
+		for (uint32_t y = low_y; y <= high_y; ++y) {
+			count += popcount(chunk.rows[y] & mask);
+		}
+		return true;
+	});
+	return count;
+}
+
+bool MapOccupancy::isAreaEmpty(int min_x, int min_y, int max_x, int max_y, int z) const {
+	bool empty = true;
+	visitChunks(min_x, min_y, max_x, max_y, z, [&empty](const Chunk& chunk, uint32_t low_x, uint32_t high_x, uint32_t low_y, uint32_t high_y) {
+		// Chunks only exist while they hold a tile, so a fully covered one is never empty
+		if (low_x == 0 && low_y == 0 && high_x == CHUNK_SIZE - 1 && high_y == CHUNK_SIZE - 1) {
+			empty = false;
+			return false;
+		}
+
+		const uint32_t mask = rangeMask(low_x, high_x);
+		for (uint32_t y = low_y; y <= high_y; ++y) {
+			if (chunk.rows[y] & mask) {
+				empty = false;
+				return false;
+			}
+		}
+		return true;
+	});
+	return empty;
+}
+
+uint64_t MapOccupancy::getFloorTileCount(int z) const {
+	if (z < 0 || z >= FLOORS || !layers[z]) {
+		return 0;
+	}
+	return layers[z]->count;
+}
+
+void MapOccupancy::clear() {
+	for (int z = 0; z < FLOORS; ++z) {
+		Layer* layer = layers[z];
+		if (!layer) {
+			continue;
+		}
+		for (Region* region : layer->regions) {
+			if (!region) {
+				continue;
+			}
+			for (Chunk* chunk : region->chunks) {
+				delete chunk;
+			}
+			delete region;
+		}
+		delete layer;
+		layers[z] = nullptr;
+	}
+	region_count = 0;
+	chunk_count = 0;
+}
+
+size_t MapOccupancy::memsize() const {
+	size_t layer_count = 0;
+	for (const Layer* layer : layers) {
+		if (layer) {
+			++layer_count;
+		}
+	}
+	return sizeof(*this) + layer_count * sizeof(Layer) + region_count * sizeof(Region) + chunk_count * sizeof(Chunk);
+}
@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_OCCUPANCY_H_
+#define RME_MAP_OCCUPANCY_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Per-floor bitmaps of which positions hold a tile, kept up to date by the map on every set/remove
+// Every floor is split into regions of 1024x1024 tiles and every region into chunks of 32x32 tiles,
+// a chunk stores one bit per position and both levels keep a running tile count.
+// Chunks and regions are released as soon as they run empty, so a missing chunk means empty space
+// and whole chunks can be skipped without touching a single tile.
+class MapOccupancy {
+public:
+	static const int CHUNK_BITS = 5;
+	static const int REGION_BITS = 10;
+
+	static const int CHUNK_SIZE = 1 << CHUNK_BITS; // Tiles per chunk side
+	static const int CHUNKS_PER_REGION = 1 << (REGION_BITS - CHUNK_BITS); // Chunks per region side
+	static const int REGIONS = 1 << (16 - REGION_BITS); // Regions per map side
+	static const int FLOORS = 16;
+
+	MapOccupancy();
+	~MapOccupancy();
+
+	MapOccupancy(const MapOccupancy&) = delete;
+	MapOccupancy& operator=(const MapOccupancy&) = delete;
+
+	// Marks a position as holding a tile or not, returns false if it already was in that state
+	bool set(int x, int y, int z);
+	bool reset(int x, int y, int z);
+
+	bool isOccupied(int x, int y, int z) const;
+	// Tiles in the 32x32 chunk containing the position
+	uint32_t getChunkTileCount(int x, int y, int z) const;
+	bool isChunkEmpty(int x, int y, int z) const {
+		return getChunkTileCount(x, y, z) == 0;
+	}
+
+	// Area queries take an inclusive box, clamped to the map
+	uint64_t countTiles(int min_x, int min_y, int max_x, int max_y, int z) const;
+	bool isAreaEmpty(int min_x, int min_y, int max_x, int max_y, int z) const;
+
+	uint64_t getFloorTileCount(int z) const;
+
+	void clear();
+	size_t memsize() const;
+
+protected:
+	struct Chunk {
+		uint32_t rows[CHUNK_SIZE]; // One word per y, bit x
+		uint32_t count;
+	};
+	struct Region {
+		Chunk* chunks[CHUNKS_PER_REGION * CHUNKS_PER_REGION];
+		uint32_t count;
+	};
+	struct Layer {
+		Region* regions[REGIONS * REGIONS];
+		uint64_t count;
+	};
+
+	const Chunk* getChunk(uint32_t x, uint32_t y, int z) const;
+	// Walks the chunks overlapping the box, stops early once the callback returns false
+	template <typename ChunkCallback>
+	void visitChunks(int min_x, int min_y, int max_x, int max_y, int z, ChunkCallback&& callback) const;
+
+	Layer* layers[FLOORS];
+	size_t region_count;
+	size_t chunk_count;
+};
+
+#endif
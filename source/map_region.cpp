@@ -19,6 +19,7 @@
 
 #include "map_region.h"
 #include "basemap.h"
+#include "map_snapshot.h"
 #include "position.h"
 #include "tile.h"
 
@@ -67,6 +68,7 @@ Floor::Floor(int sx, int sy, int z) {
 
 QTreeNode::QTreeNode(BaseMap& map) :
 	map(map),
+	generation(0),
 	visible(0),
 	isLeaf(false) {
 	// Doesn't matter if we're leaf or node
@@ -78,11 +80,34 @@ QTreeNode::QTreeNode(BaseMap& map) :
 QTreeNode::~QTreeNode() {
 	if (isLeaf) {
 		for (int i = 0; i < MAP_LAYERS; ++i) {
-			delete array[i];
+			map.allocator.freeFloor(array[i]);
 		}
 	} else {
 		for (int i = 0; i < MAP_LAYERS; ++i) {
-			delete child[i];
+			map.allocator.freeNode(child[i]);
+		}
+	}
+}
+
+void QTreeNode::releaseTiles() {
+	if (!isLeaf) {
+		for (QTreeNode* node : child) {
+			if (node) {
+				node->releaseTiles();
+			}
+		}
+		return;
+	}
+
+	for (Floor* floor : array) {
+		if (!floor) {
+			continue;
+		}
+		for (TileLocation& location : floor->locs) {
+			delete location.tile;
+			location.tile = nullptr;
+			delete location.house_exits;
+			location.house_exits = nullptr;
 		}
 	}
 }
@@ -121,12 +146,19 @@ QTreeNode* QTreeNode::getLeafForce(int x, int y) {
 			}
 
 		} else {
+			QTreeNode* created = map.allocator.allocateNode(map);
+			created->isLeaf = level == 0;
+			if (map.snapshot) {
+				// A snapshot may be walking the tree on another thread
+				map.snapshot->attach(qt, created);
+			} else {
+				qt = created;
+			}
 			if (level == 0) {
-				qt = newd QTreeNode(map);
-				qt->isLeaf = true;
+				if (map.chunk_index) {
+					map.chunk_index->setLeaf(x, y, qt);
+				}
 				return qt;
-			} else {
-				qt = newd QTreeNode(map);
 			}
 		}
 		node = node->child[index];
@@ -141,7 +173,10 @@ QTreeNode* QTreeNode::getLeafForce(int x, int y) {
 Floor* QTreeNode::createFloor(int x, int y, int z) {
 	ASSERT(isLeaf);
 	if (!array[z]) {
-		array[z] = newd Floor(x, y, z);
+		if (map.snapshot) {
+			map.snapshot->preserve(this, x, y);
+		}
+		array[z] = map.allocator.allocateFloor(x, y, z);
 	}
 	return array[z];
 }
@@ -227,6 +262,9 @@ TileLocation* QTreeNode::createTile(int x, int y, int z) {
 
 Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile) {
 	ASSERT(isLeaf);
+	if (map.snapshot) {
+		map.snapshot->preserve(this, x, y);
+	}
 	Floor* f = createFloor(x, y, z);
 
 	int offset_x = x & 3;
@@ -235,11 +273,14 @@ Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile) {
 	TileLocation* tmp = &f->locs[offset_x * 4 + offset_y];
 	Tile* oldtile = tmp->tile;
 	tmp->tile = newtile;
+	generation = map.generations.bump(x, y, z);
 
 	if (newtile && !oldtile) {
 		++map.tilecount;
+		map.occupancy.set(x, y, z);
 	} else if (oldtile && !newtile) {
 		--map.tilecount;
+		map.occupancy.reset(x, y, z);
 	}
 
 	return oldtile;
@@ -247,6 +288,9 @@ Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile) {
 
 void QTreeNode::clearTile(int x, int y, int z) {
 	ASSERT(isLeaf);
+	if (map.snapshot) {
+		map.snapshot->preserve(this, x, y);
+	}
 	Floor* f = createFloor(x, y, z);
 
 	int offset_x = x & 3;
@@ -255,4 +299,6 @@ void QTreeNode::clearTile(int x, int y, int z) {
 	TileLocation* tmp = &f->locs[offset_x * 4 + offset_y];
 	delete tmp->tile;
 	tmp->tile = map.allocator(tmp);
+	map.occupancy.set(x, y, z);
+	generation = map.generations.bump(x, y, z);
 }
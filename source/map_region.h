@@ -152,8 +152,18 @@ public:
 	bool isVisible(bool underground);
 	bool isRequested(bool underground);
 
+	// Deletes every tile and house exit list below this node, the nodes and floors are left
+	// with nothing to tear down so they can be dropped with their slabs
+	void releaseTiles();
+
+	// Map generation of the last change to any tile of this leaf, see MapGenerationTable
+	uint64_t getGeneration() const {
+		return generation;
+	}
+
 protected:
 	BaseMap& map;
+	uint64_t generation;
 	uint32_t visible;
 
 	bool isLeaf;
@@ -169,6 +179,8 @@ protected:
 
 	friend class BaseMap;
 	friend class MapIterator;
+	friend class MapChunkIndex;
+	friend class MapSnapshot;
 };
 
 #endif
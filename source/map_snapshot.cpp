@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_snapshot.h"
+#include "tile.h"
+
+// Bound to a reference by std::min in release, so it needs a definition
+const uint32_t MapSnapshot::END_KEY;
+
+MapSnapshot::MapSnapshot(BaseMap& map) :
+	map(map),
+	generation(map.getGeneration()),
+	tilecount(map.getTileCount()),
+	read_key(0),
+	released_key(0) {
+	ASSERT(map.snapshot == nullptr);
+	nodestack.push_back({ &map.root, 0, 0 });
+	map.snapshot = this;
+}
+
+MapSnapshot::~MapSnapshot() {
+	map.snapshot = nullptr;
+	for (const auto& entry : preserved) {
+		for (Tile* tile : entry.second) {
+			delete tile;
+		}
+	}
+}
+
+uint32_t MapSnapshot::getLeafKey(int x, int y) {
+	// Same walk as QTreeNode::getLeaf, one child index per level
+	uint32_t key = 0;
+	uint32_t cx = x, cy = y;
+	for (int level = 0; level < 7; ++level) {
+		key = (key << 4) | ((cx & 0xC000) >> 14) | ((cy & 0xC000) >> 12);
+		cx <<= 2;
+		cy <<= 2;
+	}
+	return key;
+}
+
+void MapSnapshot::preserve(QTreeNode* leaf, int x, int y) {
+	std::unique_lock<std::mutex> guard(lock);
+	const uint32_t key = getLeafKey(x, y);
+	if (key < released_key) {
+		return;
+	}
+	if (key < read_key) {
+		// Its tiles are being encoded right now, that doesn't take long
+		released.wait(guard, [this, key] { return key < released_key; });
+		return;
+	}
+	if (preserved.count(leaf) != 0) {
+		return; // Only the first change counts, that's the leaf the snapshot saw
+	}
+
+	std::vector<Tile*>& copies = preserved[leaf];
+	for (Floor* floor : leaf->array) {
+		if (!floor) {
+			continue;
+		}
+		for (TileLocation& location : floor->locs) {
+			if (Tile* tile = location.get()) {
+				copies.push_back(tile->deepCopy(map));
+			}
+		}
+	}
+}
+
+void MapSnapshot::attach(QTreeNode*& slot, QTreeNode* node) {
+	std::lock_guard<std::mutex> guard(lock);
+	slot = node;
+}
+
+void MapSnapshot::wait() {
+	std::unique_lock<std::mutex> guard(lock);
+	released.wait(guard, [this] { return released_key == END_KEY; });
+}
+
+bool MapSnapshot::read(std::vector<Entry>& tiles, size_t max_tiles) {
+	std::lock_guard<std::mutex> guard(lock);
+	const size_t limit = tiles.size() + max_tiles;
+	while (!nodestack.empty() && tiles.size() < limit) {
+		NodeIndex& current = nodestack.back();
+		if (current.index == MAP_LAYERS) {
+			nodestack.pop_back();
+			continue;
+		}
+
+		const uint32_t key = (current.key << 4) | current.index;
+		QTreeNode* child = current.node->child[current.index++];
+		if (!child) {
+			continue;
+		}
+		if (!child->isLeaf) {
+			nodestack.push_back({ child, 0, key });
+			continue;
+		}
+
+		read_key = key + 1;
+		auto copies = preserved.find(child);
+		if (copies != preserved.end()) {
+			for (Tile* tile : copies->second) {
+				tiles.push_back({ tile, key });
+			}
+			continue;
+		}
+		for (Floor* floor : child->array) {
+			if (!floor) {
+				continue;
+			}
+			for (TileLocation& location : floor->locs) {
+				if (Tile* tile = location.get()) {
+					tiles.push_back({ tile, key });
+				}
+			}
+		}
+	}
+
+	if (nodestack.empty()) {
+		read_key = END_KEY;
+		return false;
+	}
+	return true;
+}
+
+void MapSnapshot::release(uint32_t key) {
+	key = std::min(key, END_KEY);
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (key <= released_key) {
+			return;
+		}
+		released_key = key;
+	}
+	released.notify_all();
+}
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_SNAPSHOT_H_
+#define RME_MAP_SNAPSHOT_H_
+
+#include "basemap.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// The tiles of a map as they were at one point, so another thread can read them while the map
+// keeps being edited. Taking it costs nothing, the reader walks the live tree one leaf (4x4 tiles
+// on every floor) at a time. A leaf the map is about to change is copied first if the reader hasn't
+// got to it yet, or waited for if its tiles are still being read. Leaves the reader has released
+// are left alone. Tiles changed in place instead of through setTile have to call
+// BaseMap::waitForSnapshot first.
+class MapSnapshot {
+public:
+	explicit MapSnapshot(BaseMap& map);
+	~MapSnapshot();
+
+	MapSnapshot(const MapSnapshot&) = delete;
+	MapSnapshot& operator=(const MapSnapshot&) = delete;
+
+	// Leaves are read in map iteration order, which is the order of their keys
+	static uint32_t getLeafKey(int x, int y);
+	static const uint32_t END_KEY = 1u << 28;
+
+	// Called by the map right before it changes a tile or floor of the leaf holding x, y
+	void preserve(QTreeNode* leaf, int x, int y);
+	// Called by the map to hang a new node in the tree
+	void attach(QTreeNode*& slot, QTreeNode* node);
+	// Blocks until the reader has released every leaf
+	void wait();
+
+	struct Entry {
+		Tile* tile;
+		uint32_t key; // Of the leaf holding the tile
+	};
+	// Appends the tiles of the next leaves to tiles, in map order and about max_tiles of them.
+	// Returns false once every leaf has been read.
+	bool read(std::vector<Entry>& tiles, size_t max_tiles);
+	// The reader is done with the leaves before key, the map may change them from now on
+	void release(uint32_t key);
+
+	// Tiles on the map when the snapshot was taken
+	uint64_t size() const {
+		return tilecount;
+	}
+	uint64_t getGeneration() const {
+		return generation;
+	}
+
+protected:
+	struct NodeIndex {
+		QTreeNode* node;
+		int index;
+		uint32_t key;
+	};
+
+	BaseMap& map;
+	uint64_t generation;
+	uint64_t tilecount;
+
+	std::mutex lock;
+	std::condition_variable released;
+	std::vector<NodeIndex> nodestack; // Where the reader is in the tree
+	uint32_t read_key; // Every leaf before it has been read
+	uint32_t released_key; // Every leaf before it has been released
+	std::unordered_map<QTreeNode*, std::vector<Tile*>> preserved; // Copies of leaves changed since
+};
+
+#endif
@@ -55,6 +55,9 @@ MapTab::~MapTab() {
 	if (iref->owner_count <= 0) {
 		delete iref->editor;
 		delete iref;
+		// The whole map is gone, give its pooled memory back in one go
+		Tile::trimPool();
+		Item::trimPool();
 	}
 }
 
@@ -0,0 +1,232 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "memory_pool.h"
+
+namespace {
+	size_t alignedObjectSize(size_t size) {
+		const size_t alignment = alignof(std::max_align_t);
+		size = std::max(size, sizeof(void*));
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+MemoryPool::MemoryPool(size_t object_size, size_t objects_per_slab, bool synchronized) :
+	object_size(alignedObjectSize(object_size)),
+	objects_per_slab(std::max<size_t>(objects_per_slab, 1)),
+	synchronized(synchronized),
+	free_list(nullptr),
+	live(0),
+	peak(0),
+	allocations(0),
+	releases(0) {
+	////
+}
+
+MemoryPool::~MemoryPool() {
+	// Anything still alive at this point is leaked by its owner, we don't care
+	for (uint8_t* slab : slabs) {
+		::operator delete(slab);
+	}
+}
+
+void MemoryPool::addSlab() {
+	uint8_t* slab = static_cast<uint8_t*>(::operator new(object_size * objects_per_slab));
+	slabs.insert(std::upper_bound(slabs.begin(), slabs.end(), slab), slab);
+
+	// Thread the new slab onto the free list back to front, so allocation walks it in address order
+	for (size_t i = objects_per_slab; i > 0; --i) {
+		FreeNode* node = reinterpret_cast<FreeNode*>(slab + (i - 1) * object_size);
+		node->next = free_list;
+		free_list = node;
+	}
+}
+
+void* MemoryPool::pop() {
+	if (!free_list) {
+		addSlab();
+	}
+
+	FreeNode* node = free_list;
+	free_list = node->next;
+
+	++allocations;
+	if (++live > peak) {
+		peak = live;
+	}
+	return node;
+}
+
+void MemoryPool::push(void* ptr) {
+	FreeNode* node = static_cast<FreeNode*>(ptr);
+	node->next = free_list;
+	free_list = node;
+
+	++releases;
+	--live;
+}
+
+void* MemoryPool::allocate() {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+	return pop();
+}
+
+void MemoryPool::allocate(void** out, size_t count) {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = pop();
+	}
+}
+
+void MemoryPool::release(void* ptr) {
+	if (!ptr) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+	push(ptr);
+}
+
+void MemoryPool::release(void** ptrs, size_t count) {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+	for (size_t i = 0; i < count; ++i) {
+		if (ptrs[i]) {
+			push(ptrs[i]);
+		}
+	}
+}
+
+bool MemoryPool::purge() {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+
+	if (live != 0) {
+		return false;
+	}
+
+	for (uint8_t* slab : slabs) {
+		::operator delete(slab);
+	}
+	slabs.clear();
+	free_list = nullptr;
+	return true;
+}
+
+void MemoryPool::discard() {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+
+	for (uint8_t* slab : slabs) {
+		::operator delete(slab);
+	}
+	slabs.clear();
+	free_list = nullptr;
+	releases += live;
+	live = 0;
+}
+
+size_t MemoryPool::trim() {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+
+	if (slabs.empty()) {
+		return 0;
+	}
+
+	const size_t slab_bytes = object_size * objects_per_slab;
+	auto slabOf = [this](FreeNode* node) -> size_t {
+		auto it = std::upper_bound(slabs.begin(), slabs.end(), reinterpret_cast<uint8_t*>(node));
+		return (it - slabs.begin()) - 1;
+	};
+
+	// Count the free objects of every slab, a slab is unused when all of its objects are free
+	std::vector<size_t> free_count(slabs.size(), 0);
+	for (FreeNode* node = free_list; node; node = node->next) {
+		++free_count[slabOf(node)];
+	}
+
+	std::vector<bool> unused(slabs.size(), false);
+	size_t unused_count = 0;
+	for (size_t i = 0; i < slabs.size(); ++i) {
+		if (free_count[i] == objects_per_slab) {
+			unused[i] = true;
+			++unused_count;
+		}
+	}
+	if (unused_count == 0) {
+		return 0;
+	}
+
+	// Unlink the objects of unused slabs, the remaining free list keeps its order
+	FreeNode** link = &free_list;
+	while (*link) {
+		if (unused[slabOf(*link)]) {
+			*link = (*link)->next;
+		} else {
+			link = &(*link)->next;
+		}
+	}
+
+	std::vector<uint8_t*> kept;
+	kept.reserve(slabs.size() - unused_count);
+	for (size_t i = 0; i < slabs.size(); ++i) {
+		if (unused[i]) {
+			::operator delete(slabs[i]);
+		} else {
+			kept.push_back(slabs[i]);
+		}
+	}
+	slabs.swap(kept);
+	return unused_count * slab_bytes;
+}
+
+MemoryPoolStats MemoryPool::getStats() const {
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if (synchronized) {
+		lock.lock();
+	}
+
+	MemoryPoolStats stats;
+	stats.slabs = slabs.size();
+	stats.live = live;
+	stats.peak = peak;
+	stats.reserved_bytes = slabs.size() * objects_per_slab * object_size;
+	stats.used_bytes = live * object_size;
+	stats.allocations = allocations;
+	stats.releases = releases;
+	return stats;
+}
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MEMORY_POOL_H_
+#define RME_MEMORY_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct MemoryPoolStats {
+	size_t slabs = 0;
+	size_t live = 0; // Objects currently handed out
+	size_t peak = 0;
+	size_t reserved_bytes = 0; // Held in slabs, live or not
+	size_t used_bytes = 0; // Held by live objects
+	uint64_t allocations = 0;
+	uint64_t releases = 0;
+
+	MemoryPoolStats& operator+=(const MemoryPoolStats& other) {
+		slabs += other.slabs;
+		live += other.live;
+		peak += other.peak;
+		reserved_bytes += other.reserved_bytes;
+		used_bytes += other.used_bytes;
+		allocations += other.allocations;
+		releases += other.releases;
+		return *this;
+	}
+};
+
+// Fixed-size object pool
+// Storage is carved out of large slabs and recycled through an intrusive free list,
+// so allocating an object is a pointer pop instead of a trip to the heap.
+// Slabs are only returned to the system by purge(), once every object has been released.
+class MemoryPool {
+public:
+	// Set synchronized if objects may be allocated or released from more than one thread
+	MemoryPool(size_t object_size, size_t objects_per_slab = 1024, bool synchronized = false);
+	~MemoryPool();
+
+	MemoryPool(const MemoryPool&) = delete;
+	MemoryPool& operator=(const MemoryPool&) = delete;
+
+	void* allocate();
+	void release(void* ptr);
+
+	// Batched variants, these take the lock once for the whole batch
+	void allocate(void** out, size_t count);
+	void release(void** ptrs, size_t count);
+
+	// Releases all slabs in one go, fails (returns false) if any object is still alive
+	bool purge();
+	// Releases every slab that has no live objects, returns the number of bytes given back
+	size_t trim();
+	// Releases all slabs in one go, live objects included. Their destructors are never run,
+	// only for owners that have torn down whatever else the objects held.
+	void discard();
+
+	MemoryPoolStats getStats() const;
+	size_t getObjectSize() const {
+		return object_size;
+	}
+
+protected:
+	struct FreeNode {
+		FreeNode* next;
+	};
+
+	void addSlab();
+	void* pop();
+	void push(void* ptr);
+
+	const size_t object_size;
+	const size_t objects_per_slab;
+	const bool synchronized;
+
+	mutable std::mutex mutex;
+	std::vector<uint8_t*> slabs; // Sorted by address
+	FreeNode* free_list;
+
+	size_t live;
+	size_t peak;
+	uint64_t allocations;
+	uint64_t releases;
+};
+
+#endif
@@ -0,0 +1,218 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "memory_window.h"
+
+#include "gui.h"
+#include "editor.h"
+#include "map.h"
+#include "map_tab.h"
+#include "action.h"
+#include "tile.h"
+#include "item.h"
+#include "minimap_window.h"
+
+#include <wx/ffile.h>
+
+namespace {
+	wxString formatKB(uint64_t bytes) {
+		return wxString::Format("%llu KB", static_cast<unsigned long long>((bytes + 1023) / 1024));
+	}
+}
+
+std::vector<MemoryUsageEntry> MemoryReport::collect() {
+	std::vector<MemoryUsageEntry> entries;
+	auto add = [&entries](const std::string& category, uint64_t objects, uint64_t bytes, uint64_t reserved, bool in_total) {
+		entries.push_back({ category, objects, bytes, reserved, in_total });
+	};
+	auto add_pool = [&add](const std::string& category, const MemoryPoolStats& stats) {
+		add(category, stats.live, stats.used_bytes, stats.reserved_bytes, true);
+	};
+
+	// Tiles and items come from program wide pools, so these cover every map, the undo history and the copy buffer
+	add_pool("Tiles", Tile::getPoolStats());
+	add_pool("Items", Item::getPoolStats());
+
+	const size_t attribute_maps = ItemAttributeMap::getLiveCount();
+	const size_t attribute_bytes = attribute_maps * sizeof(ItemAttributeMap) + ItemAttributeMap::getLiveEntries() * sizeof(ItemAttributeMap::value_type);
+	add("Item attributes", ItemAttributeMap::getLiveEntries(), attribute_bytes, attribute_bytes, true);
+
+	// Several tabs can show the same editor
+	std::set<Editor*> editors;
+	if (g_gui.tabbook) {
+		for (int i = 0; i < g_gui.tabbook->GetTabCount(); ++i) {
+			auto* mapTab = dynamic_cast<MapTab*>(g_gui.tabbook->GetTab(i));
+			if (mapTab && mapTab->GetEditor()) {
+				editors.insert(mapTab->GetEditor());
+			}
+		}
+	}
+
+	MemoryPoolStats node_stats;
+	MemoryPoolStats floor_stats;
+	uint64_t index_bytes = 0;
+	uint64_t undo_actions = 0;
+	uint64_t undo_bytes = 0;
+	for (Editor* editor : editors) {
+		const Map& map = editor->map;
+		node_stats += map.allocator.getNodeStats();
+		floor_stats += map.allocator.getFloorStats();
+		if (const MapChunkIndex* chunk_index = map.getChunkIndex()) {
+			index_bytes += chunk_index->memsize();
+		}
+		index_bytes += map.getOccupancy().memsize() + map.getGenerations().memsize();
+
+		if (editor->actionQueue) {
+			undo_actions += editor->actionQueue->size();
+			undo_bytes += editor->actionQueue->memsize();
+		}
+	}
+	add_pool("Map tree nodes", node_stats);
+	add_pool("Map floors", floor_stats);
+	add("Map indexes", editors.size(), index_bytes, index_bytes, true);
+	add("Undo history (in tiles/items)", undo_actions, undo_bytes, undo_bytes, false);
+
+	const size_t copy_bytes = g_gui.copybuffer.memsize();
+	add("Copy buffer (in tiles/items)", g_gui.copybuffer.GetTileCount(), copy_bytes, copy_bytes, false);
+
+	const GraphicManager::MemoryStats gfx_stats = g_gui.gfx.getMemoryStats();
+	add("Sprites", gfx_stats.sprites + gfx_stats.images, gfx_stats.sprites * sizeof(GameSprite), gfx_stats.sprites * sizeof(GameSprite), true);
+	add("Sprite data", gfx_stats.dumps, gfx_stats.dump_bytes, gfx_stats.dump_bytes, true);
+	add("Sprite file (mapped)", gfx_stats.mapped_bytes ? 1 : 0, gfx_stats.mapped_bytes, gfx_stats.mapped_bytes, false);
+	add("Textures", gfx_stats.textures, gfx_stats.texture_bytes, gfx_stats.texture_bytes, true);
+	add("Texture atlas (in sprites)", gfx_stats.atlas_sprites, gfx_stats.atlas_bytes, gfx_stats.atlas_bytes, true);
+	add("Software sprites", gfx_stats.software_sprites, 0, 0, true);
+	// Cache counters, the limit rows show the budget as reserved space
+	auto add_cache = [&add](const std::string& name, const GraphicManager::CacheStats& cache, uint64_t bytes, uint64_t budget) {
+		add(name + " limit", 0, bytes, budget, false);
+		add(name + " hits", cache.hits, 0, 0, false);
+		add(name + " misses", cache.misses, 0, 0, false);
+		add(name + " evictions", cache.evictions, 0, 0, false);
+	};
+	add_cache("Texture cache", gfx_stats.texture_cache, gfx_stats.texture_bytes + gfx_stats.atlas_bytes, gfx_stats.texture_budget);
+	add_cache("Sprite cache", gfx_stats.dump_cache, gfx_stats.dump_bytes, gfx_stats.dump_budget);
+
+	if (g_gui.minimap) {
+		const size_t blocks = g_gui.minimap->getCachedBlockCount();
+		const uint64_t block_bytes = uint64_t(blocks) * MinimapWindow::BLOCK_SIZE * MinimapWindow::BLOCK_SIZE * 4;
+		add("Minimap cache", blocks, block_bytes, block_bytes, true);
+	}
+
+	uint64_t total_bytes = 0;
+	uint64_t total_reserved = 0;
+	for (const MemoryUsageEntry& entry : entries) {
+		if (entry.in_total) {
+			total_bytes += entry.bytes;
+			total_reserved += entry.reserved;
+		}
+	}
+	add("Total", 0, total_bytes, total_reserved, false);
+	return entries;
+}
+
+std::string MemoryReport::format(const std::vector<MemoryUsageEntry>& entries) {
+	std::ostringstream os;
+	os << "Category\tObjects\tIn use (KB)\tReserved (KB)\n";
+	for (const MemoryUsageEntry& entry : entries) {
+		os << entry.category << "\t" << entry.objects << "\t" << (entry.bytes + 1023) / 1024 << "\t" << (entry.reserved + 1023) / 1024 << "\n";
+	}
+	return os.str();
+}
+
+BEGIN_EVENT_TABLE(MemoryWindow, wxPanel)
+EVT_TIMER(wxID_ANY, MemoryWindow::OnRefreshTimer)
+EVT_BUTTON(wxID_REFRESH, MemoryWindow::OnClickRefresh)
+EVT_BUTTON(wxID_FILE, MemoryWindow::OnClickExport)
+END_EVENT_TABLE()
+
+MemoryWindow::MemoryWindow(wxWindow* parent) :
+	wxPanel(parent, wxID_ANY),
+	refresh_timer(this) {
+	wxSizer* main_sizer = newd wxBoxSizer(wxVERTICAL);
+
+	usage_list = newd wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxSize(420, 320), wxLC_REPORT | wxLC_SINGLE_SEL);
+	usage_list->InsertColumn(0, "Category", wxLIST_FORMAT_LEFT, 190);
+	usage_list->InsertColumn(1, "Objects", wxLIST_FORMAT_RIGHT, 70);
+	usage_list->InsertColumn(2, "In use", wxLIST_FORMAT_RIGHT, 80);
+	usage_list->InsertColumn(3, "Reserved", wxLIST_FORMAT_RIGHT, 80);
+	main_sizer->Add(usage_list, 1, wxEXPAND | wxALL, 5);
+
+	wxSizer* button_sizer = newd wxBoxSizer(wxHORIZONTAL);
+	live_checkbox = newd wxCheckBox(this, wxID_ANY, "Live");
+	live_checkbox->SetValue(true);
+	live_checkbox->SetToolTip("Refresh every second while the window is visible.");
+	button_sizer->Add(live_checkbox, 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+	button_sizer->Add(newd wxButton(this, wxID_REFRESH, "Refresh"), 0, wxALL, 5);
+	button_sizer->Add(newd wxButton(this, wxID_FILE, "Export"), 0, wxALL, 5);
+	main_sizer->Add(button_sizer, 0, wxCENTER | wxALL, 5);
+
+	SetSizerAndFit(main_sizer);
+
+	RefreshReport();
+	refresh_timer.Start(1000);
+}
+
+MemoryWindow::~MemoryWindow() {
+	refresh_timer.Stop();
+}
+
+void MemoryWindow::RefreshReport() {
+	const std::vector<MemoryUsageEntry> entries = MemoryReport::collect();
+
+	usage_list->Freeze();
+	if (usage_list->GetItemCount() != static_cast<int>(entries.size())) {
+		usage_list->DeleteAllItems();
+		for (size_t i = 0; i < entries.size(); ++i) {
+			usage_list->InsertItem(i, wxstr(entries[i].category));
+		}
+	}
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const MemoryUsageEntry& entry = entries[i];
+		usage_list->SetItem(i, 0, wxstr(entry.category));
+		usage_list->SetItem(i, 1, entry.objects > 0 ? wxString::Format("%llu", static_cast<unsigned long long>(entry.objects)) : wxString());
+		usage_list->SetItem(i, 2, formatKB(entry.bytes));
+		usage_list->SetItem(i, 3, formatKB(entry.reserved));
+	}
+	usage_list->Thaw();
+}
+
+void MemoryWindow::OnRefreshTimer(wxTimerEvent& WXUNUSED(event)) {
+	if (live_checkbox->GetValue() && IsShownOnScreen()) {
+		RefreshReport();
+	}
+}
+
+void MemoryWindow::OnClickRefresh(wxCommandEvent& WXUNUSED(event)) {
+	RefreshReport();
+}
+
+void MemoryWindow::OnClickExport(wxCommandEvent& WXUNUSED(event)) {
+	wxFileDialog dialog(this, "Export memory report", "", "memory_report.txt", "Text files (*.txt)|*.txt", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if (dialog.ShowModal() != wxID_OK) {
+		return;
+	}
+
+	wxFFile file(dialog.GetPath(), "w");
+	if (!file.IsOpened()) {
+		g_gui.PopupDialog(this, "Error", "Could not open " + dialog.GetPath() + " for writing.", wxOK);
+		return;
+	}
+	file.Write(wxstr(MemoryReport::format(MemoryReport::collect())));
+	file.Close();
+}
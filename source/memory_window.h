@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MEMORY_WINDOW_H_
+#define RME_MEMORY_WINDOW_H_
+
+#include "main.h"
+
+#include <wx/listctrl.h>
+
+// One line of the memory breakdown
+struct MemoryUsageEntry {
+	std::string category;
+	uint64_t objects;
+	uint64_t bytes; // Held by live objects
+	uint64_t reserved; // Held in total, including free pool space
+	bool in_total; // False for rows that are already part of another row
+};
+
+// Gathers the counters kept by the pools, map structures, graphics, undo history, copy buffer and minimap
+class MemoryReport {
+public:
+	static std::vector<MemoryUsageEntry> collect();
+	// Plain text table of the entries
+	static std::string format(const std::vector<MemoryUsageEntry>& entries);
+};
+
+// Dockable panel listing MemoryReport::collect(), refreshed every second while visible
+class MemoryWindow : public wxPanel {
+public:
+	MemoryWindow(wxWindow* parent);
+	virtual ~MemoryWindow();
+
+	void RefreshReport();
+
+	void OnRefreshTimer(wxTimerEvent& event);
+	void OnClickRefresh(wxCommandEvent& event);
+	void OnClickExport(wxCommandEvent& event);
+
+protected:
+	wxListCtrl* usage_list;
+	wxCheckBox* live_checkbox;
+	wxTimer refresh_timer;
+
+	DECLARE_EVENT_TABLE()
+};
+
+#endif
@@ -0,0 +1,208 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "metadata_cache.h"
+#include "client_version.h"
+#include "graphics.h"
+#include "items.h"
+
+namespace {
+	const char METADATA_CACHE_IDENTIFIER[] = "RMDC";
+	const uint32_t METADATA_CACHE_END = 0x444E4521; // Written last, a file without it was cut short
+
+	uint64_t mixKey(uint64_t key, uint64_t value) {
+		key = (key ^ value) * 1099511628211ULL;
+		return key ^ (key >> 29);
+	}
+}
+
+MetadataCache::MetadataCache(const ClientVersion& version, const GraphicManager& gfx, const FileName& data_path) :
+	key_valid(false),
+	key(14695981039346656037ULL) {
+	FileName cache_file = version.getLocalDataPath();
+	cache_file.SetFullName(wxString::Format("metadata_%d.cache", version.getID()));
+	path = nstr(cache_file.GetFullPath());
+
+	const wxString data_dir = data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR);
+	uint64_t dat_hash, otb_hash, xml_hash;
+	uint32_t dat_signature, unused;
+	if (!hashFile(gfx.getMetadataFileName(), dat_hash, dat_signature) || !hashFile(FileName(data_dir + "items.otb"), otb_hash, unused)) {
+		return;
+	}
+	// A missing items.xml only gives a warning, which is cached like any other
+	if (!hashFile(FileName(data_dir + "items.xml"), xml_hash, unused)) {
+		xml_hash = 0;
+	}
+
+	key = mixKey(key, VERSION);
+	key = mixKey(key, version.getID());
+	key = mixKey(key, version.getDatFormatForSignature(dat_signature));
+	key = mixKey(key, gfx.otfi_found | (gfx.is_extended << 1) | (gfx.has_transparency << 2) | (gfx.has_frame_durations << 3) | (gfx.has_frame_groups << 4));
+	key = mixKey(key, dat_hash);
+	key = mixKey(key, otb_hash);
+	key = mixKey(key, xml_hash);
+	key_valid = true;
+}
+
+MetadataCache::~MetadataCache() {
+	////
+}
+
+bool MetadataCache::hashFile(const FileName& filename, uint64_t& hash, uint32_t& signature) {
+	MappedFileReadHandle file(nstr(filename.GetFullPath()), true);
+	if (!file.isOk() || file.size() < sizeof(signature)) {
+		return false;
+	}
+
+	const uint8_t* data = file.data();
+	const size_t size = file.size();
+	memcpy(&signature, data, sizeof(signature));
+
+	// A multiply and xor-shift per 8 byte word (mixKey, seeded with the FNV offset basis but not FNV-1a),
+	// the files are hashed on every load so this has to keep up with the disk
+	hash = 14695981039346656037ULL ^ size;
+	size_t offset = 0;
+	for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + offset, sizeof(word));
+		hash = mixKey(hash, word);
+	}
+	for (; offset < size; ++offset) {
+		hash = mixKey(hash, data[offset]);
+	}
+	return true;
+}
+
+bool MetadataCache::open() {
+	if (!key_valid) {
+		return false;
+	}
+
+	file.reset(newd FileReadHandle(path));
+	if (!file->isOk()) {
+		file.reset();
+		return false;
+	}
+
+	uint8_t identifier[4];
+	uint64_t stored_key;
+	if (!file->getRAW(identifier, 4) || memcmp(identifier, METADATA_CACHE_IDENTIFIER, 4) != 0 || !file->getU64(stored_key) || stored_key != key) {
+		file.reset();
+		return false;
+	}
+
+	// A file cut short is turned down here, before anything has been loaded from it
+	const size_t start = file->tell();
+	uint32_t end_marker;
+	if (file->size() < start + sizeof(end_marker) || !file->seek(file->size() - sizeof(end_marker)) || !file->getU32(end_marker) || end_marker != METADATA_CACHE_END || !file->seek(start)) {
+		file.reset();
+		return false;
+	}
+	return true;
+}
+
+bool MetadataCache::loadSprites(GraphicManager& gfx, wxArrayString& warnings) {
+	if (!file) {
+		return false;
+	}
+	wxArrayString cached_warnings;
+	if (!readWarnings(*file, cached_warnings) || !gfx.loadSpriteMetadataCache(*file)) {
+		// Drop the sprites loaded so far, the items can't be read either as the read position is lost
+		gfx.clear();
+		file.reset();
+		return false;
+	}
+	for (const wxString& warning : cached_warnings) {
+		warnings.push_back(warning);
+	}
+	return true;
+}
+
+bool MetadataCache::loadItems(ItemDatabase& items, wxArrayString& warnings) {
+	if (!file) {
+		return false;
+	}
+	wxArrayString cached_warnings;
+	uint32_t end_marker;
+	const bool loaded = readWarnings(*file, cached_warnings) && items.loadFromCache(*file) && file->getU32(end_marker) && end_marker == METADATA_CACHE_END;
+	file.reset();
+	if (!loaded) {
+		items.clear();
+		return false;
+	}
+	for (const wxString& warning : cached_warnings) {
+		warnings.push_back(warning);
+	}
+	return true;
+}
+
+bool MetadataCache::save(const GraphicManager& gfx, const wxArrayString& sprite_warnings, ItemDatabase& items, const wxArrayString& item_warnings) {
+	if (!key_valid) {
+		return false;
+	}
+
+	// Written next to the old cache and moved over it once complete
+	const std::string temp_path = path + ".tmp";
+	{
+		FileWriteHandle f(temp_path);
+		if (!f.isOk()) {
+			return false;
+		}
+
+		f.addRAW(reinterpret_cast<const uint8_t*>(METADATA_CACHE_IDENTIFIER), 4);
+		f.addU64(key);
+		writeWarnings(f, sprite_warnings);
+		gfx.saveSpriteMetadataCache(f);
+		writeWarnings(f, item_warnings);
+		items.saveToCache(f);
+		f.addU32(METADATA_CACHE_END);
+
+		const bool ok = f.isOk();
+		f.close();
+		if (!ok) {
+			std::remove(temp_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+bool MetadataCache::readWarnings(FileReadHandle& file, wxArrayString& warnings) {
+	uint32_t count;
+	if (!file.getU32(count)) {
+		return false;
+	}
+	std::string warning;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (!file.getLongString(warning)) {
+			return false;
+		}
+		warnings.push_back(wxstr(warning));
+	}
+	return true;
+}
+
+void MetadataCache::writeWarnings(FileWriteHandle& file, const wxArrayString& warnings) {
+	file.addU32(warnings.size());
+	for (const wxString& warning : warnings) {
+		file.addLongString(nstr(warning));
+	}
+}
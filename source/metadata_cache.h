@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_METADATA_CACHE_H_
+#define RME_METADATA_CACHE_H_
+
+#include "filehandle.h"
+
+class ClientVersion;
+class GraphicManager;
+class ItemDatabase;
+
+// Binary copy of the parsed client metadata: the sprite info from the .dat and the item types
+// from items.otb and items.xml. A client version that was loaded before is restored from it with
+// a few large reads instead of running the parsers. The cache is keyed by hashes of the files it
+// was built from and is rebuilt as soon as any of them changes.
+class MetadataCache {
+public:
+	static const uint32_t VERSION = 1;
+
+	// The otfi file has to be loaded already, it decides which .dat is used and how it is read
+	MetadataCache(const ClientVersion& version, const GraphicManager& gfx, const FileName& data_path);
+	~MetadataCache();
+
+	// Checks the cache against the current files, the sections are then loaded in order
+	bool open();
+	bool loadSprites(GraphicManager& gfx, wxArrayString& warnings);
+	bool loadItems(ItemDatabase& items, wxArrayString& warnings);
+
+	// Stores what was just parsed, along with the warnings so a cached load reports them too
+	bool save(const GraphicManager& gfx, const wxArrayString& sprite_warnings, ItemDatabase& items, const wxArrayString& item_warnings);
+
+protected:
+	// Hashes the whole file, the first four bytes are handed back as well
+	static bool hashFile(const FileName& filename, uint64_t& hash, uint32_t& signature);
+	static bool readWarnings(FileReadHandle& file, wxArrayString& warnings);
+	static void writeWarnings(FileWriteHandle& file, const wxArrayString& warnings);
+
+	std::string path;
+	bool key_valid;
+	uint64_t key;
+	std::unique_ptr<FileReadHandle> file;
+};
+
+#endif
@@ -474,12 +474,17 @@ void MinimapWindow::OnPaint(wxPaintEvent& event) {
 			BlockKey key{bx, by, floor};
 			wxBitmap* bmp = nullptr;
 			auto it = block_cache.find(key);
+			if (it != block_cache.end() && editor.map.getGenerations().hasChangedSince(bx * BLOCK_SIZE, by * BLOCK_SIZE, (bx + 1) * BLOCK_SIZE - 1, (by + 1) * BLOCK_SIZE - 1, floor, it->second.generation)) {
+				block_cache.erase(it);
+				it = block_cache.end();
+			}
 			if (it != block_cache.end()) {
-				bmp = &it->second;
+				bmp = &it->second.bitmap;
 			} else if (IsBlockFilled(bx, by, floor)) {
-				wxBitmap rendered = RenderBlock(bx, by, floor);
-				block_cache[key] = rendered;
-				bmp = &block_cache[key];
+				CachedBlock& block = block_cache[key];
+				block.generation = editor.map.getGeneration();
+				block.bitmap = RenderBlock(bx, by, floor);
+				bmp = &block.bitmap;
 			}
 			if (bmp) {
 				int drawX = bx * BLOCK_SIZE - startX;
@@ -789,8 +794,7 @@ void MinimapWindow::CacheFilledBlocksForFloor(int floor) {
 	for (int by = 0; by < numBlocksY; ++by) {
 		for (int bx = 0; bx < numBlocksX; ++bx) {
 			if (IsBlockFilled(bx, by, floor)) {
-				wxBitmap bmp = RenderBlock(bx, by, floor);
-				block_cache[{bx, by, floor}] = bmp;
+				block_cache[{bx, by, floor}] = { RenderBlock(bx, by, floor), editor.map.getGeneration() };
 			}
 			doneBlocks++;
 			int percent = int((doneBlocks / (double)totalBlocks) * 100.0);
@@ -811,7 +815,7 @@ void MinimapWindow::SaveBlockCacheToDisk(int floor) {
 		wxString filePath = cacheDir + wxFileName::GetPathSeparator() + fileName;
 		wxFFile file(filePath, "wb");
 		if (!file.IsOpened()) continue;
-		wxImage img = pair.second.ConvertToImage();
+		wxImage img = pair.second.bitmap.ConvertToImage();
 		for (int y = 0; y < BLOCK_SIZE; ++y) {
 			for (int x = 0; x < BLOCK_SIZE; ++x) {
 				unsigned char r = img.GetRed(x, y);
@@ -838,6 +842,8 @@ void MinimapWindow::SaveBlockCacheToDisk(int floor) {
 }
 
 void MinimapWindow::LoadBlockCacheFromDisk(int floor) {
+	// Blocks on disk match the map as it is now, anything edited from here on redraws them
+	const uint64_t generation = g_gui.IsEditorOpen() ? g_gui.GetCurrentEditor()->map.getGeneration() : 0;
 	wxString dataDir = g_gui.GetDataDirectory();
 	wxString mapName = GetCurrentMapName();
 	wxString cacheDir = dataDir + wxFileName::GetPathSeparator() + "cachedmaps" + wxFileName::GetPathSeparator() + mapName;
@@ -859,7 +865,7 @@ void MinimapWindow::LoadBlockCacheFromDisk(int floor) {
 						img.SetRGB(x, y, minimap_color[idx].red, minimap_color[idx].green, minimap_color[idx].blue);
 					}
 				}
-				block_cache[{bx, by, z}] = wxBitmap(img);
+				block_cache[{bx, by, z}] = { wxBitmap(img), generation };
 			}
 		}
 		file.Close();
@@ -872,11 +878,23 @@ bool MinimapWindow::IsBlockFilled(int bx, int by, int floor) {
 	Editor& editor = *g_gui.GetCurrentEditor();
 	int startX = bx * BLOCK_SIZE;
 	int startY = by * BLOCK_SIZE;
-	for (int y = 0; y < BLOCK_SIZE; ++y) {
-		for (int x = 0; x < BLOCK_SIZE; ++x) {
-			Tile* tile = editor.map.getTile(startX + x, startY + y, floor);
-			if (tile && tile->getMiniMapColor()) {
-				return true;
+	if (editor.map.isAreaEmpty(startX, startY, startX + BLOCK_SIZE - 1, startY + BLOCK_SIZE - 1, floor)) {
+		return false;
+	}
+
+	const MapOccupancy& occupancy = editor.map.getOccupancy();
+	for (int cy = 0; cy < BLOCK_SIZE; cy += MapOccupancy::CHUNK_SIZE) {
+		for (int cx = 0; cx < BLOCK_SIZE; cx += MapOccupancy::CHUNK_SIZE) {
+			if (occupancy.isAreaEmpty(startX + cx, startY + cy, startX + cx + MapOccupancy::CHUNK_SIZE - 1, startY + cy + MapOccupancy::CHUNK_SIZE - 1, floor)) {
+				continue;
+			}
+			for (int y = cy; y < cy + MapOccupancy::CHUNK_SIZE; ++y) {
+				for (int x = cx; x < cx + MapOccupancy::CHUNK_SIZE; ++x) {
+					Tile* tile = editor.map.getTile(startX + x, startY + y, floor);
+					if (tile && tile->getMiniMapColor()) {
+						return true;
+					}
+				}
 			}
 		}
 	}
@@ -892,14 +910,23 @@ wxBitmap MinimapWindow::RenderBlock(int bx, int by, int floor) {
 	dc.Clear();
 	int startX = bx * BLOCK_SIZE;
 	int startY = by * BLOCK_SIZE;
-	for (int y = 0; y < BLOCK_SIZE; ++y) {
-		for (int x = 0; x < BLOCK_SIZE; ++x) {
-			Tile* tile = editor.map.getTile(startX + x, startY + y, floor);
-			if (tile) {
-				uint8_t color = tile->getMiniMapColor();
-				if (color) {
-					dc.SetPen(*pens[color]);
-					dc.DrawPoint(x, y);
+	const MapOccupancy& occupancy = editor.map.getOccupancy();
+	for (int cy = 0; cy < BLOCK_SIZE; cy += MapOccupancy::CHUNK_SIZE) {
+		for (int cx = 0; cx < BLOCK_SIZE; cx += MapOccupancy::CHUNK_SIZE) {
+			// Nothing to draw in chunks without tiles, the background is already black
+			if (occupancy.isAreaEmpty(startX + cx, startY + cy, startX + cx + MapOccupancy::CHUNK_SIZE - 1, startY + cy + MapOccupancy::CHUNK_SIZE - 1, floor)) {
+				continue;
+			}
+			for (int y = cy; y < cy + MapOccupancy::CHUNK_SIZE; ++y) {
+				for (int x = cx; x < cx + MapOccupancy::CHUNK_SIZE; ++x) {
+					Tile* tile = editor.map.getTile(startX + x, startY + y, floor);
+					if (tile) {
+						uint8_t color = tile->getMiniMapColor();
+						if (color) {
+							dc.SetPen(*pens[color]);
+							dc.DrawPoint(x, y);
+						}
+					}
 				}
 			}
 		}
@@ -55,6 +55,10 @@ public:
 	void OnKey(wxKeyEvent& event);
 
 	void ClearCache();
+	// Rendered blocks held in the block cache, for the memory window
+	size_t getCachedBlockCount() const {
+		return block_cache.size() + m_blocks.size();
+	}
 	
 	// Pre-cache method for building the entire minimap at load time
 	void PreCacheEntireMap();
@@ -181,7 +185,12 @@ private:
 			return by < other.by;
 		}
 	};
-	std::map<BlockKey, wxBitmap> block_cache;
+	// Blocks remember the map generation they were rendered at and get redrawn once their area moves past it
+	struct CachedBlock {
+		wxBitmap bitmap;
+		uint64_t generation;
+	};
+	std::map<BlockKey, CachedBlock> block_cache;
 
 	// UI: Save cache to disk checkbox
 	wxCheckBox* save_cache_checkbox = nullptr;
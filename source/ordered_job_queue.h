@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_ORDERED_JOB_QUEUE_H_
+#define RME_ORDERED_JOB_QUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a pool of threads. Jobs are handed back in the order they were
+// queued, so the results can be applied as if they had been done one by one.
+// finished, if set, is called on a worker thread for every job in queue order, as soon as
+// the job and all jobs before it are done. It runs with the queue locked, keep it short.
+template <typename Job>
+class OrderedJobQueue {
+public:
+	OrderedJobQueue(int thread_count, std::function<void(Job&)> work, std::function<void(Job&)> finished = nullptr) :
+		work(std::move(work)),
+		finished(std::move(finished)),
+		finished_count(0),
+		stopping(false) {
+		for (int i = 0; i < thread_count; ++i) {
+			threads.emplace_back(&OrderedJobQueue::run, this);
+		}
+	}
+	~OrderedJobQueue() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		work_available.notify_all();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	OrderedJobQueue(const OrderedJobQueue&) = delete;
+	OrderedJobQueue& operator=(const OrderedJobQueue&) = delete;
+
+	void push(std::unique_ptr<Job> job) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			slots.emplace_back(newd Slot { std::move(job), false });
+			waiting.push_back(slots.back().get());
+		}
+		work_available.notify_one();
+	}
+
+	// Returns the oldest job once it's done, or nullptr if there is none.
+	// Without wait, also returns nullptr if it's still being worked on.
+	std::unique_ptr<Job> pop(bool wait) {
+		std::unique_lock<std::mutex> guard(lock);
+		if (slots.empty()) {
+			return nullptr;
+		}
+		if (!slots.front()->done) {
+			if (!wait) {
+				return nullptr;
+			}
+			work_done.wait(guard, [this] { return slots.front()->done; });
+		}
+		std::unique_ptr<Job> job = std::move(slots.front()->job);
+		slots.pop_front();
+		// A done job at the front has been finished already
+		--finished_count;
+		return job;
+	}
+
+	// Jobs queued and not popped yet
+	size_t size() {
+		std::lock_guard<std::mutex> guard(lock);
+		return slots.size();
+	}
+
+private:
+	struct Slot {
+		std::unique_ptr<Job> job;
+		bool done;
+	};
+
+	void run() {
+		std::unique_lock<std::mutex> guard(lock);
+		while (true) {
+			work_available.wait(guard, [this] { return stopping || !waiting.empty(); });
+			if (stopping) {
+				return;
+			}
+			Slot* slot = waiting.front();
+			waiting.pop_front();
+			guard.unlock();
+
+			work(*slot->job);
+
+			guard.lock();
+			slot->done = true;
+			// Every job at the front is done up to finished_count, extend that run
+			while (finished_count < slots.size() && slots[finished_count]->done) {
+				if (finished) {
+					finished(*slots[finished_count]->job);
+				}
+				++finished_count;
+			}
+			work_done.notify_all();
+		}
+	}
+
+	std::function<void(Job&)> work;
+	std::function<void(Job&)> finished;
+	std::mutex lock;
+	std::condition_variable work_available;
+	std::condition_variable work_done;
+	std::deque<std::unique_ptr<Slot>> slots; // All queued jobs, in order
+	std::deque<Slot*> waiting; // Jobs no thread has picked up yet
+	size_t finished_count; // Jobs at the front of slots that are done and finished
+	bool stopping;
+	std::vector<std::thread> threads;
+};
+
+#endif
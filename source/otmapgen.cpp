@@ -798,7 +798,7 @@ namespace OTMapGenUtils {
         
         // Remove existing ground
         if (tile->ground) {
-            delete tile->ground;
+            Item::Release(tile->ground);
             tile->ground = nullptr;
         }
         
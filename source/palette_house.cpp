@@ -834,6 +834,7 @@ void EditHouseDialog::OnClickOK(wxCommandEvent& WXUNUSED(event)) {
 		what_house->rent = new_house_rent;
 		what_house->guildhall = guildhall_field->GetValue();
 		what_house->townid = *new_town_id;
+		map->doTrackedChange();
 
 		EndModal(1);
 	}
@@ -257,6 +257,21 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 	use_memcached_chkbox->SetToolTip("Uncheck this to conserve memory.");
 	sizer->Add(use_memcached_chkbox, 0, wxLEFT | wxTOP, 5);
 
+	use_mapped_sprites_chkbox = newd wxCheckBox(graphics_page, wxID_ANY, "Map sprite file into memory");
+	use_mapped_sprites_chkbox->SetValue(g_settings.getBoolean(Config::USE_MAPPED_SPRITES_TO_SAVE));
+	use_mapped_sprites_chkbox->SetToolTip("Read sprites straight from the mapped sprite file, starts fast and takes almost no memory. Overrides caching sprites in memory.");
+	sizer->Add(use_mapped_sprites_chkbox, 0, wxLEFT | wxTOP, 5);
+
+	use_sprite_atlas_chkbox = newd wxCheckBox(graphics_page, wxID_ANY, "Pack sprites into texture atlases");
+	use_sprite_atlas_chkbox->SetValue(g_settings.getBoolean(Config::USE_SPRITE_ATLAS_TO_SAVE));
+	use_sprite_atlas_chkbox->SetToolTip("Draws many sprites per texture switch, much faster when zoomed out over busy areas.");
+	sizer->Add(use_sprite_atlas_chkbox, 0, wxLEFT | wxTOP, 5);
+
+	sprite_prefetch_chkbox = newd wxCheckBox(graphics_page, wxID_ANY, "Decode sprites ahead of scrolling");
+	sprite_prefetch_chkbox->SetValue(g_settings.getBoolean(Config::SPRITE_PREFETCH));
+	sprite_prefetch_chkbox->SetToolTip("Prepares the sprites of the area the view is moving towards in the background, so scrolling into new areas doesn't stutter.");
+	sizer->Add(sprite_prefetch_chkbox, 0, wxLEFT | wxTOP, 5);
+
 	dark_mode_chkbox = newd wxCheckBox(graphics_page, wxID_ANY, "Use dark mode");
 	dark_mode_chkbox->SetValue(g_settings.getBoolean(Config::DARK_MODE));
 	dark_mode_chkbox->SetToolTip("Enable dark mode for the application interface.");
@@ -353,6 +368,17 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 	subsizer->Add(screenshot_format_choice, 0);
 	SetWindowToolTip(screenshot_format_choice, tmp, "This will affect the screenshot format used by the editor.\nTo take a screenshot, press F11.");
 
+	// Cache sizes
+	subsizer->Add(tmp = newd wxStaticText(graphics_page, wxID_ANY, "Texture cache size (MB): "), 0);
+	texture_cache_size_spin = newd wxSpinCtrl(graphics_page, wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CACHE_SIZE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 16, 4096);
+	subsizer->Add(texture_cache_size_spin, 0);
+	SetWindowToolTip(texture_cache_size_spin, tmp, "How much video memory sprite textures may use. The least recently drawn sprites are unloaded when it runs out.");
+
+	subsizer->Add(tmp = newd wxStaticText(graphics_page, wxID_ANY, "Sprite cache size (MB): "), 0);
+	sprite_cache_size_spin = newd wxSpinCtrl(graphics_page, wxID_ANY, i2ws(g_settings.getInteger(Config::SPRITE_CACHE_SIZE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 4096);
+	subsizer->Add(sprite_cache_size_spin, 0);
+	SetWindowToolTip(sprite_cache_size_spin, tmp, "How much memory sprite data read from the sprite file may use. Has no effect with memcached or mapped sprites.");
+
 	sizer->Add(subsizer, 1, wxEXPAND | wxALL, 5);
 
 	// Advanced g_settings
@@ -370,21 +396,6 @@ wxNotebookPage* PreferencesWindow::CreateGraphicsPage() {
 		wxFlexGridSizer* pane_grid_sizer = newd wxFlexGridSizer(2, 10, 10);
 		pane_grid_sizer->AddGrowableCol(1);
 
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture clean interval: "), 0);
-		clean_interval_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 0x1000000);
-		pane_grid_sizer->Add(clean_interval_spin, 0);
-		SetWindowToolTip(clean_interval_spin, tmp, "This controls how often the editor tries to free hardware texture resources.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture longevity: "), 0);
-		texture_longevity_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_LONGEVITY)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 0x1000000);
-		pane_grid_sizer->Add(texture_longevity_spin, 0);
-		SetWindowToolTip(texture_longevity_spin, tmp, "This controls for how long (in seconds) that the editor will keep textures in memory before it cleans them up.");
-
-		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Texture clean threshold: "), 0);
-		texture_threshold_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 100, 0x1000000);
-		pane_grid_sizer->Add(texture_threshold_spin, 0);
-		SetWindowToolTip(texture_threshold_spin, tmp, "This controls how many textures the editor will hold in memory before it attempts to clean up old textures. However, an infinite amount MIGHT be loaded.");
-
 		pane_grid_sizer->Add(tmp = newd wxStaticText(pane->GetPane(), wxID_ANY, "Software clean threshold: "), 0);
 		software_threshold_spin = newd wxSpinCtrl(pane->GetPane(), wxID_ANY, i2ws(g_settings.getInteger(Config::SOFTWARE_CLEAN_THRESHOLD)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 100, 0x1000000);
 		pane_grid_sizer->Add(software_threshold_spin, 0);
@@ -972,6 +983,17 @@ void PreferencesWindow::Apply() {
 		must_restart = true;
 	}
 	g_settings.setInteger(Config::USE_MEMCACHED_SPRITES_TO_SAVE, use_memcached_chkbox->GetValue());
+	if (g_settings.getBoolean(Config::USE_MAPPED_SPRITES) != use_mapped_sprites_chkbox->GetValue()) {
+		must_restart = true;
+	}
+	g_settings.setInteger(Config::USE_MAPPED_SPRITES_TO_SAVE, use_mapped_sprites_chkbox->GetValue());
+	if (g_settings.getBoolean(Config::USE_SPRITE_ATLAS) != use_sprite_atlas_chkbox->GetValue()) {
+		must_restart = true;
+	}
+	g_settings.setInteger(Config::USE_SPRITE_ATLAS_TO_SAVE, use_sprite_atlas_chkbox->GetValue());
+	g_settings.setInteger(Config::SPRITE_PREFETCH, sprite_prefetch_chkbox->GetValue());
+	g_settings.setInteger(Config::TEXTURE_CACHE_SIZE, texture_cache_size_spin->GetValue());
+	g_settings.setInteger(Config::SPRITE_CACHE_SIZE, sprite_cache_size_spin->GetValue());
 	if (icon_background_choice->GetSelection() == 0) {
 		if (g_settings.getInteger(Config::ICON_BACKGROUND) != 0) {
 			g_gui.gfx.cleanSoftwareSprites();
@@ -1043,9 +1065,6 @@ void PreferencesWindow::Apply() {
 	g_settings.setInteger(Config::HIDE_ITEMS_WHEN_ZOOMED, hide_items_when_zoomed_chkbox->GetValue());
 	/*
 	g_settings.setInteger(Config::TEXTURE_MANAGEMENT, texture_managment_chkbox->GetValue());
-	g_settings.setInteger(Config::TEXTURE_CLEAN_PULSE, clean_interval_spin->GetValue());
-	g_settings.setInteger(Config::TEXTURE_LONGEVITY, texture_longevity_spin->GetValue());
-	g_settings.setInteger(Config::TEXTURE_CLEAN_THRESHOLD, texture_threshold_spin->GetValue());
 	g_settings.setInteger(Config::SOFTWARE_CLEAN_THRESHOLD, software_threshold_spin->GetValue());
 	g_settings.setInteger(Config::SOFTWARE_CLEAN_SIZE, software_clean_amount_spin->GetValue());
 	*/
@@ -76,6 +76,11 @@ protected:
 	wxCheckBox* icon_selection_shadow_chkbox;
 	wxChoice* icon_background_choice;
 	wxCheckBox* use_memcached_chkbox;
+	wxCheckBox* use_mapped_sprites_chkbox;
+	wxCheckBox* use_sprite_atlas_chkbox;
+	wxCheckBox* sprite_prefetch_chkbox;
+	wxSpinCtrl* texture_cache_size_spin;
+	wxSpinCtrl* sprite_cache_size_spin;
 	wxDirPickerCtrl* screenshot_directory_picker;
 	wxChoice* screenshot_format_choice;
 	wxCheckBox* hide_items_when_zoomed_chkbox;
@@ -86,9 +91,6 @@ protected:
 	wxColourPickerCtrl* dark_mode_color_pick;
 	/*
 	wxCheckBox* texture_managment_chkbox;
-	wxSpinCtrl* clean_interval_spin;
-	wxSpinCtrl* texture_longevity_spin;
-	wxSpinCtrl* texture_threshold_spin;
 	wxSpinCtrl* software_threshold_spin;
 	wxSpinCtrl* software_clean_amount_spin;
 	*/
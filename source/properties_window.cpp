@@ -150,12 +150,19 @@ wxWindow* PropertiesWindow::createAttributesPanel(wxWindow* parent) {
 	attributesGrid->SetColLabelValue(2, "Value");
 	attributesGrid->SetColSize(2, 410);
 
-	// contents
+	// contents, listed by name as the map is ordered by key id
 	ItemAttributeMap attrs = edit_item->getAttributes();
-	attributesGrid->AppendRows(attrs.size());
+	std::vector<std::pair<std::string, const ItemAttribute*>> sorted;
+	sorted.reserve(attrs.size());
+	for (ItemAttributeMap::iterator aiter = attrs.begin(); aiter != attrs.end(); ++aiter) {
+		sorted.emplace_back(ItemAttributeNames::name(aiter->first), &aiter->second);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	attributesGrid->AppendRows(sorted.size());
 	int i = 0;
-	for (ItemAttributeMap::iterator aiter = attrs.begin(); aiter != attrs.end(); ++aiter, ++i) {
-		SetGridValue(attributesGrid, i, aiter->first, aiter->second);
+	for (const auto& entry : sorted) {
+		SetGridValue(attributesGrid, i++, entry.first, *entry.second);
 	}
 
 	wxSizer* optSizer = newd wxBoxSizer(wxHORIZONTAL);
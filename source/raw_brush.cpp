@@ -67,13 +67,13 @@ std::string RAWBrush::getName() const {
 
 void RAWBrush::undraw(BaseMap* map, Tile* tile) {
 	if (tile->ground && tile->ground->getID() == itemtype->id) {
-		delete tile->ground;
+		Item::Release(tile->ground);
 		tile->ground = nullptr;
 	}
 	for (ItemVector::iterator iter = tile->items.begin(); iter != tile->items.end();) {
 		Item* item = *iter;
 		if (item->getID() == itemtype->id) {
-			delete item;
+			Item::Release(item);
 			iter = tile->items.erase(iter);
 		} else {
 			++iter;
@@ -91,7 +91,7 @@ void RAWBrush::draw(BaseMap* map, Tile* tile, void* parameter) {
 		for (ItemVector::iterator iter = tile->items.begin(); iter != tile->items.end();) {
 			Item* item = *iter;
 			if (item->getTopOrder() == itemtype->alwaysOnTopOrder) {
-				delete item;
+				Item::Release(item);
 				iter = tile->items.erase(iter);
 			} else {
 				++iter;
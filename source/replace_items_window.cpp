@@ -585,15 +585,26 @@ void ReplaceItemsDialog::OnExecuteButtonClicked(wxCommandEvent& WXUNUSED(event))
 
 		if (!result.empty()) {
 			Action* action = editor->actionQueue->createAction(ACTION_REPLACE_ITEMS);
-			for (std::vector<std::pair<Tile*, Item*>>::const_iterator rit = result.begin(); rit != result.end(); ++rit) {
-				Tile* new_tile = rit->first->deepCopy(editor->map);
-				int index = rit->first->getIndexOf(rit->second);
-				ASSERT(index != wxNOT_FOUND);
-				Item* item = new_tile->getItemAt(index);
-				ASSERT(item && item->getID() == rit->second->getID());
-				transformItem(item, replaceWithId, new_tile);
+			for (std::vector<std::pair<Tile*, Item*>>::const_iterator rit = result.begin(); rit != result.end();) {
+				// One copy per tile. Results come in stack order and are matched slot by slot,
+				// a shared item can fill several slots so its address alone is ambiguous.
+				Tile* tile = rit->first;
+				Tile* new_tile = tile->deepCopy(editor->map);
+				int index = 0;
+				for (; rit != result.end() && rit->first == tile; ++rit) {
+					int slot = index;
+					while (tile->getItemAt(slot) && tile->getItemAt(slot) != rit->second) {
+						++slot;
+					}
+					Item* item = new_tile->getItemAt(slot);
+					if (item) {
+						ASSERT(item->getID() == rit->second->getID());
+						transformItem(item, replaceWithId, new_tile);
+						index = slot + 1;
+						total++;
+					}
+				}
 				action->addChange(new Change(new_tile));
-				total++;
 			}
 			editor->actionQueue->addAction(action);
 		}
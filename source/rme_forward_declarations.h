@@ -51,7 +51,7 @@ class Brush;
 typedef std::vector<uint32_t> HouseExitList;
 typedef std::vector<Tile*> TileVector;
 typedef std::unordered_set<Tile*> TileSet;
-typedef std::vector<Item*> ItemVector;
+typedef small_vector<Item*, 3> ItemVector; // Most stacks hold 0-3 items, see small_vector.h
 typedef std::vector<Brush*> BrushVector;
 
 #endif
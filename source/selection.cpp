@@ -24,6 +24,19 @@
 #include "editor.h"
 #include "gui.h"
 
+namespace {
+	// The item's twin in a deep copy of its tile. Searched by slot from the top, a shared
+	// item can fill several slots and the item picked on a tile is its top one.
+	Item* getCopiedItem(const Tile* tile, const Tile* copy, const Item* item) {
+		for (int index = int(tile->items.size()) - 1; index >= 0; --index) {
+			if (tile->items[index] == item) {
+				return copy->items[index];
+			}
+		}
+		return tile->ground == item ? copy->ground : nullptr;
+	}
+}
+
 Selection::Selection(Editor& editor) :
 	busy(false),
 	editor(editor),
@@ -80,10 +93,12 @@ void Selection::add(Tile* tile, Item* item) {
 		return;
 	}
 
-	// Make a copy of the tile with the item selected
-	item->select();
+	// Make a copy of the tile and select the item there, the one on the map may be shared
 	Tile* new_tile = tile->deepCopy(editor.map);
-	item->deselect();
+	Item* new_item = getCopiedItem(tile, new_tile, item);
+	if (new_item) {
+		new_item->select();
+	}
 
 	if (g_settings.getInteger(Config::BORDER_IS_GROUND)) {
 		if (item->isBorder()) {
@@ -143,11 +158,10 @@ void Selection::remove(Tile* tile, Item* item) {
 	ASSERT(tile);
 	ASSERT(item);
 
-	bool tmp = item->isSelected();
-	item->deselect();
 	Tile* new_tile = tile->deepCopy(editor.map);
-	if (tmp) {
-		item->select();
+	Item* new_item = getCopiedItem(tile, new_tile, item);
+	if (new_item) {
+		new_item->deselect();
 	}
 	if (item->isBorder() && g_settings.getInteger(Config::BORDER_IS_GROUND)) {
 		new_tile->deselectGround();
@@ -314,15 +328,27 @@ void SelectionThread::Execute() {
 
 wxThread::ExitCode SelectionThread::Entry() {
 	selection.start(Selection::SUBTHREAD);
+	const int chunk_mask = MapOccupancy::CHUNK_SIZE - 1;
 	for (int z = start.z; z >= end.z; --z) {
-		for (int x = start.x; x <= end.x; ++x) {
-			for (int y = start.y; y <= end.y; ++y) {
-				Tile* tile = editor.map.getTile(x, y, z);
-				if (!tile) {
+		// Walk the box in occupancy chunks so empty parts of large selections cost nothing
+		for (int chunk_x = start.x; chunk_x <= end.x; chunk_x = (chunk_x | chunk_mask) + 1) {
+			const int last_x = std::min(chunk_x | chunk_mask, end.x);
+			for (int chunk_y = start.y; chunk_y <= end.y; chunk_y = (chunk_y | chunk_mask) + 1) {
+				const int last_y = std::min(chunk_y | chunk_mask, end.y);
+				if (editor.map.isAreaEmpty(chunk_x, chunk_y, last_x, last_y, z)) {
 					continue;
 				}
 
-				selection.add(tile);
+				for (int x = chunk_x; x <= last_x; ++x) {
+					for (int y = chunk_y; y <= last_y; ++y) {
+						Tile* tile = editor.map.getTile(x, y, z);
+						if (!tile) {
+							continue;
+						}
+
+						selection.add(tile);
+					}
+				}
 			}
 		}
 		if (z <= GROUND_LAYER && g_settings.getInteger(Config::COMPENSATED_SELECT)) {
@@ -290,9 +290,8 @@ void Settings::IO(IOMode mode) {
 
 	section("Graphics");
 	Int(TEXTURE_MANAGEMENT, 1);
-	Int(TEXTURE_CLEAN_PULSE, 15);
-	Int(TEXTURE_LONGEVITY, 20);
-	Int(TEXTURE_CLEAN_THRESHOLD, 2500);
+	Int(TEXTURE_CACHE_SIZE, 256);
+	Int(SPRITE_CACHE_SIZE, 64);
 	Int(SOFTWARE_CLEAN_THRESHOLD, 1800);
 	Int(SOFTWARE_CLEAN_SIZE, 500);
 	Int(ICON_BACKGROUND, 0);
@@ -301,6 +300,9 @@ void Settings::IO(IOMode mode) {
 	String(SCREENSHOT_DIRECTORY, "");
 	String(SCREENSHOT_FORMAT, "png");
 	IntToSave(USE_MEMCACHED_SPRITES, 0);
+	IntToSave(USE_MAPPED_SPRITES, 0);
+	IntToSave(USE_SPRITE_ATLAS, 1);
+	Int(SPRITE_PREFETCH, 1);
 	Int(MINIMAP_UPDATE_DELAY, 333);
 	Int(MINIMAP_VIEW_BOX, 1);
 	String(MINIMAP_EXPORT_DIR, "");
@@ -413,6 +415,16 @@ void Settings::IO(IOMode mode) {
 	Int(GRID_CHUNK_SIZE, 3000);
 	Int(GRID_VISIBLE_ROWS_MARGIN, 30);
 
+	// Map structure settings
+	section("MapStructure");
+	Int(USE_CHUNK_INDEX, 0);
+	Int(CONTIGUOUS_TILE_STORAGE, 0);
+	Int(SHARE_PLAIN_ITEMS, 0);
+	Int(JOURNAL_SAVE, 0);
+	Int(BACKGROUND_SAVE, 0);
+	Int(OTBZ_USE_LZ4, 0);
+	Int(METADATA_CACHE, 1);
+
 #undef section
 #undef Int
 #undef IntToSave
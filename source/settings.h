@@ -31,12 +31,16 @@ namespace Config {
 
 		MERGE_MOVE,
 		TEXTURE_MANAGEMENT,
-		TEXTURE_CLEAN_PULSE,
-		TEXTURE_CLEAN_THRESHOLD,
-		TEXTURE_LONGEVITY,
+		TEXTURE_CACHE_SIZE,
+		SPRITE_CACHE_SIZE,
 		HARD_REFRESH_RATE,
 		USE_MEMCACHED_SPRITES,
 		USE_MEMCACHED_SPRITES_TO_SAVE,
+		USE_MAPPED_SPRITES,
+		USE_MAPPED_SPRITES_TO_SAVE,
+		USE_SPRITE_ATLAS,
+		USE_SPRITE_ATLAS_TO_SAVE,
+		SPRITE_PREFETCH,
 		SOFTWARE_CLEAN_THRESHOLD,
 		SOFTWARE_CLEAN_SIZE,
 		TRANSPARENT_FLOORS,
@@ -227,6 +231,15 @@ namespace Config {
 		// Website link control setting
 		LAST_WEBSITES_OPEN_TIME,
 
+		// Map structure
+		USE_CHUNK_INDEX,
+		CONTIGUOUS_TILE_STORAGE,
+		SHARE_PLAIN_ITEMS,
+		JOURNAL_SAVE,
+		BACKGROUND_SAVE,
+		OTBZ_USE_LZ4,
+		METADATA_CACHE,
+
 		LAST,
 	};
 
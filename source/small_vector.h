@@ -0,0 +1,327 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SMALL_VECTOR_H_
+#define RME_SMALL_VECTOR_H_
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// A vector that keeps the first N elements inline and only goes to the heap
+// once it grows past that. Meant for the item stacks on tiles and containers,
+// which almost always hold a handful of pointers.
+// Elements are moved with memcpy, so this only takes trivially copyable types.
+template <typename T, uint32_t N>
+class small_vector {
+	static_assert(std::is_trivially_copyable<T>::value, "small_vector only holds trivially copyable types");
+	static_assert(N > 0, "small_vector needs at least one inline slot");
+
+public:
+	typedef T value_type;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	static constexpr uint32_t inline_capacity = N;
+
+	small_vector() :
+		count(0), cap(N) { }
+	small_vector(std::initializer_list<T> init) :
+		count(0), cap(N) {
+		insert(end(), init.begin(), init.end());
+	}
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	small_vector(InputIt first, InputIt last) :
+		count(0), cap(N) {
+		insert(end(), first, last);
+	}
+	small_vector(const small_vector& other) :
+		count(0), cap(N) {
+		assign(other.begin(), other.end());
+	}
+	small_vector(small_vector&& other) noexcept :
+		count(0), cap(N) {
+		steal(other);
+	}
+	~small_vector() {
+		release();
+	}
+
+	small_vector& operator=(const small_vector& other) {
+		if (this != &other) {
+			assign(other.begin(), other.end());
+		}
+		return *this;
+	}
+	small_vector& operator=(small_vector&& other) noexcept {
+		if (this != &other) {
+			release();
+			count = 0;
+			cap = N;
+			steal(other);
+		}
+		return *this;
+	}
+
+	template <typename InputIt>
+	void assign(InputIt first, InputIt last) {
+		clear();
+		insert(end(), first, last);
+	}
+
+	// Element access
+	T* data() {
+		return isInline() ? local : heap;
+	}
+	const T* data() const {
+		return isInline() ? local : heap;
+	}
+	T& operator[](size_t index) {
+		return data()[index];
+	}
+	const T& operator[](size_t index) const {
+		return data()[index];
+	}
+	T& at(size_t index) {
+		if (index >= count) {
+			throw std::out_of_range("small_vector::at");
+		}
+		return data()[index];
+	}
+	const T& at(size_t index) const {
+		if (index >= count) {
+			throw std::out_of_range("small_vector::at");
+		}
+		return data()[index];
+	}
+	T& front() {
+		return data()[0];
+	}
+	const T& front() const {
+		return data()[0];
+	}
+	T& back() {
+		return data()[count - 1];
+	}
+	const T& back() const {
+		return data()[count - 1];
+	}
+
+	// Iterators
+	iterator begin() {
+		return data();
+	}
+	const_iterator begin() const {
+		return data();
+	}
+	const_iterator cbegin() const {
+		return data();
+	}
+	iterator end() {
+		return data() + count;
+	}
+	const_iterator end() const {
+		return data() + count;
+	}
+	const_iterator cend() const {
+		return data() + count;
+	}
+	reverse_iterator rbegin() {
+		return reverse_iterator(end());
+	}
+	const_reverse_iterator rbegin() const {
+		return const_reverse_iterator(end());
+	}
+	reverse_iterator rend() {
+		return reverse_iterator(begin());
+	}
+	const_reverse_iterator rend() const {
+		return const_reverse_iterator(begin());
+	}
+
+	// Capacity
+	bool empty() const {
+		return count == 0;
+	}
+	size_t size() const {
+		return count;
+	}
+	size_t capacity() const {
+		return cap;
+	}
+	// True while the elements live inside the object itself
+	bool isInline() const {
+		return cap == N;
+	}
+	// Bytes allocated outside of the object, 0 while inline
+	size_t heapBytes() const {
+		return isInline() ? 0 : cap * sizeof(T);
+	}
+	void reserve(size_t new_cap) {
+		if (new_cap > cap) {
+			reallocate(new_cap);
+		}
+	}
+	void shrink_to_fit() {
+		if (!isInline() && count < cap) {
+			reallocate(count);
+		}
+	}
+
+	// Modifiers
+	void clear() {
+		count = 0;
+	}
+	void push_back(const T& value) {
+		if (count == cap) {
+			const T copy = value; // value may point into our own storage
+			grow(count + 1);
+			data()[count++] = copy;
+		} else {
+			data()[count++] = value;
+		}
+	}
+	template <typename... Args>
+	T& emplace_back(Args&&... args) {
+		push_back(T(std::forward<Args>(args)...));
+		return back();
+	}
+	void pop_back() {
+		--count;
+	}
+	void resize(size_t new_size, const T& value = T()) {
+		if (new_size > count) {
+			const T copy = value;
+			reserve(new_size);
+			std::fill(data() + count, data() + new_size, copy);
+		}
+		count = static_cast<uint32_t>(new_size);
+	}
+
+	iterator insert(const_iterator pos, const T& value) {
+		const size_t index = pos - begin();
+		const T copy = value;
+		if (count == cap) {
+			grow(count + 1);
+		}
+		T* base = data();
+		std::memmove(base + index + 1, base + index, (count - index) * sizeof(T));
+		base[index] = copy;
+		++count;
+		return base + index;
+	}
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	iterator insert(const_iterator pos, InputIt first, InputIt last) {
+		const size_t index = pos - begin();
+		const size_t n = std::distance(first, last);
+		if (n == 0) {
+			return begin() + index;
+		}
+		if (count + n > cap) {
+			grow(count + n);
+		}
+		T* base = data();
+		std::memmove(base + index + n, base + index, (count - index) * sizeof(T));
+		std::copy(first, last, base + index);
+		count += static_cast<uint32_t>(n);
+		return base + index;
+	}
+	iterator erase(const_iterator pos) {
+		return erase(pos, pos + 1);
+	}
+	iterator erase(const_iterator first, const_iterator last) {
+		T* base = data();
+		const size_t index = first - base;
+		const size_t n = last - first;
+		std::memmove(base + index, base + index + n, (count - index - n) * sizeof(T));
+		count -= static_cast<uint32_t>(n);
+		return base + index;
+	}
+	void swap(small_vector& other) {
+		small_vector tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+	bool operator==(const small_vector& other) const {
+		return count == other.count && std::equal(begin(), end(), other.begin());
+	}
+	bool operator!=(const small_vector& other) const {
+		return !(*this == other);
+	}
+
+private:
+	void grow(size_t min_cap) {
+		reallocate(std::max<size_t>(min_cap, size_t(cap) * 2));
+	}
+	void reallocate(size_t new_cap) {
+		T* old = data();
+		if (new_cap <= N) {
+			if (!isInline()) {
+				T* old_heap = heap;
+				std::memcpy(local, old_heap, count * sizeof(T));
+				::operator delete(old_heap);
+				cap = N;
+			}
+			return;
+		}
+		T* fresh = static_cast<T*>(::operator new(new_cap * sizeof(T)));
+		std::memcpy(fresh, old, count * sizeof(T));
+		release();
+		heap = fresh;
+		cap = static_cast<uint32_t>(new_cap);
+	}
+	void release() {
+		if (!isInline()) {
+			::operator delete(heap);
+		}
+	}
+	void steal(small_vector& other) {
+		if (other.isInline()) {
+			std::memcpy(local, other.local, other.count * sizeof(T));
+		} else {
+			heap = other.heap;
+			cap = other.cap;
+			other.cap = N;
+		}
+		count = other.count;
+		other.count = 0;
+	}
+
+	uint32_t count;
+	uint32_t cap;
+	union {
+		T* heap;
+		T local[N];
+	};
+};
+
+#endif
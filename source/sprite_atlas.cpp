@@ -0,0 +1,221 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "sprite_atlas.h"
+
+// Bound to references by std::min and the ternary in getMaxPages, so they need a definition
+const int SpriteAtlas::MAX_PAGE_SIZE;
+const size_t SpriteAtlas::MAX_PAGES;
+
+SpriteAtlas::SpriteAtlas(GLuint (*allocate_texture)()) :
+	allocate_texture(allocate_texture),
+	page_size(0),
+	slots_per_side(0),
+	frame(1),
+	max_bytes(DEFAULT_MAX_BYTES),
+	evictions(0),
+	next_generation(0) {
+	////
+}
+
+SpriteAtlas::~SpriteAtlas() {
+	clear();
+}
+
+void SpriteAtlas::clear() {
+	for (Page& page : pages) {
+		glDeleteTextures(1, &page.texture);
+	}
+	pages.clear();
+}
+
+void SpriteAtlas::setMaxBytes(size_t bytes) {
+	max_bytes = bytes;
+	// Drop trailing pages over the new limit, regions still pointing at them fail the generation check
+	while (pages.size() > getMaxPages() && pages.back().lastuse < frame) {
+		evictions += pages.back().used;
+		glDeleteTextures(1, &pages.back().texture);
+		pages.pop_back();
+	}
+}
+
+size_t SpriteAtlas::getMaxPages() const {
+	const size_t side = page_size > 0 ? page_size : MAX_PAGE_SIZE;
+	return std::min(std::max<size_t>(max_bytes / (side * side * 4), 1), MAX_PAGES);
+}
+
+size_t SpriteAtlas::getSpriteCount() const {
+	size_t count = 0;
+	for (const Page& page : pages) {
+		count += page.used;
+	}
+	return count;
+}
+
+size_t SpriteAtlas::getByteSize() const {
+	return pages.size() * page_size * page_size * 4;
+}
+
+SpriteTexture SpriteAtlas::getTexture(const Region& region) const {
+	const float x = (region.slot % slots_per_side) * SLOT_SIZE + 1;
+	const float y = (region.slot / slots_per_side) * SLOT_SIZE + 1;
+
+	SpriteTexture texture(pages[region.page].texture);
+	texture.left = x / page_size;
+	texture.top = y / page_size;
+	texture.right = (x + SPRITE_PIXELS) / page_size;
+	texture.bottom = (y + SPRITE_PIXELS) / page_size;
+	return texture;
+}
+
+bool SpriteAtlas::contains(const Region& region) const {
+	return region.page >= 0 && region.page < static_cast<int>(pages.size()) && pages[region.page].generation == region.generation;
+}
+
+bool SpriteAtlas::hasRoom() const {
+	if (pages.size() < getMaxPages()) {
+		return true;
+	}
+	for (const Page& page : pages) {
+		if (page.used < slots_per_side * slots_per_side) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SpriteAtlas::find(const Region& region, SpriteTexture& texture) {
+	if (!contains(region)) {
+		return false;
+	}
+	pages[region.page].lastuse = frame;
+	texture = getTexture(region);
+	return true;
+}
+
+int SpriteAtlas::findPage() {
+	const int slots = slots_per_side * slots_per_side;
+	for (size_t i = 0; i < pages.size(); ++i) {
+		if (pages[i].used < slots) {
+			return i;
+		}
+	}
+
+	if (pages.size() < getMaxPages()) {
+		if (page_size == 0) {
+			GLint max_size = 0;
+			glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+			page_size = std::min<int>(MAX_PAGE_SIZE, max_size);
+			slots_per_side = page_size / SLOT_SIZE;
+		}
+		if (slots_per_side == 0) {
+			return -1;
+		}
+
+		Page page;
+		page.texture = allocate_texture();
+		page.generation = ++next_generation;
+		page.used = 0;
+		page.lastuse = frame;
+
+		glBindTexture(GL_TEXTURE_2D, page.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page_size, page_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+		pages.push_back(page);
+		return pages.size() - 1;
+	}
+
+	// Every page is full, empty the one that went unused the longest
+	int oldest = -1;
+	for (size_t i = 0; i < pages.size(); ++i) {
+		if (pages[i].lastuse < frame && (oldest == -1 || pages[i].lastuse < pages[oldest].lastuse)) {
+			oldest = i;
+		}
+	}
+	if (oldest != -1) {
+		evictions += pages[oldest].used;
+		pages[oldest].generation = ++next_generation;
+		pages[oldest].used = 0;
+	}
+	return oldest;
+}
+
+bool SpriteAtlas::insert(Region& region, const uint8_t* rgba, SpriteTexture& texture) {
+	const int index = findPage();
+	if (index == -1) {
+		return false;
+	}
+
+	Page& page = pages[index];
+	region.page = index;
+	region.slot = page.used++;
+	region.generation = page.generation;
+	page.lastuse = frame;
+
+	// Copy the sprite into the middle of the slot and repeat its outer pixels around it
+	uint8_t pixels[SLOT_SIZE * SLOT_SIZE * 4];
+	for (int y = 0; y < SLOT_SIZE; ++y) {
+		const int source_y = std::min(std::max(y - 1, 0), SPRITE_PIXELS - 1);
+		for (int x = 0; x < SLOT_SIZE; ++x) {
+			const int source_x = std::min(std::max(x - 1, 0), SPRITE_PIXELS - 1);
+			memcpy(&pixels[(y * SLOT_SIZE + x) * 4], &rgba[(source_y * SPRITE_PIXELS + source_x) * 4], 4);
+		}
+	}
+
+	texture = getTexture(region);
+	glBindTexture(GL_TEXTURE_2D, page.texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (region.slot % slots_per_side) * SLOT_SIZE, (region.slot / slots_per_side) * SLOT_SIZE, SLOT_SIZE, SLOT_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	return true;
+}
+
+void SpriteBatch::add(const SpriteTexture& texture, int x, int y, int size, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+	if (texture.id != this->texture) {
+		flush();
+		this->texture = texture.id;
+	}
+
+	vertices.push_back({ float(x), float(y), texture.left, texture.top, red, green, blue, alpha });
+	vertices.push_back({ float(x + size), float(y), texture.right, texture.top, red, green, blue, alpha });
+	vertices.push_back({ float(x + size), float(y + size), texture.right, texture.bottom, red, green, blue, alpha });
+	vertices.push_back({ float(x), float(y + size), texture.left, texture.bottom, red, green, blue, alpha });
+}
+
+void SpriteBatch::flush() {
+	if (vertices.empty()) {
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &vertices[0].x);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &vertices[0].u);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &vertices[0].red);
+	glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(vertices.size()));
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	vertices.clear();
+}
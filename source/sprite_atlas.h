@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SPRITE_ATLAS_H_
+#define RME_SPRITE_ATLAS_H_
+
+#include <vector>
+
+// A texture and the part of it a sprite covers
+struct SpriteTexture {
+	GLuint id = 0;
+	float left = 0.f;
+	float top = 0.f;
+	float right = 1.f;
+	float bottom = 1.f;
+
+	SpriteTexture() = default;
+	explicit SpriteTexture(GLuint id) :
+		id(id) { }
+};
+
+// Packs 32x32 sprites into large texture pages, so whole runs of sprites can be drawn with one bind
+// Pages are created on demand, once the memory limit is reached the least recently used page is
+// emptied and refilled. Images keep a Region and check it on every use, nothing points back at them.
+class SpriteAtlas {
+public:
+	static const int SLOT_SIZE = SPRITE_PIXELS + 2; // One pixel gutter copied from the edges, stops linear filtering from bleeding
+	static const int MAX_PAGE_SIZE = 2048;
+	static const size_t MAX_PAGES = 64;
+	static const size_t DEFAULT_MAX_PAGES = 8; // Limit when no texture budget is set, the atlas share of the default one
+	static const size_t DEFAULT_MAX_BYTES = DEFAULT_MAX_PAGES * MAX_PAGE_SIZE * MAX_PAGE_SIZE * 4;
+
+	struct Region {
+		int page = -1;
+		int slot = 0;
+		uint32_t generation = 0;
+	};
+
+	// Page textures take their ids from allocate_texture, like every other texture
+	explicit SpriteAtlas(GLuint (*allocate_texture)());
+	~SpriteAtlas();
+
+	SpriteAtlas(const SpriteAtlas&) = delete;
+	SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+	// Fills texture if the region still holds its sprite
+	bool find(const Region& region, SpriteTexture& texture);
+	bool contains(const Region& region) const;
+	// True if a sprite can be inserted without evicting a page
+	bool hasRoom() const;
+	// Uploads 32x32 RGBA pixels into a free slot, fails if every page was used this frame
+	bool insert(Region& region, const uint8_t* rgba, SpriteTexture& texture);
+	// Pages used during the current frame are never evicted, the drawer may still have them queued
+	void nextFrame() {
+		++frame;
+	}
+	// Pages are kept within the limit, at least one page is always allowed
+	void setMaxBytes(size_t bytes);
+	void clear();
+
+	size_t getPageCount() const {
+		return pages.size();
+	}
+	size_t getSpriteCount() const;
+	size_t getByteSize() const;
+	// Sprites dropped to make room for others
+	uint64_t getEvictionCount() const {
+		return evictions;
+	}
+
+private:
+	struct Page {
+		GLuint texture;
+		uint32_t generation;
+		int used;
+		uint64_t lastuse;
+	};
+
+	SpriteTexture getTexture(const Region& region) const;
+	int findPage();
+	size_t getMaxPages() const;
+
+	GLuint (*allocate_texture)();
+	std::vector<Page> pages;
+	int page_size;
+	int slots_per_side;
+	uint64_t frame;
+	size_t max_bytes;
+	uint64_t evictions;
+	uint32_t next_generation; // Never reused, not even after a clear
+};
+
+// Collects textured quads and draws each run that shares a texture with one call
+// Anything else drawn in between has to flush first, so painter's order is kept.
+class SpriteBatch {
+public:
+	void add(const SpriteTexture& texture, int x, int y, int size, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+	void flush();
+
+	bool empty() const {
+		return vertices.empty();
+	}
+
+private:
+	struct Vertex {
+		float x, y;
+		float u, v;
+		uint8_t red, green, blue, alpha;
+	};
+
+	std::vector<Vertex> vertices;
+	GLuint texture = 0;
+};
+
+#endif
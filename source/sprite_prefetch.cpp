@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "sprite_prefetch.h"
+#include "settings.h"
+#include "gui.h"
+
+#include <chrono>
+
+SpritePrefetcher::SpritePrefetcher() :
+	busy(0),
+	stopping(false) {
+	////
+}
+
+SpritePrefetcher::~SpritePrefetcher() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void SpritePrefetcher::start() {
+	// Leave a core to the main thread
+	const unsigned cores = std::thread::hardware_concurrency();
+	const unsigned count = std::max(1u, std::min(4u, cores > 1 ? cores - 1 : 1));
+	for (unsigned i = 0; i < count; ++i) {
+		workers.emplace_back([this]() { work(); });
+	}
+}
+
+void SpritePrefetcher::request(GameSprite* sprite) {
+	if (workers.empty()) {
+		start();
+	}
+
+	// Memory cached dumps are never released, so the workers can read them where they are
+	const bool memcached = g_settings.getInteger(Config::USE_MEMCACHED_SPRITES) && !g_gui.gfx.sprite_mapping;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (GameSprite::NormalImage* image : sprite->spriteList) {
+		if (queued.size() >= MAX_QUEUED) {
+			break;
+		}
+		if (image->isLoaded() || (memcached && !image->dump)) {
+			continue;
+		}
+		if (!queued.insert(image).second) {
+			continue;
+		}
+
+		Job job;
+		job.image = image;
+		job.id = image->id;
+		job.dump = memcached ? image->dump : nullptr;
+		job.size = memcached ? image->size : 0;
+		jobs.push_back(job);
+	}
+	wake.notify_all();
+}
+
+void SpritePrefetcher::upload() {
+	std::vector<Result> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(results);
+	}
+	if (finished.empty()) {
+		return;
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(UPLOAD_BUDGET);
+	size_t done = 0;
+	while (done < finished.size() && std::chrono::steady_clock::now() < deadline) {
+		Result& result = finished[done++];
+		queued.erase(result.image);
+		// The drawer may have needed it first and decoded it itself
+		if (result.rgba && !result.image->isLoaded()) {
+			result.image->loadRGBAData(result.rgba.get());
+		}
+	}
+
+	if (done < finished.size()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		results.insert(results.end(), std::make_move_iterator(finished.begin() + done), std::make_move_iterator(finished.end()));
+	}
+}
+
+void SpritePrefetcher::clear() {
+	std::unique_lock<std::mutex> lock(mutex);
+	jobs.clear();
+	idle.wait(lock, [this]() { return busy == 0; });
+	results.clear();
+	queued.clear();
+}
+
+void SpritePrefetcher::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+		if (stopping) {
+			return;
+		}
+
+		// Newest first, those are closest to where the camera is heading
+		const Job job = jobs.back();
+		jobs.pop_back();
+		++busy;
+
+		lock.unlock();
+		std::unique_ptr<uint8_t[]> rgba = decode(job);
+		lock.lock();
+
+		results.push_back({ job.image, std::move(rgba) });
+		if (--busy == 0) {
+			idle.notify_all();
+		}
+	}
+}
+
+std::unique_ptr<uint8_t[]> SpritePrefetcher::decode(const Job& job) const {
+	const GraphicManager& gfx = g_gui.gfx;
+
+	const uint8_t* pixels = job.dump;
+	uint16_t size = job.size;
+	std::unique_ptr<uint8_t[]> dump;
+	if (gfx.sprite_mapping) {
+		if (!gfx.getMappedSpriteDump(pixels, size, job.id)) {
+			return nullptr;
+		}
+	} else if (!pixels) {
+		uint8_t* read = nullptr;
+		if (!gfx.readSpriteDump(read, size, job.id)) {
+			return nullptr;
+		}
+		dump.reset(read);
+		pixels = read;
+	}
+
+	std::unique_ptr<uint8_t[]> rgba(newd uint8_t[SPRITE_PIXELS_SIZE * 4]);
+	GameSprite::NormalImage::decodeRGBA(pixels, size, gfx.hasTransparency(), rgba.get());
+	return rgba;
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SPRITE_PREFETCH_H_
+#define RME_SPRITE_PREFETCH_H_
+
+#include "graphics.h"
+
+#include <condition_variable>
+#include <thread>
+
+// Decodes sprites on worker threads before the drawer needs them
+// Requests and uploads happen on the main thread, the workers only see sprite ids and pixel buffers.
+class SpritePrefetcher {
+public:
+	static const size_t MAX_QUEUED = 8192; // About 32 MB once decoded
+	static const int UPLOAD_BUDGET = 2; // Milliseconds per frame
+
+	SpritePrefetcher();
+	~SpritePrefetcher();
+
+	SpritePrefetcher(const SpritePrefetcher&) = delete;
+	SpritePrefetcher& operator=(const SpritePrefetcher&) = delete;
+
+	// Queues every image of the sprite that isn't on the GPU yet
+	void request(GameSprite* sprite);
+	// Uploads decoded images until the frame budget runs out, the rest waits for the next frame
+	void upload();
+	// Drops all work, waits for the workers to finish what they hold
+	void clear();
+
+private:
+	struct Job {
+		GameSprite::NormalImage* image;
+		uint32_t id;
+		const uint8_t* dump; // Only set for dumps that stay in memory for good
+		uint16_t size;
+	};
+	struct Result {
+		GameSprite::NormalImage* image;
+		std::unique_ptr<uint8_t[]> rgba;
+	};
+
+	void start();
+	void work();
+	std::unique_ptr<uint8_t[]> decode(const Job& job) const;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::deque<Job> jobs;
+	std::vector<Result> results;
+	size_t busy;
+	bool stopping;
+	std::vector<std::thread> workers;
+
+	std::unordered_set<GameSprite::NormalImage*> queued; // Requested and not uploaded yet, main thread only
+};
+
+#endif
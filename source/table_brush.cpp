@@ -121,7 +121,7 @@ void TableBrush::undraw(BaseMap* map, Tile* t) {
 		if ((*it)->isTable()) {
 			TableBrush* tb = (*it)->getTableBrush();
 			if (tb == this) {
-				delete *it;
+				Item::Release(*it);
 				it = t->items.erase(it);
 			} else {
 				++it;
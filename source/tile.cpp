@@ -33,6 +33,30 @@
 
 static thread_local std::set<Position> wallize_processing_tiles;
 
+static MemoryPool& getTilePool() {
+	// Never destroyed, tiles may still be released from static destructors at exit
+	// Synchronized, since selection and other worker threads copy tiles too
+	static MemoryPool* pool = newd MemoryPool(sizeof(Tile), 4096, true);
+	return *pool;
+}
+
+void* Tile::operator new(size_t size) {
+	ASSERT(size == sizeof(Tile));
+	return getTilePool().allocate();
+}
+
+void Tile::operator delete(void* ptr) {
+	getTilePool().release(ptr);
+}
+
+MemoryPoolStats Tile::getPoolStats() {
+	return getTilePool().getStats();
+}
+
+size_t Tile::trimPool() {
+	return getTilePool().trim();
+}
+
 Tile::Tile(int x, int y, int z) :
 	location(nullptr),
 	ground(nullptr),
@@ -73,12 +97,10 @@ Tile::~Tile() {
 	}
 #endif
 
-	while (!items.empty()) {
-		delete items.back();
-		items.pop_back();
-	}
+	Item::Release(items.data(), items.size());
+	items.clear();
 	delete creature;
-	delete ground;
+	Item::Release(&ground, 1);
 	delete spawn;
 	
 #ifdef __WXDEBUG__
@@ -149,11 +171,45 @@ uint32_t Tile::memsize() const {
 		++it;
 	}
 
-	mem += sizeof(Item*) * items.capacity();
+	mem += items.heapBytes();
 
 	return mem;
 }
 
+uint32_t Tile::shareItems() {
+	uint32_t count = 0;
+	if (ground && ground->isShareable()) {
+		Item* shared = Item::GetShared(ground);
+		delete ground;
+		ground = shared;
+		++count;
+	}
+	for (Item*& item : items) {
+		if (item->isShareable()) {
+			Item* shared = Item::GetShared(item);
+			delete item;
+			item = shared;
+			++count;
+		}
+	}
+	return count;
+}
+
+uint32_t Tile::unshareItems() {
+	uint32_t count = 0;
+	if (ground && ground->isShared()) {
+		ground = ground->deepCopy();
+		++count;
+	}
+	for (Item*& item : items) {
+		if (item->isShared()) {
+			item = item->deepCopy();
+			++count;
+		}
+	}
+	return count;
+}
+
 int Tile::size() const {
 	int sz = 0;
 	if (ground) {
@@ -189,7 +245,7 @@ void Tile::merge(Tile* other) {
 	}
 
 	if (other->ground) {
-		delete ground;
+		Item::Release(ground);
 		ground = other->ground;
 		other->ground = nullptr;
 	}
@@ -298,11 +354,13 @@ void Tile::addItem(Item* item) {
 	// Handle ground tiles
 	if (item->isGroundTile()) {
 #ifdef __WXDEBUG__
-		printf("DEBUG: Adding ground tile ID %d to position %d,%d,%d\n", 
-			item->getID(), getPosition().x, getPosition().y, getPosition().z);
+		if (location) { // Tiles decoded by the map loader get their location later
+			printf("DEBUG: Adding ground tile ID %d to position %d,%d,%d\n", 
+				item->getID(), getPosition().x, getPosition().y, getPosition().z);
+		}
 #endif
 		// Always delete the existing ground first
-		delete ground;
+		Item::Release(ground);
 		ground = item;
 		
 		// Also check for any ground items that might be in the items list
@@ -313,7 +371,7 @@ void Tile::addItem(Item* item) {
 #ifdef __WXDEBUG__
 				printf("DEBUG: Removing misplaced ground item with ID %d from tile items\n", (*it)->getID());
 #endif
-				delete *it;
+				Item::Release(*it);
 				it = items.erase(it);
 			} else {
 				++it;
@@ -326,7 +384,7 @@ void Tile::addItem(Item* item) {
 	uint16_t gid = item->getGroundEquivalent();
 	if (gid != 0) {
 		// If item has a ground equivalent, replace the ground
-		delete ground;
+		Item::Release(ground);
 		ground = Item::Create(gid);
 		
 		// Insert at the very bottom of the stack
@@ -634,7 +692,7 @@ void Tile::cleanBorders() {
 	// When Same Ground Type Border is disabled, remove all border items
 	for (ItemVector::iterator it = items.begin(); it != items.end();) {
 		if ((*it)->isBorder()) {
-			delete *it;
+			Item::Release(*it);
 			it = items.erase(it);
 		} else {
 			++it;
@@ -710,7 +768,7 @@ void Tile::cleanWalls(bool dontdelete) {
 	while (it != items.end()) {
 		if ((*it)->isWall()) {
 			if (!dontdelete) {
-				delete *it;
+				Item::Release(*it);
 			}
 			it = items.erase(it);
 		} else {
@@ -725,7 +783,7 @@ void Tile::cleanWalls(WallBrush* wb) {
 	it = items.begin();
 	while (it != items.end()) {
 		if ((*it)->isWall() && wb->hasWall(*it)) {
-			delete *it;
+			Item::Release(*it);
 			it = items.erase(it);
 		} else {
 			++it;
@@ -740,7 +798,7 @@ void Tile::cleanTables(bool dontdelete) {
 	while (it != items.end()) {
 		if ((*it)->isTable()) {
 			if (!dontdelete) {
-				delete *it;
+				Item::Release(*it);
 			}
 			it = items.erase(it);
 		} else {
@@ -21,6 +21,7 @@
 #include "position.h"
 #include "item.h"
 #include "map_region.h"
+#include "memory_pool.h"
 #include <unordered_set>
 
 enum {
@@ -63,9 +64,30 @@ public:
 
 	~Tile();
 
+	// Tiles are recycled through a shared slab pool, maps allocate them through MapAllocator
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr);
+#ifdef DEBUG_MEM
+	static void* operator new(size_t size, const char*, int) {
+		return operator new(size);
+	}
+	static void operator delete(void* ptr, const char*, int) {
+		operator delete(ptr);
+	}
+#endif
+	static MemoryPoolStats getPoolStats();
+	// Hands back the memory of every pool slab that no longer holds any tile
+	static size_t trimPool();
+
 	// Argument is a the map to allocate the tile from
 	Tile* deepCopy(BaseMap& map);
 
+	// Swaps plain items for their shared instance (see Item::GetShared), returns how many
+	uint32_t shareItems();
+	// Gives the tile private copies of its shared items again, must be done before
+	// changing items of a tile that is on the map in place
+	uint32_t unshareItems();
+
 	// The location of the tile
 	// Stores state that remains between the tile being moved (like house exits)
 	void setLocation(TileLocation* where) {
@@ -0,0 +1,165 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "xml_stream_writer.h"
+
+XMLStreamWriter::XMLStreamWriter() :
+	tag_open(false),
+	failed(false) {
+	////
+}
+
+XMLStreamWriter::XMLStreamWriter(const std::string& name) :
+	file(newd FileWriteHandle(name)),
+	tag_open(false),
+	failed(false) {
+	failed = !file->isOk();
+	buffer.reserve(FLUSH_SIZE + 1024);
+}
+
+XMLStreamWriter::~XMLStreamWriter() {
+	close();
+}
+
+bool XMLStreamWriter::isOk() const {
+	return !failed;
+}
+
+void XMLStreamWriter::declaration() {
+	buffer += "<?xml version=\"1.0\"?>\n";
+}
+
+void XMLStreamWriter::startElement(const char* name) {
+	closeStartTag();
+	indent();
+	buffer += '<';
+	buffer += name;
+	elements.push_back(name);
+	tag_open = true;
+}
+
+void XMLStreamWriter::endElement() {
+	ASSERT(!elements.empty());
+	const char* name = elements.back();
+	elements.pop_back();
+	if (tag_open) {
+		buffer += " />\n";
+		tag_open = false;
+	} else {
+		indent();
+		buffer += "</";
+		buffer += name;
+		buffer += ">\n";
+	}
+	if (file && buffer.size() >= FLUSH_SIZE) {
+		flush();
+	}
+}
+
+void XMLStreamWriter::attribute(const char* name, const char* value) {
+	ASSERT(tag_open);
+	buffer += ' ';
+	buffer += name;
+	buffer += "=\"";
+	escape(value);
+	buffer += '"';
+}
+
+void XMLStreamWriter::attribute(const char* name, const std::string& value) {
+	attribute(name, value.c_str());
+}
+
+void XMLStreamWriter::attribute(const char* name, int value) {
+	char number[16];
+	snprintf(number, sizeof(number), "%d", value);
+	attribute(name, number);
+}
+
+void XMLStreamWriter::attribute(const char* name, unsigned int value) {
+	char number[16];
+	snprintf(number, sizeof(number), "%u", value);
+	attribute(name, number);
+}
+
+void XMLStreamWriter::attribute(const char* name, bool value) {
+	attribute(name, value ? "true" : "false");
+}
+
+bool XMLStreamWriter::close() {
+	while (!elements.empty()) {
+		endElement();
+	}
+	if (file) {
+		flush();
+		failed = failed || !file->isOk();
+		file->close();
+		file.reset();
+	}
+	return !failed;
+}
+
+void XMLStreamWriter::closeStartTag() {
+	if (tag_open) {
+		buffer += ">\n";
+		tag_open = false;
+	}
+}
+
+void XMLStreamWriter::indent() {
+	buffer.append(elements.size(), '\t');
+}
+
+void XMLStreamWriter::escape(const char* value) {
+	// Same entities as pugixml writes for attribute values
+	for (const char* run = value; *value; run = ++value) {
+		while (*value && *value != '&' && *value != '<' && *value != '>' && *value != '"' && static_cast<unsigned char>(*value) >= 32) {
+			++value;
+		}
+		buffer.append(run, value - run);
+		switch (*value) {
+			case '\0':
+				return;
+			case '&':
+				buffer += "&amp;";
+				break;
+			case '<':
+				buffer += "&lt;";
+				break;
+			case '>':
+				buffer += "&gt;";
+				break;
+			case '"':
+				buffer += "&quot;";
+				break;
+			default: {
+				char entity[8];
+				snprintf(entity, sizeof(entity), "&#%02d;", static_cast<int>(*value));
+				buffer += entity;
+				break;
+			}
+		}
+	}
+}
+
+void XMLStreamWriter::flush() {
+	if (!buffer.empty() && !failed) {
+		failed = !file->addRAW(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+	}
+	buffer.clear();
+}
@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_XML_STREAM_WRITER_H_
+#define RME_XML_STREAM_WRITER_H_
+
+#include "filehandle.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Writes an XML document element by element, without building a tree first. Output goes
+// to a file through a buffer, or into memory, formatted like pugixml does with tab indents.
+class XMLStreamWriter {
+public:
+	// Writes into memory, see getData
+	XMLStreamWriter();
+	// Writes into the file, the name is UTF-8
+	explicit XMLStreamWriter(const std::string& name);
+	~XMLStreamWriter();
+
+	XMLStreamWriter(const XMLStreamWriter&) = delete;
+	XMLStreamWriter& operator=(const XMLStreamWriter&) = delete;
+
+	bool isOk() const;
+
+	void declaration();
+	// Names have to stay valid until the element is ended, string literals in practice
+	void startElement(const char* name);
+	void endElement();
+
+	// Only valid right after startElement
+	void attribute(const char* name, const char* value);
+	void attribute(const char* name, const std::string& value);
+	void attribute(const char* name, int value);
+	void attribute(const char* name, unsigned int value);
+	void attribute(const char* name, bool value);
+
+	// Ends open elements and writes out the buffer, returns false if anything failed to write
+	bool close();
+
+	// Everything written so far in memory mode
+	std::string& getData() {
+		return buffer;
+	}
+
+protected:
+	static const size_t FLUSH_SIZE = 64 * 1024;
+
+	void closeStartTag();
+	void indent();
+	void escape(const char* value);
+	void flush();
+
+	std::unique_ptr<FileWriteHandle> file;
+	std::string buffer;
+	std::vector<const char*> elements; // Currently open, innermost last
+	bool tag_open; // The start tag of the innermost element still takes attributes
+	bool failed;
+};
+
+#endif
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_TESTS_HEADLESS_H_
+#define RME_TESTS_HEADLESS_H_
+
+// Forced in front of every test and source file instead of main.h (see CMakeLists.txt),
+// for the parts of the editor that need neither wxWidgets nor a window.
+
+#define newd new
+
+#include <assert.h>
+#define ASSERT assert
+#define _MSG(msg) !bool(msg)
+
+#include <boost/utility.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+	#include <windows.h>
+#endif
+#include <GL/gl.h>
+
+typedef std::vector<std::string> StringVector;
+
+#include "definitions.h"
+
+// The compressed file handles, left out when CMake didn't find zstd and lz4
+#ifdef RME_HEADLESS_NO_OTBZ
+	#undef OTBZ_SUPPORT
+#endif
+#ifdef OTBZ_SUPPORT
+	#include <zstd.h>
+	#include <lz4frame.h>
+#endif
+
+// From common.cpp, which needs wxWidgets
+inline std::string i2s(int i) {
+	return std::to_string(i);
+}
+
+// Minimal checks, a failure is printed and counted, the test returns the count
+namespace test {
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+}
+
+#define CHECK(expr)                                                                           \
+	do {                                                                                      \
+		if (!(expr)) {                                                                        \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #expr << std::endl; \
+			++test::failures();                                                               \
+		}                                                                                     \
+	} while (false)
+
+#endif
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "item_attributes.h"
+
+#include <thread>
+
+namespace {
+	void testBuiltinNames() {
+		CHECK(ItemAttributeNames::name(ATTRIBUTE_ACTION_ID) == "aid");
+		CHECK(ItemAttributeNames::name(ATTRIBUTE_KEY_ID) == "keyid");
+		CHECK(ItemAttributeNames::find("uid") == ATTRIBUTE_UNIQUE_ID);
+		CHECK(ItemAttributeNames::intern("desc") == ATTRIBUTE_DESCRIPTION);
+		for (uint16_t key = 0; key < ATTRIBUTE_FIRST_CUSTOM; ++key) {
+			const ItemAttributeKey id = static_cast<ItemAttributeKey>(key);
+			CHECK(ItemAttributeNames::find(ItemAttributeNames::name(id)) == id);
+		}
+	}
+
+	void testCustomNames() {
+		CHECK(ItemAttributeNames::find("test_never_used") == ATTRIBUTE_NONE);
+		const ItemAttributeKey key = ItemAttributeNames::intern("test_custom");
+		CHECK(key >= ATTRIBUTE_FIRST_CUSTOM && key != ATTRIBUTE_NONE);
+		CHECK(ItemAttributeNames::intern("test_custom") == key);
+		CHECK(ItemAttributeNames::find("test_custom") == key);
+		CHECK(ItemAttributeNames::name(key) == "test_custom");
+	}
+
+	void testConcurrentNames() {
+		// Save workers read names while the loader may still intern new ones
+		const ItemAttributeKey custom = ItemAttributeNames::intern("test_shared");
+		std::vector<std::thread> threads;
+		std::vector<int> mismatches(4, 0);
+		for (int t = 0; t < 4; ++t) {
+			threads.emplace_back([t, custom, &mismatches]() {
+				for (int i = 0; i < 2000; ++i) {
+					if (t == 0) {
+						ItemAttributeNames::intern("test_thread_" + std::to_string(i));
+					}
+					mismatches[t] += ItemAttributeNames::name(ATTRIBUTE_TEXT) != "text";
+					mismatches[t] += ItemAttributeNames::name(custom) != "test_shared";
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		for (int count : mismatches) {
+			CHECK(count == 0);
+		}
+		CHECK(ItemAttributeNames::find("test_thread_1999") != ATTRIBUTE_NONE);
+	}
+
+	void testMapOrder() {
+		ItemAttributeMap map;
+		map[ItemAttributeNames::intern("test_zeta")].set(int32_t(1));
+		map[ATTRIBUTE_UNIQUE_ID].set(int32_t(2));
+		map[ATTRIBUTE_ACTION_ID].set(int32_t(3));
+		CHECK(map.size() == 3);
+
+		// Kept sorted by key id, builtin keys first
+		ItemAttributeKey previous = ATTRIBUTE_ACTION_ID;
+		for (const ItemAttributeMap::value_type& entry : map) {
+			CHECK(entry.first >= previous);
+			previous = entry.first;
+		}
+		CHECK(map.begin()->first == ATTRIBUTE_ACTION_ID);
+		CHECK(map.find(ATTRIBUTE_TEXT) == map.end());
+		CHECK(*map.find(ATTRIBUTE_UNIQUE_ID)->second.getInteger() == 2);
+	}
+}
+
+int main() {
+	testBuiltinNames();
+	testCustomNames();
+	testConcurrentNames();
+	testMapOrder();
+	return test::failures() == 0 ? 0 : 1;
+}
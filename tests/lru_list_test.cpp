@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "lru_list.h"
+
+namespace {
+	struct Entry {
+		explicit Entry(int id = 0) :
+			id(id) { }
+
+		int id;
+		LRUHook<Entry> hook;
+	};
+
+	typedef LRUList<Entry, &Entry::hook> EntryList;
+
+	void testOrder() {
+		EntryList list;
+		CHECK(list.back() == nullptr);
+		CHECK(list.size() == 0 && list.bytes() == 0);
+
+		Entry a(1), b(2), c(3);
+		list.insert(&a, 10, 1);
+		list.insert(&b, 20, 1);
+		list.insert(&c, 30, 2);
+		CHECK(list.size() == 3);
+		CHECK(list.bytes() == 60);
+		CHECK(list.back() == &a);
+
+		// Touching moves to the front, so the next oldest is at the back
+		list.touch(&a, 3);
+		CHECK(a.hook.lastuse == 3);
+		CHECK(list.back() == &b);
+		list.touch(&c, 4);
+		CHECK(list.back() == &b);
+		list.touch(&b, 5);
+		CHECK(list.back() == &a);
+
+		list.remove(&a);
+		list.remove(&b);
+		list.remove(&c);
+		CHECK(list.back() == nullptr);
+		CHECK(list.size() == 0 && list.bytes() == 0);
+	}
+
+	void testRemove() {
+		EntryList list;
+		Entry a(1), b(2), c(3);
+		list.insert(&a, 10, 1);
+		list.insert(&b, 20, 1);
+		list.insert(&c, 30, 1);
+
+		// From the middle, then from both ends
+		list.remove(&b);
+		CHECK(!b.hook.linked);
+		CHECK(list.size() == 2 && list.bytes() == 40);
+		CHECK(list.back() == &a);
+		list.remove(&b);
+		CHECK(list.size() == 2 && list.bytes() == 40);
+
+		list.remove(&a);
+		CHECK(list.back() == &c);
+		list.remove(&c);
+		CHECK(list.back() == nullptr);
+
+		// Unlinked objects are left alone
+		list.touch(&a, 7);
+		CHECK(!a.hook.linked && a.hook.lastuse == 1);
+		CHECK(list.size() == 0);
+	}
+
+	void testReinsert() {
+		EntryList list;
+		Entry a(1), b(2);
+		list.insert(&a, 10, 1);
+		list.insert(&b, 20, 1);
+
+		// A linked object is moved to the front with its new size
+		list.insert(&a, 15, 2);
+		CHECK(list.size() == 2);
+		CHECK(list.bytes() == 35);
+		CHECK(list.back() == &b);
+		CHECK(a.hook.bytes == 15 && a.hook.lastuse == 2);
+	}
+
+	void testEviction() {
+		// The way the texture and dump caches keep to their budget
+		EntryList list;
+		std::vector<Entry> entries(100);
+		for (int i = 0; i < 100; ++i) {
+			entries[i].id = i;
+			list.insert(&entries[i], 4, i);
+			if (i % 3 == 0) {
+				list.touch(&entries[i / 2], i);
+			}
+		}
+
+		std::vector<int> evicted;
+		while (list.bytes() > 40) {
+			Entry* oldest = list.back();
+			CHECK(oldest != nullptr);
+			evicted.push_back(oldest->id);
+			list.remove(oldest);
+		}
+		CHECK(list.size() == 10);
+		CHECK(evicted.size() == 90);
+		// Evicted in order of last use
+		for (size_t i = 1; i < evicted.size(); ++i) {
+			CHECK(entries[evicted[i - 1]].hook.lastuse <= entries[evicted[i]].hook.lastuse);
+		}
+	}
+}
+
+int main() {
+	testOrder();
+	testRemove();
+	testReinsert();
+	testEviction();
+	return test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "memory_pool.h"
+
+#include <set>
+
+namespace {
+	void testRecycle() {
+		MemoryPool pool(24, 4);
+		CHECK(pool.getObjectSize() >= 24);
+		std::set<void*> objects;
+		for (int i = 0; i < 10; ++i) {
+			objects.insert(pool.allocate());
+		}
+		CHECK(objects.size() == 10);
+		CHECK(pool.getStats().slabs == 3);
+		CHECK(pool.getStats().live == 10);
+
+		void* freed = *objects.begin();
+		pool.release(freed);
+		CHECK(pool.allocate() == freed);
+		CHECK(!pool.purge()); // Objects are still alive
+
+		for (void* object : objects) {
+			pool.release(object);
+		}
+		CHECK(pool.getStats().live == 0);
+		CHECK(pool.getStats().peak == 10);
+		CHECK(pool.purge());
+		CHECK(pool.getStats().slabs == 0);
+	}
+
+	void testTrim() {
+		MemoryPool pool(16, 4);
+		void* objects[8];
+		pool.allocate(objects, 8);
+		CHECK(pool.getStats().slabs == 2);
+
+		// The second slab runs empty, the first still holds an object
+		pool.release(objects + 1, 7);
+		CHECK(pool.trim() == pool.getObjectSize() * 4);
+		CHECK(pool.getStats().slabs == 1);
+		pool.release(objects[0]);
+		CHECK(pool.trim() == pool.getObjectSize() * 4);
+		CHECK(pool.getStats().slabs == 0);
+	}
+
+	void testDiscard() {
+		MemoryPool pool(32, 8, true);
+		for (int i = 0; i < 20; ++i) {
+			pool.allocate();
+		}
+		// Live objects don't keep discard from dropping the slabs
+		pool.discard();
+		MemoryPoolStats stats = pool.getStats();
+		CHECK(stats.slabs == 0);
+		CHECK(stats.live == 0);
+		CHECK(stats.reserved_bytes == 0);
+		CHECK(stats.allocations == stats.releases);
+
+		// And the pool starts over afterwards
+		void* object = pool.allocate();
+		CHECK(object != nullptr);
+		CHECK(pool.getStats().slabs == 1);
+		pool.release(object);
+		CHECK(pool.purge());
+	}
+}
+
+int main() {
+	testRecycle();
+	testTrim();
+	testDiscard();
+	return test::failures() == 0 ? 0 : 1;
+}
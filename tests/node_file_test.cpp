@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "filehandle.h"
+
+#include <iostream>
+
+namespace {
+	// Returns the raw bytes of every node below the map data node, in file order
+	std::vector<std::vector<uint8_t>> readTopNodes(NodeFileReadHandle& f, bool copy) {
+		std::vector<std::vector<uint8_t>> nodes;
+		BinaryNode* root = f.getRootNode();
+		BinaryNode* mapHeaderNode = root ? root->getChild() : nullptr;
+		if (!mapHeaderNode) {
+			return nodes;
+		}
+		for (BinaryNode* node = mapHeaderNode->getChild(); node != nullptr; node = node->advance()) {
+			uint8_t type;
+			node->getByte(type);
+			std::vector<uint8_t> bytes;
+			if (copy) {
+				CHECK(node->copyRawSubtree(bytes));
+			} else {
+				const uint8_t* begin;
+				size_t size;
+				CHECK(node->getRawSubtree(begin, size));
+				bytes.assign(begin, begin + size);
+			}
+			nodes.push_back(std::move(bytes));
+		}
+		CHECK(f.isOk());
+		return nodes;
+	}
+
+	void testRawSubtrees(const std::string& path) {
+		MappedNodeFileReadHandle mapped(path, StringVector(1, "OTBM"));
+		CHECK(mapped.isOk());
+		const std::vector<std::vector<uint8_t>> expected = readTopNodes(mapped, false);
+		CHECK(!expected.empty());
+
+		// The small cache of the disk handle makes areas straddle its refills
+		DiskNodeFileReadHandle disk(path, StringVector(1, "OTBM"));
+		CHECK(disk.isOk());
+		CHECK(readTopNodes(disk, true) == expected);
+
+		MappedNodeFileReadHandle mapped_copy(path, StringVector(1, "OTBM"));
+		CHECK(readTopNodes(mapped_copy, true) == expected);
+
+		// Each copy reads back as a node file of its own
+		for (const std::vector<uint8_t>& bytes : expected) {
+			MemoryNodeFileReadHandle memory(bytes.data(), bytes.size());
+			BinaryNode* node = memory.getRootNode();
+			uint8_t type;
+			CHECK(node && node->getByte(type));
+		}
+	}
+
+#ifdef OTBZ_SUPPORT
+	void testCompressedRawSubtrees(const std::string& path, FileCompression compression) {
+		MappedNodeFileReadHandle mapped(path, StringVector(1, "OTBM"));
+		const std::vector<std::vector<uint8_t>> expected = readTopNodes(mapped, false);
+
+		// Recompress the node file as it is, the identifier is written by the handle
+		std::vector<uint8_t> nodes;
+		{
+			FileReadHandle file(path);
+			nodes.resize(file.size() - 4);
+			CHECK(file.seek(4) && file.getRAW(nodes.data(), nodes.size()));
+		}
+		const std::string compressed_path = "node_file_test.otbz"; // In the working directory
+		{
+			CompressedNodeFileWriteHandle f(compressed_path, "OTBM", compression, 2);
+			CHECK(f.isOk());
+			f.addNodeData(nodes.data(), nodes.size());
+			f.close();
+			CHECK(f.error_code == FILE_NO_ERROR);
+		}
+
+		// Areas are copied out of the decompressor window while it moves on
+		CompressedNodeFileReadHandle compressed(compressed_path, StringVector(1, "OTBM"));
+		CHECK(compressed.isOk());
+		CHECK(readTopNodes(compressed, true) == expected);
+		compressed.close();
+		remove(compressed_path.c_str());
+	}
+
+	#ifdef __linux__
+	void testCompressedWriteError() {
+		// Every write to /dev/full fails with ENOSPC, mostly only once the stream is flushed
+		CompressedNodeFileWriteHandle f("/dev/full", "OTBM", FILE_COMPRESSION_ZSTD, 1);
+		f.addNode(0);
+		f.addU32(0);
+		f.endNode();
+		f.close();
+		CHECK(f.error_code != FILE_NO_ERROR);
+	}
+	#endif
+#endif
+}
+
+int main(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		testRawSubtrees(argv[i]);
+#ifdef OTBZ_SUPPORT
+		testCompressedRawSubtrees(argv[i], FILE_COMPRESSION_ZSTD);
+		testCompressedRawSubtrees(argv[i], FILE_COMPRESSION_LZ4);
+#endif
+	}
+#if defined(OTBZ_SUPPORT) && defined(__linux__)
+	testCompressedWriteError();
+#endif
+	return test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+// Times the scalar, SSE2 and AVX2 special byte scans over captured OTBM files.
+// Usage: node_scan_benchmark [--megabytes N] file.otbm...
+// Each file is scanned as stored, which is what the readers see, and with the
+// escapes and markers taken out, which is what the writers see. Fails if the
+// paths disagree on what they find.
+
+#include "filehandle.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+
+namespace {
+	struct Result {
+		double ms = 0.0;
+		uint64_t count = 0;
+	};
+
+	Result scan(const std::vector<uint8_t>& payload, int passes, NodeScanPath path) {
+		Result result;
+		const uint8_t* begin = payload.data();
+		const uint8_t* end = begin + payload.size();
+		const auto start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; ++pass) {
+			const uint8_t* ptr = findNodeSpecialByte(begin, end, path);
+			while (ptr != end) {
+				++result.count;
+				ptr = findNodeSpecialByte(ptr + 1, end, path);
+			}
+		}
+		result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+	// The node data as the writers get it, before escaping
+	std::vector<uint8_t> decode(const std::vector<uint8_t>& stored) {
+		std::vector<uint8_t> decoded;
+		decoded.reserve(stored.size());
+		for (size_t i = 4; i < stored.size(); ++i) {
+			if (stored[i] == ESCAPE_CHAR) {
+				if (++i < stored.size()) {
+					decoded.push_back(stored[i]);
+				}
+			} else if (stored[i] != NODE_START && stored[i] != NODE_END) {
+				decoded.push_back(stored[i]);
+			}
+		}
+		return decoded;
+	}
+
+	bool run(const std::string& name, const std::vector<uint8_t>& payload, size_t megabytes) {
+		static const std::pair<NodeScanPath, const char*> paths[] = {
+			{ NODE_SCAN_SCALAR, "scalar" },
+			{ NODE_SCAN_SSE2, "SSE2" },
+			{ NODE_SCAN_AVX2, "AVX2" },
+		};
+
+		const int passes = int(std::max<size_t>(1, (megabytes << 20) / std::max<size_t>(payload.size(), 1)));
+		const double scanned = double(payload.size()) * passes / (1024.0 * 1024.0);
+		std::cout << name << ": " << payload.size() << " bytes, " << passes << " passes" << std::endl;
+
+		bool agree = true;
+		Result scalar;
+		for (const auto& path : paths) {
+			if (!isNodeScanSupported(path.first)) {
+				std::cout << "\t" << std::setw(8) << std::left << path.second << "not supported" << std::endl;
+				continue;
+			}
+			const Result result = scan(payload, passes, path.first);
+			if (path.first == NODE_SCAN_SCALAR) {
+				scalar = result;
+			} else if (result.count != scalar.count) {
+				std::cout << "\t" << path.second << " found " << result.count << " bytes, scalar found " << scalar.count << std::endl;
+				agree = false;
+			}
+			std::cout << "\t" << std::setw(8) << std::left << path.second << std::fixed << std::setprecision(2)
+					  << result.ms << " ms, " << (result.ms > 0.0 ? scanned / result.ms * 1000.0 : 0.0) << " MB/s, "
+					  << result.count / passes << " special bytes" << std::endl;
+		}
+		return agree;
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t megabytes = 256;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--megabytes" && i + 1 < argc) {
+			megabytes = std::stoul(argv[++i]);
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (files.empty()) {
+		std::cerr << "Usage: " << argv[0] << " [--megabytes N] file.otbm..." << std::endl;
+		return 2;
+	}
+
+	bool agree = true;
+	for (const std::string& file : files) {
+		std::ifstream stream(file, std::ios::binary);
+		if (!stream) {
+			std::cerr << "Could not open " << file << std::endl;
+			return 2;
+		}
+		const std::vector<uint8_t> stored((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		agree &= run(file + " (stored)", stored, megabytes);
+		agree &= run(file + " (decoded)", decode(stored), megabytes);
+	}
+	return agree ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "ordered_job_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+
+namespace {
+	struct TestJob {
+		explicit TestJob(int index) :
+			index(index), delay(0), result(-1) { }
+
+		int index;
+		int delay; // Microseconds
+		int result;
+	};
+
+	void testOrder(int thread_count) {
+		// Later jobs often finish first, they must still come back in order
+		std::mt19937 random(thread_count);
+		std::atomic<int> running(0);
+		std::atomic<int> most_running(0);
+		std::vector<int> finished;
+		std::vector<int> finished_results;
+		OrderedJobQueue<TestJob> queue(thread_count, [&](TestJob& job) {
+			const int now = ++running;
+			int most = most_running;
+			while (now > most && !most_running.compare_exchange_weak(most, now)) {
+				////
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(job.delay));
+			job.result = job.index * 2;
+			--running;
+		}, [&](TestJob& job) {
+			// Runs with the queue locked, so no two calls overlap
+			finished.push_back(job.index);
+			finished_results.push_back(job.result);
+		});
+
+		const int job_count = 500;
+		int popped = 0;
+		int mismatches = 0;
+		for (int i = 0; i < job_count; ++i) {
+			std::unique_ptr<TestJob> job(new TestJob(i));
+			job->delay = random() % 200;
+			queue.push(std::move(job));
+			while (std::unique_ptr<TestJob> done = queue.pop(i % 7 == 0)) {
+				mismatches += done->index != popped || done->result != popped * 2;
+				++popped;
+			}
+		}
+		while (std::unique_ptr<TestJob> done = queue.pop(true)) {
+			mismatches += done->index != popped || done->result != popped * 2;
+			++popped;
+		}
+		CHECK(mismatches == 0);
+		CHECK(popped == job_count);
+		CHECK(queue.size() == 0);
+		CHECK(queue.pop(false) == nullptr);
+		CHECK(most_running <= thread_count);
+
+		// Every job was finished exactly once, in order and after its work was done
+		CHECK(finished.size() == size_t(job_count));
+		for (size_t i = 0; i < finished.size(); ++i) {
+			mismatches += finished[i] != int(i) || finished_results[i] != int(i) * 2;
+		}
+		CHECK(mismatches == 0);
+	}
+
+	void testFinishedBeforePop() {
+		// A job is finished as soon as it and the ones before it are done, without waiting for pop
+		std::mutex lock;
+		std::condition_variable changed;
+		int finished = 0;
+		OrderedJobQueue<TestJob> queue(2, [](TestJob&) { }, [&](TestJob&) {
+			std::lock_guard<std::mutex> guard(lock);
+			++finished;
+			changed.notify_all();
+		});
+		for (int i = 0; i < 10; ++i) {
+			queue.push(std::unique_ptr<TestJob>(new TestJob(i)));
+		}
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			CHECK(changed.wait_for(guard, std::chrono::seconds(10), [&] { return finished == 10; }));
+		}
+		CHECK(queue.size() == 10);
+		while (queue.pop(true)) {
+			////
+		}
+	}
+
+	void testStopWithQueuedJobs() {
+		// Jobs nobody popped are dropped with the queue
+		OrderedJobQueue<TestJob> queue(3, [](TestJob& job) {
+			std::this_thread::sleep_for(std::chrono::microseconds(job.delay));
+		});
+		for (int i = 0; i < 50; ++i) {
+			std::unique_ptr<TestJob> job(new TestJob(i));
+			job->delay = 100;
+			queue.push(std::move(job));
+		}
+		CHECK(queue.pop(true) != nullptr);
+	}
+}
+
+int main() {
+	testOrder(1);
+	testOrder(4);
+	testOrder(16);
+	testFinishedBeforePop();
+	testStopWithQueuedJobs();
+	return test::failures() == 0 ? 0 : 1;
+}
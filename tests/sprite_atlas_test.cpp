@@ -0,0 +1,229 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "sprite_atlas.h"
+
+// The atlas only records what it would upload, these stand in for the driver
+namespace gl {
+	const GLint max_texture_size = 4 * SpriteAtlas::SLOT_SIZE; // 4x4 slots per page
+	std::vector<GLuint> created;
+	std::vector<GLuint> deleted;
+	GLuint bound = 0;
+	std::vector<uint8_t> upload;
+}
+
+extern "C" {
+	void APIENTRY glGetIntegerv(GLenum name, GLint* value) {
+		if (name == GL_MAX_TEXTURE_SIZE) {
+			*value = gl::max_texture_size;
+		}
+	}
+	void APIENTRY glBindTexture(GLenum, GLuint texture) {
+		gl::bound = texture;
+	}
+	void APIENTRY glDeleteTextures(GLsizei count, const GLuint* textures) {
+		gl::deleted.insert(gl::deleted.end(), textures, textures + count);
+	}
+	void APIENTRY glTexParameteri(GLenum, GLenum, GLint) { }
+	void APIENTRY glTexImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum, GLenum, const GLvoid*) {
+		CHECK(width == gl::max_texture_size && height == gl::max_texture_size);
+		gl::created.push_back(gl::bound);
+	}
+	void APIENTRY glTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum, GLenum, const GLvoid* pixels) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(pixels);
+		gl::upload.assign(bytes, bytes + width * height * 4);
+	}
+	void APIENTRY glEnableClientState(GLenum) { }
+	void APIENTRY glDisableClientState(GLenum) { }
+	void APIENTRY glVertexPointer(GLint, GLenum, GLsizei, const GLvoid*) { }
+	void APIENTRY glTexCoordPointer(GLint, GLenum, GLsizei, const GLvoid*) { }
+	void APIENTRY glColorPointer(GLint, GLenum, GLsizei, const GLvoid*) { }
+	void APIENTRY glDrawArrays(GLenum, GLint, GLsizei) { }
+}
+
+namespace {
+	const int SLOTS_PER_PAGE = 16;
+	const size_t PAGE_BYTES = size_t(gl::max_texture_size) * gl::max_texture_size * 4;
+
+	GLuint next_texture = 100;
+	GLuint allocateTexture() {
+		return next_texture++;
+	}
+
+	std::vector<uint8_t> makeSprite(uint8_t seed) {
+		std::vector<uint8_t> rgba(SPRITE_PIXELS * SPRITE_PIXELS * 4);
+		for (size_t i = 0; i < rgba.size(); ++i) {
+			rgba[i] = uint8_t(seed + i * 7);
+		}
+		return rgba;
+	}
+
+	// Fills the atlas with sprites, returns their regions
+	std::vector<SpriteAtlas::Region> fill(SpriteAtlas& atlas, int count) {
+		const std::vector<uint8_t> rgba = makeSprite(1);
+		std::vector<SpriteAtlas::Region> regions(count);
+		for (SpriteAtlas::Region& region : regions) {
+			SpriteTexture texture;
+			CHECK(atlas.insert(region, rgba.data(), texture));
+		}
+		return regions;
+	}
+
+	void testPages() {
+		SpriteAtlas atlas(&allocateTexture);
+		atlas.setMaxBytes(2 * PAGE_BYTES);
+		CHECK(atlas.getPageCount() == 0);
+		CHECK(atlas.hasRoom());
+
+		// Pages are created as the sprites need them, with textures from the allocator
+		const GLuint first_texture = next_texture;
+		std::vector<SpriteAtlas::Region> regions = fill(atlas, SLOTS_PER_PAGE + 1);
+		CHECK(atlas.getPageCount() == 2);
+		CHECK(atlas.getSpriteCount() == size_t(SLOTS_PER_PAGE + 1));
+		CHECK(atlas.getByteSize() == 2 * PAGE_BYTES);
+		CHECK(gl::created.size() >= 2 && gl::created[gl::created.size() - 2] == first_texture);
+		CHECK(regions.front().page == 0 && regions.back().page == 1);
+		CHECK(regions.front().generation != regions.back().generation);
+
+		SpriteTexture texture;
+		for (const SpriteAtlas::Region& region : regions) {
+			CHECK(atlas.contains(region));
+			CHECK(atlas.find(region, texture));
+		}
+		CHECK(texture.id == first_texture + 1);
+
+		// The last slot of the last page is free
+		fill(atlas, SLOTS_PER_PAGE - 2);
+		CHECK(atlas.hasRoom());
+		fill(atlas, 1);
+		CHECK(!atlas.hasRoom());
+	}
+
+	void testSlots() {
+		SpriteAtlas atlas(&allocateTexture);
+		const std::vector<uint8_t> rgba = makeSprite(3);
+		SpriteAtlas::Region region;
+		SpriteTexture texture;
+		fill(atlas, 5);
+		CHECK(atlas.insert(region, rgba.data(), texture));
+		CHECK(region.slot == 5);
+
+		// Slot 5 is column 1, row 1, the sprite starts one pixel in
+		const float side = float(gl::max_texture_size);
+		CHECK(texture.left == (SpriteAtlas::SLOT_SIZE + 1) / side);
+		CHECK(texture.top == (SpriteAtlas::SLOT_SIZE + 1) / side);
+		CHECK(texture.right == (SpriteAtlas::SLOT_SIZE + 1 + SPRITE_PIXELS) / side);
+		CHECK(texture.bottom == (SpriteAtlas::SLOT_SIZE + 1 + SPRITE_PIXELS) / side);
+
+		// The upload repeats the outer pixels into the gutter
+		const int slot = SpriteAtlas::SLOT_SIZE;
+		CHECK(gl::upload.size() == size_t(slot * slot * 4));
+		auto uploaded = [&](int x, int y) { return &gl::upload[(y * slot + x) * 4]; };
+		auto source = [&](int x, int y) { return &rgba[(y * SPRITE_PIXELS + x) * 4]; };
+		CHECK(memcmp(uploaded(0, 0), source(0, 0), 4) == 0);
+		CHECK(memcmp(uploaded(1, 1), source(0, 0), 4) == 0);
+		CHECK(memcmp(uploaded(5, 0), source(4, 0), 4) == 0);
+		CHECK(memcmp(uploaded(slot - 1, slot - 1), source(SPRITE_PIXELS - 1, SPRITE_PIXELS - 1), 4) == 0);
+		CHECK(memcmp(uploaded(17, 9), source(16, 8), 4) == 0);
+	}
+
+	void testEviction() {
+		SpriteAtlas atlas(&allocateTexture);
+		atlas.setMaxBytes(2 * PAGE_BYTES);
+		std::vector<SpriteAtlas::Region> regions = fill(atlas, 2 * SLOTS_PER_PAGE);
+
+		// Pages used this frame may still be queued for drawing, nothing is evicted
+		const std::vector<uint8_t> rgba = makeSprite(5);
+		SpriteAtlas::Region region;
+		SpriteTexture texture;
+		CHECK(!atlas.insert(region, rgba.data(), texture));
+		CHECK(atlas.getEvictionCount() == 0);
+
+		// Next frame only the second page is used, so the first one is emptied
+		atlas.nextFrame();
+		CHECK(atlas.find(regions.back(), texture));
+		CHECK(atlas.insert(region, rgba.data(), texture));
+		CHECK(region.page == 0 && region.slot == 0);
+		CHECK(atlas.getEvictionCount() == size_t(SLOTS_PER_PAGE));
+		CHECK(atlas.getPageCount() == 2);
+		for (int i = 0; i < SLOTS_PER_PAGE; ++i) {
+			CHECK(!atlas.contains(regions[i]));
+			CHECK(!atlas.find(regions[i], texture));
+			CHECK(atlas.contains(regions[SLOTS_PER_PAGE + i]));
+		}
+		CHECK(atlas.contains(region));
+		CHECK(region.generation != regions.front().generation);
+	}
+
+	void testLimit() {
+		SpriteAtlas atlas(&allocateTexture);
+		atlas.setMaxBytes(3 * PAGE_BYTES);
+		std::vector<SpriteAtlas::Region> regions = fill(atlas, 3 * SLOTS_PER_PAGE);
+		CHECK(atlas.getPageCount() == 3);
+
+		// Pages used this frame stay until the next one
+		const size_t deleted = gl::deleted.size();
+		atlas.setMaxBytes(PAGE_BYTES);
+		CHECK(atlas.getPageCount() == 3);
+
+		atlas.nextFrame();
+		atlas.setMaxBytes(PAGE_BYTES);
+		CHECK(atlas.getPageCount() == 1);
+		CHECK(gl::deleted.size() == deleted + 2);
+		CHECK(atlas.getEvictionCount() == size_t(2 * SLOTS_PER_PAGE));
+		CHECK(atlas.contains(regions.front()));
+		CHECK(!atlas.contains(regions.back()));
+
+		// At least one page is always allowed
+		atlas.nextFrame();
+		atlas.setMaxBytes(0);
+		CHECK(atlas.getPageCount() == 1);
+
+		// And never more than MAX_PAGES
+		atlas.setMaxBytes(size_t(-1) / 2);
+		fill(atlas, int(SpriteAtlas::MAX_PAGES) * SLOTS_PER_PAGE);
+		CHECK(atlas.getPageCount() == SpriteAtlas::MAX_PAGES);
+		CHECK(!atlas.hasRoom());
+	}
+
+	void testGenerations() {
+		SpriteAtlas atlas(&allocateTexture);
+		std::vector<SpriteAtlas::Region> before = fill(atlas, 2);
+
+		// Regions from before a clear never match the new pages, even at the same place
+		const size_t deleted = gl::deleted.size();
+		atlas.clear();
+		CHECK(atlas.getPageCount() == 0);
+		CHECK(gl::deleted.size() == deleted + 1);
+		std::vector<SpriteAtlas::Region> after = fill(atlas, 2);
+		CHECK(after[0].page == before[0].page && after[0].slot == before[0].slot);
+		CHECK(!atlas.contains(before[0]));
+		CHECK(atlas.contains(after[0]));
+
+		// Nor does a region that was never placed
+		CHECK(!atlas.contains(SpriteAtlas::Region()));
+	}
+}
+
+int main() {
+	testPages();
+	testSlots();
+	testEviction();
+	testLimit();
+	testGenerations();
+	return test::failures() == 0 ? 0 : 1;
+}